@@ -0,0 +1,13 @@
+//Fused version of bloom_composite_frag.glsl, $ is replaced with the effect's prefix
+//Code Modified from LearnOpenGL and from previous FLORP engine
+
+uniform sampler2D $BloomTex;
+//Mip chain bloom adds every level together, this brings it back down
+uniform float $BloomScale = 1.0;
+
+vec4 $Apply(vec4 source, vec2 uv)
+{
+	vec4 bloomSource = vec4(texture($BloomTex, uv).rgb * $BloomScale, 1.0);
+
+	return 1.0 - (1.0 - source) * (1.0 - bloomSource);
+}
@@ -0,0 +1,13 @@
+//Fused version of color_correction_frag.glsl, $ is replaced with the effect's prefix
+
+uniform sampler3D $TexColorGrade;
+uniform float $LutSize;
+
+vec4 $Apply(vec4 source, vec2 uv)
+{
+	vec3 scale = vec3(($LutSize - 1.0) / $LutSize);
+	vec3 offset = vec3(1.0 / (2.0 * $LutSize));
+
+	//The LUT expects the 0-1 colour an RGBA8 target would have held
+	return vec4(texture($TexColorGrade, scale * clamp(source.rgb, 0.0, 1.0) + offset).rgb, source.a);
+}
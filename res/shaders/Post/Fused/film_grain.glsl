@@ -0,0 +1,13 @@
+//Fused version of film_grain_frag.glsl, $ is replaced with the effect's prefix
+//Code Modified from shadertoy to work with OTTER: https://www.shadertoy.com/view/4sXSWs
+
+uniform float $Time;
+uniform float $Strength = 16.0;
+
+vec4 $Apply(vec4 source, vec2 uv)
+{
+	float x = (uv.x + 4.0 ) * (uv.y + 4.0 ) * ($Time * 10.0);
+	vec4 grain = vec4(mod((mod(x, 13.0) + 1.0) * (mod(x, 123.0) + 1.0), 0.01)-0.005) * $Strength;
+
+	return source + grain;
+}
@@ -0,0 +1,12 @@
+//Fused version of greyscale_frag.glsl, $ is replaced with the effect's prefix
+
+//Affects how greyscale
+//Lower the number, closer we are to regular
+uniform float $Intensity = 1.0;
+
+vec4 $Apply(vec4 source, vec2 uv)
+{
+	float luminence = 0.2989 * source.r + 0.587 * source.g + 0.114 * source.b;
+
+	return vec4(mix(source.rgb, vec3(luminence), $Intensity), source.a);
+}
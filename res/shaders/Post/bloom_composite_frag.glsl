@@ -7,10 +7,13 @@ out vec4 fragColour;
 layout(binding = 0) uniform sampler2D s_screenTex;
 layout(binding = 1) uniform sampler2D s_bloomTex;
 
+//Mip chain bloom adds every level together, this brings it back down
+uniform float u_BloomScale = 1.0;
+
 void main() 
 {
 	vec4 source = texture(s_screenTex, inUV);
-	vec4 bloomSource = texture(s_bloomTex, inUV);
+	vec4 bloomSource = vec4(texture(s_bloomTex, inUV).rgb * u_BloomScale, 1.0);
 
 	fragColour = 1.0 - (1.0 - source) * (1.0 - bloomSource);
 }
\ No newline at end of file
@@ -0,0 +1,48 @@
+//13 tap downsample from Call of Duty: Advanced Warfare's bloom (Jimenez, SIGGRAPH 2014)
+#version 440
+
+layout(location = 0) in vec2 inUV;
+out vec4 fragColour;
+
+layout(binding = 0) uniform sampler2D s_screenTex;
+
+//Only the first downsample thresholds, the rest just filter
+uniform bool u_Prefilter = false;
+uniform float u_Threshold;
+
+void main()
+{
+	vec2 texel = 1.0 / textureSize(s_screenTex, 0);
+
+	//Four overlapping 2x2 boxes around the centre, plus one in the middle
+	vec3 a = texture(s_screenTex, inUV + texel * vec2(-2.0, -2.0)).rgb;
+	vec3 b = texture(s_screenTex, inUV + texel * vec2( 0.0, -2.0)).rgb;
+	vec3 c = texture(s_screenTex, inUV + texel * vec2( 2.0, -2.0)).rgb;
+	vec3 d = texture(s_screenTex, inUV + texel * vec2(-2.0,  0.0)).rgb;
+	vec3 e = texture(s_screenTex, inUV).rgb;
+	vec3 f = texture(s_screenTex, inUV + texel * vec2( 2.0,  0.0)).rgb;
+	vec3 g = texture(s_screenTex, inUV + texel * vec2(-2.0,  2.0)).rgb;
+	vec3 h = texture(s_screenTex, inUV + texel * vec2( 0.0,  2.0)).rgb;
+	vec3 i = texture(s_screenTex, inUV + texel * vec2( 2.0,  2.0)).rgb;
+	vec3 j = texture(s_screenTex, inUV + texel * vec2(-1.0, -1.0)).rgb;
+	vec3 k = texture(s_screenTex, inUV + texel * vec2( 1.0, -1.0)).rgb;
+	vec3 l = texture(s_screenTex, inUV + texel * vec2(-1.0,  1.0)).rgb;
+	vec3 m = texture(s_screenTex, inUV + texel * vec2( 1.0,  1.0)).rgb;
+
+	vec3 result = e * 0.125;
+	result += (a + c + g + i) * 0.03125;
+	result += (b + d + f + h) * 0.0625;
+	result += (j + k + l + m) * 0.125;
+
+	//Same test bloom_frag.glsl does, on the filtered colour
+	if (u_Prefilter)
+	{
+		float brightness = (result.r + result.g + result.b) / 3.0;
+		if (brightness <= u_Threshold)
+		{
+			result = vec3(0.0);
+		}
+	}
+
+	fragColour = vec4(result, 1.0);
+}
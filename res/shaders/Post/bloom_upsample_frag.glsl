@@ -0,0 +1,28 @@
+//3x3 tent upsample from Call of Duty: Advanced Warfare's bloom (Jimenez, SIGGRAPH 2014)
+//*Gets added on top of the next level up with additive blending
+#version 440
+
+layout(location = 0) in vec2 inUV;
+out vec4 fragColour;
+
+layout(binding = 0) uniform sampler2D s_screenTex;
+
+//How far apart the taps are, in texels of the level being read
+uniform float u_Radius = 1.0;
+
+void main()
+{
+	vec2 texel = u_Radius / textureSize(s_screenTex, 0);
+
+	vec3 result = texture(s_screenTex, inUV).rgb * 4.0;
+	result += texture(s_screenTex, inUV + texel * vec2(-1.0,  0.0)).rgb * 2.0;
+	result += texture(s_screenTex, inUV + texel * vec2( 1.0,  0.0)).rgb * 2.0;
+	result += texture(s_screenTex, inUV + texel * vec2( 0.0, -1.0)).rgb * 2.0;
+	result += texture(s_screenTex, inUV + texel * vec2( 0.0,  1.0)).rgb * 2.0;
+	result += texture(s_screenTex, inUV + texel * vec2(-1.0, -1.0)).rgb;
+	result += texture(s_screenTex, inUV + texel * vec2( 1.0, -1.0)).rgb;
+	result += texture(s_screenTex, inUV + texel * vec2(-1.0,  1.0)).rgb;
+	result += texture(s_screenTex, inUV + texel * vec2( 1.0,  1.0)).rgb;
+
+	fragColour = vec4(result / 16.0, 1.0);
+}
@@ -6,13 +6,15 @@ out vec4 frag_color;
 
 layout (binding = 0) uniform sampler2D u_FinishedFrame;
 layout(binding = 30) uniform sampler3D u_TexColorGrade;
+//Entries along each side of the LUT, .cube files can be anywhere from 2 to 256
+uniform float u_LutSize;
 
 void main()
 {
     vec4 textureColor = texture(u_FinishedFrame, inUV);
 
-    vec3 scale = vec3((64.0 - 1.0) / 64.0);
-    vec3 offset = vec3(1.0 / (2.0 * 64.0));
+    vec3 scale = vec3((u_LutSize - 1.0) / u_LutSize);
+    vec3 offset = vec3(1.0 / (2.0 * u_LutSize));
 
 	frag_color.rgb = texture(u_TexColorGrade, scale * textureColor.rgb + offset).rgb;
 	frag_color.a = textureColor.a;
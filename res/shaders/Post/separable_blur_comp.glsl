@@ -0,0 +1,78 @@
+//Both directions of a separable gaussian in one dispatch, weights come from SeparableBlur
+//*Each group loads its tile plus a RADIUS wide apron into shared memory once, blurs the rows
+// into shared memory, then blurs the columns out of that and writes the tile
+//*Texels are stored as half floats to keep a radius 16 apron inside the 32KB every driver has to give us
+#version 430
+
+//RADIUS is defined by SeparableBlur when it builds the shader
+#ifndef RADIUS
+#define RADIUS 8
+#endif
+
+#define TILE 16
+#define APRON (TILE + 2 * RADIUS)
+
+layout(local_size_x = TILE, local_size_y = TILE) in;
+
+layout(binding = 0) uniform sampler2D s_source;
+layout(binding = 0) writeonly uniform image2D u_Output;
+
+uniform float u_Weights[RADIUS + 1];
+
+shared uvec2 s_input[APRON][APRON];
+shared uvec2 s_rows[APRON][TILE];
+
+uvec2 Pack(vec4 colour)
+{
+	return uvec2(packHalf2x16(colour.rg), packHalf2x16(colour.ba));
+}
+
+vec4 Unpack(uvec2 packed)
+{
+	return vec4(unpackHalf2x16(packed.x), unpackHalf2x16(packed.y));
+}
+
+void main()
+{
+	ivec2 size = textureSize(s_source, 0);
+	ivec2 origin = ivec2(gl_WorkGroupID.xy) * TILE - RADIUS;
+	ivec2 local = ivec2(gl_LocalInvocationID.xy);
+
+	//Tile plus apron, clamped at the edges like GL_CLAMP_TO_EDGE
+	for (int y = local.y; y < APRON; y += TILE)
+	{
+		for (int x = local.x; x < APRON; x += TILE)
+		{
+			ivec2 texel = clamp(origin + ivec2(x, y), ivec2(0), size - 1);
+			s_input[y][x] = Pack(texelFetch(s_source, texel, 0));
+		}
+	}
+	barrier();
+
+	//Rows, for every row the columns will need
+	for (int y = local.y; y < APRON; y += TILE)
+	{
+		int x = local.x + RADIUS;
+		vec4 sum = Unpack(s_input[y][x]) * u_Weights[0];
+		for (int i = 1; i <= RADIUS; i++)
+		{
+			sum += (Unpack(s_input[y][x - i]) + Unpack(s_input[y][x + i])) * u_Weights[i];
+		}
+		s_rows[y][local.x] = Pack(sum);
+	}
+	barrier();
+
+	//Columns
+	int y = local.y + RADIUS;
+	vec4 sum = Unpack(s_rows[y][local.x]) * u_Weights[0];
+	for (int i = 1; i <= RADIUS; i++)
+	{
+		sum += (Unpack(s_rows[y - i][local.x]) + Unpack(s_rows[y + i][local.x])) * u_Weights[i];
+	}
+
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	if (all(lessThan(texel, imageSize(u_Output))))
+	{
+		imageStore(u_Output, texel, vec4(sum.rgb, 1.0));
+	}
+}
@@ -0,0 +1,32 @@
+//One direction of a separable gaussian, weights come from SeparableBlur
+//*Pairs of taps are folded into one linearly filtered fetch, so the source has to be linearly filtered
+#version 440
+
+layout(location = 0) in vec2 inUV;
+out vec4 fragColour;
+
+layout(binding = 0) uniform sampler2D s_screenTex;
+
+//Most folded taps each side (radius 64)
+#define MAX_TAPS 33
+
+//(1, 0) for horizontal, (0, 1) for vertical
+uniform vec2 u_Direction;
+uniform int u_TapCount;
+//Offsets in texels and weights for each folded tap, tap 0 is the centre
+uniform float u_Offsets[MAX_TAPS];
+uniform float u_Weights[MAX_TAPS];
+
+void main() 
+{
+	vec2 texel = u_Direction / textureSize(s_screenTex, 0);
+
+	vec4 result = texture(s_screenTex, inUV) * u_Weights[0];
+	for (int i = 1; i < u_TapCount; i++)
+	{
+		result += texture(s_screenTex, inUV + texel * u_Offsets[i]) * u_Weights[i];
+		result += texture(s_screenTex, inUV - texel * u_Offsets[i]) * u_Weights[i];
+	}
+
+	fragColour = vec4(result.rgb, 1.0);
+}
@@ -36,7 +36,16 @@ uniform sampler2D s_Diffuse2;
 uniform sampler2D s_Specular;
 
 uniform float u_TextureMix;
-uniform vec3  u_CamPos;
+//Camera data, bound once a frame (see BackendHandler::SetFrameUniforms)
+layout(std140, binding = 1) uniform b_Frame
+{
+	mat4 _view;
+	mat4 _projection;
+	mat4 _viewProjection;
+	mat4 _skyboxMatrix;
+	mat4 _lightSpace;
+	vec4 _cameraPosition;
+} u_Frame;
 
 out vec4 frag_color;
 
@@ -69,7 +78,7 @@ void main() {
 	vec3 diffuse = dif * sun._lightCol.xyz;// add diffuse intensity
 
 	// Specular
-	vec3 viewDir  = normalize(u_CamPos - inPos);
+	vec3 viewDir  = normalize(u_Frame._cameraPosition.xyz - inPos);
 	vec3 h        = normalize(lightDir + viewDir);
 
 	// Get the specular power from the specular map
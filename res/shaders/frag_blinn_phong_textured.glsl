@@ -1,4 +1,4 @@
-#version 410
+#version 420
 
 layout(location = 0) in vec3 inPos;
 layout(location = 1) in vec3 inColor;
@@ -25,7 +25,16 @@ uniform float u_LightAttenuationQuadratic;
 
 uniform float u_TextureMix;
 
-uniform vec3  u_CamPos;
+//Camera data, bound once a frame (see BackendHandler::SetFrameUniforms)
+layout(std140, binding = 1) uniform b_Frame
+{
+	mat4 _view;
+	mat4 _projection;
+	mat4 _viewProjection;
+	mat4 _skyboxMatrix;
+	mat4 _lightSpace;
+	vec4 _cameraPosition;
+} u_Frame;
 
 out vec4 frag_color;
 
@@ -49,7 +58,7 @@ void main() {
 		u_LightAttenuationQuadratic * dist * dist);
 
 	// Specular
-	vec3 viewDir  = normalize(u_CamPos - inPos);
+	vec3 viewDir  = normalize(u_Frame._cameraPosition.xyz - inPos);
 	vec3 h        = normalize(lightDir + viewDir);
 
 	// Get the specular power from the specular map
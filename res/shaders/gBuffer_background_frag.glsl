@@ -0,0 +1,14 @@
+#version 420
+
+//Fills in the pixels no geometry was drawn to (clear colour or skybox), they're left unlit
+
+layout (location = 0) in vec2 inUV;
+
+layout (binding = 0) uniform sampler2D s_albedoTex;
+
+out vec4 frag_colour;
+
+void main()
+{
+    frag_colour = vec4(texture(s_albedoTex, inUV).rgb, 1.0);
+}
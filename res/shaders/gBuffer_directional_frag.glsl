@@ -26,7 +26,8 @@ layout (std140, binding = 0) uniform u_Lights
 	DirectionalLight sun;
 };
 
-layout (binding = 30) uniform sampler2D s_ShadowMap;
+//One layer per cascade
+layout (binding = 30) uniform sampler2DArray s_ShadowMap;
 
 layout (binding = 0) uniform sampler2D s_albedoTex;
 layout (binding = 1) uniform sampler2D s_normalsTex;
@@ -35,36 +36,56 @@ layout (binding = 3) uniform sampler2D s_positionTex;
 
 layout (binding = 4) uniform sampler2D s_lightAccumTex;
 
-uniform mat4 u_LightSpaceMatrix;
-uniform vec3 u_CamPos;
+//Cascades, see CascadedShadows::SetUniforms
+uniform mat4 u_LightSpaceMatrices[4];
+uniform vec4 u_CascadeSplits;
+uniform int u_CascadeCount;
+uniform mat4 u_View;
+//Camera data, bound once a frame (see BackendHandler::SetFrameUniforms)
+layout(std140, binding = 1) uniform b_Frame
+{
+	mat4 _view;
+	mat4 _projection;
+	mat4 _viewProjection;
+	mat4 _skyboxMatrix;
+	mat4 _lightSpace;
+	vec4 _cameraPosition;
+} u_Frame;
 
 out vec4 frag_colour;
 
-float ShadowCalculation(vec4 fragPosLightSpace, float bias)
+//Picks the cascade this position falls in and does 3x3 PCF in it (see CascadedShadows.h)
+float ShadowCalculation(vec3 fragPos)
 {
-	//Perspective division
-	vec3 projectionCoordinates = fragPosLightSpace.xyz / fragPosLightSpace.w;
-	
-	//Transform into a [0,1] range
-	projectionCoordinates = projectionCoordinates * 0.5 + 0.5;
-	
-	//Get the closest depth value from light's perspective (using our 0-1 range)
-	float closestDepth = texture(s_ShadowMap, projectionCoordinates.xy).r;
+	//Past the last cascade, nothing is shadowed
+	float viewDepth = -(u_View * vec4(fragPos, 1.0)).z;
+	if (viewDepth > u_CascadeSplits[u_CascadeCount - 1])
+	{
+		return 0.0;
+	}
+
+	int cascade = 0;
+	while (cascade < u_CascadeCount - 1 && viewDepth > u_CascadeSplits[cascade])
+	{
+		cascade++;
+	}
+
+	vec4 fragPosLightSpace = u_LightSpaceMatrices[cascade] * vec4(fragPos, 1.0);
+
+	//Transform into a [0,1] range (orthographic, so no perspective division)
+	vec3 projectionCoordinates = fragPosLightSpace.xyz * 0.5 + 0.5;
 
 	//Get the current depth according to the light
 	float currentDepth = projectionCoordinates.z;
 
-	//Check whether there's a shadow
-	//float shadow = currentDepth - bias > closestDepth ? 1.0 : 0.0;
-
 	//PCF
 	float shadow = 0.0;
-	vec2 texelSize = 1.0 / textureSize(s_ShadowMap, 0);
+	vec2 texelSize = 1.0 / vec2(textureSize(s_ShadowMap, 0).xy);
 	for(int i = -1; i <= 1; i++)
 	{
 	    for(int j = -1; j <= 1; j++)
 	    {
-	        float pcfDepth = texture(s_ShadowMap, projectionCoordinates.xy + vec2(i, j) * texelSize).r; 
+	        float pcfDepth = texture(s_ShadowMap, vec3(projectionCoordinates.xy + vec2(i, j) * texelSize, float(cascade))).r; 
 	        shadow += currentDepth - sun._shadowBias > pcfDepth ? 1.0 : 0.0;        
 	    }    
 	}
@@ -80,9 +101,8 @@ float ShadowCalculation(vec4 fragPosLightSpace, float bias)
 }
 
 // https://learnopengl.com/Advanced-Lighting/Advanced-Lighting
+//*Only runs where the Gbuffer's stencil was marked, the background keeps the light accumulation's white clear
 void main() {
-    //Albedo
-    vec4 textureColour = texture(s_albedoTex, inUV);
     //Normals 
     vec3 inNormal = (normalize(texture(s_normalsTex, inUV).rgb) * 2.0) - 1.0;
     //Specular
@@ -97,24 +117,18 @@ void main() {
     vec3 diffuse = sun._lightCol.xyz * dif; // add diffuse intensity
 
 	// Specular
-	vec3 viewDir  = normalize(u_CamPos - fragPos);
+	vec3 viewDir  = normalize(u_Frame._cameraPosition.xyz - fragPos);
 	vec3 h        = normalize(lightDir + viewDir);
 
 	float spec = pow(max(dot(N, h), 0.0), 4.0); // Shininess coefficient (can be a uniform)
 	vec3 specular = sun._lightSpecularPow * texSpec * spec * sun._lightCol.xyz; // Can also use a specular color
 
-    vec4 fragPosLightSpace = u_LightSpaceMatrix * vec4(fragPos, 1.0);
-	float shadow = ShadowCalculation(fragPosLightSpace, sun._shadowBias);
+	float shadow = ShadowCalculation(fragPos);
 
 	vec3 result = (
 		(sun._ambientPow * sun._ambientCol.xyz) + // global ambient light
 		(1.0 - shadow) * //Shadow value
 		(diffuse + specular)); // Object color
 
-    if (textureColour.a < 0.31)
-    {
-        result = vec3(1.0, 1.0, 1.0);
-    }
-
 	frag_colour = vec4(result, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,98 @@
+#version 430
+
+//One point light, drawn as its bounding volume (see light_volume_vert.glsl) and added on top of the light accumulation
+//*Works with either Gbuffer layout, u_Packed says which one is bound
+
+layout(location = 0) flat in int inLight;
+
+struct PointLight
+{
+	//Position in xyz, radius in w
+	vec4 _positionRadius;
+	//Colour in rgb, intensity in a
+	vec4 _colour;
+};
+
+layout (std430, binding = 1) readonly buffer b_Lights
+{
+	PointLight lights[];
+};
+
+//Albedo in RGB (specular in A when packed)
+layout (binding = 0) uniform sampler2D s_albedoTex;
+layout (binding = 1) uniform sampler2D s_normalsTex;
+layout (binding = 2) uniform sampler2D s_specularTex;
+//Positions, or depth when packed
+layout (binding = 3) uniform sampler2D s_positionTex;
+
+uniform bool u_Packed;
+uniform mat4 u_InverseViewProjection;
+//Camera data, bound once a frame (see BackendHandler::SetFrameUniforms)
+layout(std140, binding = 1) uniform b_Frame
+{
+	mat4 _view;
+	mat4 _projection;
+	mat4 _viewProjection;
+	mat4 _skyboxMatrix;
+	mat4 _lightSpace;
+	vec4 _cameraPosition;
+} u_Frame;
+uniform vec2 u_ScreenSize;
+
+out vec4 frag_colour;
+
+//[0, 1] octahedral coordinates -> unit vector
+vec3 DecodeNormal(vec2 encoded)
+{
+    encoded = encoded * 2.0 - 1.0;
+    vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+//Depth and screen position back to world space
+vec3 ReconstructPosition(vec2 uv, float depth)
+{
+    vec4 clip = vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    vec4 world = u_InverseViewProjection * clip;
+    return world.xyz / world.w;
+}
+
+void main() {
+    vec2 uv = gl_FragCoord.xy / u_ScreenSize;
+
+    PointLight light = lights[inLight];
+    vec3 fragPos = u_Packed ? ReconstructPosition(uv, texture(s_positionTex, uv).r) : texture(s_positionTex, uv).rgb;
+
+    //Geometry in front of the volume still gets here, it's just out of range
+    vec3 toLight = light._positionRadius.xyz - fragPos;
+    float dist = length(toLight);
+    if (dist >= light._positionRadius.w)
+        discard;
+
+    vec3 N;
+    float texSpec;
+    if (u_Packed)
+    {
+        N = DecodeNormal(texture(s_normalsTex, uv).rg);
+        texSpec = texture(s_albedoTex, uv).a;
+    }
+    else
+    {
+        N = normalize(texture(s_normalsTex, uv).rgb * 2.0 - 1.0);
+        texSpec = texture(s_specularTex, uv).r;
+    }
+
+    //Inverse square, windowed so it hits zero at the radius
+    float window = clamp(1.0 - pow(dist / light._positionRadius.w, 4.0), 0.0, 1.0);
+    float attenuation = window * window / (dist * dist + 1.0);
+
+    vec3 lightDir = toLight / max(dist, 1e-4);
+    vec3 viewDir = normalize(u_Frame._cameraPosition.xyz - fragPos);
+    float dif = max(dot(N, lightDir), 0.0);
+    vec3 h = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(N, h), 0.0), 4.0) * texSpec;
+
+    frag_colour = vec4((dif + spec) * light._colour.rgb * light._colour.a * attenuation, 1.0);
+}
@@ -0,0 +1,49 @@
+#version 420
+
+//Unpacks one part of the packed Gbuffer layout so it can be looked at (see GBuffer::DrawBuffersToScreen)
+
+layout(location = 0) in vec2 inUV;
+
+out vec4 frag_color;
+
+layout (binding = 0) uniform sampler2D s_albedoSpecTex;
+layout (binding = 1) uniform sampler2D s_normalsTex;
+layout (binding = 3) uniform sampler2D s_depthTex;
+
+//Which part to show, matches the Target enum (albedo, normal, specular, position)
+uniform int u_Target;
+uniform mat4 u_InverseViewProjection;
+
+vec3 DecodeNormal(vec2 encoded)
+{
+	encoded = encoded * 2.0 - 1.0;
+	vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float t = clamp(-n.z, 0.0, 1.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
+
+void main() 
+{
+	vec4 albedoSpec = texture(s_albedoSpecTex, inUV);
+
+	if (u_Target == 0)
+	{
+		frag_color = vec4(albedoSpec.rgb, 1.0);
+	}
+	else if (u_Target == 1)
+	{
+		//Shown the way the old layout stored them
+		frag_color = vec4(DecodeNormal(texture(s_normalsTex, inUV).rg) * 0.5 + 0.5, 1.0);
+	}
+	else if (u_Target == 2)
+	{
+		frag_color = vec4(vec3(albedoSpec.a), 1.0);
+	}
+	else
+	{
+		float depth = texture(s_depthTex, inUV).r;
+		vec4 world = u_InverseViewProjection * vec4(vec3(inUV, depth) * 2.0 - 1.0, 1.0);
+		frag_color = vec4(world.xyz / world.w, 1.0);
+	}
+}
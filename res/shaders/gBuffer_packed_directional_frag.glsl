@@ -0,0 +1,157 @@
+#version 420
+
+//Directional light for the packed Gbuffer layout (see gBuffer_packed_pass_frag.glsl)
+
+layout(location = 0) in vec2 inUV;
+
+struct DirectionalLight
+{
+	//Light direction (defaults to down, to the left, and a little forward)
+	vec4 _lightDirection;
+
+	//Generic Light controls
+	vec4 _lightCol;
+
+	//Ambience controls
+	vec4 _ambientCol;
+	float _ambientPow;
+	
+	//Power controls
+	float _lightAmbientPow;
+	float _lightSpecularPow;
+	
+	float _shadowBias;
+};
+
+layout (std140, binding = 0) uniform u_Lights
+{
+	DirectionalLight sun;
+};
+
+//One layer per cascade
+layout (binding = 30) uniform sampler2DArray s_ShadowMap;
+
+//Albedo in RGB, specular in A
+layout (binding = 0) uniform sampler2D s_albedoSpecTex;
+layout (binding = 1) uniform sampler2D s_normalsTex;
+layout (binding = 3) uniform sampler2D s_depthTex;
+
+//Cascades, see CascadedShadows::SetUniforms
+uniform mat4 u_LightSpaceMatrices[4];
+uniform vec4 u_CascadeSplits;
+uniform int u_CascadeCount;
+uniform mat4 u_View;
+uniform mat4 u_InverseViewProjection;
+//Camera data, bound once a frame (see BackendHandler::SetFrameUniforms)
+layout(std140, binding = 1) uniform b_Frame
+{
+	mat4 _view;
+	mat4 _projection;
+	mat4 _viewProjection;
+	mat4 _skyboxMatrix;
+	mat4 _lightSpace;
+	vec4 _cameraPosition;
+} u_Frame;
+
+out vec4 frag_colour;
+
+//Picks the cascade this position falls in and does 3x3 PCF in it (see CascadedShadows.h)
+float ShadowCalculation(vec3 fragPos)
+{
+	//Past the last cascade, nothing is shadowed
+	float viewDepth = -(u_View * vec4(fragPos, 1.0)).z;
+	if (viewDepth > u_CascadeSplits[u_CascadeCount - 1])
+	{
+		return 0.0;
+	}
+
+	int cascade = 0;
+	while (cascade < u_CascadeCount - 1 && viewDepth > u_CascadeSplits[cascade])
+	{
+		cascade++;
+	}
+
+	vec4 fragPosLightSpace = u_LightSpaceMatrices[cascade] * vec4(fragPos, 1.0);
+
+	//Transform into a [0,1] range (orthographic, so no perspective division)
+	vec3 projectionCoordinates = fragPosLightSpace.xyz * 0.5 + 0.5;
+
+	//Get the current depth according to the light
+	float currentDepth = projectionCoordinates.z;
+
+	//PCF
+	float shadow = 0.0;
+	vec2 texelSize = 1.0 / vec2(textureSize(s_ShadowMap, 0).xy);
+	for(int i = -1; i <= 1; i++)
+	{
+	    for(int j = -1; j <= 1; j++)
+	    {
+	        float pcfDepth = texture(s_ShadowMap, vec3(projectionCoordinates.xy + vec2(i, j) * texelSize, float(cascade))).r; 
+	        shadow += currentDepth - sun._shadowBias > pcfDepth ? 1.0 : 0.0;        
+	    }    
+	}
+	shadow /= 9.0;
+
+	if (projectionCoordinates.z > 1.0)
+	{
+		shadow = 0.0;
+	}
+
+	//Return the value
+	return shadow;
+}
+
+//[0, 1] octahedral coordinates -> unit vector
+vec3 DecodeNormal(vec2 encoded)
+{
+    encoded = encoded * 2.0 - 1.0;
+    vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+//Depth and screen position back to world space
+vec3 ReconstructPosition(vec2 uv, float depth)
+{
+    vec4 clip = vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    vec4 world = u_InverseViewProjection * clip;
+    return world.xyz / world.w;
+}
+
+// https://learnopengl.com/Advanced-Lighting/Advanced-Lighting
+void main() {
+    //Only runs where the Gbuffer's stencil was marked, so there's always geometry here
+    float depth = texture(s_depthTex, inUV).r;
+
+    //Albedo and specular
+    vec4 albedoSpec = texture(s_albedoSpecTex, inUV);
+    //Normals 
+    vec3 inNormal = DecodeNormal(texture(s_normalsTex, inUV).rg);
+    //Specular
+    float texSpec = albedoSpec.a;
+    //Positions
+    vec3 fragPos = ReconstructPosition(inUV, depth);
+
+	// Diffuse
+	vec3 N = normalize(inNormal);
+	vec3 lightDir = normalize(-sun._lightDirection.xyz);
+	float dif = max(dot(N, lightDir), 0.0);
+    vec3 diffuse = sun._lightCol.xyz * dif; // add diffuse intensity
+
+	// Specular
+	vec3 viewDir  = normalize(u_Frame._cameraPosition.xyz - fragPos);
+	vec3 h        = normalize(lightDir + viewDir);
+
+	float spec = pow(max(dot(N, h), 0.0), 4.0); // Shininess coefficient (can be a uniform)
+	vec3 specular = sun._lightSpecularPow * texSpec * spec * sun._lightCol.xyz; // Can also use a specular color
+
+	float shadow = ShadowCalculation(fragPos);
+
+	vec3 result = (
+		(sun._ambientPow * sun._ambientCol.xyz) + // global ambient light
+		(1.0 - shadow) * //Shadow value
+		(diffuse + specular)); // Object color
+
+	frag_colour = vec4(result, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#version 420
+
+//Packed Gbuffer layout (see GBufferLayout::Packed)
+//*Albedo in RGB with specular in alpha, octahedral normals in RG16, positions come back from depth
+
+//Data for this model
+layout(location = 0) in vec3 inPos;
+layout(location = 1) in vec3 inColour;
+layout(location = 2) in vec3 inNormal;
+layout(location = 3) in vec2 inUV;
+layout(location = 5) flat in uint inAlbedoIndex;
+
+//The albedo textures
+uniform sampler2D s_Diffuse;
+uniform sampler2D s_Diffuse2;
+uniform sampler2D s_Specular;
+uniform float u_textureMix;
+
+//Instanced materials can swap the diffuse for a layer of an array, picked per instance (see InstanceBatcher)
+layout(binding = 15) uniform sampler2DArray s_DiffuseArray;
+uniform bool u_UseDiffuseArray;
+
+//MULTI RENDER TARGET
+layout(location = 0) out vec4 outColourSpec;
+layout(location = 1) out vec2 outNormals;
+
+//Folds the bottom half of the octahedron over the top
+vec2 OctWrap(vec2 v)
+{
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+//Unit vector -> [0, 1] octahedral coordinates
+vec2 EncodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    n.xy = n.z >= 0.0 ? n.xy : OctWrap(n.xy);
+    return n.xy * 0.5 + 0.5;
+}
+
+void main()
+{
+    //Get the albedo from the diffuse / albedo map
+    vec4 textureColour1 = u_UseDiffuseArray ? texture(s_DiffuseArray, vec3(inUV, float(inAlbedoIndex))) : texture(s_Diffuse, inUV);
+    vec4 textureColour2 = texture(s_Diffuse2, inUV);
+    vec4 textureColour = mix(textureColour1, textureColour2, u_textureMix);
+
+    //Lighting only ever uses the red channel of the specular map
+    outColourSpec = vec4(textureColour.rgb, texture(s_Specular, inUV).r);
+
+    outNormals = EncodeNormal(normalize(inNormal));
+}
@@ -5,6 +5,7 @@ layout(location = 0) in vec3 inPos;
 layout(location = 1) in vec3 inColour;
 layout(location = 2) in vec3 inNormal;
 layout(location = 3) in vec2 inUV;
+layout(location = 5) flat in uint inAlbedoIndex;
 
 //The albedo textures
 uniform sampler2D s_Diffuse;
@@ -12,6 +13,10 @@ uniform sampler2D s_Diffuse2;
 uniform sampler2D s_Specular;
 uniform float u_textureMix;
 
+//Instanced materials can swap the diffuse for a layer of an array, picked per instance (see InstanceBatcher)
+layout(binding = 15) uniform sampler2DArray s_DiffuseArray;
+uniform bool u_UseDiffuseArray;
+
 //MULTI RENDER TARGET
 //We can render colour to all of these
 layout(location = 0) out vec4 outColours;
@@ -22,7 +27,7 @@ layout(location = 3) out vec3 outPositions;
 void main()
 {
     //Get the albedo from the diffuse / albedo map
-    vec4 textureColour1 = texture(s_Diffuse, inUV);
+    vec4 textureColour1 = u_UseDiffuseArray ? texture(s_DiffuseArray, vec3(inUV, float(inAlbedoIndex))) : texture(s_Diffuse, inUV);
     vec4 textureColour2 = texture(s_Diffuse2, inUV);
     vec4 textureColour = mix(textureColour1, textureColour2, u_textureMix);
 
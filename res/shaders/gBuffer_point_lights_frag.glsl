@@ -0,0 +1,126 @@
+#version 430
+
+//Clustered point lights, added on top of the light accumulation (see ClusteredLights.h)
+//*Works with either Gbuffer layout, u_Packed says which one is bound
+
+layout(location = 0) in vec2 inUV;
+
+struct PointLight
+{
+	//Position in xyz, radius in w
+	vec4 _positionRadius;
+	//Colour in rgb, intensity in a
+	vec4 _colour;
+};
+
+layout (std430, binding = 1) readonly buffer b_Lights
+{
+	PointLight lights[];
+};
+
+//Offset and count into the index list, per cluster
+layout (std430, binding = 2) readonly buffer b_Clusters
+{
+	uvec2 clusters[];
+};
+
+layout (std430, binding = 3) readonly buffer b_LightIndices
+{
+	uint lightIndices[];
+};
+
+//Albedo in RGB (specular in A when packed)
+layout (binding = 0) uniform sampler2D s_albedoTex;
+layout (binding = 1) uniform sampler2D s_normalsTex;
+layout (binding = 2) uniform sampler2D s_specularTex;
+//Positions, or depth when packed
+layout (binding = 3) uniform sampler2D s_positionTex;
+
+uniform bool u_Packed;
+uniform mat4 u_InverseViewProjection;
+uniform mat4 u_View;
+//Camera data, bound once a frame (see BackendHandler::SetFrameUniforms)
+layout(std140, binding = 1) uniform b_Frame
+{
+	mat4 _view;
+	mat4 _projection;
+	mat4 _viewProjection;
+	mat4 _skyboxMatrix;
+	mat4 _lightSpace;
+	vec4 _cameraPosition;
+} u_Frame;
+
+//Matches ClusteredLights::TILES_X, TILES_Y and SLICES
+uniform ivec3 u_ClusterCounts;
+uniform vec2 u_ScreenSize;
+//slice = log(view depth) * x + y
+uniform vec2 u_SliceScaleBias;
+
+out vec4 frag_colour;
+
+//[0, 1] octahedral coordinates -> unit vector
+vec3 DecodeNormal(vec2 encoded)
+{
+    encoded = encoded * 2.0 - 1.0;
+    vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+//Depth and screen position back to world space
+vec3 ReconstructPosition(vec2 uv, float depth)
+{
+    vec4 clip = vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    vec4 world = u_InverseViewProjection * clip;
+    return world.xyz / world.w;
+}
+
+void main() {
+    vec3 fragPos;
+    vec3 N;
+    float texSpec;
+    if (u_Packed)
+    {
+        fragPos = ReconstructPosition(inUV, texture(s_positionTex, inUV).r);
+        N = DecodeNormal(texture(s_normalsTex, inUV).rg);
+        texSpec = texture(s_albedoTex, inUV).a;
+    }
+    else
+    {
+        fragPos = texture(s_positionTex, inUV).rgb;
+        N = normalize(texture(s_normalsTex, inUV).rgb * 2.0 - 1.0);
+        texSpec = texture(s_specularTex, inUV).r;
+    }
+
+    //Find which cluster this pixel is in
+    float viewDepth = -(u_View * vec4(fragPos, 1.0)).z;
+    ivec2 tile = ivec2(gl_FragCoord.xy / u_ScreenSize * vec2(u_ClusterCounts.xy));
+    int slice = int(floor(log(max(viewDepth, 1e-4)) * u_SliceScaleBias.x + u_SliceScaleBias.y));
+    ivec3 cluster = clamp(ivec3(tile, slice), ivec3(0), u_ClusterCounts - 1);
+    uvec2 range = clusters[(cluster.z * u_ClusterCounts.y + cluster.y) * u_ClusterCounts.x + cluster.x];
+
+    vec3 viewDir = normalize(u_Frame._cameraPosition.xyz - fragPos);
+    vec3 result = vec3(0.0);
+    for (uint i = 0; i < range.y; i++)
+    {
+        PointLight light = lights[lightIndices[range.x + i]];
+        vec3 toLight = light._positionRadius.xyz - fragPos;
+        float dist = length(toLight);
+        if (dist >= light._positionRadius.w)
+            continue;
+
+        //Inverse square, windowed so it hits zero at the radius and the cluster bounds hold
+        float window = clamp(1.0 - pow(dist / light._positionRadius.w, 4.0), 0.0, 1.0);
+        float attenuation = window * window / (dist * dist + 1.0);
+
+        vec3 lightDir = toLight / max(dist, 1e-4);
+        float dif = max(dot(N, lightDir), 0.0);
+        vec3 h = normalize(lightDir + viewDir);
+        float spec = pow(max(dot(N, h), 0.0), 4.0) * texSpec;
+
+        result += (dif + spec) * light._colour.rgb * light._colour.a * attenuation;
+    }
+
+    frag_colour = vec4(result, 1.0);
+}
@@ -0,0 +1,187 @@
+#version 430
+
+//Culls every object and writes its draw command (see GpuDrivenRenderer.h)
+//*Frustum test on the object's bounding sphere, then its box is tested against last frame's depth pyramid
+//*The LOD level is picked the same way LODComponent::SelectLevel does it
+//*Culled objects still get a command with zero instances, so each batch's commands stay where the CPU expects them
+
+layout(local_size_x = 64) in;
+
+struct GpuObject
+{
+    mat4 _model;
+    mat4 _normalMatrix;
+    uint _mesh;
+    uint _flags;
+    uint _albedoIndex;
+    uint _padding;
+};
+
+struct GpuMeshLevel
+{
+    uint _firstIndex;
+    uint _indexCount;
+    int _baseVertex;
+    float _error;
+};
+
+struct GpuMesh
+{
+    //Object space bounding sphere, radius in w
+    vec4 _sphere;
+    GpuMeshLevel _levels[4];
+    uint _levelCount;
+    uint _padding0;
+    uint _padding1;
+    uint _padding2;
+};
+
+struct DrawCommand
+{
+    uint _count;
+    uint _instanceCount;
+    uint _firstIndex;
+    int _baseVertex;
+    uint _baseInstance;
+};
+
+layout (std430, binding = 4) readonly buffer b_Objects
+{
+    GpuObject objects[];
+};
+
+layout (std430, binding = 5) readonly buffer b_Meshes
+{
+    GpuMesh meshes[];
+};
+
+layout (std430, binding = 6) writeonly buffer b_Commands
+{
+    DrawCommand commands[];
+};
+
+//Furthest depth pyramid of last frame
+layout (binding = 0) uniform sampler2D s_HiZ;
+
+uniform int u_ObjectCount;
+//Where this pass' commands start
+uniform int u_CommandOffset;
+//Objects are only drawn if (flags & mask) == value
+uniform int u_FlagMask;
+uniform int u_FlagValue;
+//Normals point inwards
+uniform vec4 u_Planes[6];
+
+uniform bool u_Occlusion;
+uniform mat4 u_HiZViewProjection;
+uniform vec2 u_HiZSize;
+uniform int u_HiZLevels;
+
+//The pass' LODView
+uniform vec3 u_CameraPosition;
+uniform float u_ProjectionScale;
+uniform bool u_Orthographic;
+uniform float u_HalfScreenHeight;
+uniform float u_AllowedError;
+
+bool InsideFrustum(vec3 centre, float radius)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        if (dot(u_Planes[i].xyz, centre) + u_Planes[i].w < -radius)
+            return false;
+    }
+    return true;
+}
+
+//True if the sphere's box is behind everything in last frame's depth where it lands on screen
+bool Occluded(vec3 centre, float radius)
+{
+    vec3 rectMin = vec3(1.0);
+    vec3 rectMax = vec3(0.0);
+    for (int i = 0; i < 8; i++)
+    {
+        vec3 corner = centre + radius * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = u_HiZViewProjection * vec4(corner, 1.0);
+        //Crosses the near plane, so it's right in front of the camera
+        if (clip.w <= 1e-5 || clip.z < -clip.w)
+            return false;
+        vec3 screen = clip.xyz / clip.w * 0.5 + 0.5;
+        rectMin = min(rectMin, screen);
+        rectMax = max(rectMax, screen);
+    }
+    rectMin.xy = clamp(rectMin.xy, 0.0, 1.0);
+    rectMax.xy = clamp(rectMax.xy, 0.0, 1.0);
+
+    //The level where the rectangle is at most one texel across, so it touches at most 2x2 texels
+    vec2 size = (rectMax.xy - rectMin.xy) * u_HiZSize;
+    int level = clamp(int(ceil(log2(max(max(size.x, size.y), 1.0)))), 0, u_HiZLevels - 1);
+    ivec2 levelSize = textureSize(s_HiZ, level);
+    ivec2 texelMin = clamp(ivec2(rectMin.xy * vec2(levelSize)), ivec2(0), levelSize - 1);
+    ivec2 texelMax = clamp(ivec2(rectMax.xy * vec2(levelSize)), texelMin, min(texelMin + 1, levelSize - 1));
+
+    float furthest = 0.0;
+    for (int y = texelMin.y; y <= texelMax.y; y++)
+    {
+        for (int x = texelMin.x; x <= texelMax.x; x++)
+        {
+            furthest = max(furthest, texelFetch(s_HiZ, ivec2(x, y), level).r);
+        }
+    }
+    return rectMin.z > furthest;
+}
+
+uint SelectLevel(GpuMesh mesh, vec3 centre, float radius)
+{
+    if (mesh._levelCount < 2)
+        return 0;
+
+    float screenRadius = radius * u_ProjectionScale * u_HalfScreenHeight;
+    if (!u_Orthographic)
+    {
+        float dist = length(centre - u_CameraPosition);
+        if (dist <= radius)
+            return 0;
+        screenRadius /= dist;
+    }
+
+    uint level = 0;
+    for (uint i = 1; i < mesh._levelCount; i++)
+    {
+        if (mesh._levels[i]._error * screenRadius > u_AllowedError)
+            break;
+        level = i;
+    }
+    return level;
+}
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= uint(u_ObjectCount))
+        return;
+
+    GpuObject object = objects[index];
+    GpuMesh mesh = meshes[object._mesh];
+
+    //Bounding sphere in world space, scaled by the biggest axis scale
+    vec3 centre = (object._model * vec4(mesh._sphere.xyz, 1.0)).xyz;
+    float scale = max(length(object._model[0].xyz), max(length(object._model[1].xyz), length(object._model[2].xyz)));
+    float radius = mesh._sphere.w * scale;
+
+    bool visible = (object._flags & uint(u_FlagMask)) == uint(u_FlagValue) && InsideFrustum(centre, radius);
+    if (visible && u_Occlusion)
+    {
+        visible = !Occluded(centre, radius);
+    }
+
+    GpuMeshLevel level = mesh._levels[SelectLevel(mesh, centre, radius)];
+    DrawCommand command;
+    command._count = level._indexCount;
+    command._instanceCount = visible ? 1 : 0;
+    command._firstIndex = level._firstIndex;
+    command._baseVertex = level._baseVertex;
+    //The vertex shader gets this back as its object id
+    command._baseInstance = index;
+    commands[u_CommandOffset + int(index)] = command;
+}
@@ -0,0 +1,47 @@
+#version 430
+
+//Builds one level of a furthest depth pyramid (see GpuDrivenRenderer::BuildHiZ)
+//*Level 0 copies the depth buffer, every level after keeps the furthest of the texels it covers
+//*Odd sized levels fold their last row and column into the texel next to them, so nothing is skipped
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+//The depth buffer for level 0, the pyramid itself after that
+layout (binding = 0) uniform sampler2D s_Source;
+layout (binding = 0, r32f) writeonly uniform image2D u_Output;
+
+uniform int u_SourceLevel;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 outputSize = imageSize(u_Output);
+    if (any(greaterThanEqual(texel, outputSize)))
+        return;
+
+    ivec2 sourceSize = textureSize(s_Source, u_SourceLevel);
+    //Same size means this is the copy from the depth buffer
+    if (sourceSize == outputSize)
+    {
+        imageStore(u_Output, texel, vec4(texelFetch(s_Source, texel, u_SourceLevel).r));
+        return;
+    }
+
+    //Texels this one covers, the last row and column pick up the odd one out
+    ivec2 first = texel * 2;
+    ivec2 last = min(first + 1, sourceSize - 1);
+    if (texel.x == outputSize.x - 1)
+        last.x = sourceSize.x - 1;
+    if (texel.y == outputSize.y - 1)
+        last.y = sourceSize.y - 1;
+
+    float furthest = 0.0;
+    for (int y = first.y; y <= last.y; y++)
+    {
+        for (int x = first.x; x <= last.x; x++)
+        {
+            furthest = max(furthest, texelFetch(s_Source, ivec2(x, y), u_SourceLevel).r);
+        }
+    }
+    imageStore(u_Output, texel, vec4(furthest));
+}
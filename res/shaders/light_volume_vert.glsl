@@ -0,0 +1,50 @@
+#version 430
+
+//Bounding sphere around a point light, one instance per light (see ClusteredLights.h)
+//*The sphere is built from gl_VertexID so nothing needs to be bound, draw STACKS * SLICES * 6 vertices
+
+struct PointLight
+{
+	//Position in xyz, radius in w
+	vec4 _positionRadius;
+	//Colour in rgb, intensity in a
+	vec4 _colour;
+};
+
+layout (std430, binding = 1) readonly buffer b_Lights
+{
+	PointLight lights[];
+};
+
+uniform mat4 u_ViewProjection;
+
+layout(location = 0) flat out int outLight;
+
+//Redeclared so this can be used as a separable stage in a program pipeline
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+const int STACKS = 8;
+const int SLICES = 12;
+const float PI = 3.14159265;
+//Pushes the faces out so the whole sphere is inside them, not just the corners
+const float CIRCUMSCRIBE = 1.0 / (cos(PI / float(STACKS * 2)) * cos(PI / float(SLICES)));
+
+//Two counter clockwise triangles per quad, looking from outside
+const ivec2 CORNERS[6] = ivec2[](ivec2(0, 0), ivec2(1, 1), ivec2(1, 0), ivec2(0, 0), ivec2(0, 1), ivec2(1, 1));
+
+void main()
+{
+    int quad = gl_VertexID / 6;
+    ivec2 corner = ivec2(quad % SLICES, quad / SLICES) + CORNERS[gl_VertexID % 6];
+
+    float phi = float(corner.x) / float(SLICES) * 2.0 * PI;
+    float theta = float(corner.y) / float(STACKS) * PI;
+    vec3 direction = vec3(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta));
+
+    vec4 light = lights[gl_InstanceID]._positionRadius;
+    outLight = gl_InstanceID;
+    gl_Position = u_ViewProjection * vec4(light.xyz + direction * light.w * CIRCUMSCRIBE, 1.0);
+}
@@ -5,6 +5,12 @@ layout (location = 1) in vec2 inUV;
 
 layout(location = 0) out vec2 outUV;
 
+//Redeclared so this can be used as a separable stage in a program pipeline
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
 void main()
 { 
 	outUV = inUV;
@@ -1,13 +1,41 @@
-#version 410
+#version 430
 
 layout (location = 0) in vec3 inPosition;
 
-//Out lightspace matrix
+//This draw's matrices, bound by offset into the uniform ring (see BackendHandler::WriteObjectUniforms)
+layout(std140, binding = 2) uniform b_Object
+{
+	mat4 _model;
+	mat4 _modelViewProjection;
+	mat4 _normalMatrix;
+} u_Object;
+
+//Lightspace matrix, only used for the MeshPool paths (their model matrices aren't in u_Object)
 uniform mat4 u_LightSpaceMatrix;
-uniform mat4 u_Model;
+
+//Set when drawing from the MeshPool (GpuDrivenRenderer or InstanceBatcher), the model matrices come from the object buffer instead
+//*inObjectId is the draw's baseInstance plus the instance, fed in by MeshPool's VAO
+layout(location = 4) in uint inObjectId;
+uniform bool u_GpuDriven;
+
+struct GpuObject
+{
+	mat4 _model;
+	mat4 _normalMatrix;
+	uint _mesh;
+	uint _flags;
+	uint _albedoIndex;
+	uint _padding;
+};
+
+layout (std430, binding = 4) readonly buffer b_Objects
+{
+	GpuObject objects[];
+};
 
 void main()
 { 
 	//Lightspace matrix is the viewProjection matrix from the light's perspective
-	gl_Position = u_LightSpaceMatrix * u_Model * vec4(inPosition, 1.0);
+	mat4 modelViewProjection = u_GpuDriven ? u_LightSpaceMatrix * objects[inObjectId]._model : u_Object._modelViewProjection;
+	gl_Position = modelViewProjection * vec4(inPosition, 1.0);
 }
\ No newline at end of file
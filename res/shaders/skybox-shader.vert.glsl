@@ -1,14 +1,24 @@
-#version 410
+#version 420
 
 layout(location = 0) in vec3 inPosition;
 
 layout(location = 0) out vec3 outNormal;
 
-uniform mat4 u_SkyboxMatrix;
+//Camera data, bound once a frame (see BackendHandler::SetFrameUniforms)
+layout(std140, binding = 1) uniform b_Frame
+{
+    mat4 _view;
+    mat4 _projection;
+    mat4 _viewProjection;
+    mat4 _skyboxMatrix;
+    mat4 _lightSpace;
+    vec4 _cameraPosition;
+} u_Frame;
+
 uniform mat3 u_EnvironmentRotation;
 
 void main() {
-    vec4 pos = u_SkyboxMatrix * vec4(inPosition, 1.0);
+    vec4 pos = u_Frame._skyboxMatrix * vec4(inPosition, 1.0);
     gl_Position = pos.xyww;
 
     // Normals
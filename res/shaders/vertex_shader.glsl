@@ -1,4 +1,4 @@
-#version 410
+#version 430
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
@@ -10,30 +10,78 @@ layout(location = 1) out vec3 outColor;
 layout(location = 2) out vec3 outNormal;
 layout(location = 3) out vec2 outUV;
 layout(location = 4) out vec4 outFragPosLightSpace;
+//Which layer of the material's albedo array to use, if it has one
+layout(location = 5) flat out uint outAlbedoIndex;
 
-uniform mat4 u_ModelViewProjection;
-uniform mat4 u_View;
-uniform mat4 u_Model;
-uniform mat3 u_NormalMatrix;
 uniform vec3 u_LightPos;
-uniform mat4 u_LightSpaceMatrix;
+
+//Camera data, bound once a frame (see BackendHandler::SetFrameUniforms)
+layout(std140, binding = 1) uniform b_Frame
+{
+	mat4 _view;
+	mat4 _projection;
+	mat4 _viewProjection;
+	mat4 _skyboxMatrix;
+	mat4 _lightSpace;
+	vec4 _cameraPosition;
+} u_Frame;
+
+//This draw's matrices, bound by offset into the uniform ring (see BackendHandler::WriteObjectUniforms)
+layout(std140, binding = 2) uniform b_Object
+{
+	mat4 _model;
+	mat4 _modelViewProjection;
+	mat4 _normalMatrix;
+} u_Object;
+
+//Set when drawing from the MeshPool (GpuDrivenRenderer or InstanceBatcher), the model matrices come from the object buffer instead
+//*inObjectId is the draw's baseInstance plus the instance, fed in by MeshPool's VAO
+layout(location = 4) in uint inObjectId;
+uniform bool u_GpuDriven;
+
+struct GpuObject
+{
+	mat4 _model;
+	mat4 _normalMatrix;
+	uint _mesh;
+	uint _flags;
+	uint _albedoIndex;
+	uint _padding;
+};
+
+layout (std430, binding = 4) readonly buffer b_Objects
+{
+	GpuObject objects[];
+};
 
 void main() {
 
-	gl_Position = u_ModelViewProjection * vec4(inPosition, 1.0);
+	mat4 model = u_Object._model;
+	mat3 normalMatrix = mat3(u_Object._normalMatrix);
+	mat4 modelViewProjection = u_Object._modelViewProjection;
+	outAlbedoIndex = 0;
+	if (u_GpuDriven)
+	{
+		model = objects[inObjectId]._model;
+		normalMatrix = mat3(objects[inObjectId]._normalMatrix);
+		modelViewProjection = u_Frame._viewProjection * model;
+		outAlbedoIndex = objects[inObjectId]._albedoIndex;
+	}
+
+	gl_Position = modelViewProjection * vec4(inPosition, 1.0);
 
 	// Lecture 5
 	// Pass vertex pos in world space to frag shader
-	outPos = (u_Model * vec4(inPosition, 1.0)).xyz;
+	outPos = (model * vec4(inPosition, 1.0)).xyz;
 
 	// Normals
-	outNormal = u_NormalMatrix * inNormal;
+	outNormal = normalMatrix * inNormal;
 
 	// Pass our UV coords to the fragment shader
 	outUV = inUV;
 
 	//Pass out the light space fragment pos
-	outFragPosLightSpace = u_LightSpaceMatrix * vec4(outPos, 1.0);
+	outFragPosLightSpace = u_Frame._lightSpace * vec4(outPos, 1.0);
 
 	///////////
 	outColor = inColor;
@@ -0,0 +1,508 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	//Interpolation weights for BC7's 4 bit indices
+	const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	//Finds the two ends of the line that best fits the block (principal axis of the first channelCount channels)
+	void FitEndpoints(const uint8_t texels[64], int channelCount, float low[4], float high[4])
+	{
+		float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+			for (int c = 0; c < channelCount; c++)
+				mean[c] += texels[i * 4 + c];
+		for (int c = 0; c < channelCount; c++)
+			mean[c] /= 16.0f;
+
+		float covariance[4][4] = {};
+		for (int i = 0; i < 16; i++)
+		{
+			for (int a = 0; a < channelCount; a++)
+			{
+				float da = texels[i * 4 + a] - mean[a];
+				for (int b = 0; b < channelCount; b++)
+					covariance[a][b] += da * (texels[i * 4 + b] - mean[b]);
+			}
+		}
+
+		//Power iteration, a few steps is plenty for a 4x4 block
+		float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		for (int step = 0; step < 8; step++)
+		{
+			float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			float length = 0.0f;
+			for (int a = 0; a < channelCount; a++)
+			{
+				for (int b = 0; b < channelCount; b++)
+					next[a] += covariance[a][b] * axis[b];
+				length += next[a] * next[a];
+			}
+			//Flat block, any axis will do
+			if (length < 1e-6f)
+				break;
+			length = std::sqrt(length);
+			for (int a = 0; a < channelCount; a++)
+				axis[a] = next[a] / length;
+		}
+
+		float minT = 0.0f, maxT = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			float t = 0.0f;
+			for (int c = 0; c < channelCount; c++)
+				t += (texels[i * 4 + c] - mean[c]) * axis[c];
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+
+		for (int c = 0; c < channelCount; c++)
+		{
+			low[c] = std::clamp(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+			high[c] = std::clamp(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+		}
+	}
+
+	uint16_t PackRGB565(const float colour[4])
+	{
+		uint16_t r = uint16_t(std::lround(colour[0] * 31.0f / 255.0f));
+		uint16_t g = uint16_t(std::lround(colour[1] * 63.0f / 255.0f));
+		uint16_t b = uint16_t(std::lround(colour[2] * 31.0f / 255.0f));
+		return uint16_t((r << 11) | (g << 5) | b);
+	}
+
+	void UnpackRGB565(uint16_t packed, int colour[3])
+	{
+		int r = (packed >> 11) & 31;
+		int g = (packed >> 5) & 63;
+		int b = packed & 31;
+		colour[0] = (r << 3) | (r >> 2);
+		colour[1] = (g << 2) | (g >> 4);
+		colour[2] = (b << 3) | (b >> 2);
+	}
+
+	//Writes count bits of value into a little endian bit stream
+	void WriteBits(uint8_t* stream, int& position, uint32_t value, int count)
+	{
+		for (int i = 0; i < count; i++, position++)
+		{
+			if ((value >> i) & 1)
+				stream[position >> 3] |= uint8_t(1 << (position & 7));
+		}
+	}
+
+	//Reads count bits from a little endian bit stream
+	uint32_t ReadBits(const uint8_t* stream, int& position, int count)
+	{
+		uint32_t value = 0;
+		for (int i = 0; i < count; i++, position++)
+		{
+			if ((stream[position >> 3] >> (position & 7)) & 1)
+				value |= 1u << i;
+		}
+		return value;
+	}
+
+	//Colour half of a BC1 block, BC3 always uses the 4 colour mode so it skips the punch through alpha
+	void DecodeColourBlock(const uint8_t block[8], bool allowPunchThrough, uint8_t texels[64])
+	{
+		uint16_t colour0 = uint16_t(block[0] | (block[1] << 8));
+		uint16_t colour1 = uint16_t(block[2] | (block[3] << 8));
+
+		int palette[4][4];
+		UnpackRGB565(colour0, palette[0]);
+		UnpackRGB565(colour1, palette[1]);
+		palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+		//Same rounding as the encoder, so it picked its indices against these exact colours
+		if (colour0 > colour1 || !allowPunchThrough)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+		}
+		else
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+			palette[3][3] = 0;
+		}
+
+		uint32_t indices;
+		std::memcpy(&indices, &block[4], 4);
+		for (int i = 0; i < 16; i++)
+		{
+			const int* colour = palette[(indices >> (i * 2)) & 3];
+			for (int c = 0; c < 4; c++)
+				texels[i * 4 + c] = uint8_t(colour[c]);
+		}
+	}
+}
+
+void BlockCompression::Encode(const uint8_t* pixels, uint32_t width, uint32_t height, BlockFormat format, std::vector<uint8_t>& blocks)
+{
+	uint32_t blocksWide = (width + 3) / 4;
+	uint32_t blocksHigh = (height + 3) / 4;
+	uint32_t blockBytes = GetBlockBytes(format);
+	blocks.assign(size_t(blocksWide) * blocksHigh * blockBytes, 0);
+
+	uint8_t texels[64];
+	for (uint32_t by = 0; by < blocksHigh; by++)
+	{
+		for (uint32_t bx = 0; bx < blocksWide; bx++)
+		{
+			//Gather the block, repeating the last row/column past the edge
+			for (uint32_t y = 0; y < 4; y++)
+			{
+				uint32_t sourceY = std::min(by * 4 + y, height - 1);
+				for (uint32_t x = 0; x < 4; x++)
+				{
+					uint32_t sourceX = std::min(bx * 4 + x, width - 1);
+					std::memcpy(&texels[(y * 4 + x) * 4], &pixels[(size_t(sourceY) * width + sourceX) * 4], 4);
+				}
+			}
+
+			uint8_t* block = &blocks[(size_t(by) * blocksWide + bx) * blockBytes];
+			switch (format)
+			{
+			case BlockFormat::BC1: EncodeBC1(texels, block); break;
+			case BlockFormat::BC3: EncodeBC3(texels, block); break;
+			case BlockFormat::BC5: EncodeBC5(texels, block); break;
+			case BlockFormat::BC7: EncodeBC7(texels, block); break;
+			}
+		}
+	}
+}
+
+void BlockCompression::EncodeBC1(const uint8_t texels[64], uint8_t block[8])
+{
+	float low[4], high[4];
+	FitEndpoints(texels, 3, low, high);
+
+	uint16_t colour0 = PackRGB565(high);
+	uint16_t colour1 = PackRGB565(low);
+	//colour0 has to be the bigger one for the 4 colour mode
+	if (colour0 < colour1)
+		std::swap(colour0, colour1);
+
+	uint32_t indices = 0;
+	if (colour0 != colour1)
+	{
+		int palette[4][3];
+		UnpackRGB565(colour0, palette[0]);
+		UnpackRGB565(colour1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0, bestError = INT32_MAX;
+			for (int p = 0; p < 4; p++)
+			{
+				int error = 0;
+				for (int c = 0; c < 3; c++)
+				{
+					int difference = texels[i * 4 + c] - palette[p][c];
+					error += difference * difference;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					best = p;
+				}
+			}
+			indices |= uint32_t(best) << (i * 2);
+		}
+	}
+
+	block[0] = uint8_t(colour0 & 0xFF);
+	block[1] = uint8_t(colour0 >> 8);
+	block[2] = uint8_t(colour1 & 0xFF);
+	block[3] = uint8_t(colour1 >> 8);
+	std::memcpy(&block[4], &indices, 4);
+}
+
+void BlockCompression::EncodeBC4(const uint8_t texels[64], int channel, uint8_t block[8])
+{
+	int low = 255, high = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		low = std::min(low, int(texels[i * 4 + channel]));
+		high = std::max(high, int(texels[i * 4 + channel]));
+	}
+
+	std::memset(block, 0, 8);
+	block[0] = uint8_t(high);
+	block[1] = uint8_t(low);
+
+	//Every texel is the same, index 0 already points at it
+	if (high == low)
+		return;
+
+	//high > low means the 8 value mode
+	int palette[8];
+	palette[0] = high;
+	palette[1] = low;
+	for (int i = 2; i < 8; i++)
+		palette[i] = ((8 - i) * high + (i - 1) * low) / 7;
+
+	int position = 16;
+	for (int i = 0; i < 16; i++)
+	{
+		int value = texels[i * 4 + channel];
+		int best = 0, bestError = INT32_MAX;
+		for (int p = 0; p < 8; p++)
+		{
+			int error = std::abs(value - palette[p]);
+			if (error < bestError)
+			{
+				bestError = error;
+				best = p;
+			}
+		}
+		WriteBits(block, position, uint32_t(best), 3);
+	}
+}
+
+void BlockCompression::EncodeBC3(const uint8_t texels[64], uint8_t block[16])
+{
+	EncodeBC4(texels, 3, block);
+	EncodeBC1(texels, block + 8);
+}
+
+void BlockCompression::EncodeBC5(const uint8_t texels[64], uint8_t block[16])
+{
+	EncodeBC4(texels, 0, block);
+	EncodeBC4(texels, 1, block + 8);
+}
+
+void BlockCompression::EncodeBC7(const uint8_t texels[64], uint8_t block[16])
+{
+	//Mode 6 only: one subset, RGBA endpoints with 7 bits + a shared low bit each, 4 bit indices
+	float low[4], high[4];
+	FitEndpoints(texels, 4, low, high);
+
+	//Pick the low bit for each endpoint that gets it closest after quantizing
+	int endpoints[2][4];
+	int pBits[2];
+	const float* targets[2] = { low, high };
+	for (int e = 0; e < 2; e++)
+	{
+		int bestError = INT32_MAX;
+		for (int p = 0; p < 2; p++)
+		{
+			int error = 0;
+			int quantized[4];
+			for (int c = 0; c < 4; c++)
+			{
+				int q = std::clamp(int(std::lround((targets[e][c] - p) / 2.0f)), 0, 127);
+				quantized[c] = (q << 1) | p;
+				int difference = quantized[c] - int(std::lround(targets[e][c]));
+				error += difference * difference;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				pBits[e] = p;
+				std::memcpy(endpoints[e], quantized, sizeof(quantized));
+			}
+		}
+	}
+
+	int palette[16][4];
+	for (int i = 0; i < 16; i++)
+		for (int c = 0; c < 4; c++)
+			palette[i][c] = ((64 - BC7_WEIGHTS[i]) * endpoints[0][c] + BC7_WEIGHTS[i] * endpoints[1][c] + 32) >> 6;
+
+	int indices[16];
+	for (int i = 0; i < 16; i++)
+	{
+		int best = 0, bestError = INT32_MAX;
+		for (int p = 0; p < 16; p++)
+		{
+			int error = 0;
+			for (int c = 0; c < 4; c++)
+			{
+				int difference = texels[i * 4 + c] - palette[p][c];
+				error += difference * difference;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				best = p;
+			}
+		}
+		indices[i] = best;
+	}
+
+	//The first index is stored with its top bit dropped, so it has to be under 8
+	if (indices[0] >= 8)
+	{
+		std::swap(endpoints[0], endpoints[1]);
+		std::swap(pBits[0], pBits[1]);
+		for (int i = 0; i < 16; i++)
+			indices[i] = 15 - indices[i];
+	}
+
+	std::memset(block, 0, 16);
+	int position = 0;
+	//Mode 6 is six 0 bits then a 1
+	WriteBits(block, position, 1u << 6, 7);
+	for (int c = 0; c < 4; c++)
+	{
+		WriteBits(block, position, uint32_t(endpoints[0][c] >> 1), 7);
+		WriteBits(block, position, uint32_t(endpoints[1][c] >> 1), 7);
+	}
+	WriteBits(block, position, uint32_t(pBits[0]), 1);
+	WriteBits(block, position, uint32_t(pBits[1]), 1);
+	WriteBits(block, position, uint32_t(indices[0]), 3);
+	for (int i = 1; i < 16; i++)
+		WriteBits(block, position, uint32_t(indices[i]), 4);
+}
+
+void BlockCompression::Decode(const uint8_t* blocks, uint32_t width, uint32_t height, BlockFormat format, std::vector<uint8_t>& pixels)
+{
+	uint32_t blocksWide = (width + 3) / 4;
+	uint32_t blocksHigh = (height + 3) / 4;
+	uint32_t blockBytes = GetBlockBytes(format);
+	pixels.assign(size_t(width) * height * 4, 0);
+
+	uint8_t texels[64];
+	for (uint32_t by = 0; by < blocksHigh; by++)
+	{
+		for (uint32_t bx = 0; bx < blocksWide; bx++)
+		{
+			const uint8_t* block = &blocks[(size_t(by) * blocksWide + bx) * blockBytes];
+			switch (format)
+			{
+			case BlockFormat::BC1: DecodeBC1(block, texels); break;
+			case BlockFormat::BC3: DecodeBC3(block, texels); break;
+			case BlockFormat::BC5: DecodeBC5(block, texels); break;
+			case BlockFormat::BC7: DecodeBC7(block, texels); break;
+			}
+
+			//Drop the padding the encoder added past the edge
+			for (uint32_t y = 0; y < 4 && by * 4 + y < height; y++)
+			{
+				for (uint32_t x = 0; x < 4 && bx * 4 + x < width; x++)
+				{
+					std::memcpy(&pixels[(size_t(by * 4 + y) * width + bx * 4 + x) * 4], &texels[(y * 4 + x) * 4], 4);
+				}
+			}
+		}
+	}
+}
+
+void BlockCompression::DecodeBC1(const uint8_t block[8], uint8_t texels[64])
+{
+	DecodeColourBlock(block, true, texels);
+}
+
+void BlockCompression::DecodeBC4(const uint8_t block[8], int channel, uint8_t texels[64])
+{
+	int high = block[0];
+	int low = block[1];
+
+	int palette[8];
+	palette[0] = high;
+	palette[1] = low;
+	if (high > low)
+	{
+		for (int i = 2; i < 8; i++)
+			palette[i] = ((8 - i) * high + (i - 1) * low) / 7;
+	}
+	else
+	{
+		//6 value mode, with 0 and 255 on the end
+		for (int i = 2; i < 6; i++)
+			palette[i] = ((6 - i) * high + (i - 1) * low) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	int position = 16;
+	for (int i = 0; i < 16; i++)
+	{
+		texels[i * 4 + channel] = uint8_t(palette[ReadBits(block, position, 3)]);
+	}
+}
+
+void BlockCompression::DecodeBC3(const uint8_t block[16], uint8_t texels[64])
+{
+	DecodeColourBlock(block + 8, false, texels);
+	DecodeBC4(block, 3, texels);
+}
+
+void BlockCompression::DecodeBC5(const uint8_t block[16], uint8_t texels[64])
+{
+	for (int i = 0; i < 16; i++)
+	{
+		texels[i * 4 + 2] = 0;
+		texels[i * 4 + 3] = 255;
+	}
+	DecodeBC4(block, 0, texels);
+	DecodeBC4(block + 8, 1, texels);
+}
+
+void BlockCompression::DecodeBC7(const uint8_t block[16], uint8_t texels[64])
+{
+	std::memset(texels, 0, 64);
+
+	int position = 0;
+	if (ReadBits(block, position, 7) != (1u << 6))
+		return;
+
+	int endpoints[2][4];
+	for (int c = 0; c < 4; c++)
+	{
+		endpoints[0][c] = int(ReadBits(block, position, 7)) << 1;
+		endpoints[1][c] = int(ReadBits(block, position, 7)) << 1;
+	}
+	int pBit0 = int(ReadBits(block, position, 1));
+	int pBit1 = int(ReadBits(block, position, 1));
+	for (int c = 0; c < 4; c++)
+	{
+		endpoints[0][c] |= pBit0;
+		endpoints[1][c] |= pBit1;
+	}
+
+	for (int i = 0; i < 16; i++)
+	{
+		//The first index has its top bit dropped
+		int index = int(ReadBits(block, position, i == 0 ? 3 : 4));
+		for (int c = 0; c < 4; c++)
+			texels[i * 4 + c] = uint8_t(((64 - BC7_WEIGHTS[index]) * endpoints[0][c] + BC7_WEIGHTS[index] * endpoints[1][c] + 32) >> 6);
+	}
+}
+
+uint32_t BlockCompression::GetBlockBytes(BlockFormat format)
+{
+	return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+size_t BlockCompression::GetImageBytes(BlockFormat format, uint32_t width, uint32_t height)
+{
+	return size_t((width + 3) / 4) * ((height + 3) / 4) * GetBlockBytes(format);
+}
+
+bool BlockCompression::HasAlpha(const uint8_t* pixels, uint32_t width, uint32_t height)
+{
+	size_t count = size_t(width) * height;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (pixels[i * 4 + 3] != 255)
+			return true;
+	}
+	return false;
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+//Block compressed formats we can bake and load
+enum class BlockFormat
+{
+	//RGB, 4 bits per texel
+	BC1,
+	//RGBA (BC1 colour + BC4 alpha), 8 bits per texel
+	BC3,
+	//Two channels (two BC4 blocks), 8 bits per texel, for normal maps
+	BC5,
+	//RGBA, 8 bits per texel, better quality than BC1/BC3
+	BC7
+};
+
+//A block compressed texture with its mip chain, level 0 first
+struct CompressedImage
+{
+	BlockFormat _format = BlockFormat::BC1;
+	uint32_t _width = 0;
+	uint32_t _height = 0;
+	std::vector<std::vector<uint8_t>> _levels;
+};
+
+//CPU block encoders and decoders, no GL calls so the whole bake can run (and be checked) without a GPU
+class BlockCompression abstract
+{
+public:
+	//Encodes a tightly packed RGBA8 image, sizes that aren't multiples of 4 are padded by repeating the edge
+	static void Encode(const uint8_t* pixels, uint32_t width, uint32_t height, BlockFormat format, std::vector<uint8_t>& blocks);
+
+	//Encodes single 4x4 blocks of RGBA8 texels (row by row)
+	static void EncodeBC1(const uint8_t texels[64], uint8_t block[8]);
+	static void EncodeBC3(const uint8_t texels[64], uint8_t block[16]);
+	static void EncodeBC5(const uint8_t texels[64], uint8_t block[16]);
+	static void EncodeBC7(const uint8_t texels[64], uint8_t block[16]);
+	//Encodes one channel of a block (0 = red ... 3 = alpha)
+	static void EncodeBC4(const uint8_t texels[64], int channel, uint8_t block[8]);
+
+	//Decodes blocks back to a tightly packed RGBA8 image, for checking what the encoders wrote
+	static void Decode(const uint8_t* blocks, uint32_t width, uint32_t height, BlockFormat format, std::vector<uint8_t>& pixels);
+
+	//Decodes single blocks to 4x4 RGBA8 texels (row by row)
+	//*BC5 leaves blue at 0, BC7 only handles mode 6 (the one EncodeBC7 writes) and leaves other modes black
+	static void DecodeBC1(const uint8_t block[8], uint8_t texels[64]);
+	static void DecodeBC3(const uint8_t block[16], uint8_t texels[64]);
+	static void DecodeBC5(const uint8_t block[16], uint8_t texels[64]);
+	static void DecodeBC7(const uint8_t block[16], uint8_t texels[64]);
+	//Decodes a block into one channel of the texels, leaving the others alone
+	static void DecodeBC4(const uint8_t block[8], int channel, uint8_t texels[64]);
+
+	//Gets the bytes in one 4x4 block
+	static uint32_t GetBlockBytes(BlockFormat format);
+	//Gets the bytes needed for an image of this size
+	static size_t GetImageBytes(BlockFormat format, uint32_t width, uint32_t height);
+	//Checks if any texel isn't fully opaque
+	static bool HasAlpha(const uint8_t* pixels, uint32_t width, uint32_t height);
+};
\ No newline at end of file
@@ -0,0 +1,293 @@
+#include "CascadedShadows.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <GLM/gtc/matrix_transform.hpp>
+
+namespace
+{
+	//Light space depth ranges are rounded out to this many units
+	const float DEPTH_STEP = 8.0f;
+}
+
+void CascadedShadows::Init(unsigned resolution, int cascadeCount)
+{
+	_resolution = resolution;
+	_cascadeCount = std::clamp(cascadeCount, 1, MAX_CASCADES);
+
+	_shadowBuffer.AddDepthTarget();
+	_shadowBuffer.SetDepthLayers(_cascadeCount);
+	_shadowBuffer.Init(_resolution, _resolution);
+}
+
+void CascadedShadows::SetResolution(unsigned resolution)
+{
+	if (resolution == _resolution)
+		return;
+	_resolution = resolution;
+	Rebuild();
+}
+
+unsigned CascadedShadows::GetResolution() const
+{
+	return _resolution;
+}
+
+void CascadedShadows::SetCascadeCount(int cascadeCount)
+{
+	cascadeCount = std::clamp(cascadeCount, 1, MAX_CASCADES);
+	if (cascadeCount == _cascadeCount)
+		return;
+	_cascadeCount = cascadeCount;
+	Rebuild();
+}
+
+int CascadedShadows::GetCascadeCount() const
+{
+	return _cascadeCount;
+}
+
+void CascadedShadows::SetShadowDistance(float distance)
+{
+	_shadowDistance = std::max(distance, 1.0f);
+}
+
+float CascadedShadows::GetShadowDistance() const
+{
+	return _shadowDistance;
+}
+
+void CascadedShadows::SetSplitBlend(float blend)
+{
+	_splitBlend = std::clamp(blend, 0.0f, 1.0f);
+}
+
+float CascadedShadows::GetSplitBlend() const
+{
+	return _splitBlend;
+}
+
+void CascadedShadows::SetSceneBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	_sceneMin = boundsMin;
+	_sceneMax = boundsMax;
+}
+
+void CascadedShadows::SetCaching(bool caching)
+{
+	_caching = caching;
+	InvalidateCache();
+}
+
+bool CascadedShadows::IsCaching() const
+{
+	return _caching;
+}
+
+void CascadedShadows::SetStaticHash(uint64_t hash)
+{
+	if (hash != _staticHash)
+	{
+		_staticHash = hash;
+		InvalidateCache();
+	}
+}
+
+void CascadedShadows::InvalidateCache()
+{
+	for (glm::mat4& viewProjection : _cachedViewProjections)
+	{
+		viewProjection = glm::mat4(1.0f);
+	}
+}
+
+void CascadedShadows::Update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightDirection)
+{
+	_view = view;
+
+	//Pulled back out of a GL perspective matrix, shadows stop at the shadow distance
+	float nearDepth = projection[3][2] / (projection[2][2] - 1.0f);
+	float farDepth = projection[3][2] / (projection[2][2] + 1.0f);
+	float shadowFar = std::min(farDepth, nearDepth + _shadowDistance);
+
+	//Corners of the whole frustum in world space, near plane then far plane
+	glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+	glm::vec3 nearCorners[4];
+	glm::vec3 farCorners[4];
+	for (int i = 0; i < 4; i++)
+	{
+		glm::vec2 ndc = glm::vec2(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f);
+		glm::vec4 nearCorner = inverseViewProjection * glm::vec4(ndc, -1.0f, 1.0f);
+		glm::vec4 farCorner = inverseViewProjection * glm::vec4(ndc, 1.0f, 1.0f);
+		nearCorners[i] = glm::vec3(nearCorner) / nearCorner.w;
+		farCorners[i] = glm::vec3(farCorner) / farCorner.w;
+	}
+
+	glm::vec3 direction = glm::normalize(lightDirection);
+	glm::vec3 up = std::abs(direction.z) > 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(0.0f, 0.0f, 1.0f);
+	//Looks down the light from the world origin, shared by every cascade
+	glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), direction, up);
+
+	float sliceNear = nearDepth;
+	for (int i = 0; i < _cascadeCount; i++)
+	{
+		//Practical split scheme, a blend of logarithmic and even spacing
+		float fraction = float(i + 1) / float(_cascadeCount);
+		float logSplit = nearDepth * std::pow(shadowFar / nearDepth, fraction);
+		float evenSplit = nearDepth + (shadowFar - nearDepth) * fraction;
+		float sliceFar = evenSplit + (logSplit - evenSplit) * _splitBlend;
+		_splits[i] = sliceFar;
+
+		//Points along each corner's ray are linear in view depth, so the slice's corners are just lerps
+		glm::vec3 corners[8];
+		glm::vec3 centre = glm::vec3(0.0f);
+		for (int c = 0; c < 4; c++)
+		{
+			corners[c] = glm::mix(nearCorners[c], farCorners[c], (sliceNear - nearDepth) / (farDepth - nearDepth));
+			corners[c + 4] = glm::mix(nearCorners[c], farCorners[c], (sliceFar - nearDepth) / (farDepth - nearDepth));
+			centre += corners[c] + corners[c + 4];
+		}
+		centre /= 8.0f;
+
+		//Bounding sphere, rounded up so it doesn't shimmer from float error
+		float radius = 0.0f;
+		for (const glm::vec3& corner : corners)
+		{
+			radius = std::max(radius, glm::length(corner - centre));
+		}
+		radius = std::ceil(radius * 16.0f) / 16.0f;
+
+		//Bounds are built around the slice in light space, with the light view itself only depending on the direction
+		//*Everything that changes with the camera is quantised, so a cascade's matrix stays exactly the same
+		// until it has moved by a whole texel (or a whole depth step), which is what lets the static cache hold
+		glm::vec3 lightCentre = glm::vec3(lightView * glm::vec4(centre, 1.0f));
+		float texelSize = radius * 2.0f / float(_resolution);
+		lightCentre.x = std::floor(lightCentre.x / texelSize) * texelSize;
+		lightCentre.y = std::floor(lightCentre.y / texelSize) * texelSize;
+
+		//Pull the near plane back to the nearest part of the scene, anything between the light and the slice can cast into it
+		float casterNear = -lightCentre.z - radius;
+		for (int c = 0; c < 8; c++)
+		{
+			glm::vec3 corner = glm::vec3(c & 1 ? _sceneMax.x : _sceneMin.x, c & 2 ? _sceneMax.y : _sceneMin.y, c & 4 ? _sceneMax.z : _sceneMin.z);
+			casterNear = std::min(casterNear, -(lightView * glm::vec4(corner, 1.0f)).z);
+		}
+		//In coarse steps, so moving casters or the camera don't change the projection (and throw the cache away) every frame
+		casterNear = std::floor(casterNear / DEPTH_STEP) * DEPTH_STEP;
+		float casterFar = std::ceil((-lightCentre.z + radius) / DEPTH_STEP) * DEPTH_STEP;
+
+		glm::mat4 lightProjection = glm::ortho(lightCentre.x - radius, lightCentre.x + radius, lightCentre.y - radius, lightCentre.y + radius,
+			casterNear, casterFar);
+
+		_viewProjections[i] = lightProjection * lightView;
+		sliceNear = sliceFar;
+	}
+}
+
+FrameGraphResource CascadedShadows::Import(FrameGraph& graph)
+{
+	return graph.ImportTarget("Shadow Cascades", &_shadowBuffer);
+}
+
+void CascadedShadows::Render(const std::function<void(const glm::mat4&)>& drawStatic, const std::function<void(const glm::mat4&)>& drawDynamic)
+{
+	_staticRedraws = 0;
+	if (_caching && !_cacheCreated)
+	{
+		_staticCache.AddDepthTarget();
+		_staticCache.SetDepthLayers(_cascadeCount);
+		_staticCache.Init(_resolution, _resolution);
+		_cacheCreated = true;
+		InvalidateCache();
+	}
+
+	for (int i = 0; i < _cascadeCount; i++)
+	{
+		const glm::mat4& viewProjection = _viewProjections[i];
+		if (!_caching)
+		{
+			BindLayer(_shadowBuffer, i);
+			drawStatic(viewProjection);
+			drawDynamic(viewProjection);
+			_staticRedraws++;
+			continue;
+		}
+
+		//Redraw the static casters only if the cascade moved or they changed
+		if (_cachedViewProjections[i] != viewProjection)
+		{
+			BindLayer(_staticCache, i);
+			drawStatic(viewProjection);
+			_staticCache.Unbind();
+			_cachedViewProjections[i] = viewProjection;
+			_staticRedraws++;
+		}
+
+		//Start from the cached static depth and put the dynamic casters on top
+		_shadowBuffer.CopyDepthLayer(&_staticCache, i);
+		_shadowBuffer.SetDrawLayer(i);
+		_shadowBuffer.SetViewport();
+		_shadowBuffer.Bind();
+		drawDynamic(viewProjection);
+	}
+
+	_shadowBuffer.Unbind();
+	_shadowBuffer.SetDrawLayer(-1);
+	if (_cacheCreated)
+	{
+		_staticCache.SetDrawLayer(-1);
+	}
+}
+
+int CascadedShadows::GetStaticRedrawCount() const
+{
+	return _staticRedraws;
+}
+
+const glm::mat4& CascadedShadows::GetViewProjection(int cascade) const
+{
+	return _viewProjections[cascade];
+}
+
+const glm::vec4& CascadedShadows::GetSplits() const
+{
+	return _splits;
+}
+
+void CascadedShadows::SetUniforms(const Shader::sptr& shader) const
+{
+	GLuint handle = shader->GetHandle();
+	glProgramUniformMatrix4fv(handle, glGetUniformLocation(handle, "u_LightSpaceMatrices"), _cascadeCount, GL_FALSE, &_viewProjections[0][0][0]);
+	shader->SetUniform("u_CascadeSplits", _splits);
+	shader->SetUniform("u_CascadeCount", _cascadeCount);
+	shader->SetUniformMatrix("u_View", _view);
+}
+
+size_t CascadedShadows::GetMemoryBytes() const
+{
+	//24 bit depth is stored in 32 bits
+	size_t bytes = size_t(_resolution) * _resolution * 4 * _cascadeCount;
+	return _cacheCreated ? bytes * 2 : bytes;
+}
+
+void CascadedShadows::Rebuild()
+{
+	_shadowBuffer.SetDepthLayers(_cascadeCount);
+	_shadowBuffer.Reshape(_resolution, _resolution);
+	if (_cacheCreated)
+	{
+		_staticCache.SetDepthLayers(_cascadeCount);
+		_staticCache.Reshape(_resolution, _resolution);
+	}
+	InvalidateCache();
+}
+
+void CascadedShadows::BindLayer(Framebuffer& buffer, int cascade)
+{
+	//Only the one layer is attached, so only it gets cleared
+	buffer.SetDrawLayer(cascade);
+	buffer.SetViewport();
+	buffer.Clear();
+	buffer.Bind();
+}
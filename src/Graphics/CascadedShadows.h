@@ -0,0 +1,102 @@
+#pragma once
+#include <functional>
+#include <cstdint>
+
+#include <GLM/glm.hpp>
+#include <Shader.h>
+
+#include "Framebuffer.h"
+#include "Graphics/FrameGraph.h"
+
+//Cascaded shadow maps for the sun
+//*The camera frustum (out to the shadow distance) is split into cascades, spaced with a blend of even and
+// logarithmic splits so the cascades near the camera are small and sharp
+//*Each cascade gets an orthographic projection around a bounding sphere of its slice, so its size doesn't
+// change as the camera turns, and its bounds are snapped to whole texels so shadow edges don't crawl as it moves
+//*Depth ranges are stretched towards the light to cover the scene bounds, so casters outside a slice still cast into it
+//*Every cascade is one layer of a single depth array texture
+//*Static casters can be cached, they're drawn into a second depth array that's only redrawn when a cascade moves
+// or the static casters change, each frame it's copied over and the dynamic casters are drawn on top
+class CascadedShadows
+{
+public:
+	static const int MAX_CASCADES = 4;
+
+	//Creates the depth array
+	void Init(unsigned resolution, int cascadeCount);
+
+	//Changing either of these rebuilds the depth array
+	void SetResolution(unsigned resolution);
+	unsigned GetResolution() const;
+	void SetCascadeCount(int cascadeCount);
+	int GetCascadeCount() const;
+
+	//How far from the camera shadows reach
+	void SetShadowDistance(float distance);
+	float GetShadowDistance() const;
+	//0 spaces the splits evenly, 1 spaces them logarithmically
+	void SetSplitBlend(float blend);
+	float GetSplitBlend() const;
+
+	//World space box around everything that casts shadows
+	void SetSceneBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+	//Turns the static caster cache on or off, off draws everything every frame
+	void SetCaching(bool caching);
+	bool IsCaching() const;
+	//Hash of whatever the static casters are (meshes, transforms), the cache is redrawn when it changes
+	void SetStaticHash(uint64_t hash);
+	//Throws the cache away, so the static casters are redrawn next frame
+	void InvalidateCache();
+
+	//Fits the cascades to the camera for this frame, lightDirection is the way the light travels
+	void Update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightDirection);
+
+	//Hands the depth array to a frame graph, Render fills every cascade so passes don't need it cleared
+	FrameGraphResource Import(FrameGraph& graph);
+
+	//Draws the casters into every cascade, each function is given the cascade's view projection
+	//*drawStatic only runs for cascades whose cache is out of date (or every cascade if caching is off)
+	void Render(const std::function<void(const glm::mat4&)>& drawStatic, const std::function<void(const glm::mat4&)>& drawDynamic);
+	//Number of cascades that had their static casters drawn last Render
+	int GetStaticRedrawCount() const;
+
+	//View projection of a cascade, for drawing casters into it
+	const glm::mat4& GetViewProjection(int cascade) const;
+	//View depth each cascade reaches out to
+	const glm::vec4& GetSplits() const;
+
+	//Sets the uniforms the lighting shaders pick and sample cascades with
+	//*u_LightSpaceMatrices, u_CascadeSplits, u_CascadeCount and u_View (the camera's)
+	void SetUniforms(const Shader::sptr& shader) const;
+
+	//Size of the depth arrays (the cache too, if it's on)
+	size_t GetMemoryBytes() const;
+
+private:
+	void Rebuild();
+	//Binds one layer of a depth array to draw into and clears it
+	void BindLayer(Framebuffer& buffer, int cascade);
+
+	Framebuffer _shadowBuffer;
+	//Just the static casters, made when caching is first turned on
+	Framebuffer _staticCache;
+	bool _caching = true;
+	bool _cacheCreated = false;
+	uint64_t _staticHash = 0;
+	//What each cached layer was drawn with, identity if it's out of date
+	glm::mat4 _cachedViewProjections[MAX_CASCADES];
+	int _staticRedraws = 0;
+
+	unsigned _resolution = 2048;
+	int _cascadeCount = 3;
+	float _shadowDistance = 40.0f;
+	float _splitBlend = 0.75f;
+
+	glm::vec3 _sceneMin = glm::vec3(-20.0f);
+	glm::vec3 _sceneMax = glm::vec3(20.0f);
+
+	glm::mat4 _view = glm::mat4(1.0f);
+	glm::mat4 _viewProjections[MAX_CASCADES];
+	glm::vec4 _splits = glm::vec4(0.0f);
+};
@@ -0,0 +1,297 @@
+#include "ClusteredLights.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define CLUSTER_SSE 1
+#include <emmintrin.h>
+#else
+#define CLUSTER_SSE 0
+#endif
+
+namespace
+{
+	//What ComputeBounds needs out of a light in view space, nearest and farthest depth along with the NDC box
+	struct LightBounds
+	{
+		float _near;
+		float _far;
+		float _minX;
+		float _maxX;
+		float _minY;
+		float _maxY;
+	};
+
+	//Turns an NDC range into a tile range, returns false if it's off screen
+	bool TileRange(float minNdc, float maxNdc, int tiles, int& first, int& last)
+	{
+		if (maxNdc < -1.0f || minNdc > 1.0f)
+			return false;
+		first = std::clamp(int(std::floor((minNdc * 0.5f + 0.5f) * tiles)), 0, tiles - 1);
+		last = std::clamp(int(std::floor((maxNdc * 0.5f + 0.5f) * tiles)), 0, tiles - 1);
+		return true;
+	}
+
+	//Uploads a vector into a buffer, replacing its storage so we never wait on last frame's draw
+	template <typename T>
+	void UploadBuffer(GLuint buffer, const std::vector<T>& data)
+	{
+		//A zero sized store can't be bound, keep at least one element around
+		static const T empty = T();
+		const T* source = data.empty() ? &empty : data.data();
+		size_t size = std::max(data.size(), size_t(1)) * sizeof(T);
+		glNamedBufferData(buffer, GLsizeiptr(size), source, GL_STREAM_DRAW);
+	}
+}
+
+ClusteredLights::~ClusteredLights()
+{
+	if (_lightBuffer != 0)
+	{
+		GLuint buffers[3] = { _lightBuffer, _clusterBuffer, _indexBuffer };
+		glDeleteBuffers(3, buffers);
+	}
+}
+
+std::vector<ClusterLight>& ClusteredLights::GetLightsRef()
+{
+	return _lights;
+}
+
+void ClusteredLights::Update(const glm::mat4& view, const glm::mat4& projection)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	_view = view;
+	_projection = projection;
+	//Pulled back out of a GL perspective matrix
+	_near = projection[3][2] / (projection[2][2] - 1.0f);
+	_far = projection[3][2] / (projection[2][2] + 1.0f);
+	//Only perspective projections are handled, this just keeps the logs finite if it's given something else
+	_near = std::max(_near, 1e-3f);
+	_far = std::max(_far, _near * 2.0f);
+
+	std::vector<int> bounds;
+	ComputeBounds(bounds);
+
+	//Count first so every cluster's list can sit in one packed array
+	std::vector<uint32_t> counts(CLUSTER_COUNT, 0);
+	_stats = ClusterStats();
+	_stats._lightCount = _lights.size();
+	for (size_t i = 0; i < _lights.size(); i++)
+	{
+		const int* b = &bounds[i * 6];
+		if (b[0] < 0)
+			continue;
+		_stats._visibleLights++;
+
+		for (int z = b[4]; z <= b[5]; z++)
+			for (int y = b[2]; y <= b[3]; y++)
+				for (int x = b[0]; x <= b[1]; x++)
+					counts[(z * TILES_Y + y) * TILES_X + x]++;
+	}
+
+	_clusters.resize(size_t(CLUSTER_COUNT) * 2);
+	uint32_t total = 0;
+	for (int i = 0; i < CLUSTER_COUNT; i++)
+	{
+		_stats._maxPerCluster = std::max(_stats._maxPerCluster, size_t(counts[i]));
+		uint32_t count = std::min(counts[i], uint32_t(MAX_LIGHTS_PER_CLUSTER));
+		_clusters[i * 2] = total;
+		_clusters[i * 2 + 1] = count;
+		total += count;
+	}
+	_stats._references = total;
+
+	//Then fill, the count doubles as the write cursor
+	_lightIndices.resize(total);
+	std::fill(counts.begin(), counts.end(), 0);
+	for (size_t i = 0; i < _lights.size(); i++)
+	{
+		const int* b = &bounds[i * 6];
+		if (b[0] < 0)
+			continue;
+
+		for (int z = b[4]; z <= b[5]; z++)
+		{
+			for (int y = b[2]; y <= b[3]; y++)
+			{
+				for (int x = b[0]; x <= b[1]; x++)
+				{
+					int cluster = (z * TILES_Y + y) * TILES_X + x;
+					if (counts[cluster] < _clusters[cluster * 2 + 1])
+					{
+						_lightIndices[_clusters[cluster * 2] + counts[cluster]] = uint32_t(i);
+						counts[cluster]++;
+					}
+				}
+			}
+		}
+	}
+
+	Upload();
+
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+	_stats._assignMilliseconds = elapsed.count();
+}
+
+void ClusteredLights::Bind() const
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_BINDING, _lightBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_BINDING, _clusterBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDEX_BINDING, _indexBuffer);
+}
+
+void ClusteredLights::Unbind() const
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_BINDING, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_BINDING, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDEX_BINDING, 0);
+}
+
+const glm::mat4& ClusteredLights::GetView() const
+{
+	return _view;
+}
+
+glm::vec2 ClusteredLights::GetSliceScaleBias() const
+{
+	//slice = log(depth / near) / log(far / near) * SLICES
+	float scale = float(SLICES) / std::log(_far / _near);
+	return glm::vec2(scale, -std::log(_near) * scale);
+}
+
+const ClusterStats& ClusteredLights::GetStats() const
+{
+	return _stats;
+}
+
+void ClusteredLights::ComputeBounds(std::vector<int>& bounds) const
+{
+	size_t count = _lights.size();
+	std::vector<LightBounds> lightBounds(count);
+
+	float xScale = _projection[0][0];
+	float yScale = _projection[1][1];
+
+	size_t i = 0;
+#if CLUSTER_SSE
+	//Four lights at a time, transform into view space and box their NDC extents
+	//*Depths are flipped so they're positive in front of the camera
+	const glm::mat4& v = _view;
+	__m128 zero = _mm_set1_ps(0.0f);
+	__m128 epsilon = _mm_set1_ps(1e-4f);
+	for (; i + 4 <= count; i += 4)
+	{
+		const ClusterLight* l = &_lights[i];
+		__m128 px = _mm_setr_ps(l[0]._positionRadius.x, l[1]._positionRadius.x, l[2]._positionRadius.x, l[3]._positionRadius.x);
+		__m128 py = _mm_setr_ps(l[0]._positionRadius.y, l[1]._positionRadius.y, l[2]._positionRadius.y, l[3]._positionRadius.y);
+		__m128 pz = _mm_setr_ps(l[0]._positionRadius.z, l[1]._positionRadius.z, l[2]._positionRadius.z, l[3]._positionRadius.z);
+		__m128 r = _mm_setr_ps(l[0]._positionRadius.w, l[1]._positionRadius.w, l[2]._positionRadius.w, l[3]._positionRadius.w);
+
+		__m128 cx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(v[0][0]), px), _mm_mul_ps(_mm_set1_ps(v[1][0]), py)),
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(v[2][0]), pz), _mm_set1_ps(v[3][0])));
+		__m128 cy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(v[0][1]), px), _mm_mul_ps(_mm_set1_ps(v[1][1]), py)),
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(v[2][1]), pz), _mm_set1_ps(v[3][1])));
+		__m128 cz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(v[0][2]), px), _mm_mul_ps(_mm_set1_ps(v[1][2]), py)),
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(v[2][2]), pz), _mm_set1_ps(v[3][2])));
+		__m128 depth = _mm_sub_ps(zero, cz);
+
+		__m128 nearDepth = _mm_sub_ps(depth, r);
+		__m128 farDepth = _mm_add_ps(depth, r);
+		//Only used when the sphere is fully in front of the camera, the clamp just keeps the divides finite
+		__m128 invNear = _mm_div_ps(_mm_set1_ps(1.0f), _mm_max_ps(nearDepth, epsilon));
+		__m128 invFar = _mm_div_ps(_mm_set1_ps(1.0f), _mm_max_ps(farDepth, epsilon));
+
+		//Each side of the box is most extreme at whichever depth makes it so
+		__m128 left = _mm_sub_ps(cx, r);
+		__m128 right = _mm_add_ps(cx, r);
+		__m128 bottom = _mm_sub_ps(cy, r);
+		__m128 top = _mm_add_ps(cy, r);
+		__m128 xs = _mm_set1_ps(xScale);
+		__m128 ys = _mm_set1_ps(yScale);
+		__m128 minX = _mm_mul_ps(xs, _mm_min_ps(_mm_mul_ps(left, invNear), _mm_mul_ps(left, invFar)));
+		__m128 maxX = _mm_mul_ps(xs, _mm_max_ps(_mm_mul_ps(right, invNear), _mm_mul_ps(right, invFar)));
+		__m128 minY = _mm_mul_ps(ys, _mm_min_ps(_mm_mul_ps(bottom, invNear), _mm_mul_ps(bottom, invFar)));
+		__m128 maxY = _mm_mul_ps(ys, _mm_max_ps(_mm_mul_ps(top, invNear), _mm_mul_ps(top, invFar)));
+
+		alignas(16) float out[6][4];
+		_mm_store_ps(out[0], nearDepth);
+		_mm_store_ps(out[1], farDepth);
+		_mm_store_ps(out[2], minX);
+		_mm_store_ps(out[3], maxX);
+		_mm_store_ps(out[4], minY);
+		_mm_store_ps(out[5], maxY);
+		for (int j = 0; j < 4; j++)
+		{
+			lightBounds[i + j] = { out[0][j], out[1][j], out[2][j], out[3][j], out[4][j], out[5][j] };
+		}
+	}
+#endif
+
+	//Whatever's left over (or everything without SSE)
+	for (; i < count; i++)
+	{
+		glm::vec3 centre = glm::vec3(_view * glm::vec4(glm::vec3(_lights[i]._positionRadius), 1.0f));
+		float r = _lights[i]._positionRadius.w;
+		float depth = -centre.z;
+
+		LightBounds& b = lightBounds[i];
+		b._near = depth - r;
+		b._far = depth + r;
+		float invNear = 1.0f / std::max(b._near, 1e-4f);
+		float invFar = 1.0f / std::max(b._far, 1e-4f);
+		b._minX = xScale * std::min((centre.x - r) * invNear, (centre.x - r) * invFar);
+		b._maxX = xScale * std::max((centre.x + r) * invNear, (centre.x + r) * invFar);
+		b._minY = yScale * std::min((centre.y - r) * invNear, (centre.y - r) * invFar);
+		b._maxY = yScale * std::max((centre.y + r) * invNear, (centre.y + r) * invFar);
+	}
+
+	//Logs don't vectorise without a library, so slices are done one light at a time
+	glm::vec2 slice = GetSliceScaleBias();
+	bounds.assign(count * 6, -1);
+	for (i = 0; i < count; i++)
+	{
+		const LightBounds& b = lightBounds[i];
+		int* out = &bounds[i * 6];
+
+		//Behind the camera or past the far plane
+		if (b._far <= _near || b._near >= _far)
+			continue;
+
+		//Crossing the near plane means the box isn't valid, it could be anywhere on screen
+		if (b._near <= _near)
+		{
+			out[0] = 0;
+			out[1] = TILES_X - 1;
+			out[2] = 0;
+			out[3] = TILES_Y - 1;
+		}
+		else if (!TileRange(b._minX, b._maxX, TILES_X, out[0], out[1]) || !TileRange(b._minY, b._maxY, TILES_Y, out[2], out[3]))
+		{
+			out[0] = -1;
+			continue;
+		}
+
+		float nearDepth = std::max(b._near, _near);
+		float farDepth = std::min(b._far, _far);
+		out[4] = std::clamp(int(std::floor(std::log(nearDepth) * slice.x + slice.y)), 0, SLICES - 1);
+		out[5] = std::clamp(int(std::floor(std::log(farDepth) * slice.x + slice.y)), 0, SLICES - 1);
+	}
+}
+
+void ClusteredLights::Upload()
+{
+	if (_lightBuffer == 0)
+	{
+		glCreateBuffers(1, &_lightBuffer);
+		glCreateBuffers(1, &_clusterBuffer);
+		glCreateBuffers(1, &_indexBuffer);
+	}
+
+	UploadBuffer(_lightBuffer, _lights);
+	UploadBuffer(_clusterBuffer, _clusters);
+	UploadBuffer(_indexBuffer, _lightIndices);
+}
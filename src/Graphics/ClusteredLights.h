@@ -0,0 +1,95 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+
+//A point light the way the clustered lighting shader reads it (std430)
+struct ClusterLight
+{
+	//World space position in xyz, radius in w (the light reaches exactly zero there)
+	glm::vec4 _positionRadius = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	//Colour in rgb, intensity in a
+	glm::vec4 _colour = glm::vec4(1.0f);
+};
+
+//Per frame numbers for the clustered lighting
+struct ClusterStats
+{
+	size_t _lightCount = 0;
+	//Lights that touched at least one cluster
+	size_t _visibleLights = 0;
+	//Total light references across every cluster
+	size_t _references = 0;
+	//Most lights any cluster ended up with (before the cap)
+	size_t _maxPerCluster = 0;
+	//Time spent assigning lights and uploading, in milliseconds
+	float _assignMilliseconds = 0.0f;
+};
+
+//Clustered (froxel) lighting, splits the view frustum into a grid of clusters and works out which point lights touch each one
+//*Tiles are screen space, slices are spaced exponentially in view depth so near clusters aren't huge
+//*Assignment runs on the CPU each frame, light bounds are worked out 4 lights at a time with SSE when it's there,
+// then each light is added to the clusters its bounds cover (counted first so the lists pack into one array)
+//*Lights, cluster ranges and light indices live in SSBOs, bind them with Bind before the lighting pass
+class ClusteredLights
+{
+public:
+	static const int TILES_X = 16;
+	static const int TILES_Y = 9;
+	static const int SLICES = 24;
+	static const int CLUSTER_COUNT = TILES_X * TILES_Y * SLICES;
+	//Lights past this many in one cluster are dropped, keeps the worst case bounded
+	static const int MAX_LIGHTS_PER_CLUSTER = 256;
+
+	//SSBO bindings the lighting shader uses
+	static const GLuint LIGHT_BINDING = 1;
+	static const GLuint CLUSTER_BINDING = 2;
+	static const GLuint INDEX_BINDING = 3;
+
+	ClusteredLights() = default;
+	~ClusteredLights();
+
+	ClusteredLights(const ClusteredLights&) = delete;
+	ClusteredLights& operator=(const ClusteredLights&) = delete;
+
+	//The lights, change these freely between updates
+	std::vector<ClusterLight>& GetLightsRef();
+
+	//Assigns the lights to clusters for this camera and uploads everything, projection has to be a perspective one
+	void Update(const glm::mat4& view, const glm::mat4& projection);
+
+	//Binds the SSBOs to their bindings
+	void Bind() const;
+	void Unbind() const;
+
+	//Uniforms the lighting shader needs to find a pixel's cluster
+	const glm::mat4& GetView() const;
+	//Multiply log(view depth) by x and add y to get the slice
+	glm::vec2 GetSliceScaleBias() const;
+
+	const ClusterStats& GetStats() const;
+
+private:
+	//Works out the cluster range each light covers, bounds is minX, maxX, minY, maxY, minZ, maxZ per light (-1 if it's off screen)
+	void ComputeBounds(std::vector<int>& bounds) const;
+	void Upload();
+
+	std::vector<ClusterLight> _lights;
+
+	//Offset and count into _lightIndices for each cluster
+	std::vector<uint32_t> _clusters;
+	std::vector<uint32_t> _lightIndices;
+
+	glm::mat4 _view = glm::mat4(1.0f);
+	glm::mat4 _projection = glm::mat4(1.0f);
+	float _near = 0.1f;
+	float _far = 100.0f;
+
+	GLuint _lightBuffer = 0;
+	GLuint _clusterBuffer = 0;
+	GLuint _indexBuffer = 0;
+
+	ClusterStats _stats;
+};
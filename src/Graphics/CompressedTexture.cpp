@@ -0,0 +1,76 @@
+#include "CompressedTexture.h"
+
+#include <algorithm>
+
+#include <Logging.h>
+
+#include "Graphics/KTX2File.h"
+
+//Only defined by glad when the S3TC extension was picked when it was generated
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+Texture2D::sptr CompressedTexture::LoadFromFile(const std::string& path)
+{
+	CompressedImage image;
+	std::string error;
+	bool srgb = false;
+	if (!KTX2File::Read(path, image, &error, &srgb))
+	{
+		LOG_WARN("Could not load \"{}\": {}", path, error);
+		return nullptr;
+	}
+
+	Texture2D::sptr texture = Texture2D::Create();
+	UploadInto(texture, image, srgb);
+	return texture;
+}
+
+void CompressedTexture::UploadInto(const Texture2D::sptr& texture, const CompressedImage& image, bool srgb)
+{
+	GLenum format = GetGLFormat(image._format, srgb);
+
+	//Immutable storage can't be resized, so swap in a new texture under the same object
+	GLuint& handle = texture->GetHandle();
+	if (handle != GL_NONE)
+	{
+		glDeleteTextures(1, &handle);
+	}
+	glCreateTextures(GL_TEXTURE_2D, 1, &handle);
+	glTextureStorage2D(handle, GLsizei(image._levels.size()), format, image._width, image._height);
+
+	for (size_t level = 0; level < image._levels.size(); level++)
+	{
+		GLsizei width = GLsizei(std::max(image._width >> level, 1u));
+		GLsizei height = GLsizei(std::max(image._height >> level, 1u));
+		glCompressedTextureSubImage2D(handle, GLint(level), 0, 0, width, height, format,
+			GLsizei(image._levels[level].size()), image._levels[level].data());
+	}
+
+	glTextureParameteri(handle, GL_TEXTURE_MIN_FILTER, image._levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTextureParameteri(handle, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(handle, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTextureParameteri(handle, GL_TEXTURE_WRAP_T, GL_REPEAT);
+}
+
+GLenum CompressedTexture::GetGLFormat(BlockFormat format, bool srgb)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1: return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case BlockFormat::BC3: return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+	case BlockFormat::BC7: return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+	}
+	return GL_NONE;
+}
\ No newline at end of file
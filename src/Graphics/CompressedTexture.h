@@ -0,0 +1,20 @@
+#pragma once
+#include <string>
+
+#include <Texture2D.h>
+
+#include "Graphics/BlockCompression.h"
+
+//Uploads block compressed textures (from the baker's KTX2 files) straight to the GPU, no decoding
+class CompressedTexture abstract
+{
+public:
+	//Loads a KTX2 file into a new texture (nullptr if it can't be read)
+	static Texture2D::sptr LoadFromFile(const std::string& path);
+	//Replaces the storage of an existing texture with the compressed image and its mips
+	//*Anything already holding the texture sees the new image
+	static void UploadInto(const Texture2D::sptr& texture, const CompressedImage& image, bool srgb = false);
+
+	//Gets the GL internal format for a block format
+	static GLenum GetGLFormat(BlockFormat format, bool srgb);
+};
\ No newline at end of file
@@ -0,0 +1,277 @@
+#include "FrameGraph.h"
+
+#include <algorithm>
+
+#include <Logging.h>
+
+std::vector<RenderTargetPool::PooledTarget> RenderTargetPool::_targets;
+
+namespace
+{
+	//Bytes per texel for the formats we render to
+	size_t BytesPerTexel(GLenum format)
+	{
+		switch (format)
+		{
+		case GL_R8: return 1;
+		case GL_RG8: case GL_R16F: return 2;
+		case GL_RGB8: case GL_RGBA8: case GL_RGB10_A2: case GL_R11F_G11F_B10F: case GL_RG16F: case GL_R32F: return 4;
+		case GL_RGBA16F: case GL_RG32F: return 8;
+		case GL_RGB32F: return 12;
+		case GL_RGBA32F: return 16;
+		default: return 4;
+		}
+	}
+}
+
+bool RenderTargetDesc::operator==(const RenderTargetDesc& other) const
+{
+	return _width == other._width && _height == other._height && _colorFormats == other._colorFormats && _depth == other._depth &&
+		_filter == other._filter;
+}
+
+size_t RenderTargetDesc::GetBytes() const
+{
+	size_t texelBytes = _depth ? 4 : 0;
+	for (GLenum format : _colorFormats)
+	{
+		texelBytes += BytesPerTexel(format);
+	}
+	return size_t(_width) * size_t(_height) * texelBytes;
+}
+
+Framebuffer* RenderTargetPool::Acquire(const RenderTargetDesc& desc)
+{
+	for (PooledTarget& pooled : _targets)
+	{
+		if (!pooled._inUse && pooled._desc == desc)
+		{
+			pooled._inUse = true;
+			pooled._idleFrames = 0;
+			return pooled._target.get();
+		}
+	}
+
+	PooledTarget pooled;
+	pooled._desc = desc;
+	pooled._target = std::make_unique<Framebuffer>();
+	for (GLenum format : desc._colorFormats)
+	{
+		pooled._target->AddColorTarget(format);
+	}
+	if (desc._depth)
+	{
+		pooled._target->AddDepthTarget();
+	}
+	pooled._target->SetFilter(desc._filter);
+	pooled._target->Init(desc._width, desc._height);
+	pooled._inUse = true;
+
+	_targets.push_back(std::move(pooled));
+	return _targets.back()._target.get();
+}
+
+void RenderTargetPool::Release(Framebuffer* target)
+{
+	for (PooledTarget& pooled : _targets)
+	{
+		if (pooled._target.get() == target)
+		{
+			pooled._inUse = false;
+			return;
+		}
+	}
+
+	LOG_WARN("Released a render target that didn't come from the pool");
+}
+
+void RenderTargetPool::EndFrame(int frameLimit)
+{
+	for (auto it = _targets.begin(); it != _targets.end();)
+	{
+		if (!it->_inUse && ++it->_idleFrames > frameLimit)
+			it = _targets.erase(it);
+		else
+			++it;
+	}
+}
+
+void RenderTargetPool::Clear()
+{
+	_targets.clear();
+}
+
+size_t RenderTargetPool::GetTargetCount()
+{
+	return _targets.size();
+}
+
+size_t RenderTargetPool::GetResidentBytes()
+{
+	size_t total = 0;
+	for (const PooledTarget& pooled : _targets)
+	{
+		total += pooled._desc.GetBytes();
+	}
+	return total;
+}
+
+FrameGraphPass& FrameGraphPass::Read(FrameGraphResource resource)
+{
+	_reads.push_back(resource);
+	return *this;
+}
+
+FrameGraphPass& FrameGraphPass::Write(FrameGraphResource resource, bool clear)
+{
+	_writes.push_back(resource);
+	if (clear)
+	{
+		_clears.push_back(resource);
+	}
+	return *this;
+}
+
+FrameGraphPass& FrameGraphPass::SideEffect()
+{
+	_sideEffect = true;
+	return *this;
+}
+
+FrameGraphResource FrameGraph::CreateTarget(const std::string& name, const RenderTargetDesc& desc)
+{
+	Resource resource;
+	resource._name = name;
+	resource._desc = desc;
+	_resources.push_back(resource);
+	return FrameGraphResource(_resources.size() - 1);
+}
+
+FrameGraphResource FrameGraph::ImportTarget(const std::string& name, Framebuffer* target)
+{
+	Resource resource;
+	resource._name = name;
+	resource._desc._width = target->_width;
+	resource._desc._height = target->_height;
+	resource._target = target;
+	resource._imported = true;
+	_resources.push_back(resource);
+	return FrameGraphResource(_resources.size() - 1);
+}
+
+FrameGraphPass& FrameGraph::AddPass(const std::string& name, std::function<void(const FrameGraph&)> execute)
+{
+	_passes.emplace_back();
+	_passes.back()._name = name;
+	_passes.back()._execute = std::move(execute);
+	return _passes.back();
+}
+
+void FrameGraph::Execute()
+{
+	//Walk back from the passes with side effects, anything that writes what a live pass reads is live too
+	std::vector<bool> needed(_resources.size(), false);
+	for (size_t i = _passes.size(); i-- > 0;)
+	{
+		FrameGraphPass& pass = _passes[i];
+		pass._live = pass._sideEffect;
+		for (FrameGraphResource resource : pass._writes)
+		{
+			if (needed[resource])
+				pass._live = true;
+		}
+
+		if (pass._live)
+		{
+			for (FrameGraphResource resource : pass._reads)
+				needed[resource] = true;
+		}
+	}
+
+	//Lifetimes of each target over the live passes
+	_livePasses = 0;
+	for (size_t i = 0; i < _passes.size(); i++)
+	{
+		if (!_passes[i]._live)
+			continue;
+		_livePasses++;
+
+		auto use = [this, i](FrameGraphResource resource) {
+			Resource& used = _resources[resource];
+			if (used._firstUse < 0)
+				used._firstUse = int(i);
+			used._lastUse = int(i);
+		};
+		for (FrameGraphResource resource : _passes[i]._reads)
+			use(resource);
+		for (FrameGraphResource resource : _passes[i]._writes)
+			use(resource);
+	}
+
+	std::vector<Framebuffer*> distinct;
+	for (size_t i = 0; i < _passes.size(); i++)
+	{
+		FrameGraphPass& pass = _passes[i];
+		if (!pass._live)
+			continue;
+
+		//Transients come out of the pool right before they're first used
+		for (Resource& resource : _resources)
+		{
+			if (!resource._imported && resource._firstUse == int(i))
+			{
+				resource._target = RenderTargetPool::Acquire(resource._desc);
+				if (std::find(distinct.begin(), distinct.end(), resource._target) == distinct.end())
+					distinct.push_back(resource._target);
+			}
+		}
+
+		for (FrameGraphResource resource : pass._clears)
+		{
+			if (!_resources[resource]._cleared)
+			{
+				_resources[resource]._target->Clear();
+				_resources[resource]._cleared = true;
+			}
+		}
+
+		pass._execute(*this);
+
+		//And go back once nothing else needs them, so later targets can reuse the memory
+		for (Resource& resource : _resources)
+		{
+			if (!resource._imported && resource._lastUse == int(i))
+			{
+				RenderTargetPool::Release(resource._target);
+				resource._target = nullptr;
+			}
+		}
+	}
+
+	_transientTargets = distinct.size();
+}
+
+Framebuffer* FrameGraph::GetTarget(FrameGraphResource resource) const
+{
+	return _resources[resource]._target;
+}
+
+const RenderTargetDesc& FrameGraph::GetDesc(FrameGraphResource resource) const
+{
+	return _resources[resource]._desc;
+}
+
+size_t FrameGraph::GetLivePassCount() const
+{
+	return _livePasses;
+}
+
+size_t FrameGraph::GetCulledPassCount() const
+{
+	return _passes.size() - _livePasses;
+}
+
+size_t FrameGraph::GetTransientTargetCount() const
+{
+	return _transientTargets;
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+
+#include "Graphics/Framebuffer.h"
+
+//Handle to a target in a frame graph
+typedef int FrameGraphResource;
+const FrameGraphResource INVALID_RESOURCE = -1;
+
+//Describes a render target, targets with the same description can share memory
+struct RenderTargetDesc
+{
+	unsigned _width = 0;
+	unsigned _height = 0;
+	std::vector<GLenum> _colorFormats;
+	bool _depth = false;
+	//How the targets are filtered when sampled, linear for anything that gets resampled at another size
+	GLenum _filter = GL_NEAREST;
+
+	bool operator==(const RenderTargetDesc& other) const;
+	//Roughly how much memory a target like this takes
+	size_t GetBytes() const;
+};
+
+//Hands out framebuffers for transient targets, reusing ones that have been released
+//*Targets nobody has asked for in a few frames are freed, so old sizes go away after a resize
+class RenderTargetPool abstract
+{
+public:
+	//Gets a free target matching the description, creating one if there isn't one
+	static Framebuffer* Acquire(const RenderTargetDesc& desc);
+	//Hands a target back so a later Acquire can reuse it
+	static void Release(Framebuffer* target);
+
+	//Frees targets that haven't been used for frameLimit frames, call this once a frame
+	static void EndFrame(int frameLimit = 3);
+	//Frees every target, none of them can be in use
+	static void Clear();
+
+	static size_t GetTargetCount();
+	static size_t GetResidentBytes();
+
+private:
+	struct PooledTarget
+	{
+		RenderTargetDesc _desc;
+		std::unique_ptr<Framebuffer> _target;
+		bool _inUse = false;
+		int _idleFrames = 0;
+	};
+
+	static std::vector<PooledTarget> _targets;
+};
+
+class FrameGraph;
+
+//One pass in a frame graph, declares what it reads and writes so the graph can order, cull and allocate
+struct FrameGraphPass
+{
+	std::string _name;
+	std::function<void(const FrameGraph&)> _execute;
+	std::vector<FrameGraphResource> _reads;
+	std::vector<FrameGraphResource> _writes;
+	//Targets this pass wants cleared before it writes them
+	std::vector<FrameGraphResource> _clears;
+	//Passes with side effects (drawing to the screen) are never culled
+	bool _sideEffect = false;
+	bool _live = false;
+
+	FrameGraphPass& Read(FrameGraphResource resource);
+	//Fullscreen passes cover every pixel, so they don't need the target cleared
+	FrameGraphPass& Write(FrameGraphResource resource, bool clear = false);
+	FrameGraphPass& SideEffect();
+};
+
+//Builds up the passes for a frame, then runs the ones that contribute to the output
+//*Passes run in the order they're added, any pass nothing live reads from is culled
+//*Transient targets are taken from RenderTargetPool just before their first use and handed back
+// after their last, so targets with the same description alias each other through the frame
+//*Each target is cleared at most once, by the first live pass that asks for it
+class FrameGraph
+{
+public:
+	//Declares a target that only lives for this frame
+	FrameGraphResource CreateTarget(const std::string& name, const RenderTargetDesc& desc);
+	//Declares a target that lives outside the graph (shadow maps, the G-buffer)
+	FrameGraphResource ImportTarget(const std::string& name, Framebuffer* target);
+
+	//Adds a pass, declare its reads and writes on what comes back
+	//*The pass is only good until the next AddPass
+	FrameGraphPass& AddPass(const std::string& name, std::function<void(const FrameGraph&)> execute);
+
+	//Culls, allocates and runs the passes
+	void Execute();
+
+	//Gets the framebuffer behind a target, only valid while the passes using it are running
+	Framebuffer* GetTarget(FrameGraphResource resource) const;
+	const RenderTargetDesc& GetDesc(FrameGraphResource resource) const;
+
+	//Number of passes that ran and got culled last Execute
+	size_t GetLivePassCount() const;
+	size_t GetCulledPassCount() const;
+	//Number of distinct pooled targets the transients were packed into
+	size_t GetTransientTargetCount() const;
+
+private:
+	struct Resource
+	{
+		std::string _name;
+		RenderTargetDesc _desc;
+		Framebuffer* _target = nullptr;
+		bool _imported = false;
+		bool _cleared = false;
+		//First and last live pass that uses it
+		int _firstUse = -1;
+		int _lastUse = -1;
+	};
+
+	std::vector<Resource> _resources;
+	std::deque<FrameGraphPass> _passes;
+
+	size_t _livePasses = 0;
+	size_t _transientTargets = 0;
+};
@@ -69,13 +69,27 @@ void Framebuffer::Init()
 	{
 		//because we have depth we need to clear our depth bit
 		_clearFlag |= GL_DEPTH_BUFFER_BIT;
+		if (_stencilActive)
+		{
+			_clearFlag |= GL_STENCIL_BUFFER_BIT;
+		}
+
+		GLenum target = _depthLayers > 0 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+		GLenum format = _stencilActive ? GL_DEPTH24_STENCIL8 : GL_DEPTH_COMPONENT24;
 
 		//Generate the texture
 		glGenTextures(1, &_depth._texture.GetHandle());
 		//Binds the texture
-		glBindTexture(GL_TEXTURE_2D, _depth._texture.GetHandle());
+		glBindTexture(target, _depth._texture.GetHandle());
 		//Sets the texture data
-		glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, _width, _height);
+		if (_depthLayers > 0)
+		{
+			glTexStorage3D(target, 1, format, _width, _height, _depthLayers);
+		}
+		else
+		{
+			glTexStorage2D(target, 1, format, _width, _height);
+		}
 
 		//Set texture parameters
 		glTextureParameteri(_depth._texture.GetHandle(), GL_TEXTURE_MIN_FILTER, _filter);
@@ -83,10 +97,10 @@ void Framebuffer::Init()
 		glTextureParameteri(_depth._texture.GetHandle(), GL_TEXTURE_WRAP_S, _wrap);
 		glTextureParameteri(_depth._texture.GetHandle(), GL_TEXTURE_WRAP_T, _wrap);
 
-		//Sets up as a framebuffer texture
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, _depth._texture.GetHandle(), 0);
+		//Sets up as a framebuffer texture (every layer at once if it's an array)
+		glFramebufferTexture(GL_FRAMEBUFFER, _stencilActive ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT, _depth._texture.GetHandle(), 0);
 
-		glBindTexture(GL_TEXTURE_2D, GL_NONE);
+		glBindTexture(target, GL_NONE);
 	}
 
 	//If there is more than zero color attachments
@@ -131,7 +145,7 @@ void Framebuffer::Init()
 	_isInit = true;
 }
 
-void Framebuffer::AddDepthTarget()
+void Framebuffer::AddDepthTarget(bool stencil)
 {
 	//If there is a handle already, unload it
 	if (_depth._texture.GetHandle())
@@ -140,6 +154,37 @@ void Framebuffer::AddDepthTarget()
 	}
 	//Make depth active true
 	_depthActive = true;
+	_stencilActive = stencil;
+}
+
+void Framebuffer::SetDepthLayers(unsigned layers)
+{
+	_depthLayers = layers;
+}
+
+void Framebuffer::SetDrawLayer(int layer)
+{
+	GLenum attachment = _stencilActive ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+	if (layer < 0)
+	{
+		glNamedFramebufferTexture(_FBO, attachment, _depth._texture.GetHandle(), 0);
+	}
+	else
+	{
+		glNamedFramebufferTextureLayer(_FBO, attachment, _depth._texture.GetHandle(), 0, layer);
+	}
+}
+
+void Framebuffer::CopyDepthLayer(Framebuffer* source, unsigned layer)
+{
+	glCopyImageSubData(source->_depth._texture.GetHandle(), GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer,
+		_depth._texture.GetHandle(), GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, _width, _height, 1);
+}
+
+void Framebuffer::CopyDepth(Framebuffer* source)
+{
+	glCopyImageSubData(source->_depth._texture.GetHandle(), GL_TEXTURE_2D, 0, 0, 0, 0,
+		_depth._texture.GetHandle(), GL_TEXTURE_2D, 0, 0, 0, 0, _width, _height, 1);
 }
 
 void Framebuffer::AddColorTarget(GLenum format)
@@ -154,6 +199,11 @@ void Framebuffer::AddColorTarget(GLenum format)
 	_color._numAttachments++;
 }
 
+void Framebuffer::SetFilter(GLenum filter)
+{
+	_filter = filter;
+}
+
 void Framebuffer::BindDepthAsTexture(int textureSlot) const
 {
 	_depth._texture.Bind(textureSlot);
@@ -164,6 +214,12 @@ void Framebuffer::BindColorAsTexture(unsigned colorBuffer, int textureSlot) cons
 	_color._textures[colorBuffer].Bind(textureSlot);
 }
 
+void Framebuffer::BindColorAsImage(unsigned colorBuffer, int imageUnit, GLenum access)
+{
+	//Storage is immutable (glTexStorage2D) so it can be bound as an image in its own format
+	glBindImageTexture(imageUnit, _color._textures[colorBuffer].GetHandle(), 0, GL_FALSE, 0, access, _color._formats[colorBuffer]);
+}
+
 void Framebuffer::UnbindTexture(int textureSlot) const
 {
 	//Binds textures to GL_NONE
@@ -171,6 +227,19 @@ void Framebuffer::UnbindTexture(int textureSlot) const
 	glBindTexture(GL_TEXTURE_2D, GL_NONE);
 }
 
+void Framebuffer::ShareDepthTarget(Framebuffer* other)
+{
+	//Clear out whatever's attached first, depth-stencil covers both attachment points
+	glNamedFramebufferTexture(_FBO, GL_DEPTH_STENCIL_ATTACHMENT, GL_NONE, 0);
+
+	Framebuffer* source = other != nullptr ? other : this;
+	if (source->_depthActive)
+	{
+		GLenum attachment = source->_stencilActive ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+		glNamedFramebufferTexture(_FBO, attachment, source->_depth._texture.GetHandle(), 0);
+	}
+}
+
 void Framebuffer::Reshape(unsigned width, unsigned height)
 {
 	//Set size
@@ -44,21 +44,41 @@ public:
 	//Initializes framebuffer
 	void Init();
 
-	//Adds depth target
+	//Adds depth target, with a stencil buffer packed in if stencil is true
 	//**ONLY EVER ONE**//
-	void AddDepthTarget();
+	void AddDepthTarget(bool stencil = false);
+
+	//Makes the depth target an array texture with this many layers (0 for a plain texture)
+	//*Has to be called before Init, every layer is attached at once so Clear clears them all
+	void SetDepthLayers(unsigned layers);
+	//Attaches just one layer of an array depth target for drawing into, -1 attaches them all again
+	void SetDrawLayer(int layer);
+	//Copies one layer of another framebuffer's depth array into the same layer of ours, they have to match in size and format
+	void CopyDepthLayer(Framebuffer* source, unsigned layer);
+	//Copies another framebuffer's whole depth (and stencil) target into ours, they have to match in size and format
+	void CopyDepth(Framebuffer* source);
 
 	//Adds a color target
 	//**You can have as many as you want**//
 	void AddColorTarget(GLenum format);
+
+	//Sets how the targets are filtered when they're sampled
+	//*Has to be called before Init
+	void SetFilter(GLenum filter);
 	
 	//Binds our depth buffer as a texture to specified slot
 	void BindDepthAsTexture(int textureSlot) const;
 	//Binds our color buffer as a texture to specified slot
 	void BindColorAsTexture(unsigned colorBuffer, int textureSlot) const;
+	//Binds our color buffer as an image to specified unit, for compute shaders to read or write
+	void BindColorAsImage(unsigned colorBuffer, int imageUnit, GLenum access);
 	//Unbinds texture from a specific texture slot
 	void UnbindTexture(int textureSlot) const;
 
+	//Attaches another framebuffer's depth (and stencil) target in place of our own, so draws into this one can test against it
+	//*Pass nullptr to put our own back (or none), the other framebuffer has to be the same size
+	void ShareDepthTarget(Framebuffer* other);
+
 	//Reshapes the framebuffer
 	void Reshape(unsigned width, unsigned height);
 	//Sets the size of the framebuffer
@@ -113,6 +133,10 @@ protected:
 	bool _isInit = false;
 	//Depth attachment?
 	bool _depthActive = false;
+	//Stencil packed in with the depth?
+	bool _stencilActive = false;
+	//Layers in the depth array (0 if it isn't one)
+	unsigned _depthLayers = 0;
 
 	//Full screen quad VBO handle
 	static GLuint _fullscreenQuadVBO;
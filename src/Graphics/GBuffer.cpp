@@ -1,44 +1,104 @@
 #include "GBuffer.h"
+#include "Utilities/AssetRegistry.h"
 
-void GBuffer::Init(unsigned width, unsigned height)
+void GBuffer::Init(unsigned width, unsigned height, GBufferLayout layout)
 {
 	//Stores the window width and height
 	_windowWidth = width;
 	_windowHeight = height;
+	_layout = layout;
 
-	//Adds color targets to our GBuffer
-	_gBuffer.AddColorTarget(GL_RGBA8); //Albedo Buffer, needs all channels
-	_gBuffer.AddColorTarget(GL_RGB8); //Normals Buffer, does not need alpha
-	_gBuffer.AddColorTarget(GL_RGB8); //Specular Buffer, technically only needs 1 channel
-
-	//Important note, you can obtain the positional data using the depth buffer (there's a calculation that you can do)
-	//But here, we're going to use POSITION buffer
-	_gBuffer.AddColorTarget(GL_RGB32F);
+	if (_layout == GBufferLayout::Packed)
+	{
+		//Specular only ever needs one channel, so it rides in the albedo's alpha
+		_gBuffer.AddColorTarget(GL_RGBA8); //Albedo + Specular Buffer
+		//Octahedral normals only need two channels, 16 bits keeps them smooth
+		_gBuffer.AddColorTarget(GL_RG16); //Normals Buffer
+		//No position buffer, the lighting rebuilds it from depth
+	}
+	else
+	{
+		//Adds color targets to our GBuffer
+		_gBuffer.AddColorTarget(GL_RGBA8); //Albedo Buffer, needs all channels
+		_gBuffer.AddColorTarget(GL_RGB8); //Normals Buffer, does not need alpha
+		_gBuffer.AddColorTarget(GL_RGB8); //Specular Buffer, technically only needs 1 channel
+
+		//Important note, you can obtain the positional data using the depth buffer (there's a calculation that you can do)
+		//But here, we're going to use POSITION buffer
+		_gBuffer.AddColorTarget(GL_RGB32F);
+	}
 
-	//Add a depth buffer
-	_gBuffer.AddDepthTarget();
+	//Add a depth buffer, with stencil so lighting can skip pixels nothing was drawn to
+	_gBuffer.AddDepthTarget(true);
 
 	//Initializes our framebuffer
 	_gBuffer.Init(width, height);
 
+	if (_layout == GBufferLayout::Packed)
+	{
+		_depthCopy.AddDepthTarget(true);
+		_depthCopy.Init(width, height);
+	}
+
 	//Initialize pass through shader
-	_passThrough = Shader::Create();
-	_passThrough->LoadShaderPartFromFile("shaders/passthrough_vert.glsl", GL_VERTEX_SHADER);
-	_passThrough->LoadShaderPartFromFile("shaders/passthrough_frag.glsl", GL_FRAGMENT_SHADER);
-	_passThrough->Link();
+	_passThrough = AssetRegistry::GetPipeline("shaders/passthrough_vert.glsl", "shaders/passthrough_frag.glsl");
+	if (_layout == GBufferLayout::Packed)
+	{
+		_packedDebug = AssetRegistry::GetPipeline("shaders/passthrough_vert.glsl", "shaders/gBuffer_packed_debug_frag.glsl");
+	}
+}
+
+const char* GBuffer::GetPassShaderFile(GBufferLayout layout)
+{
+	return layout == GBufferLayout::Packed ? "shaders/gBuffer_packed_pass_frag.glsl" : "shaders/gBuffer_pass_frag.glsl";
+}
+
+GBufferLayout GBuffer::GetLayout() const
+{
+	return _layout;
+}
+
+void GBuffer::SetViewProjection(const glm::mat4& viewProjection)
+{
+	_viewProjection = viewProjection;
+	_inverseViewProjection = glm::inverse(viewProjection);
+}
+
+const glm::mat4& GBuffer::GetViewProjection() const
+{
+	return _viewProjection;
+}
+
+const glm::mat4& GBuffer::GetInverseViewProjection() const
+{
+	return _inverseViewProjection;
 }
 
 void GBuffer::Bind()
 {
 	_gBuffer.Bind();
+
+	//Mark everything that gets drawn
+	glEnable(GL_STENCIL_TEST);
+	glStencilFunc(GL_ALWAYS, STENCIL_GEOMETRY, 0xFF);
+	glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+	glStencilMask(0xFF);
 }
 
 void GBuffer::BindLighting()
 {
 	_gBuffer.BindColorAsTexture(Target::ALBEDO, 0);
 	_gBuffer.BindColorAsTexture(Target::NORMAL, 1);
-	_gBuffer.BindColorAsTexture(Target::SPECULAR, 2);
-	_gBuffer.BindColorAsTexture(Target::POSITION, 3);
+	if (_layout == GBufferLayout::Packed)
+	{
+		//Depth goes where the positions were, slot 2 is left empty
+		_depthCopy.BindDepthAsTexture(3);
+	}
+	else
+	{
+		_gBuffer.BindColorAsTexture(Target::SPECULAR, 2);
+		_gBuffer.BindColorAsTexture(Target::POSITION, 3);
+	}
 }
 
 void GBuffer::Clear()
@@ -46,9 +106,20 @@ void GBuffer::Clear()
 	_gBuffer.Clear();
 }
 
+FrameGraphResource GBuffer::Import(FrameGraph& graph)
+{
+	return graph.ImportTarget("G-Buffer", &_gBuffer);
+}
+
 void GBuffer::Unbind()
 {
+	glDisable(GL_STENCIL_TEST);
 	_gBuffer.Unbind();
+
+	if (_layout == GBufferLayout::Packed)
+	{
+		_depthCopy.CopyDepth(&_gBuffer);
+	}
 }
 
 void GBuffer::UnbindLighting()
@@ -59,64 +130,80 @@ void GBuffer::UnbindLighting()
 	_gBuffer.UnbindTexture(3);
 }
 
+void GBuffer::AttachDepthStencil(Framebuffer* target)
+{
+	target->ShareDepthTarget(&_gBuffer);
+}
+
+void GBuffer::DetachDepthStencil(Framebuffer* target)
+{
+	target->ShareDepthTarget(nullptr);
+}
+
+void GBuffer::BindDepth(int textureSlot) const
+{
+	_gBuffer.BindDepthAsTexture(textureSlot);
+}
+
+unsigned GBuffer::GetWidth() const
+{
+	return _gBuffer._width;
+}
+
+unsigned GBuffer::GetHeight() const
+{
+	return _gBuffer._height;
+}
+
 void GBuffer::DrawBuffersToScreen(int bufferNumber)
 {
 	bufferNum = bufferNumber;
-	//Binds passthrough shader	
-	_passThrough->Bind();
 
 	glViewport(0, 0, _windowWidth, _windowHeight);
-	if (bufferNumber == 0)
+	if (bufferNumber >= Target::ALBEDO && bufferNumber <= Target::POSITION)
 	{
-		_gBuffer.BindColorAsTexture(Target::ALBEDO, 0);
-		_gBuffer.DrawFullscreenQuad();
-		_gBuffer.UnbindTexture(0);
-	}
-	else if (bufferNumber == 1)
-	{
-		_gBuffer.BindColorAsTexture(Target::NORMAL, 0);
-		_gBuffer.DrawFullscreenQuad();
-		_gBuffer.UnbindTexture(0);
-	}
-	else if (bufferNumber == 2)
-	{
-		_gBuffer.BindColorAsTexture(Target::SPECULAR, 0);
-		_gBuffer.DrawFullscreenQuad();
-		_gBuffer.UnbindTexture(0);
-	}
-	else if (bufferNumber == 3)
-	{
-		_gBuffer.BindColorAsTexture(Target::POSITION, 0);
-		_gBuffer.DrawFullscreenQuad();
-		_gBuffer.UnbindTexture(0);
+		DrawTarget(Target(bufferNumber));
 	}
 	else
 	{
 		//Set viewport to top left
 		glViewport(0, _windowHeight / 2.0f, _windowWidth / 2.0f, _windowHeight / 2.0f);
-		_gBuffer.BindColorAsTexture(Target::ALBEDO, 0);
-		_gBuffer.DrawFullscreenQuad();
-		_gBuffer.UnbindTexture(0);
+		DrawTarget(Target::ALBEDO);
 
 		//Set viewport to top right
 		glViewport(_windowWidth / 2.0f, _windowHeight / 2.0f, _windowWidth / 2.0f, _windowHeight / 2.0f);
-		_gBuffer.BindColorAsTexture(Target::NORMAL, 0);
-		_gBuffer.DrawFullscreenQuad();
-		_gBuffer.UnbindTexture(0);
+		DrawTarget(Target::NORMAL);
 
 		//Set viewport to bottom left
 		glViewport(0, 0, _windowWidth / 2.0f, _windowHeight / 2.0f);
-		_gBuffer.BindColorAsTexture(Target::SPECULAR, 0);
-		_gBuffer.DrawFullscreenQuad();
-		_gBuffer.UnbindTexture(0);
+		DrawTarget(Target::SPECULAR);
 
 		//Set viewport to bottom right
 		glViewport(_windowWidth / 2.0f, 0, _windowWidth / 2.0f, _windowHeight / 2.0f);
-		_gBuffer.BindColorAsTexture(Target::POSITION, 0);
+		DrawTarget(Target::POSITION);
+	}
+}
+
+void GBuffer::DrawTarget(Target target)
+{
+	if (_layout == GBufferLayout::Packed)
+	{
+		//Nothing to pass through, each part has to be unpacked
+		_packedDebug->Bind();
+		_packedDebug->GetFragmentStage()->SetUniform("u_Target", int(target));
+		_packedDebug->GetFragmentStage()->SetUniformMatrix("u_InverseViewProjection", _inverseViewProjection);
+		BindLighting();
 		_gBuffer.DrawFullscreenQuad();
-		_gBuffer.UnbindTexture(0);
+		UnbindLighting();
+		_packedDebug->UnBind();
+		return;
 	}
 
+	//Binds passthrough shader	
+	_passThrough->Bind();
+	_gBuffer.BindColorAsTexture(target, 0);
+	_gBuffer.DrawFullscreenQuad();
+	_gBuffer.UnbindTexture(0);
 	//Unbind our passthrough shader
 	_passThrough->UnBind();
 }
@@ -129,6 +216,10 @@ void GBuffer::Reshape(unsigned width, unsigned height)
 
 	//Reshapes the framebuffer
 	_gBuffer.Reshape(width, height);
+	if (_layout == GBufferLayout::Packed)
+	{
+		_depthCopy.Reshape(width, height);
+	}
 }
 
 bool GBuffer::GetIsDrawing()
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Framebuffer.h"
+#include "Graphics/FrameGraph.h"
+#include "Graphics/ShaderPipeline.h"
 
 enum Target
 {
@@ -10,14 +12,38 @@ enum Target
 	POSITION,
 };
 
+//How the Gbuffer stores what the lighting passes need
+enum class GBufferLayout
+{
+	//RGBA8 albedo, RGB8 normals, RGB8 specular and RGB32F positions, plus depth
+	Full,
+	//RGBA8 albedo with specular in alpha and RG16 octahedral normals, plus depth
+	//*Positions are rebuilt from depth with the inverse view projection, so it's about half the bandwidth
+	//*Bind the depth at slot 3 where the position target used to be (a copy, see GBuffer::Unbind)
+	Packed
+};
+
 
 class GBuffer
 {
 public:
+	//Stencil value the Gbuffer pass writes wherever geometry gets drawn
+	static const GLint STENCIL_GEOMETRY = 1;
+
 	//Initialize this effects (will be overriden in each derived class)
-	void Init(unsigned width, unsigned height);
+	void Init(unsigned width, unsigned height, GBufferLayout layout = GBufferLayout::Packed);
+
+	//Gets the fragment shader materials need to write this layout
+	static const char* GetPassShaderFile(GBufferLayout layout);
+	GBufferLayout GetLayout() const;
+
+	//Sets the camera the Gbuffer was drawn with, the packed layout needs it to rebuild positions
+	void SetViewProjection(const glm::mat4& viewProjection);
+	const glm::mat4& GetViewProjection() const;
+	const glm::mat4& GetInverseViewProjection() const;
 
-	//Binds the Gbuffer
+	//Binds the Gbuffer, geometry drawn while it's bound marks the stencil with STENCIL_GEOMETRY
+	//*Turn glStencilMask off around anything that shouldn't be lit (like the skybox)
 	void Bind();
 
 	//Bind the lighting
@@ -26,12 +52,27 @@ public:
 	//Clears the Gbuffer
 	void Clear();
 
+	//Hands the Gbuffer's framebuffer to a frame graph, so passes can declare they use it
+	FrameGraphResource Import(FrameGraph& graph);
+
 	//Unbinds the Gbuffer
+	//*The packed layout copies its depth here, lighting samples the copy while the real one is attached for stencil
+	// and depth tests, sampling an attached texture would be a feedback loop
 	void Unbind();
 
 	//Unbinds the lighting
 	void UnbindLighting();
 
+	//Lends the Gbuffer's depth and stencil to a lighting target, so lighting passes can be masked to where geometry is
+	//*Lighting reads the copy made in Unbind, so nothing sampled is attached at the same time
+	void AttachDepthStencil(Framebuffer* target);
+	void DetachDepthStencil(Framebuffer* target);
+
+	//Binds just the depth to a texture slot (for building depth pyramids and the like)
+	void BindDepth(int textureSlot) const;
+	unsigned GetWidth() const;
+	unsigned GetHeight() const;
+
 	//Draws out the buffers to the screen
 	void DrawBuffersToScreen(int bufferNumber);
 
@@ -42,8 +83,19 @@ public:
 
 	void SetIsDrawing(bool _isDrawing);
 private:
+	//Draws one part of the Gbuffer into the current viewport
+	void DrawTarget(Target target);
+
 	Framebuffer _gBuffer;
-	Shader::sptr _passThrough;
+	//Copy of the depth the packed layout's lighting samples, the same format so it's a straight image copy
+	Framebuffer _depthCopy;
+	ShaderPipeline::sptr _passThrough;
+	//Unpacks the packed layout for DrawBuffersToScreen
+	ShaderPipeline::sptr _packedDebug;
+
+	GBufferLayout _layout = GBufferLayout::Packed;
+	glm::mat4 _viewProjection = glm::mat4(1.0f);
+	glm::mat4 _inverseViewProjection = glm::mat4(1.0f);
 
 	int _windowWidth;
 	int _windowHeight;
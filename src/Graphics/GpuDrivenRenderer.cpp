@@ -0,0 +1,321 @@
+#include "GpuDrivenRenderer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <Logging.h>
+
+#include "Graphics/MeshPool.h"
+#include "Graphics/SceneBVH.h"
+#include "Utilities/ShaderCache.h"
+
+namespace
+{
+	const char* CULL_SHADER_FILE = "shaders/gpu_cull_comp.glsl";
+	const char* HIZ_SHADER_FILE = "shaders/hiz_downsample_comp.glsl";
+	const GLuint CULL_GROUP_SIZE = 64;
+	const GLuint HIZ_GROUP_SIZE = 8;
+
+	//Laid out the way glMultiDrawElementsIndirect reads it
+	struct DrawElementsIndirectCommand
+	{
+		uint32_t _count;
+		uint32_t _instanceCount;
+		uint32_t _firstIndex;
+		int32_t _baseVertex;
+		uint32_t _baseInstance;
+	};
+}
+
+GpuDrivenRenderer::~GpuDrivenRenderer()
+{
+	GLuint buffers[3] = { _objectBuffer, _meshBuffer, _commandBuffer };
+	glDeleteBuffers(3, buffers);
+	if (_hiZ != 0)
+		glDeleteTextures(1, &_hiZ);
+}
+
+void GpuDrivenRenderer::Init()
+{
+	_cullShader = ShaderCache::Load({ { CULL_SHADER_FILE, GL_COMPUTE_SHADER } });
+	_hiZShader = ShaderCache::Load({ { HIZ_SHADER_FILE, GL_COMPUTE_SHADER } });
+	if (_cullShader == nullptr || _hiZShader == nullptr)
+	{
+		LOG_WARN("GPU driven culling shaders did not load, nothing will be drawn through it");
+	}
+}
+
+void GpuDrivenRenderer::Begin()
+{
+	_objects.clear();
+	_batches.clear();
+	_commandSets = 0;
+
+	size_t meshes = _stats._meshes;
+	_stats = GpuDrivenStats();
+	_stats._meshes = meshes;
+}
+
+bool GpuDrivenRenderer::Add(const RendererComponent& renderer, const Transform& transform, const LODComponent* lod, uint32_t flags)
+{
+	if (lod == nullptr || lod->GetChain() == nullptr)
+	{
+		_stats._fallbacks++;
+		return false;
+	}
+
+	//Still loading, it has nothing to draw in either path
+	const MeshLODChain* chain = lod->GetChain().get();
+	if (chain->_levels.empty() || chain->_levels[0]._poolRange._indexCount == 0)
+		return true;
+
+	MeshPoolObject object;
+	object._model = transform.WorldTransform();
+	object._normalMatrix = glm::mat4(transform.WorldNormalMatrix());
+	object._mesh = GetMeshIndex(chain);
+	object._flags = flags;
+	object._albedoIndex = 0;
+	object._padding = 0;
+
+	//Runs of the same material share a draw
+	if (_batches.empty() || _batches.back()._material != renderer.Material)
+	{
+		Batch batch;
+		batch._material = renderer.Material;
+		batch._first = uint32_t(_objects.size());
+		_batches.push_back(batch);
+	}
+	_batches.back()._count++;
+	_objects.push_back(object);
+	return true;
+}
+
+void GpuDrivenRenderer::Upload()
+{
+	_stats._objects = _objects.size();
+	if (_objects.empty())
+		return;
+
+	//Everything's rewritten each frame, so the old contents can go
+	Reserve(_objectBuffer, _objectCapacity, _objects.size() * sizeof(MeshPoolObject));
+	glNamedBufferSubData(_objectBuffer, 0, _objects.size() * sizeof(MeshPoolObject), _objects.data());
+	Reserve(_commandBuffer, _commandCapacity, _objects.size() * MAX_CULL_PASSES * sizeof(DrawElementsIndirectCommand));
+	MeshPool::ReserveObjects(_objects.size());
+
+	if (_meshesDirty || _meshBuffer == 0)
+	{
+		Reserve(_meshBuffer, _meshCapacity, _meshes.size() * sizeof(GpuMesh));
+		glNamedBufferSubData(_meshBuffer, 0, _meshes.size() * sizeof(GpuMesh), _meshes.data());
+		_meshesDirty = false;
+	}
+}
+
+int GpuDrivenRenderer::Cull(const glm::mat4& viewProjection, const LODView& lodView, uint32_t flagMask, uint32_t flagValue, bool occlusion)
+{
+	if (_cullShader == nullptr || _objects.empty())
+		return -1;
+	if (_commandSets >= MAX_CULL_PASSES)
+	{
+		LOG_WARN("Ran out of GPU driven command sets this frame, only {} cull passes fit", MAX_CULL_PASSES);
+		return -1;
+	}
+	int commandSet = _commandSets++;
+
+	Frustum frustum = Frustum::FromMatrix(viewProjection);
+	GLuint handle = _cullShader->GetHandle();
+	_cullShader->Bind();
+	_cullShader->SetUniform("u_ObjectCount", int(_objects.size()));
+	_cullShader->SetUniform("u_CommandOffset", int(commandSet * _objects.size()));
+	_cullShader->SetUniform("u_FlagMask", int(flagMask));
+	_cullShader->SetUniform("u_FlagValue", int(flagValue));
+	glProgramUniform4fv(handle, glGetUniformLocation(handle, "u_Planes"), 6, &frustum._planes[0][0]);
+
+	_cullShader->SetUniform("u_CameraPosition", lodView._cameraPosition);
+	_cullShader->SetUniform("u_ProjectionScale", lodView._projectionScale);
+	_cullShader->SetUniform("u_Orthographic", lodView._orthographic ? 1 : 0);
+	_cullShader->SetUniform("u_HalfScreenHeight", lodView._halfScreenHeight);
+	_cullShader->SetUniform("u_AllowedError", lodView._allowedError);
+
+	bool useHiZ = occlusion && _hiZValid;
+	_cullShader->SetUniform("u_Occlusion", useHiZ ? 1 : 0);
+	if (useHiZ)
+	{
+		_cullShader->SetUniformMatrix("u_HiZViewProjection", _hiZViewProjection);
+		_cullShader->SetUniform("u_HiZSize", glm::vec2(_hiZWidth, _hiZHeight));
+		_cullShader->SetUniform("u_HiZLevels", _hiZLevels);
+		glBindTextureUnit(0, _hiZ);
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MeshPool::OBJECT_BINDING, _objectBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MESH_BINDING, _meshBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, _commandBuffer);
+	glDispatchCompute(GLuint((_objects.size() + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE), 1, 1);
+	//The draws read the commands straight after
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MESH_BINDING, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, 0);
+	if (useHiZ)
+		glBindTextureUnit(0, 0);
+	_cullShader->UnBind();
+
+	_stats._cullDispatches++;
+	return commandSet;
+}
+
+void GpuDrivenRenderer::DrawMaterials(int commandSet)
+{
+	if (commandSet < 0)
+		return;
+
+	size_t setOffset = size_t(commandSet) * _objects.size();
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MeshPool::OBJECT_BINDING, _objectBuffer);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer);
+	MeshPool::Bind();
+
+	Shader::sptr current = nullptr;
+	for (const Batch& batch : _batches)
+	{
+		const Shader::sptr& shader = batch._material->Shader;
+		if (shader != current)
+		{
+			current = shader;
+			shader->Bind();
+			shader->SetUniform("u_GpuDriven", 1);
+		}
+		batch._material->Apply();
+
+		const void* offset = reinterpret_cast<const void*>((setOffset + batch._first) * sizeof(DrawElementsIndirectCommand));
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, offset, GLsizei(batch._count), 0);
+		_stats._drawCalls++;
+	}
+
+	//Back to uniforms for everything drawn the normal way
+	for (const Batch& batch : _batches)
+	{
+		batch._material->Shader->SetUniform("u_GpuDriven", 0);
+	}
+
+	MeshPool::Unbind();
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MeshPool::OBJECT_BINDING, 0);
+	if (current != nullptr)
+		current->UnBind();
+}
+
+void GpuDrivenRenderer::DrawDepth(int commandSet, const Shader::sptr& shader, const glm::mat4& viewProjection)
+{
+	if (commandSet < 0)
+		return;
+
+	//Every batch's commands sit next to each other, so without materials it's one draw
+	size_t setOffset = size_t(commandSet) * _objects.size();
+	shader->Bind();
+	shader->SetUniform("u_GpuDriven", 1);
+	shader->SetUniformMatrix("u_LightSpaceMatrix", viewProjection);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MeshPool::OBJECT_BINDING, _objectBuffer);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer);
+	MeshPool::Bind();
+
+	const void* offset = reinterpret_cast<const void*>(setOffset * sizeof(DrawElementsIndirectCommand));
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, offset, GLsizei(_objects.size()), 0);
+	_stats._drawCalls++;
+
+	MeshPool::Unbind();
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MeshPool::OBJECT_BINDING, 0);
+	shader->SetUniform("u_GpuDriven", 0);
+	shader->UnBind();
+}
+
+void GpuDrivenRenderer::BuildHiZ(GBuffer* gBuffer, const glm::mat4& viewProjection)
+{
+	if (_hiZShader == nullptr)
+		return;
+
+	int width = int(gBuffer->GetWidth());
+	int height = int(gBuffer->GetHeight());
+	if (width != _hiZWidth || height != _hiZHeight || _hiZ == 0)
+	{
+		if (_hiZ != 0)
+			glDeleteTextures(1, &_hiZ);
+		_hiZWidth = width;
+		_hiZHeight = height;
+		_hiZLevels = 1 + int(std::floor(std::log2(float(std::max(width, height)))));
+		glCreateTextures(GL_TEXTURE_2D, 1, &_hiZ);
+		glTextureStorage2D(_hiZ, _hiZLevels, GL_R32F, width, height);
+		glTextureParameteri(_hiZ, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glTextureParameteri(_hiZ, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTextureParameteri(_hiZ, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(_hiZ, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+
+	_hiZShader->Bind();
+	int levelWidth = width;
+	int levelHeight = height;
+	for (int level = 0; level < _hiZLevels; level++)
+	{
+		//Level 0 is a straight copy of the depth, each one after keeps the furthest of the texels under it
+		if (level == 0)
+		{
+			gBuffer->BindDepth(0);
+		}
+		else
+		{
+			glBindTextureUnit(0, _hiZ);
+		}
+		_hiZShader->SetUniform("u_SourceLevel", level == 0 ? 0 : level - 1);
+		glBindImageTexture(0, _hiZ, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glDispatchCompute(GLuint((levelWidth + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE), GLuint((levelHeight + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE), 1);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+		levelWidth = std::max(levelWidth / 2, 1);
+		levelHeight = std::max(levelHeight / 2, 1);
+	}
+	glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+	glBindTextureUnit(0, 0);
+	_hiZShader->UnBind();
+
+	_hiZViewProjection = viewProjection;
+	_hiZValid = true;
+}
+
+const GpuDrivenStats& GpuDrivenRenderer::GetStats() const
+{
+	return _stats;
+}
+
+uint32_t GpuDrivenRenderer::GetMeshIndex(const MeshLODChain* chain)
+{
+	//Only a handful of chains, a linear search is fine
+	auto it = std::find(_meshChains.begin(), _meshChains.end(), chain);
+	if (it != _meshChains.end())
+		return uint32_t(it - _meshChains.begin());
+
+	GpuMesh mesh = {};
+	mesh._sphere = glm::vec4(chain->_centre, chain->_radius);
+	mesh._levelCount = uint32_t(std::min<size_t>(chain->_levels.size(), 4));
+	for (uint32_t i = 0; i < mesh._levelCount; i++)
+	{
+		const MeshLODLevel& level = chain->_levels[i];
+		mesh._levels[i] = { level._poolRange._firstIndex, level._poolRange._indexCount, level._poolRange._baseVertex, level._error };
+	}
+
+	_meshChains.push_back(chain);
+	_meshes.push_back(mesh);
+	_meshesDirty = true;
+	_stats._meshes = _meshes.size();
+	return uint32_t(_meshes.size() - 1);
+}
+
+void GpuDrivenRenderer::Reserve(GLuint& buffer, size_t& capacity, size_t size)
+{
+	if (buffer != 0 && size <= capacity)
+		return;
+
+	capacity = std::max(size, capacity * 2);
+	if (buffer != 0)
+		glDeleteBuffers(1, &buffer);
+	glCreateBuffers(1, &buffer);
+	glNamedBufferData(buffer, GLsizeiptr(capacity), nullptr, GL_DYNAMIC_DRAW);
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+#include <Shader.h>
+#include <ShaderMaterial.h>
+#include <RendererComponent.h>
+#include <Transform.h>
+
+#include "Graphics/GBuffer.h"
+#include "Graphics/LODComponent.h"
+
+//Flags each object carries, culling passes can pick objects by them
+enum GpuObjectFlags : uint32_t
+{
+	GPU_OBJECT_CASTS_SHADOWS = 1,
+	//Has behaviours, so it can move (shadow caching draws these separately)
+	GPU_OBJECT_DYNAMIC = 2
+};
+
+//Per frame numbers for the GPU driven path
+struct GpuDrivenStats
+{
+	size_t _objects = 0;
+	size_t _meshes = 0;
+	//Multi draw calls issued, this is all the CPU submits no matter how many objects there are
+	size_t _drawCalls = 0;
+	size_t _cullDispatches = 0;
+	//Renderers that couldn't be pooled (no LOD chain), they get drawn the normal way
+	size_t _fallbacks = 0;
+};
+
+//GPU driven drawing, objects live in SSBOs and a compute shader culls them and writes the draw commands
+//*Every LOD level is in the MeshPool, so each material's objects go out in one glMultiDrawElementsIndirect
+//*The cull shader does frustum culling, Hi-Z occlusion culling against last frame's depth pyramid and LOD selection,
+// and writes one command per object (culled ones get zero instances)
+//*Objects are added in material order each frame, each run of one material is a batch with its own draw
+//*Shaders read their model matrix from the object buffer when u_GpuDriven is set, using the object id
+// MeshPool feeds in from the command's baseInstance
+class GpuDrivenRenderer
+{
+public:
+	//SSBO bindings the cull shader uses (objects are at MeshPool::OBJECT_BINDING)
+	static const GLuint MESH_BINDING = 5;
+	static const GLuint COMMAND_BINDING = 6;
+	//Cull calls allowed per frame (the camera, plus static and dynamic for every cascade)
+	static const int MAX_CULL_PASSES = 9;
+
+	GpuDrivenRenderer() = default;
+	~GpuDrivenRenderer();
+
+	GpuDrivenRenderer(const GpuDrivenRenderer&) = delete;
+	GpuDrivenRenderer& operator=(const GpuDrivenRenderer&) = delete;
+
+	//Loads the compute shaders
+	void Init();
+
+	//Starts a frame's object list
+	void Begin();
+	//Adds an object, call these in material order
+	//*Returns false if it can't be drawn this way (no LOD chain), draw it the normal way instead
+	bool Add(const RendererComponent& renderer, const Transform& transform, const LODComponent* lod, uint32_t flags);
+	//Uploads the objects (and any meshes that are new)
+	void Upload();
+
+	//Culls every object whose flags & flagMask == flagValue into a new set of commands, returns the set
+	//*occlusion tests against the depth pyramid from the last BuildHiZ
+	int Cull(const glm::mat4& viewProjection, const LODView& lodView, uint32_t flagMask, uint32_t flagValue, bool occlusion);
+
+	//Draws a set of commands into the Gbuffer, applying each batch's material
+	//*Camera matrices and position come from the frame block (BackendHandler::SetFrameUniforms)
+	void DrawMaterials(int commandSet);
+	//Draws a set of commands with one depth only shader, in one call
+	void DrawDepth(int commandSet, const Shader::sptr& shader, const glm::mat4& viewProjection);
+
+	//Builds the depth pyramid from the Gbuffer's depth, next frame's occlusion culling tests against it
+	void BuildHiZ(GBuffer* gBuffer, const glm::mat4& viewProjection);
+
+	const GpuDrivenStats& GetStats() const;
+
+private:
+	//One LOD level as the cull shader reads it
+	struct GpuMeshLevel
+	{
+		uint32_t _firstIndex;
+		uint32_t _indexCount;
+		int32_t _baseVertex;
+		float _error;
+	};
+
+	//One LOD chain as the cull shader reads it
+	struct GpuMesh
+	{
+		//Object space bounding sphere, radius in w
+		glm::vec4 _sphere;
+		GpuMeshLevel _levels[4];
+		uint32_t _levelCount;
+		uint32_t _padding[3];
+	};
+
+	//A run of objects that share a material
+	struct Batch
+	{
+		ShaderMaterial::sptr _material;
+		uint32_t _first = 0;
+		uint32_t _count = 0;
+	};
+
+	//Gets (or adds) the mesh entry for a chain
+	uint32_t GetMeshIndex(const MeshLODChain* chain);
+	//Makes sure a buffer holds at least size bytes, its contents don't survive
+	static void Reserve(GLuint& buffer, size_t& capacity, size_t size);
+
+	Shader::sptr _cullShader;
+	Shader::sptr _hiZShader;
+
+	std::vector<MeshPoolObject> _objects;
+	std::vector<GpuMesh> _meshes;
+	std::vector<const MeshLODChain*> _meshChains;
+	bool _meshesDirty = false;
+	std::vector<Batch> _batches;
+
+	GLuint _objectBuffer = 0;
+	GLuint _meshBuffer = 0;
+	GLuint _commandBuffer = 0;
+	size_t _objectCapacity = 0;
+	size_t _meshCapacity = 0;
+	size_t _commandCapacity = 0;
+	//Command sets used so far this frame
+	int _commandSets = 0;
+
+	//Max depth pyramid of last frame's depth
+	GLuint _hiZ = 0;
+	int _hiZWidth = 0;
+	int _hiZHeight = 0;
+	int _hiZLevels = 0;
+	bool _hiZValid = false;
+	//What the pyramid was drawn with
+	glm::mat4 _hiZViewProjection = glm::mat4(1.0f);
+
+	GpuDrivenStats _stats;
+};
@@ -0,0 +1,58 @@
+#include "GpuTimer.h"
+
+GpuTimer::~GpuTimer()
+{
+	if (_queries[0] != 0)
+	{
+		glDeleteQueries(QUERY_COUNT, _queries);
+	}
+}
+
+void GpuTimer::Begin()
+{
+	if (_queries[0] == 0)
+	{
+		glGenQueries(QUERY_COUNT, _queries);
+	}
+
+	//Pick up any queries that have finished since last time
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		int index = (_current + i) % QUERY_COUNT;
+		if (!_pending[index])
+			continue;
+
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(_queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available != GL_TRUE)
+			break;
+
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(_queries[index], GL_QUERY_RESULT, &elapsed);
+		_milliseconds = float(double(elapsed) / 1000000.0);
+		_pending[index] = false;
+	}
+
+	//Every query is still in flight, skip timing this one rather than wait
+	if (_pending[_current])
+		return;
+
+	glBeginQuery(GL_TIME_ELAPSED, _queries[_current]);
+	_running = true;
+}
+
+void GpuTimer::End()
+{
+	if (!_running)
+		return;
+
+	glEndQuery(GL_TIME_ELAPSED);
+	_pending[_current] = true;
+	_current = (_current + 1) % QUERY_COUNT;
+	_running = false;
+}
+
+float GpuTimer::GetMilliseconds() const
+{
+	return _milliseconds;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <glad/glad.h>
+
+//Times a span of GL commands on the GPU without stalling
+//*Queries go round a small ring and are only read back once the driver says they're done,
+// so the time reported is from a few frames ago
+//*Only one timer can be running at a time (GL_TIME_ELAPSED queries can't nest)
+class GpuTimer
+{
+public:
+	GpuTimer() = default;
+	~GpuTimer();
+
+	GpuTimer(const GpuTimer&) = delete;
+	GpuTimer& operator=(const GpuTimer&) = delete;
+
+	void Begin();
+	void End();
+
+	//Most recent finished time, in milliseconds
+	float GetMilliseconds() const;
+
+private:
+	static const int QUERY_COUNT = 4;
+
+	GLuint _queries[QUERY_COUNT] = {};
+	//Whether each query has been started and not read back yet
+	bool _pending[QUERY_COUNT] = {};
+	int _current = 0;
+	bool _running = false;
+	float _milliseconds = 0.0f;
+};
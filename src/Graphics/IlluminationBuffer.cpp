@@ -1,33 +1,41 @@
 #include "IlluminationBuffer.h"
+#include "Utilities/AssetRegistry.h"
+
+namespace
+{
+	//Matches STACKS and SLICES in light_volume_vert.glsl
+	const int VOLUME_VERTEX_COUNT = 8 * 12 * 6;
+
+	//The light volumes are generated from gl_VertexID, but a VAO still has to be bound to draw
+	GLuint GetEmptyVao()
+	{
+		static GLuint vao = 0;
+		if (vao == 0)
+		{
+			glCreateVertexArrays(1, &vao);
+		}
+		return vao;
+	}
+}
 
 void IlluminationBuffer::Init(unsigned width, unsigned height)
 {
-	//Composite Buffer
-	int index = int(_buffers.size());
-	_buffers.push_back(new Framebuffer());
-	_buffers[index]->AddColorTarget(GL_RGBA8);
-	_buffers[index]->AddDepthTarget();
-	_buffers[index]->Init(width, height);
-
-	//Illum buffer
-	index = int(_buffers.size());
-	_buffers.push_back(new Framebuffer());
-	_buffers[index]->AddColorTarget(GL_RGBA8);
-	_buffers[index]->AddDepthTarget();
-	_buffers[index]->Init(width, height);
-
-	index = int(_shaders.size());
-	_shaders.push_back(Shader::Create());
-	_shaders[index]->LoadShaderPartFromFile("shaders/passthrough_vert.glsl", GL_VERTEX_SHADER);
-	_shaders[index]->LoadShaderPartFromFile("shaders/gBuffer_directional_frag.glsl", GL_FRAGMENT_SHADER);
-	_shaders[index]->Link();
+	AddShader("shaders/gBuffer_directional_frag.glsl");
 
 	//Loads the ambient gBuffer shader
-	index = int(_shaders.size());
-	_shaders.push_back(Shader::Create());
-	_shaders[index]->LoadShaderPartFromFile("shaders/passthrough_vert.glsl", GL_VERTEX_SHADER);
-	_shaders[index]->LoadShaderPartFromFile("shaders/gBuffer_ambient_frag.glsl", GL_FRAGMENT_SHADER);
-	_shaders[index]->Link();
+	AddShader("shaders/gBuffer_ambient_frag.glsl");
+
+	//Loads the directional shader for the packed gBuffer layout
+	AddShader("shaders/gBuffer_packed_directional_frag.glsl");
+
+	//Loads the clustered point light shader
+	AddShader("shaders/gBuffer_point_lights_frag.glsl");
+
+	//Loads the shader that fills in pixels without geometry
+	AddShader("shaders/gBuffer_background_frag.glsl");
+
+	//Point light volumes need their own vertex stage
+	_volumePipeline = AssetRegistry::GetPipeline("shaders/light_volume_vert.glsl", "shaders/gBuffer_light_volume_frag.glsl");
 
 	_sunBuffer.AllocateMemory(sizeof(DirectionalLight));
 
@@ -37,78 +45,151 @@ void IlluminationBuffer::Init(unsigned width, unsigned height)
 		_sunBuffer.SendData(reinterpret_cast<void*>(&_sun), sizeof(DirectionalLight));
 	}
 
+	Texture2DDescription desc = Texture2DDescription();
+	desc.Width = 1;
+	desc.Height = 1;
+	desc.Format = InternalFormat::RGBA8;
+	_skybox = Texture2D::Create(desc);
+	//Clear it with a white colour
+	_skybox->Clear();
+
 	PostEffect::Init(width, height);
 }
 
-void IlluminationBuffer::ApplyEffect(GBuffer* gBuffer)
+FrameGraphResource IlluminationBuffer::AddPasses(FrameGraph& graph, GBuffer* gBuffer, FrameGraphResource gBufferTarget, FrameGraphResource shadowMap,
+	FrameGraphResource* lightAccumulation)
 {
-	_sunBuffer.SendData(reinterpret_cast<void*>(&_sun), sizeof(DirectionalLight));
-	if (_sunEnabled)
+	//A lighting shader didn't compile (already logged), show the unlit Gbuffer rather than nothing
+	if (!_loaded)
 	{
-		//Binds directional light shader
-		_shaders[Lights::DIRECTIONAL]->Bind();
-		_shaders[Lights::DIRECTIONAL]->SetUniformMatrix("u_LightSpaceMatrix", _lightSpaceViewProj);
-		_shaders[Lights::DIRECTIONAL]->SetUniform("u_CamPos", _camPos);
+		if (lightAccumulation != nullptr)
+			*lightAccumulation = gBufferTarget;
+		return gBufferTarget;
+	}
+
+	FrameGraphResource illum = graph.CreateTarget("Light Accumulation", GetTargetDesc());
+	FrameGraphResource composite = graph.CreateTarget("Lit Composite", GetTargetDesc());
+
+	//Every lighting pass is masked by the Gbuffer's stencil, so only pixels with geometry get shaded
+	//*The background keeps the light accumulation's clear colour (white)
+	//*Without the sun there's nothing to overwrite the clear, so it's cleared to black for the point lights to add to
+	graph.AddPass("Directional Light", [this, gBuffer, shadowMap, illum](const FrameGraph& frame) {
+		_sunBuffer.SendData(reinterpret_cast<void*>(&_sun), sizeof(DirectionalLight));
+		if (!_sunEnabled)
+		{
+			const GLfloat black[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+			Framebuffer* target = frame.GetTarget(illum);
+			target->Bind();
+			glClearBufferfv(GL_COLOR, 0, black);
+			target->Unbind();
+			return;
+		}
+
+		//Binds directional light shader for the gBuffer's layout
+		int directional = gBuffer->GetLayout() == GBufferLayout::Packed ? Lights::DIRECTIONAL_PACKED : Lights::DIRECTIONAL;
+		BindShader(directional);
+		_shadows->SetUniforms(_shaders[directional]);
+		if (directional == Lights::DIRECTIONAL_PACKED)
+		{
+			_shaders[directional]->SetUniformMatrix("u_InverseViewProjection", gBuffer->GetInverseViewProjection());
+		}
 
 		//Send the directional light data and bind it
 		_sunBuffer.Bind(0);
 
 		gBuffer->BindLighting();
+		frame.GetTarget(shadowMap)->BindDepthAsTexture(30);
 
-		//Binds and draws to the illumination buffer
-		_buffers[1]->RenderToFSQ();
+		//Draws to the illumination buffer wherever there's geometry
+		DrawMasked(gBuffer, frame.GetTarget(illum), GL_EQUAL);
+		UnbindTexture(30);
 		gBuffer->UnbindLighting();
 
 		//Unbinds the uniform buffer
 		_sunBuffer.Unbind(0);
 
 		//Unbind shader
-		_shaders[Lights::DIRECTIONAL]->UnBind();
-	}
+		UnbindShader();
+	}).Read(gBufferTarget).Read(shadowMap).Write(illum, true);
 
-	//Binds ambient shader
-	_shaders[Lights::AMBIENT]->Bind();
+	if (_pointLights != nullptr)
+	{
+		//Added on top of the sun
+		graph.AddPass("Point Lights", [this, gBuffer, illum](const FrameGraph& frame) {
+			if (_pointLights->GetLightsRef().empty())
+				return;
 
-	//Send the directional light data
-	_sunBuffer.Bind(0);
+			_pointLights->Bind();
+			gBuffer->BindLighting();
 
-	gBuffer->BindLighting();
-	_buffers[1]->BindColorAsTexture(0, 4);
-	_buffers[0]->BindColorAsTexture(0, 5);
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_ONE, GL_ONE);
+			if (_pointLightMode == PointLightMode::Volumes)
+			{
+				DrawLightVolumes(gBuffer, frame.GetTarget(illum));
+			}
+			else
+			{
+				//Each pixel only loops over the lights in its cluster
+				const Shader::sptr& shader = _shaders[Lights::POINT_LIGHTS];
+				BindShader(Lights::POINT_LIGHTS);
+				shader->SetUniform("u_Packed", gBuffer->GetLayout() == GBufferLayout::Packed ? 1 : 0);
+				shader->SetUniformMatrix("u_InverseViewProjection", gBuffer->GetInverseViewProjection());
+				shader->SetUniformMatrix("u_View", _pointLights->GetView());
+				shader->SetUniform("u_ClusterCounts", glm::ivec3(ClusteredLights::TILES_X, ClusteredLights::TILES_Y, ClusteredLights::SLICES));
+				shader->SetUniform("u_ScreenSize", glm::vec2(float(_width), float(_height)));
+				shader->SetUniform("u_SliceScaleBias", _pointLights->GetSliceScaleBias());
 
-	_buffers[0]->RenderToFSQ();
+				DrawMasked(gBuffer, frame.GetTarget(illum), GL_EQUAL);
+				UnbindShader();
+			}
+			glDisable(GL_BLEND);
 
-	_buffers[0]->UnbindTexture(5);
-	_buffers[0]->UnbindTexture(4);
-	gBuffer->UnbindLighting();
+			gBuffer->UnbindLighting();
+			_pointLights->Unbind();
+		}).Read(gBufferTarget).Read(illum).Write(illum);
+	}
 
-	//Unbinds uniform buffer
-	_sunBuffer.Unbind(0);
+	//Lit pixels get the ambient composite, the rest just get their albedo (clear colour or skybox)
+	graph.AddPass("Ambient Composite", [this, gBuffer, illum, composite](const FrameGraph& frame) {
+		Framebuffer* target = frame.GetTarget(composite);
+		gBuffer->BindLighting();
 
-	_shaders[Lights::AMBIENT]->UnBind();
-}
+		//Binds ambient shader
+		BindShader(Lights::AMBIENT);
 
-void IlluminationBuffer::DrawIllumBuffer()
-{
-	_shaders[_shaders.size() - 1]->Bind();
+		//Send the directional light data
+		_sunBuffer.Bind(0);
 
-	_buffers[1]->BindColorAsTexture(0, 0);
+		frame.GetTarget(illum)->BindColorAsTexture(0, 4);
+		_skybox->Bind(5);
 
-	Framebuffer::DrawFullscreenQuad();
+		DrawMasked(gBuffer, target, GL_EQUAL);
 
-	_buffers[1]->UnbindTexture(0);
+		UnbindTexture(5);
+		UnbindTexture(4);
 
-	_shaders[_shaders.size() - 1]->UnBind();
-}
+		//Unbinds uniform buffer
+		_sunBuffer.Unbind(0);
 
-void IlluminationBuffer::SetLightSpaceViewProj(glm::mat4 lightSpaceViewProj)
-{
-	_lightSpaceViewProj = lightSpaceViewProj;
+		BindShader(Lights::BACKGROUND);
+		DrawMasked(gBuffer, target, GL_NOTEQUAL);
+
+		gBuffer->UnbindLighting();
+		UnbindShader();
+	}).Read(gBufferTarget).Read(illum).Write(composite);
+
+	if (lightAccumulation != nullptr)
+	{
+		*lightAccumulation = illum;
+	}
+
+	return composite;
 }
 
-void IlluminationBuffer::SetCamPos(glm::vec3 camPos)
+void IlluminationBuffer::SetShadows(CascadedShadows* shadows)
 {
-	_camPos = camPos;
+	_shadows = shadows;
 }
 
 DirectionalLight& IlluminationBuffer::GetSunRef()
@@ -131,3 +212,77 @@ void IlluminationBuffer::EnableSun(bool enabled)
 {
 	_sunEnabled = enabled;
 }
+
+void IlluminationBuffer::SetPointLights(ClusteredLights* pointLights)
+{
+	_pointLights = pointLights;
+}
+
+void IlluminationBuffer::SetPointLightMode(PointLightMode mode)
+{
+	_pointLightMode = mode;
+}
+
+PointLightMode IlluminationBuffer::GetPointLightMode() const
+{
+	return _pointLightMode;
+}
+
+void IlluminationBuffer::DrawMasked(GBuffer* gBuffer, Framebuffer* target, GLenum stencilFunc)
+{
+	gBuffer->AttachDepthStencil(target);
+
+	//Stencil only, a fullscreen pass has nothing to depth test
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_STENCIL_TEST);
+	glStencilFunc(stencilFunc, GBuffer::STENCIL_GEOMETRY, 0xFF);
+	glStencilMask(0x00);
+
+	target->RenderToFSQ();
+
+	glStencilMask(0xFF);
+	glDisable(GL_STENCIL_TEST);
+	glEnable(GL_DEPTH_TEST);
+
+	gBuffer->DetachDepthStencil(target);
+}
+
+void IlluminationBuffer::DrawLightVolumes(GBuffer* gBuffer, Framebuffer* target)
+{
+	const Shader::sptr& shader = _volumePipeline->GetFragmentStage();
+	_volumePipeline->Bind();
+	_volumePipeline->GetVertexStage()->SetUniformMatrix("u_ViewProjection", gBuffer->GetViewProjection());
+	shader->SetUniform("u_Packed", gBuffer->GetLayout() == GBufferLayout::Packed ? 1 : 0);
+	shader->SetUniformMatrix("u_InverseViewProjection", gBuffer->GetInverseViewProjection());
+	shader->SetUniform("u_ScreenSize", glm::vec2(float(_width), float(_height)));
+
+	gBuffer->AttachDepthStencil(target);
+	target->SetViewport();
+	target->Bind();
+
+	//Back faces that are behind the geometry, so only pixels the volume could reach are shaded
+	//*Works with the camera inside a volume too, depth clamp keeps back faces past the far plane
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_GEQUAL);
+	glDepthMask(GL_FALSE);
+	glEnable(GL_DEPTH_CLAMP);
+	glCullFace(GL_FRONT);
+	glEnable(GL_STENCIL_TEST);
+	glStencilFunc(GL_EQUAL, GBuffer::STENCIL_GEOMETRY, 0xFF);
+	glStencilMask(0x00);
+
+	glBindVertexArray(GetEmptyVao());
+	glDrawArraysInstanced(GL_TRIANGLES, 0, VOLUME_VERTEX_COUNT, GLsizei(_pointLights->GetLightsRef().size()));
+	glBindVertexArray(0);
+
+	glStencilMask(0xFF);
+	glDisable(GL_STENCIL_TEST);
+	glCullFace(GL_BACK);
+	glDisable(GL_DEPTH_CLAMP);
+	glDepthMask(GL_TRUE);
+	glDepthFunc(GL_LEQUAL);
+
+	target->Unbind();
+	gBuffer->DetachDepthStencil(target);
+	ShaderPipeline::UnBind();
+}
@@ -5,11 +5,28 @@
 #include "GBuffer.h"
 #include "PointLight.h"
 #include "DirectionalLight.h"
+#include "ClusteredLights.h"
+#include "CascadedShadows.h"
 
 enum Lights
 {
 	DIRECTIONAL,
-	AMBIENT
+	AMBIENT,
+	//Directional light for GBufferLayout::Packed, ambient only reads albedo RGB so it works with both
+	DIRECTIONAL_PACKED,
+	//Clustered point lights, handles both layouts
+	POINT_LIGHTS,
+	//Copies albedo for pixels without geometry
+	BACKGROUND
+};
+
+//How the point lights are drawn
+enum class PointLightMode
+{
+	//One fullscreen pass, each pixel loops over the lights in its cluster
+	Clustered,
+	//A bounding sphere per light, each pixel only pays for the lights that actually cover it
+	Volumes
 };
 
 //This is a post effect to make our job easier
@@ -20,15 +37,15 @@ public:
 	//Overrides post effect Init
 	void Init(unsigned width, unsigned height) override;
 	
-	//Makes it so apply effect with a PostEffect does nothing for this object
-	void ApplyEffect(PostEffect* buffer) override { };
-	//Can only apply effect using GBuffer object
-	void ApplyEffect(GBuffer* gBuffer);
-
-	void DrawIllumBuffer();
+	//Makes it so adding passes with just an input does nothing for this object
+	FrameGraphResource AddPasses(FrameGraph& graph, FrameGraphResource input) override { return input; };
+	//Adds the directional light and ambient composite passes, reading the Gbuffer and shadow map
+	//*Returns the lit image, lightAccumulation (if given) gets the target with just the light in it
+	FrameGraphResource AddPasses(FrameGraph& graph, GBuffer* gBuffer, FrameGraphResource gBufferTarget, FrameGraphResource shadowMap,
+		FrameGraphResource* lightAccumulation = nullptr);
 
-	void SetLightSpaceViewProj(glm::mat4 lightSpaceViewProj);
-	void SetCamPos(glm::vec3 camPos);
+	//Sets the sun's shadow cascades, the shadow map passed to AddPasses has to be theirs
+	void SetShadows(CascadedShadows* shadows);
 
 	DirectionalLight& GetSunRef();
 	
@@ -38,13 +55,29 @@ public:
 
 	void EnableSun(bool enabled);
 
+	//Sets the clustered point lights added after the sun, nullptr turns them off
+	//*Update them for this frame's camera before the graph executes
+	void SetPointLights(ClusteredLights* pointLights);
+	void SetPointLightMode(PointLightMode mode);
+	PointLightMode GetPointLightMode() const;
+
 private:
-	glm::mat4 _lightSpaceViewProj;
-	glm::vec3 _camPos;
+	//Draws a fullscreen pass into target, only where the Gbuffer's stencil passes stencilFunc against STENCIL_GEOMETRY
+	void DrawMasked(GBuffer* gBuffer, Framebuffer* target, GLenum stencilFunc);
+	//Draws every point light's volume into target
+	void DrawLightVolumes(GBuffer* gBuffer, Framebuffer* target);
+
+	CascadedShadows* _shadows = nullptr;
 
 	UniformBuffer _sunBuffer;
+	//Stands in for the skybox the ambient pass multiplies by, white so it leaves the lighting alone
+	Texture2D::sptr _skybox;
 
 	bool _sunEnabled = true;
+
+	ClusteredLights* _pointLights = nullptr;
+	PointLightMode _pointLightMode = PointLightMode::Clustered;
+	ShaderPipeline::sptr _volumePipeline;
 	
 	DirectionalLight _sun;
 };
\ No newline at end of file
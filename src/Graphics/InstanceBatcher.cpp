@@ -0,0 +1,236 @@
+#include "InstanceBatcher.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <Logging.h>
+
+InstanceBatcher::~InstanceBatcher()
+{
+	if (_objectBuffer != 0)
+		glDeleteBuffers(1, &_objectBuffer);
+	for (AlbedoArray& albedo : _albedoArrays)
+	{
+		glDeleteTextures(1, &albedo._texture);
+	}
+}
+
+void InstanceBatcher::Begin()
+{
+	_instances.clear();
+	_objects.clear();
+	_batches.clear();
+}
+
+bool InstanceBatcher::Add(const RendererComponent& renderer, const Transform& transform, const LODComponent* lod, int level, uint32_t albedoIndex)
+{
+	if (lod == nullptr || lod->GetChain() == nullptr)
+		return false;
+
+	//Placeholder chains (still loading) aren't in the pool yet
+	const MeshLODChain* chain = lod->GetChain().get();
+	if (level < 0 || level >= int(chain->_levels.size()) || chain->_levels[level]._poolRange._indexCount == 0)
+		return false;
+
+	Instance instance;
+	instance._material = renderer.Material;
+	instance._range = chain->_levels[level]._poolRange;
+	instance._object._model = transform.WorldTransform();
+	instance._object._normalMatrix = glm::mat4(transform.WorldNormalMatrix());
+	instance._object._mesh = 0;
+	instance._object._flags = 0;
+	instance._object._albedoIndex = albedoIndex;
+	instance._object._padding = 0;
+	_instances.push_back(instance);
+	return true;
+}
+
+void InstanceBatcher::Upload()
+{
+	if (_instances.empty())
+		return;
+
+	//Same material next to each other (so it's only applied once), then same mesh within it
+	//*A pooled mesh is identified by where its indices start
+	std::sort(_instances.begin(), _instances.end(), [](const Instance& l, const Instance& r) {
+		if (l._material != r._material)
+			return l._material < r._material;
+		return l._range._firstIndex < r._range._firstIndex;
+	});
+
+	_objects.reserve(_instances.size());
+	for (const Instance& instance : _instances)
+	{
+		if (_batches.empty() || _batches.back()._material != instance._material || _batches.back()._range._firstIndex != instance._range._firstIndex)
+		{
+			Batch batch;
+			batch._material = instance._material;
+			batch._range = instance._range;
+			batch._first = uint32_t(_objects.size());
+			_batches.push_back(batch);
+		}
+		_batches.back()._count++;
+		_objects.push_back(instance._object);
+	}
+	_stats._instances += _objects.size();
+
+	//Every pass uploads its own list, so the old storage is orphaned rather than waited on
+	if (_objectBuffer == 0)
+		glCreateBuffers(1, &_objectBuffer);
+	glNamedBufferData(_objectBuffer, GLsizeiptr(_objects.size() * sizeof(MeshPoolObject)), _objects.data(), GL_STREAM_DRAW);
+	MeshPool::ReserveObjects(_objects.size());
+}
+
+void InstanceBatcher::Draw()
+{
+	if (_batches.empty())
+		return;
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MeshPool::OBJECT_BINDING, _objectBuffer);
+	MeshPool::Bind();
+
+	Shader::sptr current = nullptr;
+	ShaderMaterial::sptr currentMat = nullptr;
+	for (const Batch& batch : _batches)
+	{
+		const Shader::sptr& shader = batch._material->Shader;
+		if (shader != current)
+		{
+			current = shader;
+			current->Bind();
+			current->SetUniform("u_GpuDriven", 1);
+			currentMat = nullptr;
+		}
+		if (batch._material != currentMat)
+		{
+			currentMat = batch._material;
+			currentMat->Apply();
+			GLuint albedo = GetAlbedoArray(currentMat);
+			current->SetUniform("u_UseDiffuseArray", albedo != 0 ? 1 : 0);
+			if (albedo != 0)
+				glBindTextureUnit(ALBEDO_ARRAY_SLOT, albedo);
+		}
+
+		const void* offset = reinterpret_cast<const void*>(size_t(batch._range._firstIndex) * sizeof(uint32_t));
+		glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, GLsizei(batch._range._indexCount), GL_UNSIGNED_INT, offset,
+			GLsizei(batch._count), batch._range._baseVertex, batch._first);
+		_stats._drawCalls++;
+	}
+
+	//Back to uniforms for everything drawn the normal way
+	for (const Batch& batch : _batches)
+	{
+		batch._material->Shader->SetUniform("u_GpuDriven", 0);
+		batch._material->Shader->SetUniform("u_UseDiffuseArray", 0);
+	}
+
+	MeshPool::Unbind();
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MeshPool::OBJECT_BINDING, 0);
+	glBindTextureUnit(ALBEDO_ARRAY_SLOT, 0);
+	current->UnBind();
+}
+
+void InstanceBatcher::DrawDepth(const Shader::sptr& shader, const glm::mat4& viewProjection)
+{
+	if (_batches.empty())
+		return;
+
+	shader->Bind();
+	shader->SetUniform("u_GpuDriven", 1);
+	shader->SetUniformMatrix("u_LightSpaceMatrix", viewProjection);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MeshPool::OBJECT_BINDING, _objectBuffer);
+	MeshPool::Bind();
+
+	for (const Batch& batch : _batches)
+	{
+		const void* offset = reinterpret_cast<const void*>(size_t(batch._range._firstIndex) * sizeof(uint32_t));
+		glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, GLsizei(batch._range._indexCount), GL_UNSIGNED_INT, offset,
+			GLsizei(batch._count), batch._range._baseVertex, batch._first);
+		_stats._drawCalls++;
+	}
+
+	MeshPool::Unbind();
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MeshPool::OBJECT_BINDING, 0);
+	shader->SetUniform("u_GpuDriven", 0);
+	shader->UnBind();
+}
+
+void InstanceBatcher::SetAlbedoArray(const ShaderMaterial::sptr& material, const std::vector<Texture2D::sptr>& textures)
+{
+	if (material == nullptr || textures.empty())
+		return;
+
+	GLuint first = textures[0]->GetHandle();
+	GLint width = 0, height = 0, format = 0, compressed = 0;
+	glGetTextureLevelParameteriv(first, 0, GL_TEXTURE_WIDTH, &width);
+	glGetTextureLevelParameteriv(first, 0, GL_TEXTURE_HEIGHT, &height);
+	glGetTextureLevelParameteriv(first, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+	glGetTextureLevelParameteriv(first, 0, GL_TEXTURE_COMPRESSED, &compressed);
+	if (width == 0 || height == 0)
+	{
+		LOG_WARN("Albedo array textures aren't loaded yet, the material will use its own diffuse");
+		return;
+	}
+
+	//Compressed formats can't have their mips generated, so those only get the top level
+	GLsizei levels = compressed ? 1 : 1 + GLsizei(std::floor(std::log2(float(std::max(width, height)))));
+	GLuint array = 0;
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &array);
+	glTextureStorage3D(array, levels, GLenum(format), width, height, GLsizei(textures.size()));
+	for (size_t i = 0; i < textures.size(); i++)
+	{
+		GLuint handle = textures[i]->GetHandle();
+		GLint layerWidth = 0, layerHeight = 0, layerFormat = 0;
+		glGetTextureLevelParameteriv(handle, 0, GL_TEXTURE_WIDTH, &layerWidth);
+		glGetTextureLevelParameteriv(handle, 0, GL_TEXTURE_HEIGHT, &layerHeight);
+		glGetTextureLevelParameteriv(handle, 0, GL_TEXTURE_INTERNAL_FORMAT, &layerFormat);
+		if (layerWidth != width || layerHeight != height || layerFormat != format)
+		{
+			LOG_WARN("Albedo array layer {} doesn't match the first texture's size or format, it's left blank", i);
+			continue;
+		}
+		glCopyImageSubData(handle, GL_TEXTURE_2D, 0, 0, 0, 0, array, GL_TEXTURE_2D_ARRAY, 0, 0, 0, GLint(i), width, height, 1);
+	}
+	if (levels > 1)
+		glGenerateTextureMipmap(array);
+	glTextureParameteri(array, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTextureParameteri(array, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(array, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTextureParameteri(array, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	//Replaces the material's old array if it had one
+	for (AlbedoArray& albedo : _albedoArrays)
+	{
+		if (albedo._material == material)
+		{
+			glDeleteTextures(1, &albedo._texture);
+			albedo._texture = array;
+			return;
+		}
+	}
+	AlbedoArray albedo;
+	albedo._material = material;
+	albedo._texture = array;
+	_albedoArrays.push_back(albedo);
+}
+
+void InstanceBatcher::ResetStats()
+{
+	_stats = InstanceStats();
+}
+
+const InstanceStats& InstanceBatcher::GetStats() const
+{
+	return _stats;
+}
+
+GLuint InstanceBatcher::GetAlbedoArray(const ShaderMaterial::sptr& material) const
+{
+	//Only a handful of materials have one, a linear search is fine
+	for (const AlbedoArray& albedo : _albedoArrays)
+	{
+		if (albedo._material == material)
+			return albedo._texture;
+	}
+	return 0;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+#include <Shader.h>
+#include <ShaderMaterial.h>
+#include <RendererComponent.h>
+#include <Texture2D.h>
+#include <Transform.h>
+
+#include "Graphics/LODComponent.h"
+#include "Graphics/MeshPool.h"
+
+//Picks which layer of its material's albedo array an instanced renderer samples (see InstanceBatcher::SetAlbedoArray)
+struct InstanceVariant
+{
+	uint32_t _albedoIndex = 0;
+};
+
+//Numbers for the instanced path, added up over every pass since the last ResetStats
+struct InstanceStats
+{
+	size_t _instances = 0;
+	size_t _drawCalls = 0;
+};
+
+//Groups renderers that share a material and a LOD level and draws each group with one instanced call
+//*Every level is already in the MeshPool, so the world and normal matrices go in an object buffer and
+// each group is drawn with glDrawElementsInstancedBaseVertexBaseInstance through the pool's VAO
+//*baseInstance is where the group starts in the object buffer, the shaders read their matrices with the
+// object id the same way they do for GpuDrivenRenderer (u_GpuDriven)
+//*Materials can have an albedo texture array, each instance picks its layer through InstanceVariant,
+// so renderers that only differ by texture can still share a material and a draw
+//*Used per pass: Begin, Add what's visible, Upload, then Draw or DrawDepth
+class InstanceBatcher
+{
+public:
+	//Texture slot the albedo arrays are bound to, clear of anything a material binds
+	static const int ALBEDO_ARRAY_SLOT = 15;
+
+	InstanceBatcher() = default;
+	~InstanceBatcher();
+
+	InstanceBatcher(const InstanceBatcher&) = delete;
+	InstanceBatcher& operator=(const InstanceBatcher&) = delete;
+
+	//Starts a pass' instance list
+	void Begin();
+	//Adds a renderer drawing the given LOD level
+	//*Returns false if the level isn't in the pool (no LOD chain, or still loading), draw it the normal way instead
+	bool Add(const RendererComponent& renderer, const Transform& transform, const LODComponent* lod, int level, uint32_t albedoIndex = 0);
+	//Groups the instances and uploads their matrices
+	void Upload();
+
+	//Draws every group into the Gbuffer, applying each group's material
+	//*Camera matrices and position come from the frame block (BackendHandler::SetFrameUniforms)
+	void Draw();
+	//Draws every group with one depth only shader
+	void DrawDepth(const Shader::sptr& shader, const glm::mat4& viewProjection);
+
+	//Copies the textures into an array the material's instances sample their albedo from
+	//*They all need the size and format of the first one, and need to be loaded already
+	void SetAlbedoArray(const ShaderMaterial::sptr& material, const std::vector<Texture2D::sptr>& textures);
+
+	void ResetStats();
+	const InstanceStats& GetStats() const;
+
+private:
+	//One renderer waiting to be grouped
+	struct Instance
+	{
+		ShaderMaterial::sptr _material;
+		MeshPoolRange _range;
+		MeshPoolObject _object;
+	};
+
+	//Instances that share a material and a mesh, drawn with one call
+	struct Batch
+	{
+		ShaderMaterial::sptr _material;
+		MeshPoolRange _range;
+		uint32_t _first = 0;
+		uint32_t _count = 0;
+	};
+
+	struct AlbedoArray
+	{
+		ShaderMaterial::sptr _material;
+		GLuint _texture = 0;
+	};
+
+	//The material's albedo array, or 0 if it hasn't got one
+	GLuint GetAlbedoArray(const ShaderMaterial::sptr& material) const;
+
+	std::vector<Instance> _instances;
+	std::vector<MeshPoolObject> _objects;
+	std::vector<Batch> _batches;
+	std::vector<AlbedoArray> _albedoArrays;
+
+	GLuint _objectBuffer = 0;
+
+	InstanceStats _stats;
+};
@@ -0,0 +1,263 @@
+#include "KTX2File.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "Utilities/MappedFile.h"
+
+namespace
+{
+	const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	//Fixed part of the file after the identifier
+	//*Packed to 4 so the 64 bit fields line up with the file (they'd get padded otherwise)
+#pragma pack(push, 4)
+	struct KTX2Header
+	{
+		uint32_t _vkFormat;
+		uint32_t _typeSize;
+		uint32_t _pixelWidth;
+		uint32_t _pixelHeight;
+		uint32_t _pixelDepth;
+		uint32_t _layerCount;
+		uint32_t _faceCount;
+		uint32_t _levelCount;
+		uint32_t _supercompressionScheme;
+		uint32_t _dfdByteOffset;
+		uint32_t _dfdByteLength;
+		uint32_t _kvdByteOffset;
+		uint32_t _kvdByteLength;
+		uint64_t _sgdByteOffset;
+		uint64_t _sgdByteLength;
+	};
+#pragma pack(pop)
+
+	struct KTX2Level
+	{
+		uint64_t _byteOffset;
+		uint64_t _byteLength;
+		uint64_t _uncompressedByteLength;
+	};
+
+	//Data format descriptor numbers (Khronos Data Format spec)
+	const uint32_t DF_MODEL_BC1A = 128;
+	const uint32_t DF_MODEL_BC3 = 130;
+	const uint32_t DF_MODEL_BC5 = 132;
+	const uint32_t DF_MODEL_BC7 = 134;
+	const uint32_t DF_PRIMARIES_BT709 = 1;
+	const uint32_t DF_TRANSFER_LINEAR = 1;
+	const uint32_t DF_TRANSFER_SRGB = 2;
+
+	void PushWord(std::vector<uint8_t>& buffer, uint32_t word)
+	{
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&word);
+		buffer.insert(buffer.end(), bytes, bytes + 4);
+	}
+
+	//Builds the basic data format descriptor for a block format
+	std::vector<uint8_t> BuildDFD(BlockFormat format, bool srgb)
+	{
+		//Each sample is bit offset, bit length and channel id
+		struct Sample { uint32_t _offset, _length, _channel; };
+		std::vector<Sample> samples;
+		uint32_t model = 0;
+		switch (format)
+		{
+		case BlockFormat::BC1: model = DF_MODEL_BC1A; samples = { { 0, 64, 0 } }; break;
+		case BlockFormat::BC3: model = DF_MODEL_BC3; samples = { { 0, 64, 15 }, { 64, 64, 0 } }; break;
+		case BlockFormat::BC5: model = DF_MODEL_BC5; samples = { { 0, 64, 0 }, { 64, 64, 1 } }; break;
+		case BlockFormat::BC7: model = DF_MODEL_BC7; samples = { { 0, 128, 0 } }; break;
+		}
+
+		uint32_t blockSize = 24 + 16 * uint32_t(samples.size());
+		std::vector<uint8_t> dfd;
+		PushWord(dfd, 4 + blockSize);
+		//Khronos vendor, basic descriptor type
+		PushWord(dfd, 0);
+		//Version 2 (data format 1.3) and the block size
+		PushWord(dfd, 2 | (blockSize << 16));
+		PushWord(dfd, model | (DF_PRIMARIES_BT709 << 8) | ((srgb ? DF_TRANSFER_SRGB : DF_TRANSFER_LINEAR) << 16));
+		//4x4 texel blocks, dimensions are stored minus one
+		PushWord(dfd, 3 | (3 << 8));
+		PushWord(dfd, BlockCompression::GetBlockBytes(format));
+		PushWord(dfd, 0);
+
+		for (const Sample& sample : samples)
+		{
+			PushWord(dfd, sample._offset | ((sample._length - 1) << 16) | (sample._channel << 24));
+			PushWord(dfd, 0);
+			PushWord(dfd, 0);
+			PushWord(dfd, 0xFFFFFFFF);
+		}
+
+		return dfd;
+	}
+
+	uint64_t AlignTo(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	bool Fail(std::string* error, const std::string& reason)
+	{
+		if (error != nullptr)
+			*error = reason;
+		return false;
+	}
+}
+
+bool KTX2File::Write(const std::string& path, const CompressedImage& image, bool srgb)
+{
+	uint32_t levelCount = uint32_t(image._levels.size());
+	if (levelCount == 0)
+		return false;
+
+	std::vector<uint8_t> dfd = BuildDFD(image._format, srgb);
+
+	KTX2Header header;
+	std::memset(static_cast<void*>(&header), 0, sizeof(header));
+	header._vkFormat = GetVkFormat(image._format, srgb);
+	header._typeSize = 1;
+	header._pixelWidth = image._width;
+	header._pixelHeight = image._height;
+	header._faceCount = 1;
+	header._levelCount = levelCount;
+	header._dfdByteOffset = uint32_t(sizeof(KTX2_IDENTIFIER) + sizeof(KTX2Header) + levelCount * sizeof(KTX2Level));
+	header._dfdByteLength = uint32_t(dfd.size());
+
+	//Levels go smallest first, each one aligned to the block size
+	uint64_t alignment = BlockCompression::GetBlockBytes(image._format);
+	std::vector<KTX2Level> levels(levelCount);
+	uint64_t offset = header._dfdByteOffset + header._dfdByteLength;
+	for (int level = int(levelCount) - 1; level >= 0; level--)
+	{
+		offset = AlignTo(offset, alignment);
+		levels[level]._byteOffset = offset;
+		levels[level]._byteLength = image._levels[level].size();
+		levels[level]._uncompressedByteLength = image._levels[level].size();
+		offset += image._levels[level].size();
+	}
+
+	std::vector<uint8_t> file;
+	file.reserve(size_t(offset));
+	file.insert(file.end(), KTX2_IDENTIFIER, KTX2_IDENTIFIER + sizeof(KTX2_IDENTIFIER));
+	const uint8_t* headerBytes = reinterpret_cast<const uint8_t*>(&header);
+	file.insert(file.end(), headerBytes, headerBytes + sizeof(header));
+	const uint8_t* levelBytes = reinterpret_cast<const uint8_t*>(levels.data());
+	file.insert(file.end(), levelBytes, levelBytes + levels.size() * sizeof(KTX2Level));
+	file.insert(file.end(), dfd.begin(), dfd.end());
+	for (int level = int(levelCount) - 1; level >= 0; level--)
+	{
+		file.resize(size_t(levels[level]._byteOffset), 0);
+		file.insert(file.end(), image._levels[level].begin(), image._levels[level].end());
+	}
+
+	//Write to a temporary file first so a half written file never looks valid
+	std::string tempPath = path + ".tmp";
+	std::error_code error;
+	{
+		std::ofstream stream(tempPath, std::ios::binary | std::ios::trunc);
+		if (!stream)
+			return false;
+		stream.write(reinterpret_cast<const char*>(file.data()), file.size());
+		if (!stream)
+		{
+			stream.close();
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(tempPath, path, error);
+	if (error)
+	{
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+
+	return true;
+}
+
+bool KTX2File::Read(const std::string& path, CompressedImage& image, std::string* error, bool* srgb)
+{
+	MappedFile file;
+	if (!file.Open(path))
+		return Fail(error, "could not open the file");
+
+	const uint8_t* data = file.GetData();
+	size_t size = file.GetSize();
+	if (size < sizeof(KTX2_IDENTIFIER) + sizeof(KTX2Header) || std::memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+		return Fail(error, "not a KTX2 file");
+
+	KTX2Header header;
+	std::memcpy(&header, data + sizeof(KTX2_IDENTIFIER), sizeof(header));
+
+	bool isSrgb = false;
+	if (!FromVkFormat(header._vkFormat, image._format, isSrgb))
+		return Fail(error, "unsupported format " + std::to_string(header._vkFormat));
+	if (header._typeSize != 1 || header._pixelWidth == 0 || header._pixelHeight == 0 || header._pixelDepth != 0)
+		return Fail(error, "not a 2D block compressed texture");
+	if (header._layerCount > 1 || header._faceCount != 1)
+		return Fail(error, "arrays and cube maps aren't supported");
+	if (header._supercompressionScheme != 0)
+		return Fail(error, "supercompressed files aren't supported");
+	if (header._levelCount == 0 || header._levelCount > 32)
+		return Fail(error, "bad level count");
+
+	size_t levelIndexOffset = sizeof(KTX2_IDENTIFIER) + sizeof(KTX2Header);
+	if (levelIndexOffset + header._levelCount * sizeof(KTX2Level) > size)
+		return Fail(error, "level index runs off the end of the file");
+
+	image._width = header._pixelWidth;
+	image._height = header._pixelHeight;
+	image._levels.resize(header._levelCount);
+	for (uint32_t level = 0; level < header._levelCount; level++)
+	{
+		KTX2Level entry;
+		std::memcpy(&entry, data + levelIndexOffset + level * sizeof(KTX2Level), sizeof(entry));
+
+		uint32_t width = std::max(image._width >> level, 1u);
+		uint32_t height = std::max(image._height >> level, 1u);
+		if (entry._byteLength != BlockCompression::GetImageBytes(image._format, width, height))
+			return Fail(error, "level " + std::to_string(level) + " is the wrong size");
+		if (entry._byteOffset + entry._byteLength > size)
+			return Fail(error, "level " + std::to_string(level) + " runs off the end of the file");
+
+		image._levels[level].assign(data + entry._byteOffset, data + entry._byteOffset + entry._byteLength);
+	}
+
+	if (srgb != nullptr)
+		*srgb = isSrgb;
+	return true;
+}
+
+uint32_t KTX2File::GetVkFormat(BlockFormat format, bool srgb)
+{
+	//VK_FORMAT_BC*_BLOCK numbers
+	switch (format)
+	{
+	case BlockFormat::BC1: return srgb ? 132 : 131;
+	case BlockFormat::BC3: return srgb ? 138 : 137;
+	case BlockFormat::BC5: return 141;
+	case BlockFormat::BC7: return srgb ? 146 : 145;
+	}
+	return 0;
+}
+
+bool KTX2File::FromVkFormat(uint32_t vkFormat, BlockFormat& format, bool& srgb)
+{
+	switch (vkFormat)
+	{
+	case 131: format = BlockFormat::BC1; srgb = false; return true;
+	case 132: format = BlockFormat::BC1; srgb = true; return true;
+	case 137: format = BlockFormat::BC3; srgb = false; return true;
+	case 138: format = BlockFormat::BC3; srgb = true; return true;
+	case 141: format = BlockFormat::BC5; srgb = false; return true;
+	case 145: format = BlockFormat::BC7; srgb = false; return true;
+	case 146: format = BlockFormat::BC7; srgb = true; return true;
+	default: return false;
+	}
+}
\ No newline at end of file
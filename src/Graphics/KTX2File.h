@@ -0,0 +1,21 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+#include "Graphics/BlockCompression.h"
+
+//Reads and writes KTX2 files holding block compressed 2D textures
+//*Only what the baker writes is supported: one layer, one face, no supercompression
+class KTX2File abstract
+{
+public:
+	//Writes the image and its mip chain, returns false if the file can't be written
+	static bool Write(const std::string& path, const CompressedImage& image, bool srgb = false);
+	//Reads a file the baker wrote, error gets the reason if it fails
+	static bool Read(const std::string& path, CompressedImage& image, std::string* error = nullptr, bool* srgb = nullptr);
+
+	//Gets the Vulkan format number KTX2 uses for a block format (0 if it has none)
+	static uint32_t GetVkFormat(BlockFormat format, bool srgb);
+	//Gets the block format for a Vulkan format number, returns false if we don't support it
+	static bool FromVkFormat(uint32_t vkFormat, BlockFormat& format, bool& srgb);
+};
\ No newline at end of file
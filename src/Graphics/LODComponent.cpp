@@ -0,0 +1,89 @@
+#include "LODComponent.h"
+
+#include <algorithm>
+
+LODSettings LODComponent::_settings;
+
+LODView LODView::Create(const glm::mat4& view, const glm::mat4& projection, int screenHeight, float bias)
+{
+	LODView result;
+	result._cameraPosition = glm::vec3(glm::inverse(view) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	result._projectionScale = projection[1][1];
+	//Perspective projections put -1 in here, orthographic ones 0
+	result._orthographic = projection[2][3] == 0.0f;
+	result._halfScreenHeight = float(std::max(screenHeight, 1)) * 0.5f;
+	result._allowedError = LODComponent::GetSettingsRef()._pixelError * bias;
+	return result;
+}
+
+LODView LODView::CreateOrthographic(const glm::mat4& viewProjection, int targetHeight, float bias)
+{
+	LODView result;
+	//The view's rotation doesn't change lengths, so the y row is projection[1][1] turned to face the light
+	result._projectionScale = glm::length(glm::vec3(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1]));
+	result._orthographic = true;
+	result._halfScreenHeight = float(std::max(targetHeight, 1)) * 0.5f;
+	result._allowedError = LODComponent::GetSettingsRef()._pixelError * bias;
+	return result;
+}
+
+LODComponent& LODComponent::SetChain(const MeshLODChain::sptr& chain)
+{
+	_chain = chain;
+	return *this;
+}
+
+const MeshLODChain::sptr& LODComponent::GetChain() const
+{
+	return _chain;
+}
+
+int LODComponent::SelectLevel(const Transform& transform, const LODView& view) const
+{
+	//Still loading (or not simplified), only the full mesh is there
+	if (_chain == nullptr || _chain->_levels.size() < 2)
+		return 0;
+
+	//Bounding sphere in world space, scaled by the biggest axis scale
+	const glm::mat4& world = transform.WorldTransform();
+	glm::vec3 centre = glm::vec3(world * glm::vec4(_chain->_centre, 1.0f));
+	float scale = std::max(glm::length(glm::vec3(world[0])), std::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+	float radius = _chain->_radius * scale;
+
+	//Radius of the sphere on screen, in pixels
+	float screenRadius = radius * view._projectionScale * view._halfScreenHeight;
+	if (!view._orthographic)
+	{
+		float distance = glm::length(centre - view._cameraPosition);
+		//Camera is inside it
+		if (distance <= radius)
+			return 0;
+		screenRadius /= distance;
+	}
+
+	//Errors only go up along the chain, so stop at the first one that's too big
+	int level = 0;
+	for (size_t i = 1; i < _chain->_levels.size(); i++)
+	{
+		if (_chain->_levels[i]._error * screenRadius > view._allowedError)
+			break;
+		level = int(i);
+	}
+
+	return level;
+}
+
+const VertexArrayObject::sptr& LODComponent::SelectMesh(const Transform& transform, const LODView& view) const
+{
+	return _chain->_levels[SelectLevel(transform, view)]._mesh;
+}
+
+size_t LODComponent::GetIndexCount(int level) const
+{
+	return _chain != nullptr && size_t(level) < _chain->_levels.size() ? _chain->_levels[level]._indexCount : 0;
+}
+
+LODSettings& LODComponent::GetSettingsRef()
+{
+	return _settings;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include <Transform.h>
+#include <VertexArrayObject.h>
+
+#include "Graphics/MeshPool.h"
+
+//One level of a mesh's LOD chain
+struct MeshLODLevel
+{
+	VertexArrayObject::sptr _mesh;
+	//How far this level's surface is from the full mesh, relative to the bounding radius
+	float _error = 0.0f;
+	size_t _vertexCount = 0;
+	size_t _indexCount = 0;
+	//Where the level lives in the MeshPool, for GPU driven drawing
+	MeshPoolRange _poolRange;
+};
+
+//A mesh and its simplified versions, finest first
+struct MeshLODChain
+{
+	typedef std::shared_ptr<MeshLODChain> sptr;
+
+	std::vector<MeshLODLevel> _levels;
+	//Object space bounding sphere of the full mesh
+	glm::vec3 _centre = glm::vec3(0.0f);
+	float _radius = 0.0f;
+
+	//CPU copy of the full level's triangles, for rasterising into the occlusion buffer
+	std::vector<glm::vec3> _occluderPositions;
+	std::vector<uint32_t> _occluderIndices;
+};
+
+//How LOD levels get picked, shared by every LODComponent
+struct LODSettings
+{
+	//How many pixels the surface is allowed to move on screen before a finer level is used
+	float _pixelError = 1.0f;
+	//Multiplies the pixel error for the G-buffer pass
+	float _bias = 1.0f;
+	//Multiplies the pixel error for the shadow pass, shadows are filtered anyway so they can go coarser
+	float _shadowBias = 4.0f;
+};
+
+//What LOD selection needs to know about the camera for one pass
+struct LODView
+{
+	glm::vec3 _cameraPosition = glm::vec3(0.0f);
+	//projection[1][1], so cot(fov / 2) for perspective cameras
+	float _projectionScale = 1.0f;
+	bool _orthographic = false;
+	float _halfScreenHeight = 1.0f;
+	//Pixel error allowed in this pass (pixel error times the pass' bias)
+	float _allowedError = 1.0f;
+
+	static LODView Create(const glm::mat4& view, const glm::mat4& projection, int screenHeight, float bias);
+	//For an orthographic view projection whose view is just a rotation and translation, like a shadow cascade's
+	//*Only the projection's size matters, so the levels it picks don't change as the camera moves
+	static LODView CreateOrthographic(const glm::mat4& viewProjection, int targetHeight, float bias);
+};
+
+//Picks which level of a LOD chain an entity draws, sits next to its RendererComponent
+//*The renderer's mesh should be the chain's finest level, it's what gets drawn if there's no chain
+//*Levels are picked from how big the mesh's bounding sphere is on screen, the coarsest level whose error
+// projects to less than the allowed pixel error wins
+class LODComponent
+{
+public:
+	LODComponent& SetChain(const MeshLODChain::sptr& chain);
+	const MeshLODChain::sptr& GetChain() const;
+
+	//Picks the level to draw for this view
+	int SelectLevel(const Transform& transform, const LODView& view) const;
+	//Picks the level for this view and gets its mesh (only call this once a chain is set)
+	const VertexArrayObject::sptr& SelectMesh(const Transform& transform, const LODView& view) const;
+	//Gets how many indices a level draws
+	size_t GetIndexCount(int level) const;
+
+	static LODSettings& GetSettingsRef();
+
+private:
+	MeshLODChain::sptr _chain;
+
+	static LODSettings _settings;
+};
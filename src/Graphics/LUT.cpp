@@ -1,47 +1,130 @@
 #include "LUT.h"
-#pragma warning(disable : 4996)
+
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#include <thread>
+
+#include <Logging.h>
+
+#include "Utilities/MappedFile.h"
+#include "Utilities/Util.h"
+
+bool LUT3D::_cacheEnabled = true;
+
+namespace
+{
+	//Every baked LUT starts with these
+	const char LUT_CACHE_MAGIC[4] = { 'L', 'U', 'T', 'C' };
+	//Bump this whenever the layout of a baked LUT changes
+	const uint32_t LUT_CACHE_VERSION = 1;
+
+	//Checks if the text at the cursor starts with a keyword (followed by a blank or the end of the line)
+	bool MatchKeyword(const char*& cursor, const char* end, const char* keyword)
+	{
+		size_t length = std::strlen(keyword);
+		if (size_t(end - cursor) < length || std::memcmp(cursor, keyword, length) != 0)
+			return false;
+		if (cursor + length < end && cursor[length] != ' ' && cursor[length] != '\t' && cursor[length] != '\r' && cursor[length] != '\n')
+			return false;
+
+		cursor += length;
+		return true;
+	}
+
+	//Packs a colour into the GL_UNSIGNED_INT_2_10_10_10_REV layout
+	uint32_t PackRGB10A2(const glm::vec3& colour)
+	{
+		glm::vec3 clamped = glm::clamp(colour, glm::vec3(0.0f), glm::vec3(1.0f));
+		uint32_t r = uint32_t(clamped.r * 1023.0f + 0.5f);
+		uint32_t g = uint32_t(clamped.g * 1023.0f + 0.5f);
+		uint32_t b = uint32_t(clamped.b * 1023.0f + 0.5f);
+		return r | (g << 10) | (b << 20) | (3u << 30);
+	}
+}
+
 LUT3D::LUT3D()
 {
 }
 
-LUT3D::LUT3D(std::string path)
+LUT3D::LUT3D(std::string path, LUTFormat format)
+{
+	loadFromFile(path, format);
+}
+
+LUT3D::~LUT3D()
 {
-	loadFromFile(path);
+	//Deletes the texture
+	if (_handle != GL_NONE)
+	{
+		glDeleteTextures(1, &_handle);
+	}
 }
 
-void LUT3D::loadFromFile(std::string path)
+bool LUT3D::loadFromFile(std::string path, LUTFormat format)
 {
-	std::string filePath = path;
-	std::ifstream LUTstream;
-	LUTstream.open(filePath);
+	std::string cachePath = GetCachePath(path);
 
-	while (!LUTstream.eof())
+	//Fast path, upload straight out of the mapped baked LUT
+	if (_cacheEnabled)
 	{
-		std::string _line;
-		std::getline(LUTstream, _line);
+		MappedFile file;
+		if (file.Open(cachePath) && file.GetSize() >= sizeof(LUTCacheHeader))
+		{
+			const LUTCacheHeader* header = reinterpret_cast<const LUTCacheHeader*>(file.GetData());
+			uint64_t tableBytes = uint64_t(header->_size) * header->_size * header->_size * sizeof(glm::vec3);
+
+			bool valid = std::memcmp(header->_magic, LUT_CACHE_MAGIC, sizeof(LUT_CACHE_MAGIC)) == 0 &&
+				header->_version == LUT_CACHE_VERSION &&
+				header->_size > 0 &&
+				sizeof(LUTCacheHeader) + tableBytes <= file.GetSize();
 
-		if (_line.empty())
-			continue;
+			//Make sure it was baked from the .cube as it is now (if the .cube is gone, use it as is)
+			SourceStamp current;
+			bool touched = false;
+			if (valid && SourceStamp::Get(path, current, false) &&
+				(current._time != header->_source._time || current._size != header->_source._size))
+			{
+				valid = current._size == header->_source._size &&
+					SourceStamp::Get(path, current, true) && current._hash == header->_source._hash;
+				touched = valid;
+			}
 
-		glm::vec3 lineData;
-		if (sscanf(_line.c_str(), "%f %f %f", &lineData.x, &lineData.y, &lineData.z) == 3)
-			data.push_back(lineData);
+			if (valid)
+			{
+				Upload(reinterpret_cast<const glm::vec3*>(file.GetData() + sizeof(LUTCacheHeader)), int(header->_size), format);
+				//Same contents, so store the new time and skip hashing it on every later load
+				if (touched)
+				{
+					file.Close();
+					SourceStamp::Rewrite(cachePath, offsetof(LUTCacheHeader, _source), current);
+				}
+				return true;
+			}
+		}
 	}
 
-	glEnable(GL_TEXTURE_3D);
+	std::vector<glm::vec3> table;
+	int size = 0;
+	if (!ParseCube(path, table, size))
+	{
+		return false;
+	}
 
-	glGenTextures(1, &_handle);
-	bind();
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+	Upload(table.data(), size, format);
 
-	glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB, 64, 64, 64, 0, GL_RGB, GL_FLOAT, &data[0]);
-	unbind();
+	if (_cacheEnabled)
+	{
+		SourceStamp stamp;
+		if (SourceStamp::Get(path, stamp, true))
+		{
+			WriteCacheFile(path, stamp, table, size);
+		}
+	}
 
-	glDisable(GL_TEXTURE_3D);
+	//The table goes out of scope here, the GPU has the only copy now
+	return true;
 }
 
 void LUT3D::bind()
@@ -64,4 +147,184 @@ void LUT3D::unbind(int textureSlot)
 {
 	glActiveTexture(GL_TEXTURE0 + textureSlot);
 	unbind();
+}
+
+GLuint LUT3D::GetHandle() const
+{
+	return _handle;
+}
+
+int LUT3D::GetSize() const
+{
+	return _size;
+}
+
+LUTFormat LUT3D::GetFormat() const
+{
+	return _format;
+}
+
+bool LUT3D::ParseCube(const std::string& path, std::vector<glm::vec3>& table, int& size)
+{
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		LOG_WARN("Could not open LUT \"{}\"", path);
+		return false;
+	}
+
+	const char* cursor = reinterpret_cast<const char*>(file.GetData());
+	const char* end = cursor + file.GetSize();
+
+	table.clear();
+	size = 0;
+
+	while (cursor < end)
+	{
+		cursor = Util::SkipBlank(cursor, end);
+		if (cursor >= end)
+			break;
+
+		char first = *cursor;
+		if (first == '#' || first == '\r' || first == '\n')
+		{
+			//Comment or empty line
+		}
+		else if (MatchKeyword(cursor, end, "LUT_3D_SIZE"))
+		{
+			cursor = Util::SkipBlank(cursor, end);
+			if (!Util::ReadInt(cursor, end, size) || size < 2 || size > 256)
+			{
+				LOG_WARN("Bad LUT_3D_SIZE in \"{}\"", path);
+				return false;
+			}
+			table.reserve(size_t(size) * size * size);
+		}
+		else if (MatchKeyword(cursor, end, "LUT_1D_SIZE"))
+		{
+			LOG_WARN("\"{}\" is a 1D LUT, only 3D LUTs are supported", path);
+			return false;
+		}
+		else if ((first >= 'A' && first <= 'Z') || (first >= 'a' && first <= 'z'))
+		{
+			//TITLE, DOMAIN_MIN and DOMAIN_MAX, the shader assumes the default 0 to 1 domain
+		}
+		else
+		{
+			glm::vec3 entry;
+			if (!Util::ReadFloat(cursor, end, entry.r) || !Util::ReadFloat(cursor, end, entry.g) || !Util::ReadFloat(cursor, end, entry.b))
+			{
+				LOG_WARN("Bad LUT entry in \"{}\"", path);
+				return false;
+			}
+			table.push_back(entry);
+		}
+
+		cursor = Util::SkipLine(cursor, end);
+	}
+
+	if (size == 0 || table.size() != size_t(size) * size * size)
+	{
+		LOG_WARN("\"{}\" has {} entries, LUT_3D_SIZE {} needs {}", path, table.size(), size, size_t(size) * size * size);
+		return false;
+	}
+
+	return true;
+}
+
+std::string LUT3D::GetCachePath(const std::string& path)
+{
+	return path + ".bin";
+}
+
+void LUT3D::SetCacheEnabled(bool enabled)
+{
+	_cacheEnabled = enabled;
+}
+
+void LUT3D::Upload(const glm::vec3* table, int size, LUTFormat format)
+{
+	if (_handle == GL_NONE)
+	{
+		glGenTextures(1, &_handle);
+	}
+
+	_size = size;
+	_format = format;
+
+	bind();
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+
+	switch (format)
+	{
+	case LUTFormat::RGB16F:
+		glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB16F, size, size, size, 0, GL_RGB, GL_FLOAT, table);
+		break;
+	case LUTFormat::RGB10_A2:
+	{
+		//Pack it ourselves so we only send a third of the data
+		size_t count = size_t(size) * size * size;
+		std::vector<uint32_t> packed(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			packed[i] = PackRGB10A2(table[i]);
+		}
+		glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB10_A2, size, size, size, 0, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, packed.data());
+		break;
+	}
+	case LUTFormat::RGB8:
+	default:
+		glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB8, size, size, size, 0, GL_RGB, GL_FLOAT, table);
+		break;
+	}
+
+	unbind();
+}
+
+bool LUT3D::WriteCacheFile(const std::string& path, const SourceStamp& source, const std::vector<glm::vec3>& table, int size)
+{
+	LUTCacheHeader header;
+	std::memset(static_cast<void*>(&header), 0, sizeof(header));
+	std::memcpy(header._magic, LUT_CACHE_MAGIC, sizeof(LUT_CACHE_MAGIC));
+	header._version = LUT_CACHE_VERSION;
+	header._size = uint32_t(size);
+	header._source = source;
+
+	//Write to a temporary file first so a half written file never looks valid
+	std::string cachePath = GetCachePath(path);
+	std::stringstream tempPath;
+	tempPath << cachePath << "." << std::hash<std::thread::id>()(std::this_thread::get_id()) << ".tmp";
+
+	std::error_code error;
+	{
+		std::ofstream stream(tempPath.str(), std::ios::binary | std::ios::trunc);
+		if (!stream)
+		{
+			LOG_WARN("Could not write baked LUT \"{}\"", cachePath);
+			return false;
+		}
+
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		stream.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(glm::vec3));
+
+		if (!stream)
+		{
+			stream.close();
+			std::filesystem::remove(tempPath.str(), error);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(tempPath.str(), cachePath, error);
+	if (error)
+	{
+		std::filesystem::remove(tempPath.str(), error);
+		return false;
+	}
+
+	return true;
 }
\ No newline at end of file
@@ -1,22 +1,78 @@
 #pragma once
 #include <vector>
+#include <memory>
 #include <fstream>
 #include <string>
+#include <cstdint>
 #include <glad/glad.h>
 #include "glm/common.hpp"
 
+#include "Utilities/SourceStamp.h"
+
+//What the LUT is stored as on the GPU
+enum class LUTFormat
+{
+	RGB8,
+	//Half floats, keeps the precision for grades that push values hard
+	RGB16F,
+	//Half the size of RGB16F, 10 bits a channel is plenty for most grades
+	RGB10_A2
+};
+
+//Header at the front of a baked LUT
+//*The RGB float table follows straight after it, red changing fastest
+struct LUTCacheHeader
+{
+	char _magic[4];
+	uint32_t _version;
+	uint32_t _size;
+	uint32_t _padding;
+	SourceStamp _source;
+};
+
 class LUT3D
 {
 public:
+	typedef std::shared_ptr<LUT3D> sptr;
+
 	LUT3D();
-	LUT3D(std::string path);
-	void loadFromFile(std::string path);
+	LUT3D(std::string path, LUTFormat format = LUTFormat::RGB8);
+	~LUT3D();
+
+	//The LUT owns its texture, so share it through an sptr instead of copying it
+	LUT3D(const LUT3D&) = delete;
+	LUT3D& operator=(const LUT3D&) = delete;
+
+	//Loads a .cube file, using the baked copy next to it when it's up to date
+	//*The table is only on the CPU while it uploads, returns false if the file couldn't be read
+	bool loadFromFile(std::string path, LUTFormat format = LUTFormat::RGB8);
 	void bind();
 	void unbind();
 
 	void bind(int textureSlot);
 	void unbind(int textureSlot);
+
+	GLuint GetHandle() const;
+	//Gets the number of entries along each side
+	int GetSize() const;
+	LUTFormat GetFormat() const;
+
+	//Parses a .cube file into an RGB table, honouring LUT_3D_SIZE
+	static bool ParseCube(const std::string& path, std::vector<glm::vec3>& table, int& size);
+	//Gets the baked file path for a .cube file (it sits right next to it)
+	static std::string GetCachePath(const std::string& path);
+	//Turns reading and writing baked LUTs on or off
+	static void SetCacheEnabled(bool enabled);
+
 private:
+	//Creates the texture from an RGB float table
+	void Upload(const glm::vec3* table, int size, LUTFormat format);
+	//Writes the baked copy of a table
+	static bool WriteCacheFile(const std::string& path, const SourceStamp& source, const std::vector<glm::vec3>& table, int size);
+
 	GLuint _handle = GL_NONE;
-	std::vector<glm::vec3> data;
+	int _size = 0;
+	LUTFormat _format = LUTFormat::RGB8;
+
+	static bool _cacheEnabled;
 };
\ No newline at end of file
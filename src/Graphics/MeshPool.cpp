@@ -0,0 +1,154 @@
+#include "MeshPool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+GLuint MeshPool::_vao = 0;
+GLuint MeshPool::_vertexBuffer = 0;
+GLuint MeshPool::_indexBuffer = 0;
+GLuint MeshPool::_objectIdBuffer = 0;
+size_t MeshPool::_vertexCapacity = 0;
+size_t MeshPool::_indexCapacity = 0;
+size_t MeshPool::_objectCapacity = 0;
+size_t MeshPool::_vertexCount = 0;
+size_t MeshPool::_indexCount = 0;
+
+MeshPoolRange MeshPool::Add(const MeshData& data)
+{
+	return Add(data._vertices.data(), data._vertices.size(), data._indices.data(), data._indices.size());
+}
+
+MeshPoolRange MeshPool::Add(const VertexPosNormTexCol* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount)
+{
+	if (_vao == 0)
+		Create();
+
+	MeshPoolRange range;
+	range._firstIndex = uint32_t(_indexCount);
+	range._indexCount = uint32_t(indexCount);
+	range._baseVertex = int32_t(_vertexCount);
+
+	size_t vertexBytes = (_vertexCount + vertexCount) * sizeof(VertexPosNormTexCol);
+	size_t indexBytes = (_indexCount + indexCount) * sizeof(uint32_t);
+	if (vertexBytes > _vertexCapacity)
+	{
+		Grow(_vertexBuffer, _vertexCapacity, vertexBytes);
+		glVertexArrayVertexBuffer(_vao, 0, _vertexBuffer, 0, sizeof(VertexPosNormTexCol));
+	}
+	if (indexBytes > _indexCapacity)
+	{
+		Grow(_indexBuffer, _indexCapacity, indexBytes);
+		glVertexArrayElementBuffer(_vao, _indexBuffer);
+	}
+
+	//Indices stay relative to the mesh, baseVertex offsets them when it's drawn
+	glNamedBufferSubData(_vertexBuffer, _vertexCount * sizeof(VertexPosNormTexCol), vertexCount * sizeof(VertexPosNormTexCol), vertices);
+	glNamedBufferSubData(_indexBuffer, _indexCount * sizeof(uint32_t), indexCount * sizeof(uint32_t), indices);
+	_vertexCount += vertexCount;
+	_indexCount += indexCount;
+
+	return range;
+}
+
+void MeshPool::ReserveObjects(size_t count)
+{
+	if (_vao == 0)
+		Create();
+	if (count <= _objectCapacity)
+		return;
+
+	_objectCapacity = std::max(count, _objectCapacity * 2);
+	std::vector<uint32_t> ids(_objectCapacity);
+	for (size_t i = 0; i < ids.size(); i++)
+	{
+		ids[i] = uint32_t(i);
+	}
+
+	if (_objectIdBuffer != 0)
+		glDeleteBuffers(1, &_objectIdBuffer);
+	glCreateBuffers(1, &_objectIdBuffer);
+	glNamedBufferStorage(_objectIdBuffer, ids.size() * sizeof(uint32_t), ids.data(), 0);
+	glVertexArrayVertexBuffer(_vao, 1, _objectIdBuffer, 0, sizeof(uint32_t));
+}
+
+void MeshPool::Bind()
+{
+	glBindVertexArray(_vao);
+}
+
+void MeshPool::Unbind()
+{
+	glBindVertexArray(0);
+}
+
+size_t MeshPool::GetUsedBytes()
+{
+	return _vertexCount * sizeof(VertexPosNormTexCol) + _indexCount * sizeof(uint32_t);
+}
+
+void MeshPool::Clear()
+{
+	if (_vao == 0)
+		return;
+
+	GLuint buffers[3] = { _vertexBuffer, _indexBuffer, _objectIdBuffer };
+	glDeleteBuffers(3, buffers);
+	glDeleteVertexArrays(1, &_vao);
+	_vao = _vertexBuffer = _indexBuffer = _objectIdBuffer = 0;
+	_vertexCapacity = _indexCapacity = _objectCapacity = 0;
+	_vertexCount = _indexCount = 0;
+}
+
+void MeshPool::Create()
+{
+	glCreateVertexArrays(1, &_vao);
+
+	//Same locations the mesh shaders use, matching VertexPosNormTexCol::V_DECL
+	struct Attribute
+	{
+		GLuint _location;
+		GLint _components;
+		size_t _offset;
+	};
+	const Attribute attributes[] = {
+		{ 0, GLint(sizeof(VertexPosNormTexCol::Position) / sizeof(float)), offsetof(VertexPosNormTexCol, Position) },
+		{ 1, GLint(sizeof(VertexPosNormTexCol::Color) / sizeof(float)), offsetof(VertexPosNormTexCol, Color) },
+		{ 2, GLint(sizeof(VertexPosNormTexCol::Normal) / sizeof(float)), offsetof(VertexPosNormTexCol, Normal) },
+		{ 3, GLint(sizeof(VertexPosNormTexCol::UV) / sizeof(float)), offsetof(VertexPosNormTexCol, UV) },
+	};
+	for (const Attribute& attribute : attributes)
+	{
+		glEnableVertexArrayAttrib(_vao, attribute._location);
+		glVertexArrayAttribFormat(_vao, attribute._location, attribute._components, GL_FLOAT, GL_FALSE, GLuint(attribute._offset));
+		glVertexArrayAttribBinding(_vao, attribute._location, 0);
+	}
+
+	//Object ids step once per instance, so an indirect command's baseInstance picks its object
+	glEnableVertexArrayAttrib(_vao, OBJECT_ID_LOCATION);
+	glVertexArrayAttribIFormat(_vao, OBJECT_ID_LOCATION, 1, GL_UNSIGNED_INT, 0);
+	glVertexArrayAttribBinding(_vao, OBJECT_ID_LOCATION, 1);
+	glVertexArrayBindingDivisor(_vao, 1, 1);
+
+	Grow(_vertexBuffer, _vertexCapacity, 4 * 1024 * 1024);
+	Grow(_indexBuffer, _indexCapacity, 2 * 1024 * 1024);
+	glVertexArrayVertexBuffer(_vao, 0, _vertexBuffer, 0, sizeof(VertexPosNormTexCol));
+	glVertexArrayElementBuffer(_vao, _indexBuffer);
+	ReserveObjects(1024);
+}
+
+void MeshPool::Grow(GLuint& buffer, size_t& capacity, size_t size)
+{
+	size_t newCapacity = std::max(size, capacity * 2);
+	GLuint newBuffer = 0;
+	glCreateBuffers(1, &newBuffer);
+	glNamedBufferData(newBuffer, GLsizeiptr(newCapacity), nullptr, GL_STATIC_DRAW);
+
+	if (buffer != 0)
+	{
+		glCopyNamedBufferSubData(buffer, newBuffer, 0, 0, GLsizeiptr(capacity));
+		glDeleteBuffers(1, &buffer);
+	}
+	buffer = newBuffer;
+	capacity = newCapacity;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+#include <VertexTypes.h>
+
+#include "Utilities/MeshCache.h"
+
+//Where a mesh lives in the pool, in the form a DrawElementsIndirectCommand wants
+struct MeshPoolRange
+{
+	uint32_t _firstIndex = 0;
+	uint32_t _indexCount = 0;
+	int32_t _baseVertex = 0;
+};
+
+//What an object id points at in the object buffer (std430), for every shader that draws from the pool
+struct MeshPoolObject
+{
+	glm::mat4 _model;
+	//mat3 padded out to columns of vec4
+	glm::mat4 _normalMatrix;
+	//Which GpuDrivenRenderer mesh it draws (unused when instancing)
+	uint32_t _mesh;
+	uint32_t _flags;
+	//Layer of its material's albedo array
+	uint32_t _albedoIndex;
+	uint32_t _padding;
+};
+
+//One vertex buffer and one index buffer shared by every pooled mesh, so a single VAO can draw
+//any of them and whole scenes can go out in one multi draw indirect call
+//*Vertices are in the VertexPosNormTexCol layout, plus a per instance object id at location 4
+// (fed by baseInstance, so indirect commands can say which object they're drawing)
+//*The buffers double in size when they fill up, meshes are never removed until Clear
+class MeshPool abstract
+{
+public:
+	static const GLuint OBJECT_ID_LOCATION = 4;
+	//SSBO binding the MeshPoolObjects are read from
+	static const GLuint OBJECT_BINDING = 4;
+
+	//Copies a mesh into the pool
+	static MeshPoolRange Add(const MeshData& data);
+	static MeshPoolRange Add(const VertexPosNormTexCol* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount);
+
+	//Makes sure object ids up to count can be drawn
+	static void ReserveObjects(size_t count);
+
+	//Binds the pool's VAO (and its index buffer)
+	static void Bind();
+	static void Unbind();
+
+	//Size of the vertex and index data in the pool
+	static size_t GetUsedBytes();
+
+	//Deletes the buffers, call while the context is still alive
+	static void Clear();
+
+private:
+	static void Create();
+	//Grows a buffer to at least size bytes, keeping what's already in it
+	static void Grow(GLuint& buffer, size_t& capacity, size_t size);
+
+	static GLuint _vao;
+	static GLuint _vertexBuffer;
+	static GLuint _indexBuffer;
+	//0, 1, 2... for the per instance object ids
+	static GLuint _objectIdBuffer;
+
+	static size_t _vertexCapacity;
+	static size_t _indexCapacity;
+	static size_t _objectCapacity;
+	static size_t _vertexCount;
+	static size_t _indexCount;
+};
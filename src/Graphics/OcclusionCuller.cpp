@@ -0,0 +1,354 @@
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include "Utilities/ThreadPool.h"
+
+//Define OCCLUSION_NO_SIMD to force the scalar path (the tests build both)
+#if (defined(_M_X64) || defined(__SSE2__)) && !defined(OCCLUSION_NO_SIMD)
+#define OCCLUSION_SSE 1
+#include <emmintrin.h>
+#else
+#define OCCLUSION_SSE 0
+#endif
+
+void OcclusionCuller::Init(int width, int height)
+{
+	_tilesX = std::max((width + TILE_WIDTH - 1) / TILE_WIDTH, 1);
+	_tilesY = std::max((height + TILE_HEIGHT - 1) / TILE_HEIGHT, 1);
+	_width = _tilesX * TILE_WIDTH;
+	_height = _tilesY * TILE_HEIGHT;
+
+	_depth.assign(size_t(_width) * _height, 1.0f);
+	_tileMaxDepth.assign(size_t(_tilesX) * _tilesY, 1.0f);
+	_bins.resize(size_t(_tilesX) * _tilesY);
+}
+
+int OcclusionCuller::GetWidth() const
+{
+	return _width;
+}
+
+int OcclusionCuller::GetHeight() const
+{
+	return _height;
+}
+
+void OcclusionCuller::Begin(const glm::mat4& viewProjection)
+{
+	_viewProjection = viewProjection;
+	_stats = OcclusionStats();
+
+	std::fill(_depth.begin(), _depth.end(), 1.0f);
+	std::fill(_tileMaxDepth.begin(), _tileMaxDepth.end(), 1.0f);
+	_triangles.clear();
+	for (std::vector<uint32_t>& bin : _bins)
+	{
+		bin.clear();
+	}
+}
+
+void OcclusionCuller::AddOccluder(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, const glm::mat4& world)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	glm::mat4 worldViewProjection = _viewProjection * world;
+	std::vector<glm::vec4> clip(positions.size());
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		clip[i] = worldViewProjection * glm::vec4(positions[i], 1.0f);
+	}
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		SetupTriangle(clip[indices[i]], clip[indices[i + 1]], clip[indices[i + 2]]);
+	}
+	_stats._occluders++;
+
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+	_stats._rasteriseMilliseconds += elapsed.count();
+}
+
+void OcclusionCuller::Rasterise()
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	ThreadPool::ParallelFor(_bins.size(), [this](size_t tile) {
+		RasteriseTile(int(tile));
+	});
+	_stats._triangles = _triangles.size();
+
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+	_stats._rasteriseMilliseconds += elapsed.count();
+}
+
+bool OcclusionCuller::IsVisible(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	auto finish = [&](bool visible) {
+		std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		_stats._testMilliseconds += elapsed.count();
+		_stats._tested++;
+		_stats._culled += visible ? 0 : 1;
+		return visible;
+	};
+
+	//Screen rectangle and nearest depth of the box
+	glm::vec2 rectMin = glm::vec2(std::numeric_limits<float>::max());
+	glm::vec2 rectMax = glm::vec2(-std::numeric_limits<float>::max());
+	float nearest = 1.0f;
+	for (int c = 0; c < 8; c++)
+	{
+		glm::vec3 corner = glm::vec3(c & 1 ? boundsMax.x : boundsMin.x, c & 2 ? boundsMax.y : boundsMin.y, c & 4 ? boundsMax.z : boundsMin.z);
+		glm::vec4 clip = _viewProjection * glm::vec4(corner, 1.0f);
+		//Crosses the near plane, so it's right in front of the camera
+		if (clip.w <= 1e-5f || clip.z < -clip.w)
+			return finish(true);
+
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		glm::vec2 pixel = (glm::vec2(ndc) * 0.5f + 0.5f) * glm::vec2(_width, _height);
+		rectMin = glm::min(rectMin, pixel);
+		rectMax = glm::max(rectMax, pixel);
+		nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+	}
+
+	//Every pixel the rectangle touches, so it's never smaller than the box
+	rectMin = glm::clamp(rectMin, glm::vec2(-1.0f), glm::vec2(_width, _height));
+	rectMax = glm::clamp(rectMax, glm::vec2(-1.0f), glm::vec2(_width, _height));
+	int x0 = std::max(int(std::floor(rectMin.x)), 0);
+	int y0 = std::max(int(std::floor(rectMin.y)), 0);
+	int x1 = std::min(int(std::ceil(rectMax.x)), _width - 1);
+	int y1 = std::min(int(std::ceil(rectMax.y)), _height - 1);
+	if (x0 > x1 || y0 > y1)
+		return finish(false);
+	nearest = std::max(nearest, 0.0f);
+
+	for (int ty = y0 / TILE_HEIGHT; ty <= y1 / TILE_HEIGHT; ty++)
+	{
+		for (int tx = x0 / TILE_WIDTH; tx <= x1 / TILE_WIDTH; tx++)
+		{
+			//Everything in this tile is nearer than the box
+			if (_tileMaxDepth[ty * _tilesX + tx] < nearest)
+				continue;
+
+			int tileX0 = std::max(x0, tx * TILE_WIDTH);
+			int tileX1 = std::min(x1, tx * TILE_WIDTH + TILE_WIDTH - 1);
+			int tileY0 = std::max(y0, ty * TILE_HEIGHT);
+			int tileY1 = std::min(y1, ty * TILE_HEIGHT + TILE_HEIGHT - 1);
+			for (int y = tileY0; y <= tileY1; y++)
+			{
+				const float* row = _depth.data() + size_t(y) * _width;
+#if OCCLUSION_SSE
+				__m128 depth = _mm_set1_ps(nearest);
+				__m128 first = _mm_set1_ps(float(tileX0));
+				__m128 last = _mm_set1_ps(float(tileX1));
+				for (int x = tileX0 & ~3; x <= tileX1; x += 4)
+				{
+					//Lanes outside the rectangle don't count
+					__m128 lanes = _mm_add_ps(_mm_set1_ps(float(x)), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+					__m128 inside = _mm_and_ps(_mm_cmpge_ps(lanes, first), _mm_cmple_ps(lanes, last));
+					if (_mm_movemask_ps(_mm_and_ps(inside, _mm_cmpge_ps(_mm_loadu_ps(row + x), depth))) != 0)
+						return finish(true);
+				}
+#else
+				for (int x = tileX0; x <= tileX1; x++)
+				{
+					if (row[x] >= nearest)
+						return finish(true);
+				}
+#endif
+			}
+		}
+	}
+	return finish(false);
+}
+
+const std::vector<float>& OcclusionCuller::GetDepth() const
+{
+	return _depth;
+}
+
+const OcclusionStats& OcclusionCuller::GetStats() const
+{
+	return _stats;
+}
+
+void OcclusionCuller::SetupTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+{
+	//Clip against the near plane (z + w >= 0), one triangle can become a quad
+	const glm::vec4* input[3] = { &a, &b, &c };
+	glm::vec4 clipped[4];
+	int count = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		const glm::vec4& from = *input[i];
+		const glm::vec4& to = *input[(i + 1) % 3];
+		float fromDistance = from.z + from.w;
+		float toDistance = to.z + to.w;
+		if (fromDistance >= 0.0f)
+		{
+			clipped[count++] = from;
+		}
+		if ((fromDistance >= 0.0f) != (toDistance >= 0.0f))
+		{
+			clipped[count++] = glm::mix(from, to, fromDistance / (fromDistance - toDistance));
+		}
+	}
+	if (count < 3)
+		return;
+
+	//To pixels, with depth in [0, 1]
+	glm::vec3 screen[4];
+	for (int i = 0; i < count; i++)
+	{
+		float w = std::max(clipped[i].w, 1e-5f);
+		glm::vec3 ndc = glm::vec3(clipped[i]) / w;
+		screen[i] = glm::vec3((ndc.x * 0.5f + 0.5f) * _width, (ndc.y * 0.5f + 0.5f) * _height, ndc.z * 0.5f + 0.5f);
+	}
+
+	BinTriangle(screen[0], screen[1], screen[2]);
+	if (count == 4)
+	{
+		BinTriangle(screen[0], screen[2], screen[3]);
+	}
+}
+
+void OcclusionCuller::BinTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+	//Occluder meshes aren't guaranteed to be closed or wound the same way, so both windings are drawn
+	float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	if (std::abs(area) < 1e-6f)
+		return;
+	const glm::vec3& p0 = a;
+	const glm::vec3& p1 = area > 0.0f ? b : c;
+	const glm::vec3& p2 = area > 0.0f ? c : b;
+	area = std::abs(area);
+
+	Triangle triangle;
+	//Clamped as floats first, vertices close to the near plane can land a long way off screen
+	glm::vec2 boundsMin = glm::clamp(glm::min(glm::vec2(p0), glm::min(glm::vec2(p1), glm::vec2(p2))), glm::vec2(-1.0f), glm::vec2(_width, _height));
+	glm::vec2 boundsMax = glm::clamp(glm::max(glm::vec2(p0), glm::max(glm::vec2(p1), glm::vec2(p2))), glm::vec2(-1.0f), glm::vec2(_width, _height));
+	triangle._minX = std::max(int(std::floor(boundsMin.x)), 0);
+	triangle._minY = std::max(int(std::floor(boundsMin.y)), 0);
+	triangle._maxX = std::min(int(std::ceil(boundsMax.x)), _width - 1);
+	triangle._maxY = std::min(int(std::ceil(boundsMax.y)), _height - 1);
+	if (triangle._minX > triangle._maxX || triangle._minY > triangle._maxY)
+		return;
+
+	//Each edge is positive on the inside
+	const glm::vec3* corners[3] = { &p0, &p1, &p2 };
+	for (int i = 0; i < 3; i++)
+	{
+		const glm::vec3& from = *corners[i];
+		const glm::vec3& to = *corners[(i + 1) % 3];
+		float edgeA = from.y - to.y;
+		float edgeB = to.x - from.x;
+		triangle._edges[i] = glm::vec3(edgeA, edgeB, -(edgeA * from.x + edgeB * from.y));
+	}
+
+	//Depth is linear in screen space after the divide
+	glm::vec3 u = p1 - p0;
+	glm::vec3 v = p2 - p0;
+	float depthX = (u.z * v.y - v.z * u.y) / area;
+	float depthY = (v.z * u.x - u.z * v.x) / area;
+	triangle._depth = glm::vec3(depthX, depthY, p0.z - depthX * p0.x - depthY * p0.y);
+
+	uint32_t index = uint32_t(_triangles.size());
+	_triangles.push_back(triangle);
+	for (int ty = triangle._minY / TILE_HEIGHT; ty <= triangle._maxY / TILE_HEIGHT; ty++)
+	{
+		for (int tx = triangle._minX / TILE_WIDTH; tx <= triangle._maxX / TILE_WIDTH; tx++)
+		{
+			_bins[ty * _tilesX + tx].push_back(index);
+		}
+	}
+}
+
+void OcclusionCuller::RasteriseTile(int tile)
+{
+	const std::vector<uint32_t>& bin = _bins[tile];
+	if (bin.empty())
+		return;
+
+	int tileX0 = (tile % _tilesX) * TILE_WIDTH;
+	int tileY0 = (tile / _tilesX) * TILE_HEIGHT;
+	int tileX1 = tileX0 + TILE_WIDTH - 1;
+	int tileY1 = tileY0 + TILE_HEIGHT - 1;
+
+	for (uint32_t index : bin)
+	{
+		const Triangle& triangle = _triangles[index];
+		//Start on a multiple of 4 so the groups of pixels never straddle a tile
+		int x0 = std::max(tileX0, triangle._minX) & ~3;
+		int x1 = std::min(tileX1, triangle._maxX);
+		int y0 = std::max(tileY0, triangle._minY);
+		int y1 = std::min(tileY1, triangle._maxY);
+
+		for (int y = y0; y <= y1; y++)
+		{
+			float* row = _depth.data() + size_t(y) * _width;
+			float pixelY = float(y) + 0.5f;
+#if OCCLUSION_SSE
+			__m128 pixelX = _mm_add_ps(_mm_set1_ps(float(x0)), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+			__m128 edges[3];
+			__m128 edgeSteps[3];
+			for (int i = 0; i < 3; i++)
+			{
+				const glm::vec3& edge = triangle._edges[i];
+				edges[i] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edge.x), pixelX), _mm_set1_ps(edge.y * pixelY + edge.z));
+				edgeSteps[i] = _mm_set1_ps(edge.x * 4.0f);
+			}
+			__m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle._depth.x), pixelX), _mm_set1_ps(triangle._depth.y * pixelY + triangle._depth.z));
+			__m128 depthStep = _mm_set1_ps(triangle._depth.x * 4.0f);
+			__m128 zero = _mm_setzero_ps();
+
+			for (int x = x0; x <= x1; x += 4)
+			{
+				__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edges[0], zero), _mm_cmpge_ps(edges[1], zero)), _mm_cmpge_ps(edges[2], zero));
+				if (_mm_movemask_ps(inside) != 0)
+				{
+					__m128 current = _mm_loadu_ps(row + x);
+					__m128 nearer = _mm_min_ps(current, _mm_max_ps(depth, zero));
+					_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, current)));
+				}
+				for (int i = 0; i < 3; i++)
+				{
+					edges[i] = _mm_add_ps(edges[i], edgeSteps[i]);
+				}
+				depth = _mm_add_ps(depth, depthStep);
+			}
+#else
+			for (int x = x0; x <= x1; x++)
+			{
+				float pixelX = float(x) + 0.5f;
+				bool inside = true;
+				for (int i = 0; i < 3; i++)
+				{
+					const glm::vec3& edge = triangle._edges[i];
+					inside &= edge.x * pixelX + edge.y * pixelY + edge.z >= 0.0f;
+				}
+				if (inside)
+				{
+					float depth = triangle._depth.x * pixelX + triangle._depth.y * pixelY + triangle._depth.z;
+					row[x] = std::min(row[x], std::max(depth, 0.0f));
+				}
+			}
+#endif
+		}
+	}
+
+	//Furthest depth left in the tile, boxes behind it are hidden without looking at pixels
+	float furthest = 0.0f;
+	for (int y = tileY0; y <= tileY1; y++)
+	{
+		const float* row = _depth.data() + size_t(y) * _width;
+		for (int x = tileX0; x <= tileX1; x++)
+		{
+			furthest = std::max(furthest, row[x]);
+		}
+	}
+	_tileMaxDepth[tile] = furthest;
+}
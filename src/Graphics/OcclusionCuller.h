@@ -0,0 +1,89 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include <GLM/glm.hpp>
+
+//Marks a renderer whose LOD chain gets drawn into the occlusion buffer, keep it to big solid things
+struct OccluderComponent
+{
+	bool _enabled = true;
+};
+
+//Per frame numbers for the occlusion culling
+struct OcclusionStats
+{
+	size_t _occluders = 0;
+	//Triangles that made it to the rasteriser (after near clipping)
+	size_t _triangles = 0;
+	size_t _tested = 0;
+	size_t _culled = 0;
+	//Time spent setting up and rasterising the occluders, in milliseconds
+	float _rasteriseMilliseconds = 0.0f;
+	//Time spent testing boxes, in milliseconds
+	float _testMilliseconds = 0.0f;
+};
+
+//Software occlusion culling, a few occluder meshes are rasterised into a small depth buffer on the CPU
+//and occludees' boxes are tested against it before they're drawn
+//*The buffer is split into tiles, triangles are binned into the tiles they touch and the tiles are
+// rasterised in parallel on the thread pool, 4 pixels at a time with SSE when it's there
+//*Each tile keeps its furthest depth, so a box behind a fully covered tile is rejected without touching its pixels
+//*Nothing in here touches GL, it only needs a view projection and triangles
+class OcclusionCuller
+{
+public:
+	static const int TILE_WIDTH = 32;
+	static const int TILE_HEIGHT = 16;
+
+	//Sets the buffer size, rounded up to whole tiles
+	void Init(int width, int height);
+	int GetWidth() const;
+	int GetHeight() const;
+
+	//Clears the buffer and starts a frame from this camera
+	void Begin(const glm::mat4& viewProjection);
+	//Queues an occluder's triangles, positions are in object space
+	void AddOccluder(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, const glm::mat4& world);
+	//Rasterises everything queued since Begin
+	void Rasterise();
+
+	//Tests a world space box against the buffer, false if it's definitely hidden
+	bool IsVisible(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+	//Buffer depths (0 near, 1 far), row 0 is the bottom of the screen
+	const std::vector<float>& GetDepth() const;
+
+	//Test numbers build up until the next Begin
+	const OcclusionStats& GetStats() const;
+
+private:
+	//A screen space triangle set up for rasterising, edge and depth functions are a * x + b * y + c
+	struct Triangle
+	{
+		glm::vec3 _edges[3];
+		glm::vec3 _depth;
+		int _minX, _minY, _maxX, _maxY;
+	};
+
+	//Clips against the near plane, then sets up and bins what's left
+	void SetupTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+	void BinTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+	void RasteriseTile(int tile);
+
+	int _width = 0;
+	int _height = 0;
+	int _tilesX = 0;
+	int _tilesY = 0;
+
+	glm::mat4 _viewProjection = glm::mat4(1.0f);
+	std::vector<float> _depth;
+	//Furthest depth in each tile
+	std::vector<float> _tileMaxDepth;
+
+	std::vector<Triangle> _triangles;
+	//Triangles touching each tile
+	std::vector<std::vector<uint32_t>> _bins;
+
+	OcclusionStats _stats;
+};
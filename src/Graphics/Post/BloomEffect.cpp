@@ -1,88 +1,155 @@
 #include "BloomEffect.h"
 
+#include <algorithm>
+#include <string>
+
 void BloomEffect::Init(unsigned width, unsigned height)
 {
-	//initialize buffers
-	int index = int(_buffers.size());
-	_buffers.push_back(new Framebuffer());
-	_buffers[index]->AddColorTarget(GL_RGBA8);
-	_buffers[index]->Init(width, height);
+	//initializing shaders
+	AddShader("shaders/Post/bloom_frag.glsl");
+	AddShader("shaders/Post/bloom_composite_frag.glsl");
+	SetFusedSource("shaders/Post/Fused/bloom_composite.glsl");
+	AddShader("shaders/Post/bloom_downsample_frag.glsl");
+	AddShader("shaders/Post/bloom_upsample_frag.glsl");
+	_blur.Init();
+
+	PostEffect::Init(width, height);
+}
 
-	_buffers.push_back(new Framebuffer());
-	_buffers[1]->AddColorTarget(GL_RGBA8);
-	_buffers[1]->Init(width, height);
+FrameGraphResource BloomEffect::AddPasses(FrameGraph& graph, FrameGraphResource input)
+{
+	FrameGraphResource bloom = AddBlurPasses(graph, input);
+	FrameGraphResource output = graph.CreateTarget("Bloom", GetTargetDesc());
+
+	graph.AddPass("Bloom Composite", [this, input, bloom, output](const FrameGraph& frame) {
+		BindShader(1);
+		_shaders[1]->SetUniform("u_BloomScale", _bloomScale);
+		frame.GetTarget(input)->BindColorAsTexture(0, 0);
+		frame.GetTarget(bloom)->BindColorAsTexture(0, 1);
+		frame.GetTarget(output)->RenderToFSQ();
+		UnbindTexture(1);
+		UnbindTexture(0);
+		UnbindShader();
+	}).Read(input).Read(bloom).Write(output);
 
-	_buffers.push_back(new Framebuffer());
-	_buffers[2]->AddColorTarget(GL_RGBA8);
-	_buffers[2]->Init(width, height);
+	return output;
+}
 
-	_buffers.push_back(new Framebuffer());
-	_buffers[3]->AddColorTarget(GL_RGBA8);
-	_buffers[3]->Init(width, height);
+bool BloomEffect::NeedsTargetInput() const
+{
+	return true;
+}
 
-	//initializing shaders
-	index = int(_shaders.size());
-	_shaders.push_back(Shader::Create());
-	_shaders[index]->LoadShaderPartFromFile("shaders/passthrough_vert.glsl", GL_VERTEX_SHADER);
-	_shaders[index]->LoadShaderPartFromFile("shaders/Post/bloom_normal_lighting_frag.glsl", GL_FRAGMENT_SHADER);
-	_shaders[index]->Link();
-
-	_shaders.push_back(Shader::Create());
-	_shaders[1]->LoadShaderPartFromFile("shaders/passthrough_vert.glsl", GL_VERTEX_SHADER);
-	_shaders[1]->LoadShaderPartFromFile("shaders/Post/bloom_frag.glsl", GL_FRAGMENT_SHADER);
-	_shaders[1]->Link();
-
-	_shaders.push_back(Shader::Create());
-	_shaders[2]->LoadShaderPartFromFile("shaders/passthrough_vert.glsl", GL_VERTEX_SHADER);
-	_shaders[2]->LoadShaderPartFromFile("shaders/Post/gaussian_blur_frag.glsl", GL_FRAGMENT_SHADER);
-	_shaders[2]->Link();
-
-	_shaders.push_back(Shader::Create());
-	_shaders[3]->LoadShaderPartFromFile("shaders/passthrough_vert.glsl", GL_VERTEX_SHADER);
-	_shaders[3]->LoadShaderPartFromFile("shaders/Post/bloom_composite_frag.glsl", GL_FRAGMENT_SHADER);
-	_shaders[3]->Link();
-}
-
-void BloomEffect::ApplyEffect(PostEffect* buffer)
-{
-	BindShader(0);
-	buffer->BindColorAsTexture(0, 0, 0);
-	_buffers[0]->RenderToFSQ();
-	buffer->UnbindTexture(0);
-	UnbindShader();
-
-	BindShader(1);
-	_shaders[1]->SetUniform("u_Threshold", _threshold);
-	BindColorAsTexture(0, 0, 0);
-	_buffers[1]->RenderToFSQ();
-	UnbindTexture(0);
-	UnbindShader();
-
-	for (int i = 0; i < _passes; i++)
-	{
-		BindShader(2);
-		_shaders[2]->SetUniform("u_Horizontal", (int)true);
-		BindColorAsTexture(1, 0, 0);
-		_buffers[2]->RenderToFSQ();
-		UnbindTexture(0);
-		UnbindShader();
+int BloomEffect::GetFusedTextureCount() const
+{
+	return 1;
+}
+
+std::vector<FrameGraphResource> BloomEffect::AddFusedInputs(FrameGraph& graph, FrameGraphResource input)
+{
+	return { AddBlurPasses(graph, input) };
+}
+
+void BloomEffect::BindFused(const FrameGraph& frame, const Shader::sptr& shader, const std::string& prefix, int firstSlot,
+	const std::vector<FrameGraphResource>& inputs)
+{
+	frame.GetTarget(inputs[0])->BindColorAsTexture(0, firstSlot);
+	shader->SetUniform(prefix + "BloomTex", firstSlot);
+	shader->SetUniform(prefix + "BloomScale", _bloomScale);
+}
+
+void BloomEffect::UnbindFused(int firstSlot)
+{
+	UnbindTexture(firstSlot);
+}
 
-		BindShader(2);
-		_shaders[2]->SetUniform("u_Horizontal", (int)false);
-		BindColorAsTexture(2, 0, 0);
-		_buffers[1]->RenderToFSQ();
+FrameGraphResource BloomEffect::AddBlurPasses(FrameGraph& graph, FrameGraphResource input)
+{
+	if (_mode == BloomMode::MipChain)
+		return AddMipChainPasses(graph, input);
+	return AddGaussianPasses(graph, input);
+}
+
+FrameGraphResource BloomEffect::AddGaussianPasses(FrameGraph& graph, FrameGraphResource input)
+{
+	_bloomScale = 1.0f;
+
+	//Linear so the blur's fragment path can fold its taps
+	RenderTargetDesc desc = GetTargetDesc();
+	desc._filter = GL_LINEAR;
+	FrameGraphResource bright = graph.CreateTarget("Bloom Bright", desc);
+
+	graph.AddPass("Bloom Threshold", [this, input, bright](const FrameGraph& frame) {
+		BindShader(0);
+		_shaders[0]->SetUniform("u_Threshold", _threshold);
+		frame.GetTarget(input)->BindColorAsTexture(0, 0);
+		frame.GetTarget(bright)->RenderToFSQ();
 		UnbindTexture(0);
 		UnbindShader();
+	}).Read(input).Write(bright);
+
+	return _blur.AddPasses(graph, bright, desc);
+}
+
+FrameGraphResource BloomEffect::AddMipChainPasses(FrameGraph& graph, FrameGraphResource input)
+{
+	//Half resolution down, linear filtering so every tap is a 2x2 box for free
+	//*R11G11B10 so the levels can add up past 1 without costing more than RGBA8
+	std::vector<FrameGraphResource> levels;
+	RenderTargetDesc desc = GetTargetDesc({ GL_R11F_G11F_B10F });
+	desc._filter = GL_LINEAR;
+	for (int i = 0; i < _mipLevels; i++)
+	{
+		desc._width = std::max(desc._width / 2, 1u);
+		desc._height = std::max(desc._height / 2, 1u);
+		levels.push_back(graph.CreateTarget("Bloom Mip " + std::to_string(i), desc));
+
+		//Anything smaller than this is just a blob
+		if (desc._width <= 8 || desc._height <= 8)
+			break;
+	}
+
+	//The first downsample reads the full resolution input and thresholds it, so there's no full resolution bright pass
+	FrameGraphResource source = input;
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		FrameGraphResource level = levels[i];
+		bool prefilter = i == 0;
+		graph.AddPass("Bloom Downsample", [this, source, level, prefilter](const FrameGraph& frame) {
+			BindShader(2);
+			_shaders[2]->SetUniform("u_Prefilter", (int)prefilter);
+			_shaders[2]->SetUniform("u_Threshold", _threshold);
+			frame.GetTarget(source)->BindColorAsTexture(0, 0);
+			frame.GetTarget(level)->RenderToFSQ();
+			UnbindTexture(0);
+			UnbindShader();
+		}).Read(source).Write(level);
+		source = level;
 	}
 
-	BindShader(3);
-	buffer->BindColorAsTexture(0, 0, 0);
-	BindColorAsTexture(1, 0, 1);
-	_buffers[0]->RenderToFSQ();
-	UnbindTexture(1);
-	UnbindTexture(0);
-	UnbindShader();
+	//Then back up, each level is tent filtered and added on top of the one above it
+	for (size_t i = levels.size() - 1; i > 0; i--)
+	{
+		FrameGraphResource lower = levels[i];
+		FrameGraphResource upper = levels[i - 1];
+		graph.AddPass("Bloom Upsample", [this, lower, upper](const FrameGraph& frame) {
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_ONE, GL_ONE);
+
+			BindShader(3);
+			frame.GetTarget(lower)->BindColorAsTexture(0, 0);
+			frame.GetTarget(upper)->RenderToFSQ();
+			UnbindTexture(0);
+			UnbindShader();
+
+			glDisable(GL_BLEND);
+		}).Read(lower).Read(upper).Write(upper);
+	}
+
+	//Every level got added into the top one, so average them back out
+	_bloomScale = 1.0f / float(levels.size());
 
+	return levels[0];
 }
 
 float BloomEffect::GetThreshold() const
@@ -90,9 +157,19 @@ float BloomEffect::GetThreshold() const
 	return _threshold;
 }
 
-int BloomEffect::GetPasses() const
+SeparableBlur& BloomEffect::GetBlurRef()
+{
+	return _blur;
+}
+
+BloomMode BloomEffect::GetMode() const
 {
-	return _passes;
+	return _mode;
+}
+
+int BloomEffect::GetMipLevels() const
+{
+	return _mipLevels;
 }
 
 
@@ -101,12 +178,18 @@ void BloomEffect::SetThreshold(float threshold)
 	_threshold = threshold;
 }
 
-void BloomEffect::SetPasses(float passes)
+void BloomEffect::SetMode(BloomMode mode)
+{
+	_mode = mode;
+}
+
+void BloomEffect::SetMipLevels(int levels)
 {
-	_passes = passes;
+	_mipLevels = std::max(levels, 1);
 }
 
 void BloomEffect::SetShaderUniform(int _shaderNum, std::string name, float value)
 {
-	_shaders[_shaderNum]->SetUniform(name, value);
+	if (_shaders[_shaderNum] != nullptr)
+		_shaders[_shaderNum]->SetUniform(name, value);
 }
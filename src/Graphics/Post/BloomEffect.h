@@ -1,6 +1,17 @@
 #pragma once
 
 #include "Graphics/Post/PostEffect.h"
+#include "Graphics/Post/SeparableBlur.h"
+
+//How the bright parts get blurred
+enum class BloomMode
+{
+	//Thresholds at full resolution then runs a SeparableBlur over it
+	Gaussian,
+	//Progressively downsamples into a half resolution mip chain then tent filters back up, adding each level on
+	//*Costs a fraction of one full resolution pass no matter how wide the bloom is
+	MipChain
+};
 
 class BloomEffect : public PostEffect
 {
@@ -9,22 +20,41 @@ public:
 	//override post effect init
 	void Init(unsigned width, unsigned height) override;
 
-	//applies effect to this buffer
-	void ApplyEffect(PostEffect* buffer) override;
+	//Adds the effect's passes to the graph, reading from input
+	FrameGraphResource AddPasses(FrameGraph& graph, FrameGraphResource input) override;
 
-	//applies the effect to the screen
-	//void DrawToScreen() override;
+	//The fused version is just the composite, the blur still runs as its own passes on the fused pass' input
+	bool NeedsTargetInput() const override;
+	int GetFusedTextureCount() const override;
+	std::vector<FrameGraphResource> AddFusedInputs(FrameGraph& graph, FrameGraphResource input) override;
+	void BindFused(const FrameGraph& frame, const Shader::sptr& shader, const std::string& prefix, int firstSlot,
+		const std::vector<FrameGraphResource>& inputs) override;
+	void UnbindFused(int firstSlot) override;
 
 	//Getters
 	float GetThreshold() const;
-	int GetPasses() const;
+	//The blur the gaussian mode uses, set its radius and path through this
+	SeparableBlur& GetBlurRef();
+	BloomMode GetMode() const;
+	int GetMipLevels() const;
 
 	//setters
 	void SetThreshold(float threshold);
-	void SetPasses(float passes);
+	void SetMode(BloomMode mode);
+	//Sets how many levels the mip chain goes down (it stops early once levels get too small)
+	void SetMipLevels(int levels);
 	void SetShaderUniform(int _shaderNum, std::string name, float value);
 
 private:
+	//Adds the threshold and blur passes for the current mode, returns the target the blurred bright parts end up in
+	FrameGraphResource AddBlurPasses(FrameGraph& graph, FrameGraphResource input);
+	FrameGraphResource AddGaussianPasses(FrameGraph& graph, FrameGraphResource input);
+	FrameGraphResource AddMipChainPasses(FrameGraph& graph, FrameGraphResource input);
+
 	float _threshold = 0.05f;
-	int _passes = 10;
+	SeparableBlur _blur;
+	BloomMode _mode = BloomMode::MipChain;
+	int _mipLevels = 6;
+	//What the composite scales the blurred target by, set when the blur passes are added
+	float _bloomScale = 1.0f;
 };
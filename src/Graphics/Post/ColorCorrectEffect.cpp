@@ -1,45 +1,78 @@
 #include "ColorCorrectEffect.h"
 
+#include <Logging.h>
+
+#include "Utilities/AssetRegistry.h"
+
 void ColorCorrectEffect::Init(unsigned width, unsigned height)
 {
-	int index = int(_buffers.size());
-	_buffers.push_back(new Framebuffer());
-	_buffers[index]->AddColorTarget(GL_RGBA8);
-	_buffers[index]->AddDepthTarget();
-	_buffers[index]->Init(width, height);
-
 	//Loads the shaders
-	index = int(_shaders.size());
-	_shaders.push_back(Shader::Create());
-	_shaders[index]->LoadShaderPartFromFile("shaders/passthrough_vert.glsl", GL_VERTEX_SHADER);
-	_shaders[index]->LoadShaderPartFromFile("shaders/Post/color_correction_frag.glsl", GL_FRAGMENT_SHADER);
-	_shaders[index]->Link();
+	AddShader("shaders/Post/color_correction_frag.glsl");
+	SetFusedSource("shaders/Post/Fused/color_correction.glsl");
 
 	//Load in cube
-	_Lut.loadFromFile("cubes/BrightenedCorrection.cube");
+	_Lut = AssetRegistry::GetLUT("cubes/BrightenedCorrection.cube");
+	if (_Lut == nullptr)
+	{
+		LOG_WARN("Color correction has no LUT, it will pass its input through until one is set");
+	}
 
 	PostEffect::Init(width, height);
 }
 
-void ColorCorrectEffect::ApplyEffect(PostEffect* buffer)
+FrameGraphResource ColorCorrectEffect::AddPasses(FrameGraph& graph, FrameGraphResource input)
+{
+	if (_Lut == nullptr || !IsLoaded())
+		return input;
+
+	FrameGraphResource output = graph.CreateTarget("Color Correct", GetTargetDesc());
+
+	graph.AddPass("Color Correct", [this, input, output](const FrameGraph& frame) {
+		BindShader(0);
+		//Samples land on texel centres, which depends on how many entries the LUT has
+		_shaders[0]->SetUniform("u_LutSize", float(_Lut->GetSize()));
+		frame.GetTarget(input)->BindColorAsTexture(0, 0);
+		_Lut->bind(30);
+
+		frame.GetTarget(output)->RenderToFSQ();
+
+		_Lut->unbind(30);
+		UnbindTexture(0);
+		UnbindShader();
+	}).Read(input).Write(output);
+
+	return output;
+}
+
+bool ColorCorrectEffect::IsFusable() const
 {
-	BindShader(0);
-	buffer->BindColorAsTexture(0, 0, 0);
-	_Lut.bind(30);
+	return _Lut != nullptr && PostEffect::IsFusable();
+}
 
-	_buffers[0]->RenderToFSQ();
+int ColorCorrectEffect::GetFusedTextureCount() const
+{
+	return 1;
+}
 
-	_Lut.unbind(30);
-	buffer->UnbindTexture(0);
-	UnbindShader();
+void ColorCorrectEffect::BindFused(const FrameGraph& frame, const Shader::sptr& shader, const std::string& prefix, int firstSlot,
+	const std::vector<FrameGraphResource>& inputs)
+{
+	_Lut->bind(firstSlot);
+	shader->SetUniform(prefix + "TexColorGrade", firstSlot);
+	shader->SetUniform(prefix + "LutSize", float(_Lut->GetSize()));
+}
+
+void ColorCorrectEffect::UnbindFused(int firstSlot)
+{
+	_Lut->unbind(firstSlot);
 }
 
-LUT3D ColorCorrectEffect::GetLUT() const
+LUT3D::sptr ColorCorrectEffect::GetLUT() const
 {
 	return _Lut;
 }
 
-void ColorCorrectEffect::SetLUT(LUT3D cube)
+void ColorCorrectEffect::SetLUT(LUT3D::sptr cube)
 {
 	_Lut = cube;
 }
@@ -11,15 +11,21 @@ public:
 	//Overrides post effect Init
 	void Init(unsigned width, unsigned height) override;
 
-	//Applies the effect to this buffer
-	//passes the previous framebuffer with the texture to apply as parameter
-	void ApplyEffect(PostEffect* buffer) override;
+	//Adds the effect's passes to the graph, reading from input
+	FrameGraphResource AddPasses(FrameGraph& graph, FrameGraphResource input) override;
+	//Without a LUT there's nothing to correct with, so the effect passes its input through and isn't fused
+	bool IsFusable() const override;
+	//The fused version samples the LUT from its own slot
+	int GetFusedTextureCount() const override;
+	void BindFused(const FrameGraph& frame, const Shader::sptr& shader, const std::string& prefix, int firstSlot,
+		const std::vector<FrameGraphResource>& inputs) override;
+	void UnbindFused(int firstSlot) override;
 
 	//Getters
-	LUT3D GetLUT() const;
+	LUT3D::sptr GetLUT() const;
 
 	//Setters
-	void SetLUT(LUT3D cube);
+	void SetLUT(LUT3D::sptr cube);
 private:
-	LUT3D _Lut;
+	LUT3D::sptr _Lut;
 };
\ No newline at end of file
@@ -2,41 +2,39 @@
 
 void FilmGrainEffect::Init(unsigned width, unsigned height)
 {
-	int index = int(_buffers.size());
-	_buffers.push_back(new Framebuffer());
-	_buffers[index]->AddColorTarget(GL_RGBA8);
-	_buffers[index]->AddDepthTarget();
-	_buffers[index]->Init(width, height);
-
-	index = int(_shaders.size());
-	_shaders.push_back(Shader::Create());
-	_shaders[index]->LoadShaderPartFromFile("shaders/passthrough_vert.glsl", GL_VERTEX_SHADER);
-	_shaders[index]->LoadShaderPartFromFile("shaders/Post/film_grain_frag.glsl", GL_FRAGMENT_SHADER);
-	_shaders[index]->Link();
+	AddShader("shaders/Post/film_grain_frag.glsl");
+	SetFusedSource("shaders/Post/Fused/film_grain.glsl");
+
+	PostEffect::Init(width, height);
 }
 
-void FilmGrainEffect::ApplyEffect(PostEffect* buffer)
+FrameGraphResource FilmGrainEffect::AddPasses(FrameGraph& graph, FrameGraphResource input)
 {
-	BindShader(0);
-	_time++;
-	float result = sin(_time / 10) * 10;
-	_shaders[0]->SetUniform("u_Time", result);
-	_shaders[0]->SetUniform("u_Strength", _strength);
-	buffer->BindColorAsTexture(0, 0, 0);
-	_buffers[0]->RenderToFSQ();
-	buffer->UnbindTexture(0);
-	UnbindShader();
+	FrameGraphResource output = graph.CreateTarget("Film Grain", GetTargetDesc());
+
+	graph.AddPass("Film Grain", [this, input, output](const FrameGraph& frame) {
+		BindShader(0);
+		_time++;
+		float result = sin(_time / 10) * 10;
+		_shaders[0]->SetUniform("u_Time", result);
+		_shaders[0]->SetUniform("u_Strength", _strength);
+		frame.GetTarget(input)->BindColorAsTexture(0, 0);
+		frame.GetTarget(output)->RenderToFSQ();
+		UnbindTexture(0);
+		UnbindShader();
+	}).Read(input).Write(output);
+
+	return output;
 }
 
-/*void FilmGrainEffect::DrawToScreen()
+void FilmGrainEffect::BindFused(const FrameGraph& frame, const Shader::sptr& shader, const std::string& prefix, int firstSlot,
+	const std::vector<FrameGraphResource>& inputs)
 {
-	BindShader(0);
-	_shaders[0]->SetUniform("u_Intensity", _intensity);
-	BindColorAsTexture(0, 0, 0);
-	_buffers[0]->DrawFullscreenQuad();
-	UnbindTexture(0);
-	UnbindShader();
-}*/
+	_time++;
+	float result = sin(_time / 10) * 10;
+	shader->SetUniform(prefix + "Time", result);
+	shader->SetUniform(prefix + "Strength", _strength);
+}
 
 float FilmGrainEffect::GetStrength() const
 {
@@ -9,12 +9,11 @@ public:
 	//Overrides post effect Init
 	void Init(unsigned width, unsigned height) override;
 
-	//Applies the effect to this buffer
-	//Passes the previous framebuffer with the texture to apply as a parameter
-	void ApplyEffect(PostEffect* buffer) override;
-
-	//Applies the effect to the screen
-	//void DrawToScreen() override;
+	//Adds the effect's passes to the graph, reading from input
+	FrameGraphResource AddPasses(FrameGraph& graph, FrameGraphResource input) override;
+	//Advances the grain and sets it on the fused shader
+	void BindFused(const FrameGraph& frame, const Shader::sptr& shader, const std::string& prefix, int firstSlot,
+		const std::vector<FrameGraphResource>& inputs) override;
 
 	//Getters
 	float GetStrength() const;
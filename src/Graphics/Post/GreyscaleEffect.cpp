@@ -2,32 +2,37 @@
 
 void GreyscaleEffect::Init(unsigned width, unsigned height)
 {
-    int index = int(_buffers.size());
-    _buffers.push_back(new Framebuffer());
-    _buffers[index]->AddColorTarget(GL_RGBA8);
-    _buffers[index]->AddDepthTarget();
-    _buffers[index]->Init(width, height);
-
     //Loads the shaders
-    index = int(_shaders.size());
-    _shaders.push_back(Shader::Create());
-    _shaders[index]->LoadShaderPartFromFile("shaders/passthrough_vert.glsl", GL_VERTEX_SHADER);
-    _shaders[index]->LoadShaderPartFromFile("shaders/Post/greyscale_frag.glsl", GL_FRAGMENT_SHADER);
-    _shaders[index]->Link();
+    AddShader("shaders/Post/greyscale_frag.glsl");
+    SetFusedSource("shaders/Post/Fused/greyscale.glsl");
+
+    PostEffect::Init(width, height);
 }
 
-void GreyscaleEffect::ApplyEffect(PostEffect* buffer)
+FrameGraphResource GreyscaleEffect::AddPasses(FrameGraph& graph, FrameGraphResource input)
 {
-    BindShader(0);
-    _shaders[0]->SetUniform("u_Intensity", _intensity);
+    FrameGraphResource output = graph.CreateTarget("Greyscale", GetTargetDesc());
+
+    graph.AddPass("Greyscale", [this, input, output](const FrameGraph& frame) {
+        BindShader(0);
+        _shaders[0]->SetUniform("u_Intensity", _intensity);
+
+        frame.GetTarget(input)->BindColorAsTexture(0, 0);
 
-    buffer->BindColorAsTexture(0, 0, 0);
+        frame.GetTarget(output)->RenderToFSQ();
 
-    _buffers[0]->RenderToFSQ();
+        UnbindTexture(0);
 
-    buffer->UnbindTexture(0);
+        UnbindShader();
+    }).Read(input).Write(output);
 
-    UnbindShader();
+    return output;
+}
+
+void GreyscaleEffect::BindFused(const FrameGraph& frame, const Shader::sptr& shader, const std::string& prefix, int firstSlot,
+    const std::vector<FrameGraphResource>& inputs)
+{
+    shader->SetUniform(prefix + "Intensity", _intensity);
 }
 
 float GreyscaleEffect::GetIntensity() const
@@ -9,9 +9,11 @@ public:
 	//Overrides post effect Init
 	void Init(unsigned width, unsigned height) override;
 
-	//Applies the effect to this buffer
-	//passes the previous framebuffer with the texture to apply as parameter
-	void ApplyEffect(PostEffect* buffer) override;
+	//Adds the effect's passes to the graph, reading from input
+	FrameGraphResource AddPasses(FrameGraph& graph, FrameGraphResource input) override;
+	//Sets the intensity on the fused shader
+	void BindFused(const FrameGraph& frame, const Shader::sptr& shader, const std::string& prefix, int firstSlot,
+		const std::vector<FrameGraphResource>& inputs) override;
 
 	//Getters
 	float GetIntensity() const;
@@ -2,30 +2,26 @@
 
 void PixelatedEffect::Init(unsigned width, unsigned height)
 {
-	int index = int(_buffers.size());
-	_buffers.push_back(new Framebuffer());
-	_buffers[index]->AddColorTarget(GL_RGBA8);
-	_buffers[index]->AddDepthTarget();
-	_buffers[index]->Init(width, height);
-
 	//Loads the shaders
-	index = int(_shaders.size());
-	_shaders.push_back(Shader::Create());
-	_shaders[index]->LoadShaderPartFromFile("shaders/passthrough_vert.glsl", GL_VERTEX_SHADER);
-	_shaders[index]->LoadShaderPartFromFile("shaders/Post/pixelated_frag.glsl", GL_FRAGMENT_SHADER);
-	_shaders[index]->Link();
+	AddShader("shaders/Post/pixelated_frag.glsl");
 
 	PostEffect::Init(width, height);
 }
 
-void PixelatedEffect::ApplyEffect(PostEffect* buffer)
+FrameGraphResource PixelatedEffect::AddPasses(FrameGraph& graph, FrameGraphResource input)
 {
-	BindShader(0);
-	_shaders[0]->SetUniform("u_Pixels", _pixels);
-	buffer->BindColorAsTexture(0, 0, 0);
-	_buffers[0]->RenderToFSQ();
-	buffer->UnbindTexture(0);
-	UnbindShader();
+	FrameGraphResource output = graph.CreateTarget("Pixelated", GetTargetDesc());
+
+	graph.AddPass("Pixelated", [this, input, output](const FrameGraph& frame) {
+		BindShader(0);
+		_shaders[0]->SetUniform("u_Pixels", _pixels);
+		frame.GetTarget(input)->BindColorAsTexture(0, 0);
+		frame.GetTarget(output)->RenderToFSQ();
+		UnbindTexture(0);
+		UnbindShader();
+	}).Read(input).Write(output);
+
+	return output;
 }
 
 float PixelatedEffect::GetPixels() const
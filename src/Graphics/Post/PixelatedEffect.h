@@ -10,9 +10,8 @@ public:
 	//Overrides post effect Init
 	void Init(unsigned width, unsigned height) override;
 
-	//Applies the effect to this buffer
-	//passes the previous framebuffer with the texture to apply as parameter
-	void ApplyEffect(PostEffect* buffer) override;
+	//Adds the effect's passes to the graph, reading from input
+	FrameGraphResource AddPasses(FrameGraph& graph, FrameGraphResource input) override;
 
 	//Getters
 	float GetPixels() const;
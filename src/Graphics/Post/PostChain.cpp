@@ -0,0 +1,211 @@
+#include "PostChain.h"
+
+#include <sstream>
+
+#include <Logging.h>
+
+#include "Utilities/AssetRegistry.h"
+#include "Utilities/ShaderCache.h"
+#include "Utilities/Util.h"
+
+void PostChain::Init(unsigned width, unsigned height)
+{
+	PostEffect::Init(width, height);
+}
+
+void PostChain::AddEffect(PostEffect* effect, const std::string& name, bool enabled)
+{
+	PostChainEntry entry;
+	entry._effect = effect;
+	entry._name = name;
+	entry._enabled = enabled;
+	_effects.push_back(entry);
+}
+
+std::vector<PostChainEntry>& PostChain::GetEffectsRef()
+{
+	return _effects;
+}
+
+FrameGraphResource PostChain::AddPasses(FrameGraph& graph, FrameGraphResource input)
+{
+	_fusedPasses = 0;
+	_fusedEffects = 0;
+
+	FrameGraphResource current = input;
+	std::vector<PostEffect*> run;
+	auto flush = [&]() {
+		if (!run.empty())
+			current = AddFusedPass(graph, current, run);
+		run.clear();
+	};
+
+	for (const PostChainEntry& entry : _effects)
+	{
+		if (!entry._enabled || !entry._effect->IsLoaded())
+			continue;
+
+		if (!_fusing || !entry._effect->IsFusable())
+		{
+			flush();
+			current = entry._effect->AddPasses(graph, current);
+			continue;
+		}
+
+		if (entry._effect->NeedsTargetInput())
+			flush();
+		run.push_back(entry._effect);
+	}
+	flush();
+
+	//Nothing enabled, the input is the output
+	return current;
+}
+
+void PostChain::SetFusing(bool fusing)
+{
+	_fusing = fusing;
+}
+
+bool PostChain::IsFusing() const
+{
+	return _fusing;
+}
+
+int PostChain::GetFusedPassCount() const
+{
+	return _fusedPasses;
+}
+
+int PostChain::GetFusedEffectCount() const
+{
+	return _fusedEffects;
+}
+
+size_t PostChain::GetFusedShaderCount() const
+{
+	return _fusedPipelines.size();
+}
+
+FrameGraphResource PostChain::AddFusedPass(FrameGraph& graph, FrameGraphResource input, const std::vector<PostEffect*>& run)
+{
+	ShaderPipeline::sptr pipeline = GetFusedPipeline(run);
+	if (pipeline == nullptr)
+	{
+		//Already logged when it failed to build, run them one at a time instead
+		FrameGraphResource current = input;
+		for (PostEffect* effect : run)
+			current = effect->AddPasses(graph, current);
+		return current;
+	}
+
+	//Let each effect add whatever its fused part needs, and hand out texture slots after the input
+	std::vector<std::vector<FrameGraphResource>> inputs(run.size());
+	std::vector<int> slots(run.size());
+	int slot = 1;
+	for (size_t i = 0; i < run.size(); i++)
+	{
+		inputs[i] = run[i]->AddFusedInputs(graph, input);
+		slots[i] = slot;
+		slot += run[i]->GetFusedTextureCount();
+	}
+
+	FrameGraphResource output = graph.CreateTarget("Fused Post", GetTargetDesc());
+
+	FrameGraphPass& pass = graph.AddPass("Fused Post", [run, pipeline, inputs, slots, input, output](const FrameGraph& frame) {
+		const Shader::sptr& shader = pipeline->GetFragmentStage();
+		pipeline->Bind();
+
+		frame.GetTarget(input)->BindColorAsTexture(0, 0);
+		for (size_t i = 0; i < run.size(); i++)
+		{
+			run[i]->BindFused(frame, shader, GetPrefix(i), slots[i], inputs[i]);
+		}
+
+		frame.GetTarget(output)->RenderToFSQ();
+
+		for (size_t i = 0; i < run.size(); i++)
+		{
+			run[i]->UnbindFused(slots[i]);
+		}
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, GL_NONE);
+		ShaderPipeline::UnBind();
+	});
+	pass.Read(input).Write(output);
+	for (const std::vector<FrameGraphResource>& effectInputs : inputs)
+	{
+		for (FrameGraphResource effectInput : effectInputs)
+			pass.Read(effectInput);
+	}
+
+	_fusedPasses++;
+	_fusedEffects += int(run.size());
+	return output;
+}
+
+ShaderPipeline::sptr PostChain::GetFusedPipeline(const std::vector<PostEffect*>& run)
+{
+	uint64_t key = Util::HashBytes(run.data(), run.size() * sizeof(PostEffect*));
+	auto it = _fusedPipelines.find(key);
+	if (it != _fusedPipelines.end())
+		return it->second;
+
+	//Remember failures too, so a broken snippet doesn't get recompiled every frame
+	ShaderPipeline::sptr pipeline;
+	Shader::sptr vertexStage = AssetRegistry::GetShaderStage("shaders/passthrough_vert.glsl", GL_VERTEX_SHADER);
+	Shader::sptr fragmentStage = ShaderCache::LoadSeparableSource({ "fused post effect", GL_FRAGMENT_SHADER }, GenerateSource(run));
+	if (vertexStage != nullptr && fragmentStage != nullptr)
+	{
+		pipeline = ShaderPipeline::Create(vertexStage, fragmentStage);
+		LOG_INFO("Fused {} post effects into one pass", run.size());
+	}
+	else
+	{
+		LOG_WARN("Could not build a fused pass for {} post effects, running them separately", run.size());
+	}
+
+	_fusedPipelines[key] = pipeline;
+	return pipeline;
+}
+
+std::string PostChain::GenerateSource(const std::vector<PostEffect*>& run)
+{
+	std::stringstream source;
+	source << "#version 440\n\n"
+		<< "layout(location = 0) in vec2 inUV;\n\n"
+		<< "out vec4 frag_color;\n\n"
+		<< "layout (binding = 0) uniform sampler2D s_screenTex;\n\n";
+
+	for (size_t i = 0; i < run.size(); i++)
+	{
+		//Swap every $ for the effect's prefix so two effects can't clash (even two of the same effect)
+		std::string prefix = GetPrefix(i);
+		const std::string& snippet = run[i]->GetFusedSource();
+		std::string renamed;
+		renamed.reserve(snippet.size() + prefix.size() * 8);
+		for (char c : snippet)
+		{
+			if (c == '$')
+				renamed += prefix;
+			else
+				renamed += c;
+		}
+		source << renamed << "\n\n";
+	}
+
+	source << "void main()\n{\n"
+		<< "\tvec4 colour = texture(s_screenTex, inUV);\n";
+	for (size_t i = 0; i < run.size(); i++)
+	{
+		source << "\tcolour = " << GetPrefix(i) << "Apply(colour, inUV);\n";
+	}
+	source << "\tfrag_color = colour;\n}\n";
+
+	return source.str();
+}
+
+std::string PostChain::GetPrefix(size_t index)
+{
+	return "fx" + std::to_string(index) + "_";
+}
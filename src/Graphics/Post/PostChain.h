@@ -0,0 +1,65 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "Graphics/Post/PostEffect.h"
+
+//One effect in a chain
+struct PostChainEntry
+{
+	PostEffect* _effect = nullptr;
+	std::string _name;
+	bool _enabled = true;
+};
+
+//Runs an ordered list of effects, fusing runs of point-wise effects into one generated pass
+//*Each fused run becomes a single fragment shader that reads the run's input once, applies every
+// effect's snippet in order in registers, and writes once, so N colour ops cost one fullscreen pass
+//*Effects that read neighbouring pixels (pixelation) break a run and get added with their own passes
+//*Effects whose fused part needs a real input target (bloom blurs its input) start a new run
+//*Generated shaders are built the first time a run shows up and kept, and go through ShaderCache,
+// so a run that was seen in an earlier session loads as a driver binary
+class PostChain : public PostEffect
+{
+public:
+	//Effects in the chain have to be initialized by whoever owns them
+	void Init(unsigned width, unsigned height) override;
+
+	//Adds an effect to the end of the chain
+	void AddEffect(PostEffect* effect, const std::string& name, bool enabled = true);
+	//The chain's effects in order, entries can be toggled and reordered freely
+	std::vector<PostChainEntry>& GetEffectsRef();
+
+	//Adds the enabled effects' passes to the graph, reading from input
+	FrameGraphResource AddPasses(FrameGraph& graph, FrameGraphResource input) override;
+
+	//Turns fusing on or off, with it off every effect adds its own passes
+	void SetFusing(bool fusing);
+	bool IsFusing() const;
+
+	//Number of fused passes and effects folded into them on the last AddPasses
+	int GetFusedPassCount() const;
+	int GetFusedEffectCount() const;
+	//Number of fused shaders built so far
+	size_t GetFusedShaderCount() const;
+
+private:
+	//Adds one pass running every effect in the run, reading from input
+	FrameGraphResource AddFusedPass(FrameGraph& graph, FrameGraphResource input, const std::vector<PostEffect*>& run);
+	//Gets the pipeline for a run, generating it if this run hasn't been seen before
+	ShaderPipeline::sptr GetFusedPipeline(const std::vector<PostEffect*>& run);
+	//Writes the fragment shader for a run, effect i's names start with GetPrefix(i)
+	static std::string GenerateSource(const std::vector<PostEffect*>& run);
+	static std::string GetPrefix(size_t index);
+
+	std::vector<PostChainEntry> _effects;
+	bool _fusing = true;
+
+	//Fused pipelines, keyed by a hash of the effects in the run
+	std::unordered_map<uint64_t, ShaderPipeline::sptr> _fusedPipelines;
+
+	int _fusedPasses = 0;
+	int _fusedEffects = 0;
+};
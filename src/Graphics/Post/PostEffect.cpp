@@ -1,100 +1,106 @@
 #include "PostEffect.h"
 
-void PostEffect::Init(unsigned width, unsigned height)
-{
-	if (!_shaders.size() > 0)
-	{
+#include <fstream>
+#include <sstream>
 
-		int index = int(_buffers.size());
-		_buffers.push_back(new Framebuffer());
-		_buffers[index]->AddColorTarget(GL_RGBA8);
-		_buffers[index]->AddDepthTarget();
-		_buffers[index]->Init(width, height);
-	}
-
-	_shaders.push_back(Shader::Create());
-	_shaders[_shaders.size() - 1]->LoadShaderPartFromFile("shaders/passthrough_vert.glsl", GL_VERTEX_SHADER);
-	_shaders[_shaders.size() - 1]->LoadShaderPartFromFile("shaders/passthrough_frag.glsl", GL_FRAGMENT_SHADER);
-	_shaders[_shaders.size() - 1]->Link();
+#include <Logging.h>
 
-}
+#include "Utilities/AssetRegistry.h"
 
-void PostEffect::ApplyEffect(PostEffect* previousBuffer)
+void PostEffect::Init(unsigned width, unsigned height)
 {
-	BindShader(_shaders.size() - 1);
+	_width = width;
+	_height = height;
 
-	previousBuffer->BindColorAsTexture(0, 0, 0);
+	_passThrough = int(_shaders.size());
+	AddShader("shaders/passthrough_frag.glsl");
+}
 
-	_buffers[0]->RenderToFSQ();
+FrameGraphResource PostEffect::AddPasses(FrameGraph& graph, FrameGraphResource input)
+{
+	if (!_loaded)
+		return input;
 
-	previousBuffer->UnbindTexture(0);
+	FrameGraphResource output = graph.CreateTarget("Passthrough", GetTargetDesc());
 
+	graph.AddPass("Passthrough", [this, input, output](const FrameGraph& frame) {
+		BindShader(_passThrough);
+		frame.GetTarget(input)->BindColorAsTexture(0, 0);
+		frame.GetTarget(output)->RenderToFSQ();
+		UnbindTexture(0);
+		UnbindShader();
+	}).Read(input).Write(output);
 
-	UnbindShader();
+	return output;
 }
 
-void PostEffect::DrawToScreen()
+void PostEffect::AddDrawToScreen(FrameGraph& graph, FrameGraphResource input)
 {
-	BindShader(_shaders.size() - 1);
-
-	BindColorAsTexture(0, 0, 0);
-
-	_buffers[0]->DrawFullscreenQuad();
+	if (!_loaded)
+		return;
+
+	graph.AddPass("Draw To Screen", [this, input](const FrameGraph& frame) {
+		BindShader(_passThrough);
+		glViewport(0, 0, _width, _height);
+		frame.GetTarget(input)->BindColorAsTexture(0, 0);
+		Framebuffer::DrawFullscreenQuad();
+		UnbindTexture(0);
+		UnbindShader();
+	}).Read(input).SideEffect();
+}
 
-	UnbindTexture(0);
+void PostEffect::Reshape(unsigned width, unsigned height)
+{
+	//The graph picks the new size up next frame, old sized targets age out of the pool
+	_width = width;
+	_height = height;
+}
 
-	UnbindShader();
+bool PostEffect::IsLoaded() const
+{
+	return _loaded;
 }
 
-void PostEffect::Reshape(unsigned width, unsigned height)
+bool PostEffect::IsFusable() const
 {
-	for (unsigned int i = 0; i < _buffers.size(); i++)
-	{
-		_buffers[i]->Reshape(width, height);
-	}
+	return !_fusedSource.empty();
 }
 
-void PostEffect::Clear()
+const std::string& PostEffect::GetFusedSource() const
 {
-	for (unsigned int i = 0; i < _buffers.size(); i++)
-	{
-		_buffers[i]->Clear();
-	}
+	return _fusedSource;
 }
 
-void PostEffect::Unload()
+bool PostEffect::NeedsTargetInput() const
 {
-	for (unsigned int i = 0; i < _buffers.size(); i++)
-	{
-		if (_buffers[i] != nullptr)
-		{
-			_buffers[i]->Unload();
-			delete _buffers[i];
-			_buffers[i] = nullptr;
-		}
-	}
+	return false;
+}
 
-	_shaders.clear();
+int PostEffect::GetFusedTextureCount() const
+{
+	return 0;
 }
 
-void PostEffect::BindBuffer(int index)
+std::vector<FrameGraphResource> PostEffect::AddFusedInputs(FrameGraph& graph, FrameGraphResource input)
 {
-	_buffers[index]->Bind();
+	return {};
 }
 
-void PostEffect::UnbindBuffer()
+void PostEffect::BindFused(const FrameGraph& frame, const Shader::sptr& shader, const std::string& prefix, int firstSlot,
+	const std::vector<FrameGraphResource>& inputs)
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, GL_NONE);
 }
 
-void PostEffect::BindColorAsTexture(int index, int colorBuffer, int textureSlot)
+void PostEffect::UnbindFused(int firstSlot)
 {
-	_buffers[index]->BindColorAsTexture(colorBuffer, textureSlot);
 }
 
-void PostEffect::BindDepthAsTexture(int index, int textureSlot)
+void PostEffect::Unload()
 {
-	_buffers[index]->BindDepthAsTexture(textureSlot);
+	_shaders.clear();
+	_pipelines.clear();
+	_passThrough = -1;
+	_loaded = true;
 }
 
 void PostEffect::UnbindTexture(int textureSlot)
@@ -105,10 +111,50 @@ void PostEffect::UnbindTexture(int textureSlot)
 
 void PostEffect::BindShader(int index)
 {
-	_shaders[index]->Bind();
+	_pipelines[index]->Bind();
 }
 
 void PostEffect::UnbindShader()
 {
-	glUseProgram(GL_NONE);
+	ShaderPipeline::UnBind();
+}
+
+void PostEffect::AddShader(const std::string& fragmentFile)
+{
+	ShaderPipeline::sptr pipeline = AssetRegistry::GetPipeline("shaders/passthrough_vert.glsl", fragmentFile);
+	if (pipeline == nullptr)
+	{
+		LOG_ERROR("Could not load \"{}\", the effect using it is disabled", fragmentFile);
+		_loaded = false;
+		_pipelines.push_back(nullptr);
+		_shaders.push_back(nullptr);
+		return;
+	}
+
+	_pipelines.push_back(pipeline);
+	_shaders.push_back(pipeline->GetFragmentStage());
+}
+
+RenderTargetDesc PostEffect::GetTargetDesc(std::vector<GLenum> colorFormats) const
+{
+	RenderTargetDesc desc;
+	desc._width = _width;
+	desc._height = _height;
+	desc._colorFormats = colorFormats;
+	return desc;
+}
+
+void PostEffect::SetFusedSource(const std::string& fileName)
+{
+	std::ifstream stream(fileName);
+	if (!stream)
+	{
+		LOG_WARN("Could not read fused snippet \"{}\", the effect won't be fused", fileName);
+		_fusedSource.clear();
+		return;
+	}
+
+	std::stringstream contents;
+	contents << stream.rdbuf();
+	_fusedSource = contents.str();
 }
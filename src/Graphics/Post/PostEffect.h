@@ -1,34 +1,52 @@
 #pragma once
 
-#include "Graphics/Framebuffer.h"
+#include "Graphics/FrameGraph.h"
 #include "Shader.h"
+#include "Graphics/ShaderPipeline.h"
 
+//A fullscreen effect that runs as passes in the frame graph
+//*Effects don't own any targets, they declare transient ones on the graph each frame,
+// so only the effects that are actually in use take up memory
 class PostEffect
 {
 public:
 	//Initialize this effects (will be overriden in each derived class)
+	//*Loads the shaders and remembers the size the effect's targets should be
 	virtual void Init(unsigned width, unsigned height);
 
-	//Applies the effect
-	virtual void ApplyEffect(PostEffect* previousBuffer);
-	virtual void DrawToScreen();
+	//Adds the effect's passes to the graph, reading from input
+	//*Returns the target the result ends up in
+	virtual FrameGraphResource AddPasses(FrameGraph& graph, FrameGraphResource input);
+	//Adds a pass that draws a target to the screen with the passthrough shader
+	void AddDrawToScreen(FrameGraph& graph, FrameGraphResource input);
 
 	//Reshapes the buffer
 	virtual void Reshape(unsigned width, unsigned height);
 
-	//Clears the buffers
-	void Clear();
+	//Returns false if one of the effect's shaders didn't compile, chains skip effects that aren't loaded
+	bool IsLoaded() const;
 
-	//Unloads all the buffers
-	void Unload();
+	//Fusing, point-wise effects can be merged with their neighbours into one generated pass (see PostChain)
+	//*Fusable effects have a GLSL snippet defining vec4 $Apply(vec4 source, vec2 uv), with every
+	// global name starting with $ so the chain can give each effect its own prefix
+	virtual bool IsFusable() const;
+	const std::string& GetFusedSource() const;
+	//Returns true if the fused part has to read a real target as its input, so it has to start a fused pass
+	virtual bool NeedsTargetInput() const;
+	//Number of texture slots the fused part binds, after the chain's input
+	virtual int GetFusedTextureCount() const;
+	//Adds any passes the fused part depends on, input is the fused pass' input
+	//*Returns the targets the fused pass has to read, these get handed back to BindFused
+	virtual std::vector<FrameGraphResource> AddFusedInputs(FrameGraph& graph, FrameGraphResource input);
+	//Sets the effect's uniforms on the fused shader (names start with prefix) and binds its textures from firstSlot
+	virtual void BindFused(const FrameGraph& frame, const Shader::sptr& shader, const std::string& prefix, int firstSlot,
+		const std::vector<FrameGraphResource>& inputs);
+	virtual void UnbindFused(int firstSlot);
 
-	//Binds buffers
-	void BindBuffer(int index);
-	void UnbindBuffer();
+	//Unloads all the shaders
+	void Unload();
 
 	//Bind textures
-	void BindColorAsTexture(int index, int colorBuffer, int textureSlot);
-	void BindDepthAsTexture(int index, int textureSlot);
 	void UnbindTexture(int textureSlot);
 
 	//Bind shaders
@@ -36,9 +54,26 @@ public:
 	void UnbindShader();
 
 protected:
-	//Holds all our buffers for the effects
-	std::vector<Framebuffer*> _buffers;
+	//Adds a fullscreen pass, sharing the passthrough vertex stage with every other pass
+	void AddShader(const std::string& fragmentFile);
+	//Describes a screen sized target with these colour formats (RGBA8 if none are given)
+	RenderTargetDesc GetTargetDesc(std::vector<GLenum> colorFormats = { GL_RGBA8 }) const;
+	//Loads the GLSL snippet used when the effect is fused, effects without one are never fused
+	void SetFusedSource(const std::string& fileName);
+
+	//Size of the screen, the effect's targets are made this size
+	unsigned _width = 0;
+	unsigned _height = 0;
 
 	//Holds all our shaders for the effects
+	//*These are the fragment stages of the pipelines, set uniforms on them
 	std::vector<Shader::sptr> _shaders;
-};
\ No newline at end of file
+	std::vector<ShaderPipeline::sptr> _pipelines;
+	//Index of the passthrough shader (-1 if the effect doesn't have one)
+	int _passThrough = -1;
+	//Cleared when a shader fails to compile, its slot is left null so the indices still line up
+	bool _loaded = true;
+
+	//Snippet for the fused version of the effect (empty if it can't be fused)
+	std::string _fusedSource;
+};
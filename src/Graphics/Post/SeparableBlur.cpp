@@ -0,0 +1,236 @@
+#include "SeparableBlur.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#include <Logging.h>
+
+#include "Utilities/AssetRegistry.h"
+#include "Utilities/ShaderCache.h"
+
+namespace
+{
+	const char* COMPUTE_SHADER_FILE = "shaders/Post/separable_blur_comp.glsl";
+	//Matches TILE in the compute shader
+	const int COMPUTE_TILE = 16;
+
+	//Sets a float array uniform, Shader only knows how to set single values
+	void SetUniformArray(const Shader::sptr& shader, const char* name, const std::vector<float>& values)
+	{
+		GLuint handle = shader->GetHandle();
+		glProgramUniform1fv(handle, glGetUniformLocation(handle, name), GLsizei(values.size()), values.data());
+	}
+}
+
+void SeparableBlur::Init()
+{
+	_fragmentPipeline = AssetRegistry::GetPipeline("shaders/passthrough_vert.glsl", "shaders/Post/separable_blur_frag.glsl");
+	_timer = std::make_unique<GpuTimer>();
+	SetRadius(_radius);
+
+	if (_path == BlurPath::Compute && !IsComputeSupported())
+	{
+		LOG_INFO("Compute shaders aren't supported, blurring with fragment passes");
+		_path = BlurPath::Fragment;
+	}
+}
+
+FrameGraphResource SeparableBlur::AddPasses(FrameGraph& graph, FrameGraphResource input, const RenderTargetDesc& desc)
+{
+	//The fragment path's folded taps need linear filtering, and whoever samples the result probably does too
+	RenderTargetDesc linear = desc;
+	linear._filter = GL_LINEAR;
+
+	if (_path == BlurPath::Compute)
+	{
+		FrameGraphResource result = AddComputePasses(graph, input, linear);
+		if (result != INVALID_RESOURCE)
+			return result;
+	}
+	return AddFragmentPasses(graph, input, linear);
+}
+
+void SeparableBlur::SetRadius(int radius)
+{
+	_radius = std::clamp(radius, 1, MAX_RADIUS);
+
+	//Fold taps 2i - 1 and 2i into one fetch between them, weighted so bilinear filtering gives the same sum
+	std::vector<float> weights = GetWeights(_radius);
+	_linearOffsets = { 0.0f };
+	_linearWeights = { weights[0] };
+	for (int i = 1; i <= _radius; i += 2)
+	{
+		float first = weights[i];
+		float second = i + 1 <= _radius ? weights[i + 1] : 0.0f;
+		float weight = first + second;
+		_linearOffsets.push_back((float(i) * first + float(i + 1) * second) / weight);
+		_linearWeights.push_back(weight);
+	}
+}
+
+int SeparableBlur::GetRadius() const
+{
+	return _radius;
+}
+
+void SeparableBlur::SetPath(BlurPath path)
+{
+	_path = path == BlurPath::Compute && !IsComputeSupported() ? BlurPath::Fragment : path;
+}
+
+BlurPath SeparableBlur::GetPath() const
+{
+	return _path;
+}
+
+float SeparableBlur::GetGpuMilliseconds() const
+{
+	return _timer != nullptr ? _timer->GetMilliseconds() : 0.0f;
+}
+
+bool SeparableBlur::IsComputeSupported()
+{
+	//The context can't change while we're running, so only ask once
+	static int supported = -1;
+	if (supported < 0)
+	{
+		GLint major = 0;
+		GLint minor = 0;
+		glGetIntegerv(GL_MAJOR_VERSION, &major);
+		glGetIntegerv(GL_MINOR_VERSION, &minor);
+		supported = major > 4 || (major == 4 && minor >= 3) ? 1 : 0;
+	}
+	return supported == 1;
+}
+
+std::vector<float> SeparableBlur::GetWeights(int radius)
+{
+	//Three sigma covers everything but the last 0.3% of the curve
+	float sigma = std::max(float(radius) / 3.0f, 0.5f);
+	std::vector<float> weights(size_t(radius) + 1);
+	float total = 0.0f;
+	for (int i = 0; i <= radius; i++)
+	{
+		weights[i] = std::exp(-float(i * i) / (2.0f * sigma * sigma));
+		total += i == 0 ? weights[i] : weights[i] * 2.0f;
+	}
+
+	for (float& weight : weights)
+	{
+		weight /= total;
+	}
+	return weights;
+}
+
+Shader::sptr SeparableBlur::GetComputeShader(int radius)
+{
+	auto it = _computeShaders.find(radius);
+	if (it != _computeShaders.end())
+		return it->second;
+
+	//The radius sizes the shared memory, so it's baked in with a define after the #version line
+	Shader::sptr shader;
+	std::ifstream stream(COMPUTE_SHADER_FILE);
+	if (stream)
+	{
+		std::stringstream contents;
+		contents << stream.rdbuf();
+		std::string source = ShaderCache::InsertDefines(contents.str(), "#define RADIUS " + std::to_string(radius) + "\n");
+
+		shader = ShaderCache::LoadSeparableSource({ COMPUTE_SHADER_FILE, GL_COMPUTE_SHADER }, source);
+	}
+	else
+	{
+		LOG_WARN("Could not read \"{}\"", COMPUTE_SHADER_FILE);
+	}
+
+	//Remember failures too, so they aren't retried every frame
+	_computeShaders[radius] = shader;
+	return shader;
+}
+
+FrameGraphResource SeparableBlur::AddFragmentPasses(FrameGraph& graph, FrameGraphResource input, const RenderTargetDesc& desc)
+{
+	FrameGraphResource horizontal = graph.CreateTarget("Blur Horizontal", desc);
+	FrameGraphResource output = graph.CreateTarget("Blur", desc);
+
+	//Each direction is the same pass with a different direction
+	auto addPass = [this, &graph](const char* name, FrameGraphResource source, FrameGraphResource target, glm::vec2 direction, bool first) {
+		graph.AddPass(name, [this, source, target, direction, first](const FrameGraph& frame) {
+			if (first)
+				_timer->Begin();
+
+			const Shader::sptr& shader = _fragmentPipeline->GetFragmentStage();
+			_fragmentPipeline->Bind();
+			shader->SetUniform("u_Direction", direction);
+			shader->SetUniform("u_TapCount", int(_linearWeights.size()));
+			SetUniformArray(shader, "u_Offsets", _linearOffsets);
+			SetUniformArray(shader, "u_Weights", _linearWeights);
+
+			frame.GetTarget(source)->BindColorAsTexture(0, 0);
+			frame.GetTarget(target)->RenderToFSQ();
+			frame.GetTarget(source)->UnbindTexture(0);
+			ShaderPipeline::UnBind();
+
+			if (!first)
+				_timer->End();
+		}).Read(source).Write(target);
+	};
+	addPass("Blur Horizontal", input, horizontal, glm::vec2(1.0f, 0.0f), true);
+	addPass("Blur Vertical", horizontal, output, glm::vec2(0.0f, 1.0f), false);
+
+	return output;
+}
+
+FrameGraphResource SeparableBlur::AddComputePasses(FrameGraph& graph, FrameGraphResource input, const RenderTargetDesc& desc)
+{
+	//Split big radii into a few gaussians that fit in shared memory, k blurs of sigma s make one of sigma s * sqrt(k)
+	float ratio = float(_radius) / float(MAX_COMPUTE_RADIUS);
+	int steps = std::max(int(std::ceil(ratio * ratio)), 1);
+	int stepRadius = std::min(int(std::ceil(float(_radius) / std::sqrt(float(steps)))), MAX_COMPUTE_RADIUS);
+
+	Shader::sptr shader = GetComputeShader(stepRadius);
+	if (shader == nullptr)
+		return INVALID_RESOURCE;
+	std::vector<float> weights = GetWeights(stepRadius);
+
+	//Ping pong through a second target if it takes more than one step, ending up in the output
+	FrameGraphResource output = graph.CreateTarget("Blur", desc);
+	FrameGraphResource temp = steps > 1 ? graph.CreateTarget("Blur Temp", desc) : INVALID_RESOURCE;
+
+	FrameGraphPass& pass = graph.AddPass("Compute Blur", [this, shader, weights, steps, input, output, temp](const FrameGraph& frame) {
+		_timer->Begin();
+
+		shader->Bind();
+		SetUniformArray(shader, "u_Weights", weights);
+
+		FrameGraphResource source = input;
+		for (int i = 0; i < steps; i++)
+		{
+			//Whatever is left to do decides where this step goes, so the last one always writes the output
+			FrameGraphResource target = (steps - 1 - i) % 2 == 0 ? output : temp;
+			Framebuffer* targetBuffer = frame.GetTarget(target);
+
+			frame.GetTarget(source)->BindColorAsTexture(0, 0);
+			targetBuffer->BindColorAsImage(0, 0, GL_WRITE_ONLY);
+			glDispatchCompute((targetBuffer->_width + COMPUTE_TILE - 1) / COMPUTE_TILE, (targetBuffer->_height + COMPUTE_TILE - 1) / COMPUTE_TILE, 1);
+			//The next step (or pass) samples what we just wrote
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+			source = target;
+		}
+
+		glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+		frame.GetTarget(input)->UnbindTexture(0);
+		shader->UnBind();
+
+		_timer->End();
+	});
+	pass.Read(input).Write(output);
+	if (temp != INVALID_RESOURCE)
+		pass.Write(temp);
+
+	return output;
+}
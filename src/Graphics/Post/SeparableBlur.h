@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+#include "Graphics/FrameGraph.h"
+#include "Graphics/GpuTimer.h"
+#include "Graphics/ShaderPipeline.h"
+
+//Which path a SeparableBlur runs on
+enum class BlurPath
+{
+	//Two fullscreen passes, one per direction
+	Fragment,
+	//One dispatch that does both directions out of shared memory
+	Compute
+};
+
+//Gaussian blur of any radius, for bloom and anything else that needs one
+//*Weights are generated on the CPU from the radius (sigma is a third of it)
+//*The fragment path folds each pair of taps into one linearly filtered fetch, so it's about radius / 2 + 1
+// fetches a pixel each direction, the input has to be linearly filtered for that to work
+//*The compute path loads a tile and its apron into shared memory once and does both directions from there,
+// so the input is read once and the output written once, it needs GL 4.3 (llvmpipe has it)
+//*Compute shaders are built per radius, radii past MAX_COMPUTE_RADIUS are split into several smaller
+// gaussians run back to back (gaussians add up in sigma squared)
+class SeparableBlur
+{
+public:
+	static const int MAX_RADIUS = 64;
+	static const int MAX_COMPUTE_RADIUS = 16;
+
+	//Loads the fragment path, compute shaders are built when a radius is first used
+	void Init();
+
+	//Adds the blur to the graph, the result is a new target made from desc (linearly filtered)
+	FrameGraphResource AddPasses(FrameGraph& graph, FrameGraphResource input, const RenderTargetDesc& desc);
+
+	void SetRadius(int radius);
+	int GetRadius() const;
+	//Falls back to the fragment path if compute isn't supported
+	void SetPath(BlurPath path);
+	BlurPath GetPath() const;
+
+	//How long the blur took on the GPU last time it finished, in milliseconds
+	float GetGpuMilliseconds() const;
+
+	//Returns true if the context can run compute shaders
+	static bool IsComputeSupported();
+
+private:
+	//Normalised gaussian weights for offsets 0 to radius
+	static std::vector<float> GetWeights(int radius);
+	//Gets the compute shader for a radius, building it the first time (nullptr if it didn't compile)
+	Shader::sptr GetComputeShader(int radius);
+
+	FrameGraphResource AddFragmentPasses(FrameGraph& graph, FrameGraphResource input, const RenderTargetDesc& desc);
+	FrameGraphResource AddComputePasses(FrameGraph& graph, FrameGraphResource input, const RenderTargetDesc& desc);
+
+	int _radius = 16;
+	BlurPath _path = BlurPath::Compute;
+
+	//Folded taps for the fragment path, tap 0 is the centre
+	std::vector<float> _linearOffsets;
+	std::vector<float> _linearWeights;
+
+	ShaderPipeline::sptr _fragmentPipeline;
+	std::unordered_map<int, Shader::sptr> _computeShaders;
+
+	//Held by pointer so effects holding a blur can still be moved around by the registry
+	std::unique_ptr<GpuTimer> _timer;
+};
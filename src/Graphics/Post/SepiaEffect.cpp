@@ -2,32 +2,37 @@
 
 void SepiaEffect::Init(unsigned width, unsigned height)
 {
-    int index = int(_buffers.size());
-    _buffers.push_back(new Framebuffer());
-    _buffers[index]->AddColorTarget(GL_RGBA8);
-    _buffers[index]->AddDepthTarget();
-    _buffers[index]->Init(width, height);
-
     //Set up shaders
-    index = int(_shaders.size());
-    _shaders.push_back(Shader::Create());
-    _shaders[index]->LoadShaderPartFromFile("shaders/passthrough_vert.glsl", GL_VERTEX_SHADER);
-    _shaders[index]->LoadShaderPartFromFile("shaders/Post/sepia_frag.glsl", GL_FRAGMENT_SHADER);
-    _shaders[index]->Link();
+    AddShader("shaders/Post/sepia_frag.glsl");
+    SetFusedSource("shaders/Post/Fused/sepia.glsl");
+
+    PostEffect::Init(width, height);
 }
 
-void SepiaEffect::ApplyEffect(PostEffect* buffer)
+FrameGraphResource SepiaEffect::AddPasses(FrameGraph& graph, FrameGraphResource input)
 {
-    BindShader(0);
-    _shaders[0]->SetUniform("u_Intensity", _intensity);
+    FrameGraphResource output = graph.CreateTarget("Sepia", GetTargetDesc());
+
+    graph.AddPass("Sepia", [this, input, output](const FrameGraph& frame) {
+        BindShader(0);
+        _shaders[0]->SetUniform("u_Intensity", _intensity);
+
+        frame.GetTarget(input)->BindColorAsTexture(0, 0);
 
-    buffer->BindColorAsTexture(0, 0, 0);
+        frame.GetTarget(output)->RenderToFSQ();
 
-    _buffers[0]->RenderToFSQ();
+        UnbindTexture(0);
 
-    buffer->UnbindTexture(0);
+        UnbindShader();
+    }).Read(input).Write(output);
 
-    UnbindShader();
+    return output;
+}
+
+void SepiaEffect::BindFused(const FrameGraph& frame, const Shader::sptr& shader, const std::string& prefix, int firstSlot,
+    const std::vector<FrameGraphResource>& inputs)
+{
+    shader->SetUniform(prefix + "Intensity", _intensity);
 }
 
 float SepiaEffect::GetIntensity() const
@@ -8,8 +8,11 @@ public:
 	//Initializes framebuffer
 	void Init(unsigned width, unsigned height) override;
 
-	//Applies effect to this buffer
-	void ApplyEffect(PostEffect* buffer) override;
+	//Adds the effect's passes to the graph, reading from input
+	FrameGraphResource AddPasses(FrameGraph& graph, FrameGraphResource input) override;
+	//Sets the intensity on the fused shader
+	void BindFused(const FrameGraph& frame, const Shader::sptr& shader, const std::string& prefix, int firstSlot,
+		const std::vector<FrameGraphResource>& inputs) override;
 
 	//Getters
 	float GetIntensity() const;
@@ -0,0 +1,444 @@
+#include "SceneBVH.h"
+
+#include <algorithm>
+
+#include <RendererComponent.h>
+
+#include "Graphics/LODComponent.h"
+
+#if (defined(_M_X64) || defined(__SSE2__)) && !defined(BVH_NO_SIMD)
+#define BVH_SSE 1
+#include <emmintrin.h>
+#else
+#define BVH_SSE 0
+#endif
+
+namespace
+{
+	enum class Containment
+	{
+		Outside,
+		Intersecting,
+		Inside
+	};
+
+	float SurfaceArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		glm::vec3 size = boundsMax - boundsMin;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	//The frustum laid out for testing, planes 6 and 7 are padding that everything is inside
+	struct FrustumSoA
+	{
+		alignas(16) float _x[8];
+		alignas(16) float _y[8];
+		alignas(16) float _z[8];
+		alignas(16) float _w[8];
+
+		explicit FrustumSoA(const Frustum& frustum)
+		{
+			for (int i = 0; i < 8; i++)
+			{
+				glm::vec4 plane = i < 6 ? frustum._planes[i] : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+				_x[i] = plane.x;
+				_y[i] = plane.y;
+				_z[i] = plane.z;
+				_w[i] = plane.w;
+			}
+		}
+
+		Containment Test(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const
+		{
+			glm::vec3 centre = (boundsMin + boundsMax) * 0.5f;
+			glm::vec3 extents = (boundsMax - boundsMin) * 0.5f;
+
+#if BVH_SSE
+			__m128 cx = _mm_set1_ps(centre.x);
+			__m128 cy = _mm_set1_ps(centre.y);
+			__m128 cz = _mm_set1_ps(centre.z);
+			__m128 ex = _mm_set1_ps(extents.x);
+			__m128 ey = _mm_set1_ps(extents.y);
+			__m128 ez = _mm_set1_ps(extents.z);
+			__m128 zero = _mm_setzero_ps();
+			//Clearing the sign bit is abs
+			__m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+			int outside = 0;
+			int intersecting = 0;
+			for (int i = 0; i < 8; i += 4)
+			{
+				__m128 nx = _mm_load_ps(_x + i);
+				__m128 ny = _mm_load_ps(_y + i);
+				__m128 nz = _mm_load_ps(_z + i);
+				//Distance from the centre to each plane, and how far the box reaches towards it
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)), _mm_add_ps(_mm_mul_ps(nz, cz), _mm_load_ps(_w + i)));
+				__m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_and_ps(nx, absMask), ex), _mm_mul_ps(_mm_and_ps(ny, absMask), ey)),
+					_mm_mul_ps(_mm_and_ps(nz, absMask), ez));
+				outside |= _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(distance, reach), zero));
+				intersecting |= _mm_movemask_ps(_mm_cmplt_ps(_mm_sub_ps(distance, reach), zero));
+			}
+#else
+			bool outside = false;
+			bool intersecting = false;
+			for (int i = 0; i < 6; i++)
+			{
+				float distance = _x[i] * centre.x + _y[i] * centre.y + _z[i] * centre.z + _w[i];
+				float reach = std::abs(_x[i]) * extents.x + std::abs(_y[i]) * extents.y + std::abs(_z[i]) * extents.z;
+				outside |= distance + reach < 0.0f;
+				intersecting |= distance - reach < 0.0f;
+			}
+#endif
+			if (outside)
+				return Containment::Outside;
+			return intersecting ? Containment::Intersecting : Containment::Inside;
+		}
+	};
+}
+
+Frustum Frustum::FromMatrix(const glm::mat4& viewProjection)
+{
+	//Gribb and Hartmann, each plane is the last row plus or minus one of the others
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+	{
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+
+	Frustum frustum;
+	for (int i = 0; i < 3; i++)
+	{
+		frustum._planes[i * 2] = rows[3] + rows[i];
+		frustum._planes[i * 2 + 1] = rows[3] - rows[i];
+	}
+	for (glm::vec4& plane : frustum._planes)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+	return frustum;
+}
+
+void SceneBVH::Update(entt::registry& registry)
+{
+	_updateCount++;
+	_reinserts = 0;
+	_unbounded.clear();
+
+	registry.view<RendererComponent, Transform>().each([&](entt::entity entity, RendererComponent& renderer, Transform& transform) {
+		const LODComponent* lod = registry.try_get<LODComponent>(entity);
+		//Chains that haven't finished loading have no bounds yet either
+		if (lod == nullptr || lod->GetChain() == nullptr || lod->GetChain()->_radius <= 0.0f)
+		{
+			_unbounded.push_back(entity);
+			return;
+		}
+
+		//World space box around the chain's bounding sphere
+		const glm::mat4& world = transform.WorldTransform();
+		float scale = std::max(glm::length(glm::vec3(world[0])), std::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+		glm::vec3 centre = glm::vec3(world * glm::vec4(lod->GetChain()->_centre, 1.0f));
+		glm::vec3 radius = glm::vec3(lod->GetChain()->_radius * scale);
+		glm::vec3 boundsMin = centre - radius;
+		glm::vec3 boundsMax = centre + radius;
+
+		LeafRecord& record = _leaves[entity];
+		record._seen = _updateCount;
+		if (record._node >= 0)
+		{
+			const SceneBVHNode& leaf = _nodes[record._node];
+			//Still inside its fattened box, nothing to do
+			if (glm::all(glm::greaterThanEqual(boundsMin, leaf._min)) && glm::all(glm::lessThanEqual(boundsMax, leaf._max)))
+				return;
+
+			RemoveLeaf(record._node);
+			_reinserts++;
+		}
+		else
+		{
+			record._node = AllocateNode();
+			_nodes[record._node]._entity = entity;
+		}
+
+		glm::vec3 margin = radius * 0.1f + 0.1f;
+		_nodes[record._node]._min = boundsMin - margin;
+		_nodes[record._node]._max = boundsMax + margin;
+		InsertLeaf(record._node);
+	});
+
+	//Anything that wasn't seen was removed (or lost its renderer)
+	for (auto it = _leaves.begin(); it != _leaves.end();)
+	{
+		if (it->second._seen != _updateCount)
+		{
+			RemoveLeaf(it->second._node);
+			FreeNode(it->second._node);
+			it = _leaves.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void SceneBVH::Cull(const glm::mat4& viewProjection, std::vector<entt::entity>& visible)
+{
+	visible.assign(_unbounded.begin(), _unbounded.end());
+	_stats = SceneBVHStats();
+	if (_root < 0)
+	{
+		_stats._visible = visible.size();
+		return;
+	}
+
+	//Nodes under one that's fully inside are pushed flipped (~index), they're in without being tested
+	FrustumSoA frustum(Frustum::FromMatrix(viewProjection));
+	_stack.clear();
+	_stack.push_back(_root);
+	while (!_stack.empty())
+	{
+		int entry = _stack.back();
+		_stack.pop_back();
+		bool inside = entry < 0;
+		const SceneBVHNode& node = _nodes[inside ? ~entry : entry];
+
+		if (!inside)
+		{
+			_stats._nodesTested++;
+			Containment containment = frustum.Test(node._min, node._max);
+			if (containment == Containment::Outside)
+				continue;
+			inside = containment == Containment::Inside;
+		}
+
+		if (node.IsLeaf())
+		{
+			visible.push_back(node._entity);
+		}
+		else
+		{
+			_stack.push_back(inside ? ~node._left : node._left);
+			_stack.push_back(inside ? ~node._right : node._right);
+		}
+	}
+	_stats._visible = visible.size();
+}
+
+bool SceneBVH::GetBounds(entt::entity entity, glm::vec3& boundsMin, glm::vec3& boundsMax) const
+{
+	auto it = _leaves.find(entity);
+	if (it == _leaves.end())
+		return false;
+
+	boundsMin = _nodes[it->second._node]._min;
+	boundsMax = _nodes[it->second._node]._max;
+	return true;
+}
+
+size_t SceneBVH::GetLeafCount() const
+{
+	return _leaves.size();
+}
+
+size_t SceneBVH::GetNodeCount() const
+{
+	return _nodes.size() - _freeNodes.size();
+}
+
+int SceneBVH::GetHeight() const
+{
+	return _root >= 0 ? _nodes[_root]._height : 0;
+}
+
+size_t SceneBVH::GetReinsertCount() const
+{
+	return _reinserts;
+}
+
+const SceneBVHStats& SceneBVH::GetStats() const
+{
+	return _stats;
+}
+
+int SceneBVH::AllocateNode()
+{
+	if (!_freeNodes.empty())
+	{
+		int node = _freeNodes.back();
+		_freeNodes.pop_back();
+		_nodes[node] = SceneBVHNode();
+		return node;
+	}
+	_nodes.emplace_back();
+	return int(_nodes.size() - 1);
+}
+
+void SceneBVH::FreeNode(int node)
+{
+	_freeNodes.push_back(node);
+}
+
+void SceneBVH::InsertLeaf(int leaf)
+{
+	if (_root < 0)
+	{
+		_root = leaf;
+		_nodes[leaf]._parent = -1;
+		return;
+	}
+
+	//Walk down to the sibling that grows the tree's surface area least
+	glm::vec3 leafMin = _nodes[leaf]._min;
+	glm::vec3 leafMax = _nodes[leaf]._max;
+	int sibling = _root;
+	while (!_nodes[sibling].IsLeaf())
+	{
+		const SceneBVHNode& node = _nodes[sibling];
+		float area = SurfaceArea(node._min, node._max);
+		float combinedArea = SurfaceArea(glm::min(node._min, leafMin), glm::max(node._max, leafMax));
+
+		//Pairing with this node makes a new parent, going lower grows this node anyway
+		float cost = 2.0f * combinedArea;
+		float inheritance = 2.0f * (combinedArea - area);
+
+		auto childCost = [&](int child) {
+			const SceneBVHNode& c = _nodes[child];
+			float grown = SurfaceArea(glm::min(c._min, leafMin), glm::max(c._max, leafMax));
+			return (c.IsLeaf() ? grown : grown - SurfaceArea(c._min, c._max)) + inheritance;
+		};
+		float leftCost = childCost(node._left);
+		float rightCost = childCost(node._right);
+
+		if (cost < leftCost && cost < rightCost)
+			break;
+		sibling = leftCost < rightCost ? node._left : node._right;
+	}
+
+	//New parent takes the sibling's place
+	int oldParent = _nodes[sibling]._parent;
+	int newParent = AllocateNode();
+	_nodes[newParent]._parent = oldParent;
+	_nodes[newParent]._left = sibling;
+	_nodes[newParent]._right = leaf;
+	_nodes[sibling]._parent = newParent;
+	_nodes[leaf]._parent = newParent;
+
+	if (oldParent < 0)
+	{
+		_root = newParent;
+	}
+	else if (_nodes[oldParent]._left == sibling)
+	{
+		_nodes[oldParent]._left = newParent;
+	}
+	else
+	{
+		_nodes[oldParent]._right = newParent;
+	}
+
+	Refit(newParent);
+}
+
+void SceneBVH::RemoveLeaf(int leaf)
+{
+	if (leaf == _root)
+	{
+		_root = -1;
+		return;
+	}
+
+	//The sibling takes the parent's place
+	int parent = _nodes[leaf]._parent;
+	int grandParent = _nodes[parent]._parent;
+	int sibling = _nodes[parent]._left == leaf ? _nodes[parent]._right : _nodes[parent]._left;
+
+	if (grandParent < 0)
+	{
+		_root = sibling;
+		_nodes[sibling]._parent = -1;
+	}
+	else
+	{
+		if (_nodes[grandParent]._left == parent)
+		{
+			_nodes[grandParent]._left = sibling;
+		}
+		else
+		{
+			_nodes[grandParent]._right = sibling;
+		}
+		_nodes[sibling]._parent = grandParent;
+		Refit(grandParent);
+	}
+	FreeNode(parent);
+	_nodes[leaf]._parent = -1;
+}
+
+void SceneBVH::Refit(int node)
+{
+	while (node >= 0)
+	{
+		node = Balance(node);
+		FitToChildren(node);
+		node = _nodes[node]._parent;
+	}
+}
+
+int SceneBVH::Balance(int node)
+{
+	SceneBVHNode& a = _nodes[node];
+	if (a.IsLeaf() || a._height < 2)
+		return node;
+
+	int left = a._left;
+	int right = a._right;
+	int difference = _nodes[right]._height - _nodes[left]._height;
+	if (difference >= -1 && difference <= 1)
+		return node;
+
+	//The taller child takes node's place, node takes its shorter grandchild
+	//*Same rotation either way round, just mirrored, so it's written once for whichever side is up
+	int up = difference > 1 ? right : left;
+	int stays = difference > 1 ? left : right;
+	int upLeft = _nodes[up]._left;
+	int upRight = _nodes[up]._right;
+	int taller = _nodes[upLeft]._height > _nodes[upRight]._height ? upLeft : upRight;
+	int shorter = taller == upLeft ? upRight : upLeft;
+
+	int parent = a._parent;
+	_nodes[up]._parent = parent;
+	if (parent < 0)
+	{
+		_root = up;
+	}
+	else if (_nodes[parent]._left == node)
+	{
+		_nodes[parent]._left = up;
+	}
+	else
+	{
+		_nodes[parent]._right = up;
+	}
+
+	//Node keeps its other child and adopts the shorter grandchild, the one going up keeps the taller one
+	a._parent = up;
+	a._left = difference > 1 ? stays : shorter;
+	a._right = difference > 1 ? shorter : stays;
+	_nodes[shorter]._parent = node;
+	_nodes[up]._left = difference > 1 ? node : taller;
+	_nodes[up]._right = difference > 1 ? taller : node;
+
+	FitToChildren(node);
+	FitToChildren(up);
+	return up;
+}
+
+void SceneBVH::FitToChildren(int node)
+{
+	SceneBVHNode& current = _nodes[node];
+	const SceneBVHNode& left = _nodes[current._left];
+	const SceneBVHNode& right = _nodes[current._right];
+	current._min = glm::min(left._min, right._min);
+	current._max = glm::max(left._max, right._max);
+	current._height = 1 + std::max(left._height, right._height);
+}
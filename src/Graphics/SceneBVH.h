@@ -0,0 +1,98 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include <GLM/glm.hpp>
+#include <Scene.h>
+
+//Six planes pulled out of a view projection (perspective or ortho), normals point inwards
+struct Frustum
+{
+	glm::vec4 _planes[6];
+
+	static Frustum FromMatrix(const glm::mat4& viewProjection);
+};
+
+//One node of a SceneBVH, leaves have no children and hold an entity
+struct SceneBVHNode
+{
+	//Leaves are fattened a little so small movements don't need the tree touched
+	glm::vec3 _min = glm::vec3(0.0f);
+	glm::vec3 _max = glm::vec3(0.0f);
+	int _parent = -1;
+	int _left = -1;
+	int _right = -1;
+	//Leaves are 0, for keeping the tree balanced
+	int _height = 0;
+	entt::entity _entity = entt::null;
+
+	bool IsLeaf() const { return _left < 0; }
+};
+
+//What the last Cull did
+struct SceneBVHStats
+{
+	size_t _nodesTested = 0;
+	size_t _visible = 0;
+};
+
+//Dynamic bounding volume hierarchy over every renderable entity, for frustum culling each pass
+//*Leaves are inserted where they grow the tree's surface area least (like Box2D's dynamic tree), and nodes on
+// the way back up are rotated when one side gets more than a level taller, so the tree stays balanced
+//*Update refits from each entity's transform, leaves only move in the tree once they leave their fattened box
+//*Bounds come from the LOD chain's bounding sphere, renderers without one are never culled
+//*Culling tests a box against all six planes at once with SSE (define BVH_NO_SIMD to force the scalar test),
+// and subtrees fully inside skip their tests
+class SceneBVH
+{
+public:
+	//Adds new renderers, refits moved ones and drops removed ones
+	void Update(entt::registry& registry);
+
+	//Gets the renderers that might be inside the frustum, unordered
+	void Cull(const glm::mat4& viewProjection, std::vector<entt::entity>& visible);
+
+	//Gets an entity's (fattened) box, false if it isn't in the tree
+	bool GetBounds(entt::entity entity, glm::vec3& boundsMin, glm::vec3& boundsMax) const;
+
+	size_t GetLeafCount() const;
+	size_t GetNodeCount() const;
+	//Levels from the root to the deepest leaf, 0 for a single leaf or an empty tree
+	int GetHeight() const;
+	//Leaves that had to move in the tree last Update
+	size_t GetReinsertCount() const;
+	const SceneBVHStats& GetStats() const;
+
+private:
+	int AllocateNode();
+	void FreeNode(int node);
+	void InsertLeaf(int leaf);
+	void RemoveLeaf(int leaf);
+	//Recalculates the boxes and heights from node up to the root, balancing as it goes
+	void Refit(int node);
+	//Rotates the taller child of node up if it's more than a level taller, returns whatever is in node's place now
+	int Balance(int node);
+	//Sets a node's box and height from its children
+	void FitToChildren(int node);
+
+	std::vector<SceneBVHNode> _nodes;
+	std::vector<int> _freeNodes;
+	int _root = -1;
+	//Kept between Culls so traversal never allocates once it's big enough
+	std::vector<int> _stack;
+
+	//Leaf for each entity in the tree, and the last Update that saw it
+	struct LeafRecord
+	{
+		int _node = -1;
+		uint64_t _seen = 0;
+	};
+	std::unordered_map<entt::entity, LeafRecord> _leaves;
+	//Renderers without bounds, always visible
+	std::vector<entt::entity> _unbounded;
+
+	uint64_t _updateCount = 0;
+	size_t _reinserts = 0;
+	SceneBVHStats _stats;
+};
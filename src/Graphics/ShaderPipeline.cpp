@@ -0,0 +1,49 @@
+#include "ShaderPipeline.h"
+
+ShaderPipeline::ShaderPipeline(const Shader::sptr& vertexStage, const Shader::sptr& fragmentStage)
+	: _vertexStage(vertexStage), _fragmentStage(fragmentStage)
+{
+	glCreateProgramPipelines(1, &_handle);
+	glUseProgramStages(_handle, GL_VERTEX_SHADER_BIT, _vertexStage != nullptr ? _vertexStage->GetHandle() : GL_NONE);
+	glUseProgramStages(_handle, GL_FRAGMENT_SHADER_BIT, _fragmentStage != nullptr ? _fragmentStage->GetHandle() : GL_NONE);
+
+	//So glUniform calls made while it's bound land on the fragment stage, where all our uniforms are
+	if (_fragmentStage != nullptr)
+	{
+		glActiveShaderProgram(_handle, _fragmentStage->GetHandle());
+	}
+}
+
+ShaderPipeline::~ShaderPipeline()
+{
+	if (_handle != GL_NONE)
+	{
+		glDeleteProgramPipelines(1, &_handle);
+	}
+}
+
+void ShaderPipeline::Bind() const
+{
+	glUseProgram(GL_NONE);
+	glBindProgramPipeline(_handle);
+}
+
+void ShaderPipeline::UnBind()
+{
+	glBindProgramPipeline(GL_NONE);
+}
+
+const Shader::sptr& ShaderPipeline::GetVertexStage() const
+{
+	return _vertexStage;
+}
+
+const Shader::sptr& ShaderPipeline::GetFragmentStage() const
+{
+	return _fragmentStage;
+}
+
+GLuint ShaderPipeline::GetHandle() const
+{
+	return _handle;
+}
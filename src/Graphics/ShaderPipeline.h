@@ -0,0 +1,38 @@
+#pragma once
+#include <memory>
+
+#include <Shader.h>
+
+//Program pipeline made of separable stage programs
+//*Fullscreen passes all share the one passthrough vertex stage this way, so it's only compiled once
+// and switching between passes only swaps the fragment stage
+//*Uniforms are set on the stage programs (GetFragmentStage()->SetUniform(...))
+class ShaderPipeline
+{
+public:
+	typedef std::shared_ptr<ShaderPipeline> sptr;
+
+	static inline sptr Create(const Shader::sptr& vertexStage, const Shader::sptr& fragmentStage)
+	{
+		return std::make_shared<ShaderPipeline>(vertexStage, fragmentStage);
+	}
+
+	ShaderPipeline(const Shader::sptr& vertexStage, const Shader::sptr& fragmentStage);
+	~ShaderPipeline();
+
+	ShaderPipeline(const ShaderPipeline&) = delete;
+	ShaderPipeline& operator=(const ShaderPipeline&) = delete;
+
+	//Binds the pipeline (unbinding any program, since a bound program wins over a pipeline)
+	void Bind() const;
+	static void UnBind();
+
+	const Shader::sptr& GetVertexStage() const;
+	const Shader::sptr& GetFragmentStage() const;
+	GLuint GetHandle() const;
+
+private:
+	GLuint _handle = GL_NONE;
+	Shader::sptr _vertexStage;
+	Shader::sptr _fragmentStage;
+};
@@ -0,0 +1,154 @@
+#include "UniformRing.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <Logging.h>
+
+namespace
+{
+	//Plenty for a frame's camera and a few thousand draws, it grows if not
+	const size_t DEFAULT_FRAME_CAPACITY = 1024 * 1024;
+	const GLbitfield MAP_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+}
+
+GLuint UniformRing::_buffer = 0;
+uint8_t* UniformRing::_mapped = nullptr;
+GLsync UniformRing::_fences[FRAMES_IN_FLIGHT] = {};
+std::vector<GLuint> UniformRing::_retired;
+size_t UniformRing::_frameCapacity = 0;
+size_t UniformRing::_alignment = 256;
+int UniformRing::_frame = 0;
+size_t UniformRing::_head = 0;
+float UniformRing::_waitMilliseconds = 0.0f;
+
+void UniformRing::BeginFrame()
+{
+	if (_buffer == 0)
+		Create(DEFAULT_FRAME_CAPACITY);
+
+	//Nothing can name these any more, the driver frees them once the GPU's done
+	if (!_retired.empty())
+	{
+		glDeleteBuffers(GLsizei(_retired.size()), _retired.data());
+		_retired.clear();
+	}
+
+	_frame = (_frame + 1) % FRAMES_IN_FLIGHT;
+	_head = 0;
+	_waitMilliseconds = 0.0f;
+
+	GLsync fence = _fences[_frame];
+	if (fence == nullptr)
+		return;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	while (result == GL_TIMEOUT_EXPIRED)
+	{
+		result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+	}
+	if (result == GL_WAIT_FAILED)
+	{
+		LOG_WARN("Waiting on a uniform ring fence failed, the region may still be in use");
+	}
+	glDeleteSync(fence);
+	_fences[_frame] = nullptr;
+	_waitMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void UniformRing::EndFrame()
+{
+	if (_buffer == 0)
+		return;
+
+	if (_fences[_frame] != nullptr)
+		glDeleteSync(_fences[_frame]);
+	_fences[_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+UniformAllocation UniformRing::Allocate(size_t size)
+{
+	if (_buffer == 0)
+		Create(DEFAULT_FRAME_CAPACITY);
+
+	if (_head + size > _frameCapacity)
+	{
+		//Draws already recorded this frame still name the old buffer, so it lives until the next one
+		size_t capacity = std::max(_frameCapacity * 2, GetStride(_head + size));
+		LOG_WARN("Uniform ring ran out, growing to {} KB a frame", capacity / 1024);
+		_retired.push_back(_buffer);
+		for (GLsync& fence : _fences)
+		{
+			if (fence != nullptr)
+				glDeleteSync(fence);
+			fence = nullptr;
+		}
+		Create(capacity);
+		_head = 0;
+	}
+
+	UniformAllocation allocation;
+	allocation._buffer = _buffer;
+	allocation._offset = GLintptr(_frame * _frameCapacity + _head);
+	allocation._data = _mapped + allocation._offset;
+	allocation._size = size;
+	_head += GetStride(size);
+	return allocation;
+}
+
+size_t UniformRing::GetStride(size_t size)
+{
+	return (size + _alignment - 1) / _alignment * _alignment;
+}
+
+size_t UniformRing::GetUsedBytes()
+{
+	return _head;
+}
+
+size_t UniformRing::GetFrameCapacity()
+{
+	return _frameCapacity;
+}
+
+float UniformRing::GetWaitMilliseconds()
+{
+	return _waitMilliseconds;
+}
+
+void UniformRing::Clear()
+{
+	for (GLsync& fence : _fences)
+	{
+		if (fence != nullptr)
+			glDeleteSync(fence);
+		fence = nullptr;
+	}
+	if (_buffer != 0)
+	{
+		glUnmapNamedBuffer(_buffer);
+		_retired.push_back(_buffer);
+	}
+	if (!_retired.empty())
+		glDeleteBuffers(GLsizei(_retired.size()), _retired.data());
+	_retired.clear();
+
+	_buffer = 0;
+	_mapped = nullptr;
+	_frameCapacity = 0;
+	_head = 0;
+}
+
+void UniformRing::Create(size_t frameCapacity)
+{
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	//Never below 16, so SSE can store straight into the blocks
+	_alignment = std::max<size_t>(size_t(alignment), 16);
+	_frameCapacity = GetStride(frameCapacity);
+
+	glCreateBuffers(1, &_buffer);
+	glNamedBufferStorage(_buffer, GLsizeiptr(_frameCapacity * FRAMES_IN_FLIGHT), nullptr, MAP_FLAGS);
+	_mapped = static_cast<uint8_t*>(glMapNamedBufferRange(_buffer, 0, GLsizeiptr(_frameCapacity * FRAMES_IN_FLIGHT), MAP_FLAGS));
+}
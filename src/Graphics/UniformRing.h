@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+//A block of ring memory handed out for this frame
+struct UniformAllocation
+{
+	GLuint _buffer = 0;
+	//Where it starts in _buffer, aligned for glBindBufferRange
+	GLintptr _offset = 0;
+	//Where to write it, mapped for the whole frame
+	uint8_t* _data = nullptr;
+	size_t _size = 0;
+};
+
+//One persistently mapped uniform buffer split into a region per frame in flight
+//*Each frame allocates from its own region, a fence per region makes sure the GPU is done with it
+// before it's written again three frames later
+//*Allocations are aligned to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, so any of them can be bound by offset
+//*If a frame runs out the buffer doubles, the old one is kept until the next frame since draws may still name it
+class UniformRing abstract
+{
+public:
+	static const int FRAMES_IN_FLIGHT = 3;
+
+	//Moves on to the next region, waiting for the GPU if it's still reading it
+	static void BeginFrame();
+	//Fences off the region this frame wrote
+	static void EndFrame();
+
+	//Gets size bytes of this frame's region
+	static UniformAllocation Allocate(size_t size);
+	//size rounded up to the binding alignment, for arrays of blocks that are bound one at a time
+	static size_t GetStride(size_t size);
+
+	//Bytes used by this frame so far, and how big each frame's region is
+	static size_t GetUsedBytes();
+	static size_t GetFrameCapacity();
+	//Time BeginFrame spent waiting on the GPU last frame
+	static float GetWaitMilliseconds();
+
+	//Deletes the buffer, call while the context is still alive
+	static void Clear();
+
+private:
+	static void Create(size_t frameCapacity);
+
+	static GLuint _buffer;
+	static uint8_t* _mapped;
+	static GLsync _fences[FRAMES_IN_FLIGHT];
+	//Buffers that were outgrown this frame, deleted at the start of the next
+	static std::vector<GLuint> _retired;
+
+	static size_t _frameCapacity;
+	static size_t _alignment;
+	static int _frame;
+	static size_t _head;
+	static float _waitMilliseconds;
+};
@@ -0,0 +1,836 @@
+#include "AssetRegistry.h"
+
+#include <filesystem>
+
+#include <Logging.h>
+
+#include "Utilities/AsyncLoader.h"
+#include "Utilities/MappedFile.h"
+#include "Utilities/ShaderCache.h"
+#include "Utilities/SourceStamp.h"
+#include "Utilities/TextureLoader.h"
+#include "Utilities/Util.h"
+
+AssetTable<VertexArrayObject> AssetRegistry::_meshes;
+AssetTable<MeshLODChain> AssetRegistry::_meshLODs;
+AssetTable<Texture2D> AssetRegistry::_textures;
+AssetTable<TextureCubeMap> AssetRegistry::_cubeMaps;
+AssetTable<LUT3D> AssetRegistry::_luts;
+AssetTable<Shader> AssetRegistry::_shaders;
+AssetTable<Shader> AssetRegistry::_shaderStages;
+AssetTable<ShaderPipeline> AssetRegistry::_pipelines;
+
+std::unordered_map<const VertexArrayObject*, MeshInfo> AssetRegistry::_meshInfo;
+
+namespace
+{
+	//Suffixes TextureCubeMap::LoadFromImages adds to the file name for each face
+	const char* CUBE_FACE_SUFFIXES[6] = { "_pos_x", "_neg_x", "_pos_y", "_neg_y", "_pos_z", "_neg_z" };
+
+	//Bytes per texel for the uncompressed formats we use
+	size_t BytesPerTexel(GLint format)
+	{
+		switch (format)
+		{
+		case GL_R8: return 1;
+		case GL_RG8: case GL_R16F: case GL_DEPTH_COMPONENT16: return 2;
+		case GL_RGB8: case GL_RGBA8: case GL_SRGB8: case GL_SRGB8_ALPHA8: case GL_RG16: case GL_RG16F: case GL_R32F:
+		case GL_RGB10_A2: case GL_R11F_G11F_B10F: case GL_DEPTH_COMPONENT24: case GL_DEPTH_COMPONENT32F: return 4;
+		case GL_RGB16F: case GL_RGBA16F: case GL_RG32F: return 8;
+		case GL_RGB32F: case GL_RGBA32F: return 16;
+		default: return 4;
+		}
+	}
+
+	//Adds up the size of every level of the texture bound to target
+	size_t TextureLevelBytes(GLenum target, GLenum levelTarget)
+	{
+		size_t total = 0;
+		for (int level = 0; level < 16; level++)
+		{
+			GLint width = 0, height = 0, depth = 0, compressed = GL_FALSE, format = 0;
+			glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_WIDTH, &width);
+			if (width == 0)
+				break;
+			glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_HEIGHT, &height);
+			glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_DEPTH, &depth);
+			glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_COMPRESSED, &compressed);
+
+			if (compressed == GL_TRUE)
+			{
+				GLint imageSize = 0;
+				glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &imageSize);
+				total += size_t(imageSize);
+			}
+			else
+			{
+				glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_INTERNAL_FORMAT, &format);
+				total += size_t(width) * size_t(height) * size_t(depth > 0 ? depth : 1) * BytesPerTexel(format);
+			}
+		}
+
+		return total;
+	}
+
+	//Gets roughly how much memory a texture is using (every level, every face)
+	size_t TextureBytes(GLenum target, GLuint handle)
+	{
+		glBindTexture(target, handle);
+
+		size_t total = 0;
+		if (target == GL_TEXTURE_CUBE_MAP)
+		{
+			for (int face = 0; face < 6; face++)
+			{
+				total += TextureLevelBytes(target, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face);
+			}
+		}
+		else
+		{
+			total = TextureLevelBytes(target, target);
+		}
+
+		glBindTexture(target, GL_NONE);
+		return total;
+	}
+
+	//Hashers and sizers shared between the sync and async paths
+	bool HashSingleFile(const std::string& file, uint64_t& hash)
+	{
+		return AssetRegistry::HashFile(file, hash);
+	}
+
+	bool HashCubeMapFiles(const std::string& file, uint64_t& hash)
+	{
+		//The cube map is made of six files, so chain all their hashes together
+		std::filesystem::path path(file);
+		std::string stem = (path.parent_path() / path.stem()).string();
+		std::string extension = path.extension().string();
+
+		hash = 14695981039346656037ull;
+		for (int face = 0; face < 6; face++)
+		{
+			if (!AssetRegistry::HashFile(stem + CUBE_FACE_SUFFIXES[face] + extension, hash, hash))
+				return false;
+		}
+		return true;
+	}
+
+	//Cheap keys for the async loads, they only look at the file sizes and write times
+	bool StampFile(const std::string& file, uint64_t& key, uint64_t seed)
+	{
+		SourceStamp stamp;
+		if (!SourceStamp::Get(file, stamp, false))
+			return false;
+		key = Util::HashBytes(&stamp._time, sizeof(stamp._time), seed);
+		key = Util::HashBytes(&stamp._size, sizeof(stamp._size), key);
+		return true;
+	}
+
+	bool StampSingleFile(const std::string& file, uint64_t& key)
+	{
+		return StampFile(file, key, 14695981039346656037ull);
+	}
+
+	bool StampCubeMapFiles(const std::string& file, uint64_t& key)
+	{
+		std::filesystem::path path(file);
+		std::string stem = (path.parent_path() / path.stem()).string();
+		std::string extension = path.extension().string();
+
+		key = 14695981039346656037ull;
+		for (int face = 0; face < 6; face++)
+		{
+			if (!StampFile(stem + CUBE_FACE_SUFFIXES[face] + extension, key, key))
+				return false;
+		}
+		return true;
+	}
+
+	size_t TextureBytes2D(const Texture2D::sptr& texture)
+	{
+		return TextureBytes(GL_TEXTURE_2D, texture->GetHandle());
+	}
+
+	size_t CubeMapBytes(const TextureCubeMap::sptr& cubeMap)
+	{
+		return TextureBytes(GL_TEXTURE_CUBE_MAP, cubeMap->GetHandle());
+	}
+
+	//Programs are made of several files, so chain all their hashes (and what they're compiled as) together
+	bool HashShaderFiles(const std::vector<ShaderStage>& stages, uint64_t& hash)
+	{
+		hash = 14695981039346656037ull;
+		for (const ShaderStage& stage : stages)
+		{
+			hash = Util::HashBytes(&stage._type, sizeof(stage._type), hash);
+			if (!AssetRegistry::HashFile(stage._fileName, hash, hash))
+				return false;
+		}
+		return true;
+	}
+
+	//Key for a set of stages, the canonical path of each stage joined together
+	std::string ShaderKey(const std::vector<ShaderStage>& stages)
+	{
+		std::string key;
+		for (const ShaderStage& stage : stages)
+		{
+			key += AssetRegistry::CanonicalPath(stage._fileName) + "|" + std::to_string(stage._type) + "|";
+		}
+		return key;
+	}
+
+	//The driver's binary is the closest thing we have to a program's size
+	size_t ProgramBytes(const Shader::sptr& shader)
+	{
+		GLint length = 0;
+		glGetProgramiv(shader->GetHandle(), GL_PROGRAM_BINARY_LENGTH, &length);
+		return size_t(length);
+	}
+
+	//Uploads every LOD level into the chain, levels that already have a (placeholder) VAO are filled in
+	void UploadLODChain(const MeshLODChain::sptr& chain, const std::vector<MeshData>& levels, const std::vector<float>& errors)
+	{
+		const MeshData& full = levels.front();
+		chain->_centre = (full._boundsMin + full._boundsMax) * 0.5f;
+		chain->_radius = glm::length(full._boundsMax - full._boundsMin) * 0.5f;
+
+		chain->_levels.resize(levels.size());
+		for (size_t i = 0; i < levels.size(); i++)
+		{
+			MeshLODLevel& level = chain->_levels[i];
+			if (level._mesh != nullptr)
+				MeshCache::UploadInto(level._mesh, levels[i]);
+			else
+				level._mesh = MeshCache::Upload(levels[i]);
+
+			level._error = errors[i];
+			level._vertexCount = levels[i]._vertices.size();
+			level._indexCount = levels[i]._indices.size();
+			level._poolRange = MeshPool::Add(levels[i]);
+		}
+
+		//Keep the full level's positions around for occlusion culling
+		//*Simplified levels can bulge past the real surface and hide things that should show, the full mesh never does
+		chain->_occluderPositions.resize(full._vertices.size());
+		for (size_t i = 0; i < full._vertices.size(); i++)
+		{
+			chain->_occluderPositions[i] = full._vertices[i].Position;
+		}
+		chain->_occluderIndices = full._indices;
+	}
+
+	size_t LODChainBytes(const MeshLODChain::sptr& chain)
+	{
+		size_t total = 0;
+		for (const MeshLODLevel& level : chain->_levels)
+		{
+			total += level._vertexCount * sizeof(VertexPosNormTexCol) + level._indexCount * sizeof(uint32_t);
+		}
+		total += chain->_occluderPositions.size() * sizeof(glm::vec3) + chain->_occluderIndices.size() * sizeof(uint32_t);
+		return total;
+	}
+
+	//Looks an asset up by key, then by content hash, and only loads it if neither finds it
+	template <typename T, typename THash, typename TLoad, typename TBytes>
+	std::shared_ptr<T> FindOrLoadAt(AssetTable<T>& table, const std::string& path, const std::string& fileName, THash hashFunc, TLoad loadFunc, TBytes bytesFunc)
+	{
+		//Already loaded from this path
+		auto byPath = table._byPath.find(path);
+		if (byPath != table._byPath.end())
+		{
+			table._hits++;
+			return byPath->second->_asset;
+		}
+
+		//Already loaded from a different path to the same contents
+		uint64_t hash = 0;
+		bool hashed = hashFunc(fileName, hash);
+		if (hashed)
+		{
+			auto byHash = table._byHash.find(hash);
+			if (byHash != table._byHash.end())
+			{
+				table._hits++;
+				byHash->second->_paths.push_back(path);
+				table._byPath[path] = byHash->second;
+				return byHash->second->_asset;
+			}
+		}
+
+		std::shared_ptr<T> asset = loadFunc(fileName);
+		if (asset == nullptr)
+		{
+			return nullptr;
+		}
+
+		std::shared_ptr<AssetEntry<T>> entry = std::make_shared<AssetEntry<T>>();
+		entry->_asset = asset;
+		entry->_hash = hash;
+		entry->_hashed = hashed;
+		entry->_residentBytes = bytesFunc(asset);
+		entry->_paths.push_back(path);
+
+		table._loads++;
+		table._byPath[path] = entry;
+		//Files we couldn't hash can still be shared by path, just not by contents
+		if (hashed)
+		{
+			table._byHash[hash] = entry;
+		}
+
+		return asset;
+	}
+
+	//Looks an asset up by canonical path, then by content hash, and only loads it if neither finds it
+	template <typename T, typename THash, typename TLoad, typename TBytes>
+	std::shared_ptr<T> FindOrLoad(AssetTable<T>& table, const std::string& fileName, THash hashFunc, TLoad loadFunc, TBytes bytesFunc)
+	{
+		return FindOrLoadAt(table, AssetRegistry::CanonicalPath(fileName), fileName, hashFunc, loadFunc, bytesFunc);
+	}
+
+	//Hands back what's registered for this path or for a file with the same stamp, or registers a placeholder for it
+	//*Only the cheap stamp is looked at here, the contents are hashed on the worker so the main thread never reads
+	// the whole file, a stamp match is only trusted once a hash of this file agrees with the loaded one
+	//*Returns the new entry if the caller has to load it, nullptr if it was already there
+	template <typename T, typename TStamp, typename THash, typename TMake>
+	std::shared_ptr<AssetEntry<T>> ReserveEntry(AssetTable<T>& table, const std::string& fileName, TStamp stampFunc, THash hashFunc, TMake makePlaceholder, std::shared_ptr<T>& asset)
+	{
+		std::string path = AssetRegistry::CanonicalPath(fileName);
+
+		auto byPath = table._byPath.find(path);
+		if (byPath != table._byPath.end())
+		{
+			table._hits++;
+			asset = byPath->second->_asset;
+			return nullptr;
+		}
+
+		uint64_t stamp = 0;
+		bool stamped = stampFunc(fileName, stamp);
+		if (stamped)
+		{
+			//Sizes and times matching is rare enough between different files that hashing here to make sure is fine,
+			//but we can't if the other one is still loading since we don't know its hash yet
+			auto byStamp = table._byStamp.find(stamp);
+			uint64_t hash = 0;
+			if (byStamp != table._byStamp.end() && byStamp->second->_hashed &&
+				hashFunc(fileName, hash) && hash == byStamp->second->_hash)
+			{
+				table._hits++;
+				byStamp->second->_paths.push_back(path);
+				table._byPath[path] = byStamp->second;
+				asset = byStamp->second->_asset;
+				return nullptr;
+			}
+		}
+
+		std::shared_ptr<AssetEntry<T>> entry = std::make_shared<AssetEntry<T>>();
+		entry->_asset = makePlaceholder();
+		entry->_stamp = stamp;
+		entry->_paths.push_back(path);
+
+		table._loads++;
+		table._byPath[path] = entry;
+		if (stamped)
+		{
+			table._byStamp.emplace(stamp, entry);
+		}
+
+		asset = entry->_asset;
+		return entry;
+	}
+
+	//Fills in the rest of a reserved entry once it's loaded
+	template <typename T>
+	void CompleteEntry(const std::shared_ptr<AssetEntry<T>>& entry, size_t residentBytes)
+	{
+		entry->_residentBytes = residentBytes;
+	}
+
+	//Unregisters a reserved entry whose load failed, so asking for it again retries the load
+	//*Whoever already has the placeholder keeps it, it just never gets filled in
+	template <typename T>
+	void FailEntry(AssetTable<T>& table, const std::shared_ptr<AssetEntry<T>>& entry)
+	{
+		for (const std::string& path : entry->_paths)
+		{
+			auto byPath = table._byPath.find(path);
+			if (byPath != table._byPath.end() && byPath->second == entry)
+				table._byPath.erase(byPath);
+		}
+		auto byStamp = table._byStamp.find(entry->_stamp);
+		if (byStamp != table._byStamp.end() && byStamp->second == entry)
+			table._byStamp.erase(byStamp);
+		if (entry->_hashed)
+		{
+			auto byHash = table._byHash.find(entry->_hash);
+			if (byHash != table._byHash.end() && byHash->second == entry)
+				table._byHash.erase(byHash);
+		}
+	}
+
+	//Loads a reserved entry on the worker, hashing its contents on the way
+	//*If finish throws the entry is failed like any other load that didn't work out
+	template <typename T, typename THash>
+	void RunEntryLoad(AssetTable<T>& table, const std::shared_ptr<AssetEntry<T>>& entry, const std::string& fileName, THash hashFunc,
+		std::function<void()> work, std::function<void()> finish)
+	{
+		struct Hash
+		{
+			uint64_t _hash = 0;
+			bool _hashed = false;
+		};
+		std::shared_ptr<Hash> hash = std::make_shared<Hash>();
+
+		AsyncLoader::Run(
+			[fileName, hashFunc, hash, work]() {
+				hash->_hashed = hashFunc(fileName, hash->_hash);
+				work();
+			},
+			[&table, entry, fileName, hash, finish]() {
+				//The placeholder was already handed out, so if another path got to these contents first it can't be merged
+				//into that one anymore, it just isn't registered by hash
+				if (hash->_hashed)
+				{
+					entry->_hash = hash->_hash;
+					entry->_hashed = true;
+					table._byHash.emplace(hash->_hash, entry);
+				}
+
+				try
+				{
+					finish();
+				}
+				catch (const std::exception& e)
+				{
+					LOG_ERROR("Could not finish loading \"{}\": {}", fileName, e.what());
+					FailEntry(table, entry);
+				}
+				catch (...)
+				{
+					LOG_ERROR("Could not finish loading \"{}\"", fileName);
+					FailEntry(table, entry);
+				}
+			});
+	}
+
+	Texture2D::sptr MakePlaceholderTexture()
+	{
+		//RGBA so the real texture keeps its alpha when it's loaded over the top
+		Texture2DDescription desc = Texture2DDescription();
+		desc.Width = 1;
+		desc.Height = 1;
+		desc.Format = InternalFormat::RGBA8;
+		Texture2D::sptr texture = Texture2D::Create(desc);
+		//Clear it with a white colour
+		texture->Clear();
+		return texture;
+	}
+
+	//Fills in the stats for one table
+	template <typename T>
+	AssetStats GetTableStats(const AssetTable<T>& table, const std::string& type)
+	{
+		AssetStats stats;
+		stats._type = type;
+		stats._hits = table._hits;
+		stats._loads = table._loads;
+
+		//Entries can be reachable from more than one path, only count each one once
+		std::vector<const AssetEntry<T>*> counted;
+		for (const auto& pair : table._byPath)
+		{
+			const AssetEntry<T>* entry = pair.second.get();
+			if (Util::FindInVector(entry, counted) != -1)
+				continue;
+			counted.push_back(entry);
+
+			stats._count++;
+			//The registry holds one of the references itself
+			stats._references += size_t(entry->_asset.use_count() - 1);
+			stats._residentBytes += entry->_residentBytes;
+		}
+
+		return stats;
+	}
+
+	//Drops every entry in the table that only the registry is holding onto
+	template <typename T>
+	size_t CollectTable(AssetTable<T>& table)
+	{
+		size_t released = 0;
+		for (auto it = table._byHash.begin(); it != table._byHash.end();)
+		{
+			if (it->second->_asset.use_count() == 1)
+				it = table._byHash.erase(it);
+			else
+				++it;
+		}
+		for (auto it = table._byStamp.begin(); it != table._byStamp.end();)
+		{
+			if (it->second->_asset.use_count() == 1)
+				it = table._byStamp.erase(it);
+			else
+				++it;
+		}
+		for (auto it = table._byPath.begin(); it != table._byPath.end();)
+		{
+			if (it->second->_asset.use_count() == 1)
+			{
+				//Only count it when its last path goes
+				if (it->second.use_count() == 1)
+					released++;
+				it = table._byPath.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		return released;
+	}
+
+	template <typename T>
+	void ClearTable(AssetTable<T>& table)
+	{
+		table._byPath.clear();
+		table._byHash.clear();
+		table._byStamp.clear();
+	}
+}
+
+VertexArrayObject::sptr AssetRegistry::GetMesh(const std::string& fileName)
+{
+	return FindOrLoad(_meshes, fileName,
+		HashSingleFile,
+		[](const std::string& file) {
+			MeshInfo info;
+			VertexArrayObject::sptr mesh = MeshCache::LoadFromFile(file, &info);
+			if (mesh != nullptr)
+				_meshInfo[mesh.get()] = info;
+			return mesh;
+		},
+		[](const VertexArrayObject::sptr& mesh) {
+			const MeshInfo* info = GetMeshInfo(mesh);
+			return info != nullptr ? info->_vertexCount * sizeof(VertexPosNormTexCol) + info->_indexCount * sizeof(uint32_t) : size_t(0);
+		});
+}
+
+MeshLODChain::sptr AssetRegistry::GetMeshLODs(const std::string& fileName)
+{
+	return FindOrLoad(_meshLODs, fileName,
+		HashSingleFile,
+		[](const std::string& file) -> MeshLODChain::sptr {
+			std::vector<MeshData> levels;
+			std::vector<float> errors;
+			if (!MeshCache::LoadMeshLODs(file, levels, errors))
+				return nullptr;
+
+			MeshLODChain::sptr chain = std::make_shared<MeshLODChain>();
+			UploadLODChain(chain, levels, errors);
+			return chain;
+		},
+		LODChainBytes);
+}
+
+Texture2D::sptr AssetRegistry::GetTexture(const std::string& fileName)
+{
+	return FindOrLoad(_textures, fileName,
+		HashSingleFile,
+		[](const std::string& file) {
+			DecodedTexture decoded;
+			return TextureLoader::Decode(file, decoded) ? TextureLoader::Upload(decoded) : nullptr;
+		},
+		TextureBytes2D);
+}
+
+TextureCubeMap::sptr AssetRegistry::GetCubeMap(const std::string& fileName)
+{
+	return FindOrLoad(_cubeMaps, fileName,
+		HashCubeMapFiles,
+		[](const std::string& file) { return TextureCubeMap::LoadFromImages(file); },
+		CubeMapBytes);
+}
+
+LUT3D::sptr AssetRegistry::GetLUT(const std::string& fileName)
+{
+	return FindOrLoad(_luts, fileName,
+		HashSingleFile,
+		[](const std::string& file) {
+			LUT3D::sptr lut = std::make_shared<LUT3D>();
+			return lut->loadFromFile(file) ? lut : nullptr;
+		},
+		[](const LUT3D::sptr& lut) { return TextureBytes(GL_TEXTURE_3D, lut->GetHandle()); });
+}
+
+Shader::sptr AssetRegistry::GetShader(const std::string& vertexFile, const std::string& fragmentFile)
+{
+	std::vector<ShaderStage> stages = { { vertexFile, GL_VERTEX_SHADER }, { fragmentFile, GL_FRAGMENT_SHADER } };
+	return FindOrLoadAt(_shaders, ShaderKey(stages), vertexFile,
+		[&stages](const std::string&, uint64_t& hash) { return HashShaderFiles(stages, hash); },
+		[&stages](const std::string&) { return ShaderCache::Load(stages); },
+		ProgramBytes);
+}
+
+Shader::sptr AssetRegistry::GetShaderStage(const std::string& fileName, GLenum type)
+{
+	std::vector<ShaderStage> stages = { { fileName, type } };
+	return FindOrLoadAt(_shaderStages, ShaderKey(stages), fileName,
+		[&stages](const std::string&, uint64_t& hash) { return HashShaderFiles(stages, hash); },
+		[&stages](const std::string&) { return ShaderCache::LoadSeparable(stages[0]); },
+		ProgramBytes);
+}
+
+ShaderPipeline::sptr AssetRegistry::GetPipeline(const std::string& vertexFile, const std::string& fragmentFile)
+{
+	std::vector<ShaderStage> stages = { { vertexFile, GL_VERTEX_SHADER }, { fragmentFile, GL_FRAGMENT_SHADER } };
+	return FindOrLoadAt(_pipelines, ShaderKey(stages), vertexFile,
+		[&stages](const std::string&, uint64_t& hash) { return HashShaderFiles(stages, hash); },
+		[&](const std::string&) -> ShaderPipeline::sptr {
+			Shader::sptr vertexStage = GetShaderStage(vertexFile, GL_VERTEX_SHADER);
+			Shader::sptr fragmentStage = GetShaderStage(fragmentFile, GL_FRAGMENT_SHADER);
+			if (vertexStage == nullptr || fragmentStage == nullptr)
+				return nullptr;
+			return ShaderPipeline::Create(vertexStage, fragmentStage);
+		},
+		//The stages already count the program memory
+		[](const ShaderPipeline::sptr&) { return size_t(0); });
+}
+
+VertexArrayObject::sptr AssetRegistry::GetMeshAsync(const std::string& fileName)
+{
+	VertexArrayObject::sptr mesh;
+	std::shared_ptr<AssetEntry<VertexArrayObject>> entry = ReserveEntry(_meshes, fileName, StampSingleFile, HashSingleFile, []() { return VertexArrayObject::Create(); }, mesh);
+	if (entry == nullptr)
+	{
+		return mesh;
+	}
+
+	//What the worker hands back to the main thread
+	struct Result
+	{
+		MeshData _data;
+		bool _loaded = false;
+	};
+	std::shared_ptr<Result> result = std::make_shared<Result>();
+
+	RunEntryLoad(_meshes, entry, fileName, HashSingleFile,
+		[fileName, result]() {
+			result->_loaded = MeshCache::LoadMeshData(fileName, result->_data);
+		},
+		[fileName, entry, result]() {
+			if (!result->_loaded)
+			{
+				//The ObjLoader fallback makes its own VAO, so there's nothing we can fill in
+				LOG_WARN("Could not load \"{}\" asynchronously, it will stay empty until it's requested again", fileName);
+				FailEntry(_meshes, entry);
+				return;
+			}
+
+			MeshCache::UploadInto(entry->_asset, result->_data);
+
+			MeshInfo info;
+			info._vertexCount = result->_data._vertices.size();
+			info._indexCount = result->_data._indices.size();
+			info._boundsMin = result->_data._boundsMin;
+			info._boundsMax = result->_data._boundsMax;
+			_meshInfo[entry->_asset.get()] = info;
+
+			CompleteEntry(entry, info._vertexCount * sizeof(VertexPosNormTexCol) + info._indexCount * sizeof(uint32_t));
+		});
+
+	return mesh;
+}
+
+Texture2D::sptr AssetRegistry::GetTextureAsync(const std::string& fileName)
+{
+	Texture2D::sptr texture;
+	std::shared_ptr<AssetEntry<Texture2D>> entry = ReserveEntry(_textures, fileName, StampSingleFile, HashSingleFile, MakePlaceholderTexture, texture);
+	if (entry == nullptr)
+	{
+		return texture;
+	}
+
+	struct Result
+	{
+		DecodedTexture _decoded;
+		bool _loaded = false;
+	};
+	std::shared_ptr<Result> result = std::make_shared<Result>();
+
+	RunEntryLoad(_textures, entry, fileName, HashSingleFile,
+		[fileName, result]() {
+			result->_loaded = TextureLoader::Decode(fileName, result->_decoded);
+		},
+		[fileName, entry, result]() {
+			//Failed ones just stay white
+			if (!result->_loaded)
+			{
+				LOG_WARN("Could not load \"{}\" asynchronously, it will stay white until it's requested again", fileName);
+				FailEntry(_textures, entry);
+				return;
+			}
+
+			TextureLoader::UploadInto(entry->_asset, result->_decoded);
+			CompleteEntry(entry, TextureBytes2D(entry->_asset));
+		});
+
+	return texture;
+}
+
+TextureCubeMap::sptr AssetRegistry::GetCubeMapAsync(const std::string& fileName)
+{
+	TextureCubeMap::sptr cubeMap;
+	std::shared_ptr<AssetEntry<TextureCubeMap>> entry = ReserveEntry(_cubeMaps, fileName, StampCubeMapFiles, HashCubeMapFiles, []() { return TextureCubeMap::Create(); }, cubeMap);
+	if (entry == nullptr)
+	{
+		return cubeMap;
+	}
+
+	struct Result
+	{
+		TextureCubeMapData::sptr _data;
+	};
+	std::shared_ptr<Result> result = std::make_shared<Result>();
+
+	RunEntryLoad(_cubeMaps, entry, fileName, HashCubeMapFiles,
+		[fileName, result]() {
+			result->_data = TextureCubeMapData::LoadFromImages(fileName);
+		},
+		[fileName, entry, result]() {
+			if (result->_data == nullptr)
+			{
+				LOG_WARN("Could not load cube map \"{}\"", fileName);
+				FailEntry(_cubeMaps, entry);
+				return;
+			}
+
+			entry->_asset->LoadData(result->_data);
+			CompleteEntry(entry, CubeMapBytes(entry->_asset));
+		});
+
+	return cubeMap;
+}
+
+MeshLODChain::sptr AssetRegistry::GetMeshLODsAsync(const std::string& fileName)
+{
+	MeshLODChain::sptr chain;
+	std::shared_ptr<AssetEntry<MeshLODChain>> entry = ReserveEntry(_meshLODs, fileName, StampSingleFile, HashSingleFile,
+		[]() {
+			MeshLODChain::sptr placeholder = std::make_shared<MeshLODChain>();
+			placeholder->_levels.emplace_back();
+			placeholder->_levels[0]._mesh = VertexArrayObject::Create();
+			return placeholder;
+		}, chain);
+	if (entry == nullptr)
+	{
+		return chain;
+	}
+
+	struct Result
+	{
+		std::vector<MeshData> _levels;
+		std::vector<float> _errors;
+		bool _loaded = false;
+	};
+	std::shared_ptr<Result> result = std::make_shared<Result>();
+
+	RunEntryLoad(_meshLODs, entry, fileName, HashSingleFile,
+		[fileName, result]() {
+			result->_loaded = MeshCache::LoadMeshLODs(fileName, result->_levels, result->_errors);
+		},
+		[fileName, entry, result]() {
+			if (!result->_loaded)
+			{
+				LOG_WARN("Could not load \"{}\" asynchronously, it will stay empty until it's requested again", fileName);
+				FailEntry(_meshLODs, entry);
+				return;
+			}
+
+			UploadLODChain(entry->_asset, result->_levels, result->_errors);
+			CompleteEntry(entry, LODChainBytes(entry->_asset));
+		});
+
+	return chain;
+}
+
+const MeshInfo* AssetRegistry::GetMeshInfo(const VertexArrayObject::sptr& mesh)
+{
+	auto found = _meshInfo.find(mesh.get());
+	return found != _meshInfo.end() ? &found->second : nullptr;
+}
+
+std::vector<AssetStats> AssetRegistry::GetStats()
+{
+	std::vector<AssetStats> stats;
+	stats.push_back(GetTableStats(_meshes, "Meshes"));
+	stats.push_back(GetTableStats(_meshLODs, "Mesh LOD Chains"));
+	stats.push_back(GetTableStats(_textures, "Textures"));
+	stats.push_back(GetTableStats(_cubeMaps, "Cube Maps"));
+	stats.push_back(GetTableStats(_luts, "LUTs"));
+	stats.push_back(GetTableStats(_shaders, "Shader Programs"));
+	stats.push_back(GetTableStats(_shaderStages, "Shader Stages"));
+	stats.push_back(GetTableStats(_pipelines, "Shader Pipelines"));
+	return stats;
+}
+
+size_t AssetRegistry::Collect()
+{
+	//Forget the info for meshes that are about to go away
+	for (const auto& pair : _meshes._byPath)
+	{
+		if (pair.second->_asset.use_count() == 1)
+			_meshInfo.erase(pair.second->_asset.get());
+	}
+
+	size_t released = 0;
+	released += CollectTable(_meshes);
+	released += CollectTable(_meshLODs);
+	released += CollectTable(_textures);
+	released += CollectTable(_cubeMaps);
+	released += CollectTable(_luts);
+	//Pipelines hold onto their stages, so they have to go first
+	released += CollectTable(_pipelines);
+	released += CollectTable(_shaders);
+	released += CollectTable(_shaderStages);
+	return released;
+}
+
+void AssetRegistry::Clear()
+{
+	ClearTable(_meshes);
+	ClearTable(_meshLODs);
+	ClearTable(_textures);
+	ClearTable(_cubeMaps);
+	ClearTable(_luts);
+	ClearTable(_pipelines);
+	ClearTable(_shaders);
+	ClearTable(_shaderStages);
+	_meshInfo.clear();
+}
+
+std::string AssetRegistry::CanonicalPath(const std::string& fileName)
+{
+	std::error_code error;
+	std::filesystem::path path = std::filesystem::weakly_canonical(fileName, error);
+	if (error)
+	{
+		return std::filesystem::path(fileName).lexically_normal().generic_string();
+	}
+	return path.generic_string();
+}
+
+bool AssetRegistry::HashFile(const std::string& fileName, uint64_t& hash, uint64_t seed)
+{
+	MappedFile file;
+	if (!file.Open(fileName))
+	{
+		return false;
+	}
+
+	hash = Util::HashBytes(file.GetData(), file.GetSize(), seed);
+	return true;
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+
+#include <VertexArrayObject.h>
+#include <Texture2D.h>
+#include <TextureCubeMap.h>
+
+#include "Graphics/LODComponent.h"
+#include "Graphics/LUT.h"
+#include "Graphics/ShaderPipeline.h"
+#include "Utilities/MeshCache.h"
+
+//One loaded asset, shared between every path that resolved to it
+template <typename T>
+struct AssetEntry
+{
+	std::shared_ptr<T> _asset;
+	//Hash of the file contents the asset was loaded from
+	uint64_t _hash = 0;
+	//Whether _hash is known yet (async loads only get it once the worker is done)
+	bool _hashed = false;
+	//Sizes and write times of the files the asset was loaded from, a cheap stand in for _hash
+	uint64_t _stamp = 0;
+	//Roughly how much GPU memory the asset is using
+	size_t _residentBytes = 0;
+	//Every canonical path that points at this asset
+	std::vector<std::string> _paths;
+};
+
+//All the loaded assets of one type
+template <typename T>
+struct AssetTable
+{
+	std::unordered_map<std::string, std::shared_ptr<AssetEntry<T>>> _byPath;
+	std::unordered_map<uint64_t, std::shared_ptr<AssetEntry<T>>> _byHash;
+	//Only filled in by the async loads, so they can dedupe without hashing on the main thread
+	std::unordered_map<uint64_t, std::shared_ptr<AssetEntry<T>>> _byStamp;
+
+	//Requests that were handed an asset that was already loaded
+	size_t _hits = 0;
+	//Requests that had to load the asset
+	size_t _loads = 0;
+};
+
+//Stats for one type of asset
+struct AssetStats
+{
+	std::string _type;
+	//Number of unique assets loaded
+	size_t _count = 0;
+	//Number of references held outside the registry
+	size_t _references = 0;
+	//Roughly how much GPU memory they're using
+	size_t _residentBytes = 0;
+	size_t _hits = 0;
+	size_t _loads = 0;
+};
+
+//Central place to load assets from, so each file only ever gets one GPU copy
+//*Assets are looked up by canonical path first, then by a hash of their contents,
+// so two paths to the same (or identical) files share one handle
+//*Only call this from the thread that owns the GL context
+class AssetRegistry abstract
+{
+public:
+	//Getters, these load the asset if it isn't loaded yet
+	static VertexArrayObject::sptr GetMesh(const std::string& fileName);
+	static Texture2D::sptr GetTexture(const std::string& fileName);
+	static TextureCubeMap::sptr GetCubeMap(const std::string& fileName);
+	static LUT3D::sptr GetLUT(const std::string& fileName);
+
+	//Gets a mesh along with its simplified LOD levels (see MeshCache::LoadMeshLODs)
+	//*These are kept apart from plain meshes, the chain's first level is the full mesh
+	static MeshLODChain::sptr GetMeshLODs(const std::string& fileName);
+
+	//Shader getters, each program is compiled once (through ShaderCache) and shared with everything that asks for it
+	//*Programs are keyed by their stage files, then by a hash of their sources
+	static Shader::sptr GetShader(const std::string& vertexFile, const std::string& fragmentFile);
+	//Gets a separable program for a single stage, for building pipelines out of
+	static Shader::sptr GetShaderStage(const std::string& fileName, GLenum type);
+	//Gets a pipeline made of separable vertex and fragment stages, the stages are shared between pipelines
+	//*Fullscreen passes should use these so they all share one vertex stage
+	static ShaderPipeline::sptr GetPipeline(const std::string& vertexFile, const std::string& fragmentFile);
+
+	//Async getters, these hand back the asset straight away and fill it in once it's loaded
+	//*Textures start as 1x1 white, meshes start empty (so they draw nothing) and cube maps start with no faces
+	//*The same object is filled in, so anything already holding it picks up the real asset
+	//*AsyncLoader::Poll has to be called each frame to finish them off
+	//*Loads that fail are dropped from the registry, so asking for the file again retries it
+	static VertexArrayObject::sptr GetMeshAsync(const std::string& fileName);
+	static Texture2D::sptr GetTextureAsync(const std::string& fileName);
+	static TextureCubeMap::sptr GetCubeMapAsync(const std::string& fileName);
+	//LOD chains start with just an empty full mesh, the simplified levels are added once they're loaded
+	static MeshLODChain::sptr GetMeshLODsAsync(const std::string& fileName);
+
+	//Gets the info for a mesh that was loaded through the registry (nullptr if it wasn't)
+	static const MeshInfo* GetMeshInfo(const VertexArrayObject::sptr& mesh);
+
+	//Gets the stats for every asset type
+	static std::vector<AssetStats> GetStats();
+
+	//Releases every asset nobody outside the registry is holding onto
+	//*Returns how many assets were released
+	static size_t Collect();
+	//Drops every reference the registry is holding
+	static void Clear();
+
+	//Gets the path we key assets by
+	static std::string CanonicalPath(const std::string& fileName);
+	//Hashes the contents of a file, returns false if it can't be read
+	static bool HashFile(const std::string& fileName, uint64_t& hash, uint64_t seed = 14695981039346656037ull);
+
+private:
+	static AssetTable<VertexArrayObject> _meshes;
+	static AssetTable<MeshLODChain> _meshLODs;
+	static AssetTable<Texture2D> _textures;
+	static AssetTable<TextureCubeMap> _cubeMaps;
+	static AssetTable<LUT3D> _luts;
+	static AssetTable<Shader> _shaders;
+	static AssetTable<Shader> _shaderStages;
+	static AssetTable<ShaderPipeline> _pipelines;
+
+	//Mesh info for each mesh we loaded
+	static std::unordered_map<const VertexArrayObject*, MeshInfo> _meshInfo;
+};
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include "AsyncLoader.h"
+
+#include <chrono>
+
+#include <Logging.h>
+
+#include "Utilities/ThreadPool.h"
+
+std::mutex AsyncLoader::_mutex;
+std::condition_variable AsyncLoader::_idle;
+std::vector<std::function<void()>> AsyncLoader::_done;
+std::deque<std::function<void()>> AsyncLoader::_ready;
+size_t AsyncLoader::_running = 0;
+
+void AsyncLoader::Run(std::function<void()> work, std::function<void()> finish)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_running++;
+	}
+
+	try
+	{
+		ThreadPool::Enqueue([work, finish]() {
+			//If the work throws, still hand the job back so nobody waits on it forever
+			try
+			{
+				work();
+			}
+			catch (const std::exception& e)
+			{
+				LOG_ERROR("Async load failed: {}", e.what());
+			}
+			catch (...)
+			{
+				LOG_ERROR("Async load failed with an unknown exception");
+			}
+
+			Finish(finish);
+		});
+	}
+	catch (...)
+	{
+		//The job never made it onto the pool, so nothing will ever finish it
+		Finish(nullptr);
+		throw;
+	}
+}
+
+size_t AsyncLoader::Poll(float budgetMs)
+{
+	//Take everything the workers finished in one go so we hold the lock as little as possible
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (std::function<void()>& finish : _done)
+		{
+			_ready.push_back(std::move(finish));
+		}
+		_done.clear();
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	size_t finished = 0;
+	while (!_ready.empty())
+	{
+		std::function<void()> finish = std::move(_ready.front());
+		_ready.pop_front();
+		//Whoever queued the job deals with its own failures, this just keeps one bad finish from taking the rest down with it
+		try
+		{
+			finish();
+		}
+		catch (const std::exception& e)
+		{
+			LOG_ERROR("Finishing an async load failed: {}", e.what());
+		}
+		catch (...)
+		{
+			LOG_ERROR("Finishing an async load failed with an unknown exception");
+		}
+		finished++;
+
+		std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		if (elapsed.count() >= budgetMs)
+			break;
+	}
+
+	return finished;
+}
+
+size_t AsyncLoader::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _running + _done.size() + _ready.size();
+}
+
+void AsyncLoader::Finish(std::function<void()> finish)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		//The job counts as done even if its finish can't be queued, or Shutdown would wait on it forever
+		_running--;
+		if (finish)
+		{
+			try
+			{
+				_done.push_back(std::move(finish));
+			}
+			catch (...)
+			{
+				LOG_ERROR("Could not queue an async load's finish, it's dropped");
+			}
+		}
+	}
+	_idle.notify_all();
+}
+
+void AsyncLoader::Shutdown()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_idle.wait(lock, []() { return _running == 0; });
+
+	//Dropping them releases whatever they captured while the context is still around
+	_done.clear();
+	_ready.clear();
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+//Runs loading work on the thread pool and finishes it on the main thread
+//*work runs on a worker (no GL calls), finish runs inside Poll on the thread that owns the GL context
+class AsyncLoader abstract
+{
+public:
+	//Queues a job, finish is called from Poll once work is done
+	static void Run(std::function<void()> work, std::function<void()> finish);
+
+	//Finishes jobs whose work is done, stopping once budgetMs has gone by (always finishes at least one)
+	//*Call this once a frame, returns how many were finished
+	static size_t Poll(float budgetMs = 4.0f);
+
+	//Gets how many jobs haven't been finished yet
+	static size_t GetPendingCount();
+
+	//Waits for the workers to finish what they're doing and drops everything that wasn't finished
+	//*Call this before the GL context goes away
+	static void Shutdown();
+
+private:
+	//Marks a job as no longer running and queues its finish (if it has one)
+	static void Finish(std::function<void()> finish);
+
+	static std::mutex _mutex;
+	static std::condition_variable _idle;
+	//Jobs whose work is done, filled in by the workers
+	static std::vector<std::function<void()>> _done;
+	//Jobs waiting for Poll to finish them (main thread only)
+	static std::deque<std::function<void()>> _ready;
+	//Jobs still running on a worker
+	static size_t _running;
+};
\ No newline at end of file
@@ -1,5 +1,10 @@
 #include "BackendHandler.h"
 
+#if defined(_M_X64) || defined(__SSE2__)
+#define BACKEND_SSE 1
+#include <emmintrin.h>
+#endif
+
 GLFWwindow* BackendHandler::window = nullptr;
 std::vector<std::function<void()>> BackendHandler::imGuiCallbacks;
 
@@ -198,24 +203,77 @@ void BackendHandler::RenderImGui()
 	}
 }
 
-void BackendHandler::RenderVAO(const Shader::sptr& shader, const VertexArrayObject::sptr& vao, const glm::mat4& viewProjection, const Transform& transform, const glm::mat4& lightSpaceMat)
+void BackendHandler::SetFrameUniforms(const glm::mat4& view, const glm::mat4& projection, const glm::mat4& lightSpace)
 {
-	shader->Bind();
-	shader->SetUniformMatrix("u_ModelViewProjection", viewProjection * transform.WorldTransform());
-	shader->SetUniformMatrix("u_LightSpaceMatrix", lightSpaceMat);
-	shader->SetUniformMatrix("u_Model", transform.WorldTransform());
-	shader->SetUniformMatrix("u_NormalMatrix", transform.WorldNormalMatrix());
-	vao->Render();
-	shader->UnBind();
+	UniformAllocation frame = UniformRing::Allocate(sizeof(FrameUniforms));
+	FrameUniforms* data = reinterpret_cast<FrameUniforms*>(frame._data);
+	data->_view = view;
+	data->_projection = projection;
+	data->_viewProjection = projection * view;
+	data->_skyboxMatrix = projection * glm::mat4(glm::mat3(view));
+	data->_lightSpace = lightSpace;
+	data->_cameraPosition = glm::inverse(view) * glm::vec4(0, 0, 0, 1);
+	glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_BINDING, frame._buffer, frame._offset, sizeof(FrameUniforms));
+}
+
+UniformAllocation BackendHandler::WriteObjectUniforms(const glm::mat4& viewProjection, const std::vector<const Transform*>& transforms)
+{
+	if (transforms.empty())
+		return UniformAllocation();
+
+	size_t stride = UniformRing::GetStride(sizeof(ObjectUniforms));
+	UniformAllocation objects = UniformRing::Allocate(stride * transforms.size());
+
+	//The ring is write combined, so every block is written front to back and never read
+#if BACKEND_SSE
+	__m128 vp0 = _mm_loadu_ps(&viewProjection[0][0]);
+	__m128 vp1 = _mm_loadu_ps(&viewProjection[1][0]);
+	__m128 vp2 = _mm_loadu_ps(&viewProjection[2][0]);
+	__m128 vp3 = _mm_loadu_ps(&viewProjection[3][0]);
+#endif
+	for (size_t i = 0; i < transforms.size(); i++)
+	{
+		const glm::mat4& model = transforms[i]->WorldTransform();
+		glm::mat3 normal = transforms[i]->WorldNormalMatrix();
+		float* block = reinterpret_cast<float*>(objects._data + i * stride);
+#if BACKEND_SSE
+		//Ring blocks are at least 16 byte aligned
+		__m128 columns[4];
+		__m128 mvp[4];
+		for (int c = 0; c < 4; c++)
+		{
+			columns[c] = _mm_loadu_ps(&model[c][0]);
+			mvp[c] = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(vp0, _mm_shuffle_ps(columns[c], columns[c], 0x00)), _mm_mul_ps(vp1, _mm_shuffle_ps(columns[c], columns[c], 0x55))),
+				_mm_add_ps(_mm_mul_ps(vp2, _mm_shuffle_ps(columns[c], columns[c], 0xAA)), _mm_mul_ps(vp3, _mm_shuffle_ps(columns[c], columns[c], 0xFF))));
+		}
+		for (int c = 0; c < 4; c++)
+		{
+			_mm_store_ps(block + c * 4, columns[c]);
+		}
+		for (int c = 0; c < 4; c++)
+		{
+			_mm_store_ps(block + 16 + c * 4, mvp[c]);
+		}
+		for (int c = 0; c < 3; c++)
+		{
+			_mm_store_ps(block + 32 + c * 4, _mm_setr_ps(normal[c][0], normal[c][1], normal[c][2], 0.0f));
+		}
+		_mm_store_ps(block + 44, _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f));
+#else
+		ObjectUniforms* data = reinterpret_cast<ObjectUniforms*>(block);
+		data->_model = model;
+		data->_modelViewProjection = viewProjection * model;
+		data->_normalMatrix = glm::mat4(normal);
+#endif
+	}
+	return objects;
 }
 
-void BackendHandler::SetupShaderForFrame(const Shader::sptr& shader, const glm::mat4& view, const glm::mat4& projection)
+void BackendHandler::RenderVAO(const VertexArrayObject::sptr& vao, const UniformAllocation& objects, size_t index)
 {
-	shader->Bind();
-	// These are the uniforms that update only once per frame
-	shader->SetUniformMatrix("u_View", view);
-	shader->SetUniformMatrix("u_ViewProjection", projection * view);
-	shader->SetUniformMatrix("u_SkyboxMatrix", projection * glm::mat4(glm::mat3(view)));
-	glm::vec3 camPos = glm::inverse(view) * glm::vec4(0, 0, 0, 1);
-	shader->SetUniform("u_CamPos", camPos);
+	size_t stride = UniformRing::GetStride(sizeof(ObjectUniforms));
+	glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_BINDING, objects._buffer, objects._offset + GLintptr(index * stride), sizeof(ObjectUniforms));
+	vao->Render();
 }
+
@@ -10,6 +10,8 @@
 #include "Graphics/Post/BloomEffect.h"
 #include "Graphics/Post/FilmGrainEffect.h"
 #include "Graphics/Post/PixelatedEffect.h"
+#include "Graphics/Post/PostChain.h"
+#include "Graphics/UniformRing.h"
 
 #include <iostream>
 #include <Logging.h>
@@ -31,9 +33,34 @@
 
 #define LOG_GL_NOTIFICATIONS
 
+//Camera data the scene shaders read from one uniform block a frame (std140)
+struct FrameUniforms
+{
+	glm::mat4 _view;
+	glm::mat4 _projection;
+	glm::mat4 _viewProjection;
+	glm::mat4 _skyboxMatrix;
+	//Nearest shadow cascade, for the forward shaders
+	glm::mat4 _lightSpace;
+	glm::vec4 _cameraPosition;
+};
+
+//One draw's matrices (std140), written for a whole pass at once and bound by offset
+struct ObjectUniforms
+{
+	glm::mat4 _model;
+	glm::mat4 _modelViewProjection;
+	//mat3 padded out to columns of vec4
+	glm::mat4 _normalMatrix;
+};
+
 class BackendHandler abstract
 {
 public:
+	//Uniform block bindings for FrameUniforms and ObjectUniforms
+	static const GLuint FRAME_BINDING = 1;
+	static const GLuint OBJECT_BINDING = 2;
+
 	/*
 	Handles debug messages from OpenGL
 	https://www.khronos.org/opengl/wiki/Debug_Output#Message_Components
@@ -62,9 +89,14 @@ public:
 	static void ShutdownImGui();
 	static void RenderImGui();
 
-	//Render our VAO
-	static void RenderVAO(const Shader::sptr& shader, const VertexArrayObject::sptr& vao, const glm::mat4& viewProjection, const Transform& transform, const glm::mat4& lightSpaceMat=glm::mat4());
-	static void SetupShaderForFrame(const Shader::sptr& shader, const glm::mat4& view, const glm::mat4& projection);
+	//Writes this frame's camera block into the uniform ring and binds it for every shader
+	static void SetFrameUniforms(const glm::mat4& view, const glm::mat4& projection, const glm::mat4& lightSpace);
+	//Writes the matrices for every draw in a pass into the uniform ring in one go, index i is transforms[i]
+	static UniformAllocation WriteObjectUniforms(const glm::mat4& viewProjection, const std::vector<const Transform*>& transforms);
+
+	//Render our VAO, with the matrices at index in a WriteObjectUniforms allocation
+	//*The shader needs to be bound already
+	static void RenderVAO(const VertexArrayObject::sptr& vao, const UniformAllocation& objects, size_t index);
 
 	static GLFWwindow* window;
 	static std::vector<std::function<void()>> imGuiCallbacks;
@@ -4,10 +4,11 @@
 std::vector<std::vector<GameObject>> EnvironmentGenerator::_objectsSpawned;
 
 //Object information for being spawned
-std::vector<VertexArrayObject::sptr> EnvironmentGenerator::_vaosToSpawn;
+std::vector<MeshLODChain::sptr> EnvironmentGenerator::_lodsToSpawn;
 std::vector<bool> EnvironmentGenerator::_loadedIn;
 std::vector<ShaderMaterial::sptr> EnvironmentGenerator::_materialsForSpawning;
 std::vector<int> EnvironmentGenerator::_numToSpawn;
+std::vector<int> EnvironmentGenerator::_albedoVariants;
 std::vector<glm::vec2> EnvironmentGenerator::_spawnFromAll;
 std::vector<glm::vec2> EnvironmentGenerator::_spawnToAll;
 std::vector<std::vector<glm::vec2>> EnvironmentGenerator::_avoidFromAll;
@@ -34,18 +35,23 @@ void EnvironmentGenerator::GenerateEnvironment()
 	{
 		std::vector<GameObject> temp;
 		{
-			//Load in this object vao
+			//Load in this object's LOD chain (the registry hands back the one we already have if it's loaded)
 			if (!_loadedIn[i])
 			{
-				VertexArrayObject::sptr vao = ObjLoader::LoadFromFile(_objectsToSpawn[i]);
-				_vaosToSpawn.push_back(vao);
+				_lodsToSpawn[i] = AssetRegistry::GetMeshLODs(_objectsToSpawn[i]);
 				_loadedIn[i] = true;
 			}
 
 			for (int j = 0; j < _numToSpawn[i]; j++)
 			{
 				temp.push_back(Application::Instance().ActiveScene->CreateEntity(_objectsToSpawn[i] + (std::to_string(j + 1))));
-				temp[j].emplace<RendererComponent>().SetMesh(_vaosToSpawn[i]).SetMaterial(_materialsForSpawning[i]);
+				temp[j].emplace<RendererComponent>().SetMesh(_lodsToSpawn[i] != nullptr ? _lodsToSpawn[i]->_levels[0]._mesh : nullptr).SetMaterial(_materialsForSpawning[i]);
+				//Hundreds of these get spawned, so they draw simplified versions when they're small on screen
+				if (_lodsToSpawn[i] != nullptr)
+					temp[j].emplace<LODComponent>().SetChain(_lodsToSpawn[i]);
+				//They all share a material so they get instanced, variety comes from the albedo array instead
+				if (_albedoVariants[i] > 1)
+					temp[j].emplace<InstanceVariant>()._albedoIndex = uint32_t(Util::GetRandomNumberBetween(0, _albedoVariants[i]));
 				//Randomly places
 				temp[j].get<Transform>().SetLocalPosition(glm::vec3(Util::GetRandomNumberBetween(_spawnFromAll[i],
 					_spawnToAll[i], _avoidFromAll[i], _avoidToAll[i]), 0.0f));
@@ -75,14 +81,14 @@ void EnvironmentGenerator::CleanEnvironment()
 
 void EnvironmentGenerator::CleanUpPointers()
 {
-	//Clear up vao references so the smart pointers can clear
-	_vaosToSpawn.clear();
+	//Clear up mesh references so the smart pointers can clear
+	_lodsToSpawn.clear();
 	//Clear up material references so the smart pointers can clear
 	_materialsForSpawning.clear();
 }
 
 void EnvironmentGenerator::AddObjectToGeneration(std::string fileName, ShaderMaterial::sptr objMat, int numToSpawn, glm::vec2 spawnFrom, 
-													glm::vec2 spawnTo, std::vector<glm::vec2> avoidFrom, std::vector<glm::vec2> avoidTo)
+													glm::vec2 spawnTo, std::vector<glm::vec2> avoidFrom, std::vector<glm::vec2> avoidTo, int albedoVariants)
 {
 	//Find the filename in the list
 	int index = Util::FindInVector(fileName, _objectsToSpawn);
@@ -93,13 +99,15 @@ void EnvironmentGenerator::AddObjectToGeneration(std::string fileName, ShaderMat
 		return;
 	}
 
-	//Loads in the mesh and adds to list
-	VertexArrayObject::sptr vao = ObjLoader::LoadFromFile(fileName);
-	_vaosToSpawn.push_back(vao);
+	//Loads in the mesh (and its LODs) and adds to list
+	MeshLODChain::sptr lods = AssetRegistry::GetMeshLODs(fileName);
+	_lodsToSpawn.push_back(lods);
 	//Adds material to list
 	_materialsForSpawning.push_back(objMat);
 	//Adds number to spawn for this object
 	_numToSpawn.push_back(numToSpawn);
+	//Adds how many albedo layers the spawns pick from
+	_albedoVariants.push_back(albedoVariants);
 
 	//Adds areas to spawn and not spawn
 	_spawnFromAll.push_back(spawnFrom);
@@ -109,8 +117,8 @@ void EnvironmentGenerator::AddObjectToGeneration(std::string fileName, ShaderMat
 
 	//Adds the filename to the list
 	_objectsToSpawn.push_back(fileName);
-	//Sets it as not loaded
-	_loadedIn.push_back(false);
+	//Sets it as loaded, since we just loaded it
+	_loadedIn.push_back(lods != nullptr);
 }
 
 void EnvironmentGenerator::RemoveObjectFromGeneration(std::string fileName)
@@ -123,10 +131,11 @@ void EnvironmentGenerator::RemoveObjectFromGeneration(std::string fileName)
 	}
 
 	//Erase from the vaosToSpawn, Materials, numbers, etc
-	_vaosToSpawn.erase(_vaosToSpawn.begin() + index);
+	_lodsToSpawn.erase(_lodsToSpawn.begin() + index);
 	_loadedIn.erase(_loadedIn.begin() + index);
 	_materialsForSpawning.erase(_materialsForSpawning.begin() + index);
 	_numToSpawn.erase(_numToSpawn.begin() + index);
+	_albedoVariants.erase(_albedoVariants.begin() + index);
 	_avoidFromAll.erase(_avoidFromAll.begin() + index);
 	_avoidToAll.erase(_avoidToAll.begin() + index);
 	
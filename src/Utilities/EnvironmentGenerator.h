@@ -7,6 +7,8 @@
 #include <vector>
 
 #include "Utilities/Util.h"
+#include "Utilities/AssetRegistry.h"
+#include "Graphics/InstanceBatcher.h"
 
 class EnvironmentGenerator abstract
 {
@@ -22,9 +24,10 @@ public:
 	static void CleanUpPointers();
 
 	//Adds object to generation
+	//*albedoVariants > 1 gives each spawn a random layer of the material's albedo array (see InstanceBatcher::SetAlbedoArray)
 	static void AddObjectToGeneration(std::string fileName, ShaderMaterial::sptr objMat, int numToSpawn, 
 										glm::vec2 spawnFrom, glm::vec2 spawnTo, std::vector<glm::vec2> avoidFrom, 
-											std::vector<glm::vec2> avoidTo);
+											std::vector<glm::vec2> avoidTo, int albedoVariants = 1);
 	//Removes object from generation
 	static void RemoveObjectFromGeneration(std::string fileName);
 
@@ -33,11 +36,12 @@ private:
 	//The gameobjects spawned here
 	static std::vector<std::vector<GameObject>> _objectsSpawned;
 
-	//The vaos to spawn in
-	static std::vector<VertexArrayObject::sptr> _vaosToSpawn;
+	//The meshes to spawn in, with their LODs
+	static std::vector<MeshLODChain::sptr> _lodsToSpawn;
 	static std::vector<bool> _loadedIn;
 	static std::vector<ShaderMaterial::sptr> _materialsForSpawning;
 	static std::vector<int> _numToSpawn;
+	static std::vector<int> _albedoVariants;
 	static std::vector<glm::vec2> _spawnFromAll;
 	static std::vector<glm::vec2> _spawnToAll;
 	static std::vector<std::vector<glm::vec2>> _avoidFromAll;
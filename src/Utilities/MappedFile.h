@@ -0,0 +1,40 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+//Read only memory mapping of a file
+//*The whole file is mapped in one go, the OS pages it in as we touch it
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const std::string& path);
+	~MappedFile();
+
+	//Can't copy a mapping, only one object owns the view
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	//Maps the file at path, returns false if it doesn't exist or can't be mapped
+	bool Open(const std::string& path);
+	//Unmaps the file
+	void Close();
+
+	//Is there a file mapped right now
+	bool IsOpen() const;
+
+	//Getters
+	const uint8_t* GetData() const;
+	size_t GetSize() const;
+
+private:
+	const uint8_t* _data = nullptr;
+	size_t _size = 0;
+
+#ifdef _WIN32
+	void* _fileHandle = nullptr;
+	void* _mappingHandle = nullptr;
+#else
+	int _fileDescriptor = -1;
+#endif
+};
\ No newline at end of file
@@ -0,0 +1,593 @@
+#include "MeshCache.h"
+
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+#include <Logging.h>
+#include <NotObjLoader.h>
+#include <ObjLoader.h>
+
+#include "Utilities/MeshOptimizer.h"
+#include "Utilities/MeshSimplifier.h"
+#include "Utilities/ProceduralMesh.h"
+#include "Utilities/Util.h"
+
+std::string MeshCache::_cacheDirectory = "cache/meshes";
+bool MeshCache::_cacheEnabled = true;
+
+namespace
+{
+	//Every baked mesh starts with these
+	const char MESH_CACHE_MAGIC[4] = { 'M', 'S', 'H', 'C' };
+	//Bump this whenever the layout of a baked mesh changes
+	const uint32_t MESH_CACHE_VERSION = 3;
+
+	//A corner of an OBJ face (indices into the position, uv and normal lists)
+	struct ObjCorner
+	{
+		int _position;
+		int _uv;
+		int _normal;
+
+		bool operator==(const ObjCorner& other) const
+		{
+			return _position == other._position && _uv == other._uv && _normal == other._normal;
+		}
+	};
+
+	struct ObjCornerHash
+	{
+		size_t operator()(const ObjCorner& corner) const
+		{
+			return size_t(corner._position) * 73856093u ^ size_t(corner._uv) * 19349663u ^ size_t(corner._normal) * 83492791u;
+		}
+	};
+
+	//Converts a 1 based (or negative, relative) OBJ index into a 0 based one
+	int ResolveObjIndex(int index, size_t count)
+	{
+		if (index > 0)
+			return index - 1;
+		if (index < 0)
+			return int(count) + index;
+		return -1;
+	}
+
+	//NotObj files describe primitives instead of listing triangles
+	bool IsNotObj(const std::string& fileName)
+	{
+		std::string extension = std::filesystem::path(fileName).extension().string();
+		for (char& c : extension)
+			c = char(tolower(c));
+		return extension == ".notobj";
+	}
+
+	//Rounds up to a multiple of 16 so the data blocks stay aligned in the file
+	uint64_t AlignTo16(uint64_t value)
+	{
+		return (value + 15) & ~uint64_t(15);
+	}
+
+	//Copies a mapped baked mesh out into CPU memory
+	void ReadCacheFile(const MeshCacheHeader* header, const MappedFile& file, MeshData& data)
+	{
+		const uint8_t* base = file.GetData();
+		const VertexPosNormTexCol* vertices = reinterpret_cast<const VertexPosNormTexCol*>(base + header->_vertexOffset);
+		const uint32_t* indices = reinterpret_cast<const uint32_t*>(base + header->_indexOffset);
+
+		data._vertices.assign(vertices, vertices + header->_vertexCount);
+		data._indices.assign(indices, indices + header->_indexCount);
+		data._boundsMin = glm::vec3(header->_boundsMin[0], header->_boundsMin[1], header->_boundsMin[2]);
+		data._boundsMax = glm::vec3(header->_boundsMax[0], header->_boundsMax[1], header->_boundsMax[2]);
+	}
+}
+
+void MeshData::CalculateBounds()
+{
+	if (_vertices.empty())
+	{
+		_boundsMin = glm::vec3(0.0f);
+		_boundsMax = glm::vec3(0.0f);
+		return;
+	}
+
+	_boundsMin = _vertices[0].Position;
+	_boundsMax = _vertices[0].Position;
+	for (const VertexPosNormTexCol& vertex : _vertices)
+	{
+		_boundsMin = glm::min(_boundsMin, vertex.Position);
+		_boundsMax = glm::max(_boundsMax, vertex.Position);
+	}
+}
+
+VertexArrayObject::sptr MeshCache::LoadFromFile(const std::string& fileName, MeshInfo* info)
+{
+	//Fast path, upload straight out of the mapped baked mesh
+	if (_cacheEnabled)
+	{
+		MappedFile file;
+		const MeshCacheHeader* header = OpenCacheFile(fileName, fileName, file);
+		if (header != nullptr)
+		{
+			if (info != nullptr)
+			{
+				info->_vertexCount = header->_vertexCount;
+				info->_indexCount = header->_indexCount;
+				info->_boundsMin = glm::vec3(header->_boundsMin[0], header->_boundsMin[1], header->_boundsMin[2]);
+				info->_boundsMax = glm::vec3(header->_boundsMax[0], header->_boundsMax[1], header->_boundsMax[2]);
+			}
+
+			const uint8_t* base = file.GetData();
+			return Upload(reinterpret_cast<const VertexPosNormTexCol*>(base + header->_vertexOffset), header->_vertexCount,
+				reinterpret_cast<const uint32_t*>(base + header->_indexOffset), header->_indexCount);
+		}
+	}
+
+	MeshData data;
+	if (!LoadMeshData(fileName, data))
+	{
+		//Let the framework loader have a go (it also reports the error if the file is missing)
+		if (IsNotObj(fileName))
+		{
+			LOG_WARN("Could not build \"{}\" for the mesh cache, falling back to NotObjLoader", fileName);
+			return NotObjLoader::LoadFromFile(fileName);
+		}
+		LOG_WARN("Could not parse \"{}\" for the mesh cache, falling back to ObjLoader", fileName);
+		return ObjLoader::LoadFromFile(fileName);
+	}
+
+	if (info != nullptr)
+	{
+		info->_vertexCount = data._vertices.size();
+		info->_indexCount = data._indices.size();
+		info->_boundsMin = data._boundsMin;
+		info->_boundsMax = data._boundsMax;
+	}
+
+	return Upload(data);
+}
+
+bool MeshCache::LoadMeshData(const std::string& fileName, MeshData& data)
+{
+	if (_cacheEnabled)
+	{
+		MappedFile file;
+		const MeshCacheHeader* header = OpenCacheFile(fileName, fileName, file);
+		if (header != nullptr)
+		{
+			ReadCacheFile(header, file, data);
+			return true;
+		}
+	}
+
+	//Cache miss, parse the text (or build the primitives) and bake it for next time
+	if (!(IsNotObj(fileName) ? ProceduralMesh::BuildNotObj(fileName, data) : ParseObj(fileName, data)))
+	{
+		return false;
+	}
+
+	//Only done when baking, so the cost is paid once per source change
+	MeshOptimizationReport report = MeshOptimizer::Optimize(data);
+	LOG_INFO("Optimised \"{}\": ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}, {} -> {} vertices", fileName,
+		report._before._acmr, report._after._acmr, report._before._atvr, report._after._atvr, report._verticesBefore, report._verticesAfter);
+
+	if (_cacheEnabled)
+	{
+		SourceStamp stamp;
+		if (SourceStamp::Get(fileName, stamp, true))
+		{
+			WriteCacheFile(fileName, stamp, data);
+		}
+	}
+
+	return true;
+}
+
+bool MeshCache::LoadMeshLODs(const std::string& fileName, std::vector<MeshData>& levels, std::vector<float>& errors)
+{
+	levels.clear();
+	errors.clear();
+
+	if (_cacheEnabled)
+	{
+		//The full mesh says how many levels were baked with it, they all have to be there and up to date
+		uint32_t lodCount = 0;
+		for (uint32_t level = 0; level == 0 || level < lodCount; level++)
+		{
+			MappedFile file;
+			const MeshCacheHeader* header = OpenCacheFile(GetLODKey(fileName, level), fileName, file);
+			if (header == nullptr)
+				break;
+			if (level == 0)
+				lodCount = header->_lodCount;
+
+			levels.emplace_back();
+			ReadCacheFile(header, file, levels.back());
+			errors.push_back(header->_lodError);
+		}
+
+		if (lodCount > 0 && levels.size() == lodCount)
+		{
+			return true;
+		}
+		levels.clear();
+		errors.clear();
+	}
+
+	//Cache miss, build the levels from the full mesh and bake them all
+	MeshData data;
+	if (!LoadMeshData(fileName, data))
+	{
+		return false;
+	}
+	MeshSimplifier::BuildLODChain(data, levels, errors);
+	LOG_INFO("Built {} LOD levels for \"{}\", {} triangles down to {}", levels.size(), fileName,
+		levels.front()._indices.size() / 3, levels.back()._indices.size() / 3);
+
+	if (_cacheEnabled)
+	{
+		SourceStamp stamp;
+		if (SourceStamp::Get(fileName, stamp, true))
+		{
+			//The full mesh goes last, so the level count never points at levels that aren't written yet
+			for (size_t level = levels.size(); level-- > 0;)
+			{
+				WriteCacheFile(GetLODKey(fileName, level), stamp, levels[level], level == 0 ? uint32_t(levels.size()) : 0, errors[level]);
+			}
+		}
+	}
+
+	return true;
+}
+
+VertexArrayObject::sptr MeshCache::Upload(const MeshData& data)
+{
+	return Upload(data._vertices.data(), data._vertices.size(), data._indices.data(), data._indices.size());
+}
+
+VertexArrayObject::sptr MeshCache::Upload(const VertexPosNormTexCol* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount)
+{
+	VertexArrayObject::sptr vao = VertexArrayObject::Create();
+	UploadInto(vao, vertices, vertexCount, indices, indexCount);
+	return vao;
+}
+
+void MeshCache::UploadInto(const VertexArrayObject::sptr& vao, const MeshData& data)
+{
+	UploadInto(vao, data._vertices.data(), data._vertices.size(), data._indices.data(), data._indices.size());
+}
+
+void MeshCache::UploadInto(const VertexArrayObject::sptr& vao, const VertexPosNormTexCol* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount)
+{
+	VertexBuffer::sptr vbo = VertexBuffer::Create();
+	vbo->LoadData(vertices, vertexCount);
+
+	IndexBuffer::sptr ibo = IndexBuffer::Create();
+	ibo->LoadData(indices, indexCount);
+
+	vao->AddVertexBuffer(vbo, VertexPosNormTexCol::V_DECL);
+	vao->SetIndexBuffer(ibo);
+}
+
+bool MeshCache::ParseObj(const std::string& fileName, MeshData& data)
+{
+	MappedFile file;
+	if (!file.Open(fileName))
+	{
+		return false;
+	}
+
+	const char* cursor = reinterpret_cast<const char*>(file.GetData());
+	const char* end = cursor + file.GetSize();
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+
+	//Guess at sizes so we aren't reallocating the whole way through (roughly 40 bytes a line)
+	size_t lineGuess = file.GetSize() / 40;
+	positions.reserve(lineGuess / 3);
+	normals.reserve(lineGuess / 3);
+	uvs.reserve(lineGuess / 3);
+
+	data._vertices.clear();
+	data._indices.clear();
+	data._vertices.reserve(lineGuess / 2);
+	data._indices.reserve(lineGuess);
+
+	//Maps each unique corner to the vertex we made for it
+	std::unordered_map<ObjCorner, uint32_t, ObjCornerHash> cornerLookup;
+	cornerLookup.reserve(lineGuess / 2);
+
+	//Corners of the face we're reading, faces with more than 3 get fanned into triangles
+	std::vector<uint32_t> faceVertices;
+	bool missingNormals = false;
+
+	while (cursor < end)
+	{
+		cursor = Util::SkipBlank(cursor, end);
+		if (cursor >= end)
+			break;
+
+		if (cursor[0] == 'v' && cursor + 1 < end && (cursor[1] == ' ' || cursor[1] == '\t'))
+		{
+			cursor += 1;
+			glm::vec3 position;
+			if (!Util::ReadFloat(cursor, end, position.x) || !Util::ReadFloat(cursor, end, position.y) || !Util::ReadFloat(cursor, end, position.z))
+			{
+				LOG_WARN("Bad vertex position in \"{}\"", fileName);
+				return false;
+			}
+			positions.push_back(position);
+		}
+		else if (cursor[0] == 'v' && cursor + 2 < end && cursor[1] == 't')
+		{
+			cursor += 2;
+			glm::vec2 uv;
+			if (!Util::ReadFloat(cursor, end, uv.x) || !Util::ReadFloat(cursor, end, uv.y))
+			{
+				LOG_WARN("Bad texture coordinate in \"{}\"", fileName);
+				return false;
+			}
+			uvs.push_back(uv);
+		}
+		else if (cursor[0] == 'v' && cursor + 2 < end && cursor[1] == 'n')
+		{
+			cursor += 2;
+			glm::vec3 normal;
+			if (!Util::ReadFloat(cursor, end, normal.x) || !Util::ReadFloat(cursor, end, normal.y) || !Util::ReadFloat(cursor, end, normal.z))
+			{
+				LOG_WARN("Bad normal in \"{}\"", fileName);
+				return false;
+			}
+			normals.push_back(normal);
+		}
+		else if (cursor[0] == 'f' && cursor + 1 < end && (cursor[1] == ' ' || cursor[1] == '\t'))
+		{
+			cursor += 1;
+			faceVertices.clear();
+
+			while (true)
+			{
+				cursor = Util::SkipBlank(cursor, end);
+				if (cursor >= end || *cursor == '\n' || *cursor == '\r' || *cursor == '#')
+					break;
+
+				//Corners are v, v/vt, v//vn or v/vt/vn
+				int position = 0, uv = 0, normal = 0;
+				if (!Util::ReadInt(cursor, end, position))
+				{
+					LOG_WARN("Bad face in \"{}\"", fileName);
+					return false;
+				}
+				if (cursor < end && *cursor == '/')
+				{
+					cursor++;
+					if (cursor < end && *cursor != '/')
+						Util::ReadInt(cursor, end, uv);
+					if (cursor < end && *cursor == '/')
+					{
+						cursor++;
+						Util::ReadInt(cursor, end, normal);
+					}
+				}
+
+				ObjCorner corner;
+				corner._position = ResolveObjIndex(position, positions.size());
+				corner._uv = ResolveObjIndex(uv, uvs.size());
+				corner._normal = ResolveObjIndex(normal, normals.size());
+
+				if (corner._position < 0 || corner._position >= int(positions.size()) ||
+					corner._uv >= int(uvs.size()) || corner._normal >= int(normals.size()))
+				{
+					LOG_WARN("Face index out of range in \"{}\"", fileName);
+					return false;
+				}
+
+				auto found = cornerLookup.find(corner);
+				if (found != cornerLookup.end())
+				{
+					faceVertices.push_back(found->second);
+					continue;
+				}
+
+				VertexPosNormTexCol vertex;
+				vertex.Position = positions[corner._position];
+				vertex.UV = corner._uv >= 0 ? uvs[corner._uv] : glm::vec2(0.0f);
+				vertex.Normal = corner._normal >= 0 ? normals[corner._normal] : glm::vec3(0.0f);
+				vertex.Color = glm::vec4(1.0f);
+				missingNormals |= corner._normal < 0;
+
+				uint32_t index = uint32_t(data._vertices.size());
+				data._vertices.push_back(vertex);
+				cornerLookup.emplace(corner, index);
+				faceVertices.push_back(index);
+			}
+
+			//Fan the face out into triangles
+			for (size_t i = 2; i < faceVertices.size(); i++)
+			{
+				data._indices.push_back(faceVertices[0]);
+				data._indices.push_back(faceVertices[i - 1]);
+				data._indices.push_back(faceVertices[i]);
+			}
+		}
+
+		cursor = Util::SkipLine(cursor, end);
+	}
+
+	//Faces without normals get smooth normals from the faces around them
+	if (missingNormals)
+	{
+		std::vector<glm::vec3> accumulated(data._vertices.size(), glm::vec3(0.0f));
+		for (size_t i = 0; i + 2 < data._indices.size(); i += 3)
+		{
+			const glm::vec3& a = data._vertices[data._indices[i]].Position;
+			const glm::vec3& b = data._vertices[data._indices[i + 1]].Position;
+			const glm::vec3& c = data._vertices[data._indices[i + 2]].Position;
+			glm::vec3 faceNormal = glm::cross(b - a, c - a);
+
+			accumulated[data._indices[i]] += faceNormal;
+			accumulated[data._indices[i + 1]] += faceNormal;
+			accumulated[data._indices[i + 2]] += faceNormal;
+		}
+
+		for (size_t i = 0; i < data._vertices.size(); i++)
+		{
+			if (data._vertices[i].Normal == glm::vec3(0.0f) && glm::dot(accumulated[i], accumulated[i]) > 0.0f)
+				data._vertices[i].Normal = glm::normalize(accumulated[i]);
+		}
+	}
+
+	data.CalculateBounds();
+
+	return !data._indices.empty();
+}
+
+std::string MeshCache::GetLODKey(const std::string& fileName, size_t level)
+{
+	//The full mesh is baked under its own name, so it's shared with plain loads
+	return level == 0 ? fileName : fileName + "#lod" + std::to_string(level);
+}
+
+std::string MeshCache::GetCachePath(const std::string& key)
+{
+	//Name the baked file after a hash of the key so any path flattens into one folder
+	std::stringstream name;
+	name << _cacheDirectory << "/" << std::hex << Util::HashBytes(key.data(), key.size()) << ".mesh";
+	return name.str();
+}
+
+const MeshCacheHeader* MeshCache::OpenCacheFile(const std::string& key, const std::string& sourceFile, MappedFile& file)
+{
+	std::string cachePath = GetCachePath(key);
+	if (!file.Open(cachePath) || file.GetSize() < sizeof(MeshCacheHeader))
+	{
+		file.Close();
+		return nullptr;
+	}
+
+	const MeshCacheHeader* header = reinterpret_cast<const MeshCacheHeader*>(file.GetData());
+
+	//Make sure this is a baked mesh, in the layout we're expecting, for this key
+	bool valid = std::memcmp(header->_magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) == 0 &&
+		header->_version == MESH_CACHE_VERSION &&
+		header->_vertexStride == sizeof(VertexPosNormTexCol) &&
+		header->_keyHash == Util::HashBytes(key.data(), key.size()) &&
+		header->_vertexOffset + uint64_t(header->_vertexCount) * sizeof(VertexPosNormTexCol) <= file.GetSize() &&
+		header->_indexOffset + uint64_t(header->_indexCount) * sizeof(uint32_t) <= file.GetSize();
+
+	//Make sure it was baked from the source file as it is now
+	//*If the source is gone we use the baked file as is (so we can ship without the source)
+	SourceStamp current;
+	bool touched = false;
+	if (valid && SourceStamp::Get(sourceFile, current, false))
+	{
+		if (current._time != header->_source._time || current._size != header->_source._size)
+		{
+			//The time changed, but the source may just have been touched, so check the contents
+			valid = current._size == header->_source._size &&
+				SourceStamp::Get(sourceFile, current, true) && current._hash == header->_source._hash;
+			touched = valid;
+		}
+	}
+
+	if (!valid)
+	{
+		file.Close();
+		return nullptr;
+	}
+
+	//Same contents, so store the new time and skip hashing it on every later launch
+	if (touched)
+	{
+		file.Close();
+		SourceStamp::Rewrite(cachePath, offsetof(MeshCacheHeader, _source), current);
+		if (!file.Open(cachePath) || file.GetSize() < sizeof(MeshCacheHeader))
+		{
+			file.Close();
+			return nullptr;
+		}
+		header = reinterpret_cast<const MeshCacheHeader*>(file.GetData());
+	}
+
+	return header;
+}
+
+bool MeshCache::WriteCacheFile(const std::string& key, const SourceStamp& source, const MeshData& data, uint32_t lodCount, float lodError)
+{
+	MeshCacheHeader header;
+	std::memset(static_cast<void*>(&header), 0, sizeof(header));
+	std::memcpy(header._magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+	header._version = MESH_CACHE_VERSION;
+	header._keyHash = Util::HashBytes(key.data(), key.size());
+	header._source = source;
+	header._vertexStride = sizeof(VertexPosNormTexCol);
+	header._vertexCount = uint32_t(data._vertices.size());
+	header._indexCount = uint32_t(data._indices.size());
+	header._lodCount = lodCount;
+	header._lodError = lodError;
+	for (int i = 0; i < 3; i++)
+	{
+		header._boundsMin[i] = data._boundsMin[i];
+		header._boundsMax[i] = data._boundsMax[i];
+	}
+	header._vertexOffset = AlignTo16(sizeof(MeshCacheHeader));
+	header._indexOffset = AlignTo16(header._vertexOffset + data._vertices.size() * sizeof(VertexPosNormTexCol));
+
+	std::error_code error;
+	std::filesystem::create_directories(_cacheDirectory, error);
+
+	//Write to a temporary file first so a half written file never looks valid,
+	//and so two threads baking the same mesh don't write over each other
+	std::string cachePath = GetCachePath(key);
+	std::stringstream tempPath;
+	tempPath << cachePath << "." << std::hash<std::thread::id>()(std::this_thread::get_id()) << ".tmp";
+
+	{
+		std::ofstream stream(tempPath.str(), std::ios::binary | std::ios::trunc);
+		if (!stream)
+		{
+			LOG_WARN("Could not write baked mesh \"{}\"", cachePath);
+			return false;
+		}
+
+		const char padding[16] = { 0 };
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		stream.write(padding, header._vertexOffset - sizeof(header));
+		stream.write(reinterpret_cast<const char*>(data._vertices.data()), data._vertices.size() * sizeof(VertexPosNormTexCol));
+		stream.write(padding, header._indexOffset - (header._vertexOffset + data._vertices.size() * sizeof(VertexPosNormTexCol)));
+		stream.write(reinterpret_cast<const char*>(data._indices.data()), data._indices.size() * sizeof(uint32_t));
+
+		if (!stream)
+		{
+			stream.close();
+			std::filesystem::remove(tempPath.str(), error);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(tempPath.str(), cachePath, error);
+	if (error)
+	{
+		//Someone else got there first, theirs is just as good
+		std::filesystem::remove(tempPath.str(), error);
+	}
+
+	return true;
+}
+
+void MeshCache::SetCacheDirectory(const std::string& directory)
+{
+	_cacheDirectory = directory;
+}
+
+void MeshCache::SetCacheEnabled(bool enabled)
+{
+	_cacheEnabled = enabled;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <VertexArrayObject.h>
+#include <VertexTypes.h>
+
+#include "Utilities/MappedFile.h"
+#include "Utilities/SourceStamp.h"
+
+//CPU copy of a mesh, interleaved in the VertexPosNormTexCol layout with an index buffer
+struct MeshData
+{
+	std::vector<VertexPosNormTexCol> _vertices;
+	std::vector<uint32_t> _indices;
+
+	//Object space bounds of the vertices
+	glm::vec3 _boundsMin = glm::vec3(0.0f);
+	glm::vec3 _boundsMax = glm::vec3(0.0f);
+
+	//Recalculates the bounds from the vertices
+	void CalculateBounds();
+};
+
+//Summary of a loaded mesh
+struct MeshInfo
+{
+	size_t _vertexCount = 0;
+	size_t _indexCount = 0;
+	glm::vec3 _boundsMin = glm::vec3(0.0f);
+	glm::vec3 _boundsMax = glm::vec3(0.0f);
+};
+
+//Header at the front of every baked mesh file
+//*Vertices and indices follow at the offsets given, so the file can be uploaded straight from a mapping
+struct MeshCacheHeader
+{
+	char _magic[4];
+	uint32_t _version;
+	uint64_t _keyHash;
+	SourceStamp _source;
+	uint32_t _vertexStride;
+	uint32_t _vertexCount;
+	uint32_t _indexCount;
+	//Number of LOD levels baked alongside this mesh (0 if they haven't been built)
+	uint32_t _lodCount;
+	float _boundsMin[3];
+	float _boundsMax[3];
+	//How far this LOD's surface is from the full mesh, relative to the mesh's radius
+	float _lodError;
+	uint32_t _padding;
+	uint64_t _vertexOffset;
+	uint64_t _indexOffset;
+};
+
+class MeshCache abstract
+{
+public:
+	//Loads an OBJ (or NotObj) file, using the baked mesh when it's up to date and baking it if it isn't
+	//*NotObj files are built by ProceduralMesh, so they're baked down to plain triangles too
+	//*Up to date baked meshes are mapped and uploaded without being copied or parsed
+	//*Fills out info (if given) with the counts and bounds of the mesh
+	static VertexArrayObject::sptr LoadFromFile(const std::string& fileName, MeshInfo* info = nullptr);
+	//Loads an OBJ (or NotObj) file into CPU memory, using the baked mesh if we can
+	//*No GL calls, so this is safe to call from worker threads
+	//*Freshly parsed meshes go through MeshOptimizer before they are baked
+	static bool LoadMeshData(const std::string& fileName, MeshData& data);
+
+	//Loads an OBJ (or NotObj) file and its simplified LOD levels into CPU memory
+	//*levels[0] is the full mesh, errors are how far each level's surface is from it (relative to its radius)
+	//*The levels are built by MeshSimplifier the first time and baked next to the mesh
+	//*No GL calls, so this is safe to call from worker threads
+	static bool LoadMeshLODs(const std::string& fileName, std::vector<MeshData>& levels, std::vector<float>& errors);
+
+	//Creates a VAO from mesh data
+	static VertexArrayObject::sptr Upload(const MeshData& data);
+	static VertexArrayObject::sptr Upload(const VertexPosNormTexCol* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount);
+	//Fills in an existing (empty) VAO with mesh data, for meshes that were handed out before they loaded
+	static void UploadInto(const VertexArrayObject::sptr& vao, const MeshData& data);
+	static void UploadInto(const VertexArrayObject::sptr& vao, const VertexPosNormTexCol* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount);
+
+	//Parses an OBJ file, welding matching corners together into an indexed mesh
+	static bool ParseObj(const std::string& fileName, MeshData& data);
+
+	//Gets the baked file path for a key (normally the source path)
+	static std::string GetCachePath(const std::string& key);
+
+	//Maps a baked mesh file, returns the header if it exists and was made from this version of the source
+	static const MeshCacheHeader* OpenCacheFile(const std::string& key, const std::string& sourceFile, MappedFile& file);
+	//Writes a baked mesh file for this key, stamped with the source file
+	//*LOD levels give the number of levels (on the full mesh) or their error (on each simplified level)
+	static bool WriteCacheFile(const std::string& key, const SourceStamp& source, const MeshData& data, uint32_t lodCount = 0, float lodError = 0.0f);
+	//Gets the key a mesh's LOD level is baked under
+	static std::string GetLODKey(const std::string& fileName, size_t level);
+
+	//Sets where baked meshes are stored (relative to the working directory)
+	static void SetCacheDirectory(const std::string& directory);
+	//Turns reading and writing baked meshes on or off
+	static void SetCacheEnabled(bool enabled);
+
+private:
+	static std::string _cacheDirectory;
+	static bool _cacheEnabled;
+};
\ No newline at end of file
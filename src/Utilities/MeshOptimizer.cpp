@@ -0,0 +1,363 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#include "Utilities/Util.h"
+
+namespace
+{
+	//Cache size Forsyth's scores are tuned for, bigger than real caches on purpose
+	const int SCORE_CACHE_SIZE = 32;
+	const float CACHE_DECAY_POWER = 1.5f;
+	const float LAST_TRIANGLE_SCORE = 0.75f;
+	const float VALENCE_BOOST_SCALE = 2.0f;
+	const float VALENCE_BOOST_POWER = 0.5f;
+
+	float VertexScore(int cachePosition, uint32_t remaining)
+	{
+		//Nothing left to draw with this vertex
+		if (remaining == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			//The last triangle's vertices get a fixed score so we don't just keep drawing strips
+			if (cachePosition < 3)
+				score = LAST_TRIANGLE_SCORE;
+			else
+				score = powf(1.0f - float(cachePosition - 3) / float(SCORE_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+		}
+
+		//Favour vertices with few triangles left, so they get finished off instead of left dangling
+		score += VALENCE_BOOST_SCALE * powf(float(remaining), -VALENCE_BOOST_POWER);
+		return score;
+	}
+
+	//Hashes a vertex by its bytes, for welding exact duplicates
+	struct VertexBytesHash
+	{
+		size_t operator()(const VertexPosNormTexCol& vertex) const
+		{
+			return size_t(Util::HashBytes(&vertex, sizeof(vertex)));
+		}
+	};
+
+	struct VertexBytesEqual
+	{
+		bool operator()(const VertexPosNormTexCol& a, const VertexPosNormTexCol& b) const
+		{
+			return std::memcmp(&a, &b, sizeof(VertexPosNormTexCol)) == 0;
+		}
+	};
+}
+
+MeshOptimizationReport MeshOptimizer::Optimize(MeshData& data)
+{
+	MeshOptimizationReport report;
+	report._before = AnalyzeVertexCache(data._indices, data._vertices.size());
+	report._verticesBefore = data._vertices.size();
+
+	WeldVertices(data);
+	OptimizeVertexCache(data._indices, data._vertices.size());
+	OptimizeOverdraw(data);
+	OptimizeVertexFetch(data);
+
+	report._after = AnalyzeVertexCache(data._indices, data._vertices.size());
+	report._verticesAfter = data._vertices.size();
+	return report;
+}
+
+void MeshOptimizer::WeldVertices(MeshData& data)
+{
+	std::unordered_map<VertexPosNormTexCol, uint32_t, VertexBytesHash, VertexBytesEqual> lookup;
+	lookup.reserve(data._vertices.size());
+
+	std::vector<uint32_t> remap(data._vertices.size());
+	std::vector<VertexPosNormTexCol> welded;
+	welded.reserve(data._vertices.size());
+	for (size_t i = 0; i < data._vertices.size(); i++)
+	{
+		auto inserted = lookup.emplace(data._vertices[i], uint32_t(welded.size()));
+		if (inserted.second)
+			welded.push_back(data._vertices[i]);
+		remap[i] = inserted.first->second;
+	}
+
+	//Nothing to merge, leave it be
+	if (welded.size() == data._vertices.size())
+		return;
+
+	for (uint32_t& index : data._indices)
+		index = remap[index];
+	data._vertices.swap(welded);
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	//Triangles that use each vertex, packed into one array
+	//*The first remaining[v] entries in each vertex's range are the triangles it still has to draw
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (uint32_t index : indices)
+		remaining[index]++;
+
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		offsets[v + 1] = offsets[v] + remaining[v];
+
+	std::vector<uint32_t> adjacency(indices.size());
+	{
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			for (int k = 0; k < 3; k++)
+				adjacency[fill[indices[t * 3 + k]]++] = uint32_t(t);
+		}
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScores[v] = VertexScore(-1, remaining[v]);
+
+	std::vector<float> triangleScores(triangleCount);
+	int best = -1;
+	float bestScore = -1.0f;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+		if (triangleScores[t] > bestScore)
+		{
+			bestScore = triangleScores[t];
+			best = int(t);
+		}
+	}
+
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+
+	//Simulated LRU cache, the last few slots hold vertices that are about to fall out
+	std::vector<uint32_t> cache, nextCache;
+	cache.reserve(SCORE_CACHE_SIZE + 3);
+	nextCache.reserve(SCORE_CACHE_SIZE + 3);
+	size_t scan = 0;
+
+	while (output.size() < indices.size())
+	{
+		//Nothing in the cache has triangles left, carry on from the first one we haven't drawn
+		if (best < 0)
+		{
+			while (emitted[scan])
+				scan++;
+			best = int(scan);
+		}
+
+		const uint32_t* triangle = &indices[size_t(best) * 3];
+		emitted[best] = 1;
+		output.insert(output.end(), triangle, triangle + 3);
+
+		//Take the triangle out of each of its vertices' lists
+		for (int k = 0; k < 3; k++)
+		{
+			uint32_t v = triangle[k];
+			uint32_t* list = &adjacency[offsets[v]];
+			uint32_t count = remaining[v];
+			for (uint32_t i = 0; i < count; i++)
+			{
+				if (list[i] == uint32_t(best))
+				{
+					std::swap(list[i], list[count - 1]);
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		//Move the triangle's vertices to the front of the cache
+		nextCache.assign(triangle, triangle + 3);
+		for (uint32_t v : cache)
+		{
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				nextCache.push_back(v);
+		}
+		cache.swap(nextCache);
+
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			uint32_t v = cache[i];
+			cachePosition[v] = i < SCORE_CACHE_SIZE ? int(i) : -1;
+			vertexScores[v] = VertexScore(cachePosition[v], remaining[v]);
+		}
+
+		//Rescore every triangle touching the cache and pick the best one still in it
+		best = -1;
+		bestScore = -1.0f;
+		for (uint32_t v : cache)
+		{
+			for (uint32_t i = 0; i < remaining[v]; i++)
+			{
+				uint32_t t = adjacency[offsets[v] + i];
+				const uint32_t* other = &indices[size_t(t) * 3];
+				triangleScores[t] = vertexScores[other[0]] + vertexScores[other[1]] + vertexScores[other[2]];
+				if (cachePosition[v] >= 0 && triangleScores[t] > bestScore)
+				{
+					bestScore = triangleScores[t];
+					best = int(t);
+				}
+			}
+		}
+
+		//Drop the vertices that fell out
+		if (cache.size() > SCORE_CACHE_SIZE)
+			cache.resize(SCORE_CACHE_SIZE);
+	}
+
+	indices.swap(output);
+}
+
+void MeshOptimizer::OptimizeOverdraw(MeshData& data, float threshold)
+{
+	const std::vector<uint32_t>& indices = data._indices;
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount < 2)
+		return;
+
+	//Split the cache optimised order into clusters wherever the cache starts over (all three vertices miss),
+	//reordering whole clusters keeps most of the cache reuse inside them
+	const int CACHE_SIZE = 16;
+	std::vector<uint32_t> clusterStarts;
+	{
+		std::vector<uint32_t> timestamps(data._vertices.size(), 0);
+		uint32_t time = CACHE_SIZE + 1;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			int misses = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				uint32_t v = indices[t * 3 + k];
+				if (time - timestamps[v] > CACHE_SIZE)
+				{
+					timestamps[v] = time++;
+					misses++;
+				}
+			}
+			if (misses == 3 || t == 0)
+				clusterStarts.push_back(uint32_t(t));
+		}
+	}
+	clusterStarts.push_back(uint32_t(triangleCount));
+
+	size_t clusterCount = clusterStarts.size() - 1;
+	if (clusterCount < 2)
+		return;
+
+	//Area weighted centre and normal of each cluster, and of the whole mesh
+	std::vector<glm::vec3> centres(clusterCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.0f));
+	glm::vec3 meshCentre(0.0f);
+	float meshArea = 0.0f;
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		float clusterArea = 0.0f;
+		for (uint32_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+		{
+			const glm::vec3& a = data._vertices[indices[t * 3]].Position;
+			const glm::vec3& b = data._vertices[indices[t * 3 + 1]].Position;
+			const glm::vec3& d = data._vertices[indices[t * 3 + 2]].Position;
+			glm::vec3 normal = glm::cross(b - a, d - a);
+			float area = glm::length(normal);
+
+			centres[c] += (a + b + d) * (area / 3.0f);
+			normals[c] += normal;
+			clusterArea += area;
+		}
+
+		meshCentre += centres[c];
+		meshArea += clusterArea;
+		centres[c] = clusterArea > 0.0f ? centres[c] / clusterArea : data._vertices[indices[clusterStarts[c] * 3]].Position;
+	}
+	meshCentre = meshArea > 0.0f ? meshCentre / meshArea : glm::vec3(0.0f);
+
+	//Clusters facing out from the middle of the mesh go first, they tend to hide the ones behind them
+	std::vector<float> sortKeys(clusterCount);
+	std::vector<uint32_t> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		float length = glm::length(normals[c]);
+		glm::vec3 direction = length > 0.0f ? normals[c] / length : glm::vec3(0.0f);
+		sortKeys[c] = glm::dot(centres[c] - meshCentre, direction);
+		order[c] = uint32_t(c);
+	}
+	std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<uint32_t> reordered;
+	reordered.reserve(indices.size());
+	for (uint32_t c : order)
+	{
+		reordered.insert(reordered.end(), indices.begin() + size_t(clusterStarts[c]) * 3, indices.begin() + size_t(clusterStarts[c + 1]) * 3);
+	}
+
+	//Overdraw is only worth so much vertex work
+	float before = AnalyzeVertexCache(indices, data._vertices.size(), CACHE_SIZE)._acmr;
+	float after = AnalyzeVertexCache(reordered, data._vertices.size(), CACHE_SIZE)._acmr;
+	if (after <= before * threshold)
+		data._indices.swap(reordered);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(MeshData& data)
+{
+	const uint32_t UNUSED = ~0u;
+	std::vector<uint32_t> remap(data._vertices.size(), UNUSED);
+	std::vector<VertexPosNormTexCol> reordered;
+	reordered.reserve(data._vertices.size());
+
+	for (uint32_t& index : data._indices)
+	{
+		if (remap[index] == UNUSED)
+		{
+			remap[index] = uint32_t(reordered.size());
+			reordered.push_back(data._vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	data._vertices.swap(reordered);
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize)
+{
+	VertexCacheStats stats;
+	if (indices.empty())
+		return stats;
+
+	//A vertex is in the FIFO if it was added within the last cacheSize misses
+	std::vector<uint32_t> timestamps(vertexCount, 0);
+	std::vector<uint8_t> used(vertexCount, 0);
+	uint32_t time = uint32_t(cacheSize) + 1;
+	size_t misses = 0, unique = 0;
+	for (uint32_t index : indices)
+	{
+		if (time - timestamps[index] > uint32_t(cacheSize))
+		{
+			timestamps[index] = time++;
+			misses++;
+		}
+		if (!used[index])
+		{
+			used[index] = 1;
+			unique++;
+		}
+	}
+
+	stats._acmr = float(misses) / float(indices.size() / 3);
+	stats._atvr = float(misses) / float(unique);
+	return stats;
+}
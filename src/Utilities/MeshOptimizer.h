@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include "Utilities/MeshCache.h"
+
+//How well an index buffer uses the post transform vertex cache
+struct VertexCacheStats
+{
+	//Average cache miss ratio, vertices transformed per triangle (0.5 is ideal, 3 is the worst)
+	float _acmr = 0.0f;
+	//Average transform to vertex ratio, vertices transformed per unique vertex (1 is ideal)
+	float _atvr = 0.0f;
+};
+
+//What an optimisation pass did to a mesh
+struct MeshOptimizationReport
+{
+	VertexCacheStats _before;
+	VertexCacheStats _after;
+	size_t _verticesBefore = 0;
+	size_t _verticesAfter = 0;
+};
+
+//Reorders meshes so the GPU does less vertex work, only changes the order things are drawn in
+//*Everything here is CPU only, so it can run on worker threads while meshes bake
+class MeshOptimizer abstract
+{
+public:
+	//Runs every pass below in order, returns the cache stats from before and after
+	static MeshOptimizationReport Optimize(MeshData& data);
+
+	//Merges vertices that are exactly the same and points the indices at the survivors
+	static void WeldVertices(MeshData& data);
+	//Reorders triangles so vertices are reused while they're still in the cache (Forsyth's algorithm)
+	static void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+	//Reorders clusters of triangles so the outward facing ones draw first, cutting overdraw
+	//*Only keeps the new order if the ACMR stays within threshold times what it was
+	static void OptimizeOverdraw(MeshData& data, float threshold = 1.05f);
+	//Reorders vertices into the order the indices first use them, so fetches stay close together
+	//*Vertices no triangle uses are dropped
+	static void OptimizeVertexFetch(MeshData& data);
+
+	//Simulates a FIFO vertex cache over the indices
+	static VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize = 16);
+};
@@ -0,0 +1,396 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+#include "Utilities/MeshOptimizer.h"
+#include "Utilities/ThreadPool.h"
+#include "Utilities/Util.h"
+
+namespace
+{
+	//How much harder open edges are to move than the surface, so holes and outlines keep their shape
+	const float BOUNDARY_WEIGHT = 10.0f;
+	//Collapses that turn a triangle further than this (cosine of the angle) are thrown out, they fold the surface over
+	const float MIN_NORMAL_DOT = 0.25f;
+	//Levels that keep more than this fraction of the last level's triangles aren't worth the memory
+	const float MIN_LOD_REDUCTION = 0.8f;
+
+	//Sum of squared distances to a set of planes, stored as the upper half of a symmetric 4x4 matrix
+	struct Quadric
+	{
+		double _a00 = 0.0, _a01 = 0.0, _a02 = 0.0, _a03 = 0.0;
+		double _a11 = 0.0, _a12 = 0.0, _a13 = 0.0;
+		double _a22 = 0.0, _a23 = 0.0;
+		double _a33 = 0.0;
+		//Total weight of the planes, so errors can be brought back to a squared distance
+		double _weight = 0.0;
+
+		void AddPlane(const glm::vec3& normal, float distance, float weight)
+		{
+			double a = normal.x, b = normal.y, c = normal.z, d = distance, w = weight;
+			_a00 += w * a * a; _a01 += w * a * b; _a02 += w * a * c; _a03 += w * a * d;
+			_a11 += w * b * b; _a12 += w * b * c; _a13 += w * b * d;
+			_a22 += w * c * c; _a23 += w * c * d;
+			_a33 += w * d * d;
+			_weight += w;
+		}
+
+		void Add(const Quadric& other)
+		{
+			_a00 += other._a00; _a01 += other._a01; _a02 += other._a02; _a03 += other._a03;
+			_a11 += other._a11; _a12 += other._a12; _a13 += other._a13;
+			_a22 += other._a22; _a23 += other._a23;
+			_a33 += other._a33;
+			_weight += other._weight;
+		}
+
+		//Weighted sum of squared distances from the point to every plane
+		double Evaluate(const glm::vec3& point) const
+		{
+			double x = point.x, y = point.y, z = point.z;
+			return _a00 * x * x + 2.0 * _a01 * x * y + 2.0 * _a02 * x * z + 2.0 * _a03 * x +
+				_a11 * y * y + 2.0 * _a12 * y * z + 2.0 * _a13 * y +
+				_a22 * z * z + 2.0 * _a23 * z +
+				_a33;
+		}
+	};
+
+	//Moving one position onto a neighbour
+	struct Collapse
+	{
+		uint32_t _from;
+		uint32_t _to;
+		//Squared distance the surface moves
+		double _cost;
+	};
+
+	//Hashes a position by its bytes, for welding vertices that only differ in their other attributes
+	struct PositionHash
+	{
+		size_t operator()(const glm::vec3& position) const
+		{
+			return size_t(Util::HashBytes(&position, sizeof(position)));
+		}
+	};
+
+	struct PositionEqual
+	{
+		bool operator()(const glm::vec3& a, const glm::vec3& b) const
+		{
+			return std::memcmp(&a, &b, sizeof(glm::vec3)) == 0;
+		}
+	};
+
+	uint64_t EdgeKey(uint32_t from, uint32_t to)
+	{
+		return (uint64_t(from) << 32) | to;
+	}
+
+	double CollapseCost(const std::vector<Quadric>& quadrics, const std::vector<glm::vec3>& positions, uint32_t from, uint32_t to)
+	{
+		const Quadric& a = quadrics[from];
+		const Quadric& b = quadrics[to];
+		double weight = a._weight + b._weight;
+		double error = a.Evaluate(positions[to]) + b.Evaluate(positions[to]);
+		return weight > 0.0 ? std::max(error / weight, 0.0) : 0.0;
+	}
+
+	//Checks if moving from onto to would flip (or squash) any of the triangles around from
+	bool CollapseFlips(const std::vector<uint32_t>& triangles, const uint32_t* around, uint32_t aroundCount,
+		const std::vector<glm::vec3>& positions, uint32_t from, uint32_t to)
+	{
+		for (uint32_t i = 0; i < aroundCount; i++)
+		{
+			const uint32_t* triangle = &triangles[size_t(around[i]) * 3];
+
+			//This one collapses away entirely
+			if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+				continue;
+
+			glm::vec3 corners[3] = { positions[triangle[0]], positions[triangle[1]], positions[triangle[2]] };
+			glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+			for (int k = 0; k < 3; k++)
+			{
+				if (triangle[k] == from)
+					corners[k] = positions[to];
+			}
+			glm::vec3 after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+
+			if (glm::dot(before, after) <= MIN_NORMAL_DOT * glm::length(before) * glm::length(after))
+				return true;
+		}
+
+		return false;
+	}
+}
+
+float MeshSimplifier::Simplify(const MeshData& source, size_t targetIndexCount, float maxError, MeshData& result)
+{
+	//Weld vertices by position, so seams (where normals or UVs split) collapse as one
+	std::unordered_map<glm::vec3, uint32_t, PositionHash, PositionEqual> lookup;
+	lookup.reserve(source._vertices.size());
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> vertexPositions(source._vertices.size());
+	for (size_t v = 0; v < source._vertices.size(); v++)
+	{
+		auto inserted = lookup.emplace(source._vertices[v].Position, uint32_t(positions.size()));
+		if (inserted.second)
+			positions.push_back(source._vertices[v].Position);
+		vertexPositions[v] = inserted.first->second;
+	}
+	size_t positionCount = positions.size();
+
+	//Triangles by position, alongside the source vertices at their corners
+	std::vector<uint32_t> triangles;
+	std::vector<uint32_t> corners;
+	triangles.reserve(source._indices.size());
+	corners.reserve(source._indices.size());
+	for (size_t i = 0; i + 2 < source._indices.size(); i += 3)
+	{
+		uint32_t a = vertexPositions[source._indices[i]];
+		uint32_t b = vertexPositions[source._indices[i + 1]];
+		uint32_t c = vertexPositions[source._indices[i + 2]];
+		if (a == b || b == c || a == c)
+			continue;
+
+		triangles.insert(triangles.end(), { a, b, c });
+		corners.insert(corners.end(), source._indices.begin() + i, source._indices.begin() + i + 3);
+	}
+
+	//Errors are given relative to the radius, so they mean the same thing for any size of mesh
+	glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+	for (const glm::vec3& position : positions)
+	{
+		boundsMin = glm::min(boundsMin, position);
+		boundsMax = glm::max(boundsMax, position);
+	}
+	float radius = positions.empty() ? 0.0f : glm::length(boundsMax - boundsMin) * 0.5f;
+	if (radius <= 0.0f)
+		radius = 1.0f;
+	double errorLimit = double(maxError) * double(radius);
+	errorLimit *= errorLimit;
+
+	//Each position starts with the planes of the triangles around it, weighted by their area
+	std::vector<Quadric> quadrics(positionCount);
+	std::unordered_map<uint64_t, uint32_t> edges;
+	edges.reserve(triangles.size());
+	for (size_t t = 0; t < triangles.size(); t += 3)
+	{
+		const glm::vec3& a = positions[triangles[t]];
+		glm::vec3 normal = glm::cross(positions[triangles[t + 1]] - a, positions[triangles[t + 2]] - a);
+		float area = glm::length(normal);
+		if (area > 0.0f)
+		{
+			normal /= area;
+			for (int k = 0; k < 3; k++)
+				quadrics[triangles[t + k]].AddPlane(normal, -glm::dot(normal, a), area);
+		}
+
+		for (int k = 0; k < 3; k++)
+			edges[EdgeKey(triangles[t + k], triangles[t + (k + 1) % 3])]++;
+	}
+
+	//Open edges (no triangle going the other way) also get a plane standing up along them
+	for (size_t t = 0; t < triangles.size(); t += 3)
+	{
+		const glm::vec3& a = positions[triangles[t]];
+		glm::vec3 faceNormal = glm::cross(positions[triangles[t + 1]] - a, positions[triangles[t + 2]] - a);
+		for (int k = 0; k < 3; k++)
+		{
+			uint32_t from = triangles[t + k];
+			uint32_t to = triangles[t + (k + 1) % 3];
+			if (edges.find(EdgeKey(to, from)) != edges.end())
+				continue;
+
+			glm::vec3 edge = positions[to] - positions[from];
+			glm::vec3 normal = glm::cross(edge, faceNormal);
+			float length = glm::length(normal);
+			if (length <= 0.0f)
+				continue;
+
+			normal /= length;
+			float weight = glm::dot(edge, edge) * BOUNDARY_WEIGHT;
+			quadrics[from].AddPlane(normal, -glm::dot(normal, positions[from]), weight);
+			quadrics[to].AddPlane(normal, -glm::dot(normal, positions[from]), weight);
+		}
+	}
+
+	//Collapse in passes, cheapest edges first, each position only takes part in one collapse a pass
+	std::vector<uint32_t> remap(positionCount);
+	std::vector<uint8_t> locked(positionCount);
+	std::vector<uint32_t> offsets(positionCount + 1);
+	std::vector<uint32_t> adjacency;
+	std::vector<Collapse> collapses;
+	size_t targetTriangles = targetIndexCount / 3;
+	double worstError = 0.0;
+
+	while (triangles.size() / 3 > targetTriangles)
+	{
+		size_t triangleCount = triangles.size() / 3;
+
+		//Triangles around each position
+		std::fill(offsets.begin(), offsets.end(), 0);
+		for (uint32_t id : triangles)
+			offsets[id + 1]++;
+		for (size_t p = 0; p < positionCount; p++)
+			offsets[p + 1] += offsets[p];
+		adjacency.resize(triangles.size());
+		{
+			std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < triangles.size(); i++)
+				adjacency[fill[triangles[i]]++] = uint32_t(i / 3);
+		}
+
+		//Every edge goes whichever way costs less (shared edges show up twice, the second one just gets skipped)
+		collapses.clear();
+		collapses.reserve(triangles.size());
+		for (size_t i = 0; i < triangles.size(); i++)
+		{
+			uint32_t a = triangles[i];
+			uint32_t b = triangles[i - i % 3 + (i + 1) % 3];
+			double forward = CollapseCost(quadrics, positions, a, b);
+			double backward = CollapseCost(quadrics, positions, b, a);
+			collapses.push_back(forward <= backward ? Collapse{ a, b, forward } : Collapse{ b, a, backward });
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r) { return l._cost < r._cost; });
+
+		//Each collapse takes out about two triangles
+		size_t needed = std::max<size_t>((triangleCount - targetTriangles) / 2, 1);
+		size_t done = 0;
+		std::iota(remap.begin(), remap.end(), 0u);
+		std::fill(locked.begin(), locked.end(), 0);
+		for (const Collapse& collapse : collapses)
+		{
+			if (done >= needed || collapse._cost > errorLimit)
+				break;
+			if (locked[collapse._from] || locked[collapse._to])
+				continue;
+
+			const uint32_t* around = &adjacency[offsets[collapse._from]];
+			uint32_t aroundCount = offsets[collapse._from + 1] - offsets[collapse._from];
+			if (CollapseFlips(triangles, around, aroundCount, positions, collapse._from, collapse._to))
+				continue;
+
+			remap[collapse._from] = collapse._to;
+			quadrics[collapse._to].Add(quadrics[collapse._from]);
+			worstError = std::max(worstError, collapse._cost);
+			done++;
+
+			//Everything around it changes shape, so it sits out the rest of the pass
+			for (uint32_t i = 0; i < aroundCount; i++)
+			{
+				for (int k = 0; k < 3; k++)
+					locked[triangles[size_t(around[i]) * 3 + k]] = 1;
+			}
+		}
+
+		//Nothing left that's cheap enough and doesn't fold the mesh
+		if (done == 0)
+			break;
+
+		//Point the triangles at where their positions went and drop the ones that collapsed
+		size_t kept = 0;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			uint32_t a = remap[triangles[t * 3]];
+			uint32_t b = remap[triangles[t * 3 + 1]];
+			uint32_t c = remap[triangles[t * 3 + 2]];
+			if (a == b || b == c || a == c)
+				continue;
+
+			triangles[kept * 3] = a;
+			triangles[kept * 3 + 1] = b;
+			triangles[kept * 3 + 2] = c;
+			std::copy(corners.begin() + t * 3, corners.begin() + t * 3 + 3, corners.begin() + kept * 3);
+			kept++;
+		}
+		triangles.resize(kept * 3);
+		corners.resize(kept * 3);
+	}
+
+	//Vertices at each position, corners that moved take the attributes of the closest match where they landed
+	std::vector<uint32_t> positionOffsets(positionCount + 1, 0);
+	for (uint32_t id : vertexPositions)
+		positionOffsets[id + 1]++;
+	for (size_t p = 0; p < positionCount; p++)
+		positionOffsets[p + 1] += positionOffsets[p];
+	std::vector<uint32_t> positionVertices(source._vertices.size());
+	{
+		std::vector<uint32_t> fill(positionOffsets.begin(), positionOffsets.end() - 1);
+		for (size_t v = 0; v < source._vertices.size(); v++)
+			positionVertices[fill[vertexPositions[v]]++] = uint32_t(v);
+	}
+
+	const uint32_t UNCHOSEN = ~0u;
+	std::vector<uint32_t> chosen(source._vertices.size(), UNCHOSEN);
+	result._vertices = source._vertices;
+	result._indices.resize(corners.size());
+	for (size_t i = 0; i < corners.size(); i++)
+	{
+		uint32_t vertex = corners[i];
+		uint32_t position = triangles[i];
+		if (vertexPositions[vertex] == position)
+		{
+			result._indices[i] = vertex;
+			continue;
+		}
+
+		//Every corner of a vertex lands on the same position, so it only has to be picked once
+		if (chosen[vertex] == UNCHOSEN)
+		{
+			const VertexPosNormTexCol& original = source._vertices[vertex];
+			float bestScore = -FLT_MAX;
+			for (uint32_t j = positionOffsets[position]; j < positionOffsets[position + 1]; j++)
+			{
+				const VertexPosNormTexCol& candidate = source._vertices[positionVertices[j]];
+				float score = glm::dot(original.Normal, candidate.Normal) - glm::length(original.UV - candidate.UV);
+				if (score > bestScore)
+				{
+					bestScore = score;
+					chosen[vertex] = positionVertices[j];
+				}
+			}
+		}
+		result._indices[i] = chosen[vertex];
+	}
+
+	MeshOptimizer::OptimizeVertexCache(result._indices, result._vertices.size());
+	MeshOptimizer::OptimizeVertexFetch(result);
+	result.CalculateBounds();
+
+	return float(std::sqrt(worstError)) / radius;
+}
+
+void MeshSimplifier::BuildLODChain(const MeshData& source, std::vector<MeshData>& levels, std::vector<float>& errors, int maxLevels, float maxError)
+{
+	levels.clear();
+	errors.clear();
+	levels.push_back(source);
+	errors.push_back(0.0f);
+	if (maxLevels < 2)
+		return;
+
+	//Every level is simplified from the source (not the level before) so errors don't stack, which lets them all build at once
+	size_t count = size_t(maxLevels - 1);
+	std::vector<MeshData> simplified(count);
+	std::vector<float> simplifiedErrors(count, 0.0f);
+	ThreadPool::ParallelFor(count, [&](size_t i) {
+		size_t target = (source._indices.size() >> (i + 1)) / 3 * 3;
+		simplifiedErrors[i] = Simplify(source, target, maxError, simplified[i]);
+	});
+
+	for (size_t i = 0; i < count; i++)
+	{
+		//Not enough fewer triangles to be worth keeping, the mesh can't go much further
+		if (simplified[i]._indices.empty() || float(simplified[i]._indices.size()) > float(levels.back()._indices.size()) * MIN_LOD_REDUCTION)
+			break;
+
+		levels.push_back(std::move(simplified[i]));
+		errors.push_back(std::max(simplifiedErrors[i], errors.back()));
+	}
+}
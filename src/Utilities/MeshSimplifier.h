@@ -0,0 +1,22 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include "Utilities/MeshCache.h"
+
+//Builds lower detail versions of meshes with quadric error edge collapses (Garland and Heckbert)
+//*Vertices only ever collapse onto one of their neighbours, so the result is a subset of the source's vertices
+//*Everything here is CPU only, so it can run on worker threads while meshes bake
+class MeshSimplifier abstract
+{
+public:
+	//Simplifies a mesh down towards targetIndexCount indices
+	//*Stops early if the next collapse would move the surface further than maxError (relative to the mesh's radius)
+	//*Returns how far the surface moved, relative to the mesh's radius
+	static float Simplify(const MeshData& source, size_t targetIndexCount, float maxError, MeshData& result);
+
+	//Builds a LOD chain for a mesh, each level has about half the triangles of the one before
+	//*levels[0] is the source itself with an error of 0
+	//*Stops early once a level can't be simplified much further without going over maxError
+	static void BuildLODChain(const MeshData& source, std::vector<MeshData>& levels, std::vector<float>& errors, int maxLevels = 4, float maxError = 0.25f);
+};
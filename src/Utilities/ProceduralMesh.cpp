@@ -0,0 +1,373 @@
+#include "ProceduralMesh.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+#include <GLM/gtc/constants.hpp>
+#include <GLM/gtc/matrix_transform.hpp>
+#include <GLM/gtc/quaternion.hpp>
+#include <Logging.h>
+
+#include "Utilities/MappedFile.h"
+#include "Utilities/ThreadPool.h"
+#include "Utilities/Util.h"
+
+std::unordered_map<uint64_t, std::shared_ptr<const MeshData>> ProceduralMesh::_primitives;
+std::mutex ProceduralMesh::_mutex;
+
+namespace
+{
+	//Past these the meshes get silly (an icosphere at 6 is already 80k triangles)
+	const int MAX_ICO_TESSELLATION = 6;
+	const int MAX_UV_TESSELLATION = 8;
+
+	uint64_t PrimitiveKey(PrimitiveType type, int tessellation)
+	{
+		return (uint64_t(type) << 32) | uint32_t(tessellation);
+	}
+
+	//Reads the word at the cursor (up to the next blank)
+	std::string ReadWord(const char*& cursor, const char* end)
+	{
+		cursor = Util::SkipBlank(cursor, end);
+		const char* start = cursor;
+		while (cursor < end && *cursor != ' ' && *cursor != '\t' && *cursor != '\r' && *cursor != '\n')
+			cursor++;
+		return std::string(start, cursor);
+	}
+
+	bool ReadFloats(const char*& cursor, const char* end, float* values, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			if (!Util::ReadFloat(cursor, end, values[i]))
+				return false;
+		}
+		return true;
+	}
+
+	void AddVertex(MeshData& data, const glm::vec3& position, const glm::vec3& normal, const glm::vec2& uv)
+	{
+		VertexPosNormTexCol vertex;
+		vertex.Position = position;
+		vertex.Normal = normal;
+		vertex.UV = uv;
+		vertex.Color = glm::vec4(1.0f);
+		data._vertices.push_back(vertex);
+	}
+
+	//Adds a quad from its centre and the half extents along each side
+	void AddQuad(MeshData& data, const glm::vec3& centre, const glm::vec3& right, const glm::vec3& up)
+	{
+		uint32_t first = uint32_t(data._vertices.size());
+		glm::vec3 normal = glm::normalize(glm::cross(right, up));
+		AddVertex(data, centre - right - up, normal, glm::vec2(0.0f, 0.0f));
+		AddVertex(data, centre + right - up, normal, glm::vec2(1.0f, 0.0f));
+		AddVertex(data, centre + right + up, normal, glm::vec2(1.0f, 1.0f));
+		AddVertex(data, centre - right + up, normal, glm::vec2(0.0f, 1.0f));
+		data._indices.insert(data._indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+	}
+
+	//Wraps a unit direction onto the sphere's UVs (Z is up)
+	glm::vec2 SphereUV(const glm::vec3& direction)
+	{
+		return glm::vec2(0.5f + atan2f(direction.y, direction.x) / glm::two_pi<float>(),
+			0.5f + asinf(glm::clamp(direction.z, -1.0f, 1.0f)) / glm::pi<float>());
+	}
+
+	void GenerateIcoSphere(int tessellation, MeshData& data)
+	{
+		const float t = (1.0f + sqrtf(5.0f)) / 2.0f;
+		std::vector<glm::vec3> positions = {
+			{ -1, t, 0 }, { 1, t, 0 }, { -1, -t, 0 }, { 1, -t, 0 },
+			{ 0, -1, t }, { 0, 1, t }, { 0, -1, -t }, { 0, 1, -t },
+			{ t, 0, -1 }, { t, 0, 1 }, { -t, 0, -1 }, { -t, 0, 1 }
+		};
+		std::vector<uint32_t> indices = {
+			0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11,
+			1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+			3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9,
+			4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1
+		};
+		for (glm::vec3& position : positions)
+			position = glm::normalize(position);
+
+		//Split every triangle into four, sharing the new midpoints between neighbours
+		for (int level = 0; level < tessellation; level++)
+		{
+			std::map<std::pair<uint32_t, uint32_t>, uint32_t> midpoints;
+			auto midpoint = [&](uint32_t a, uint32_t b) {
+				std::pair<uint32_t, uint32_t> edge(std::min(a, b), std::max(a, b));
+				auto found = midpoints.find(edge);
+				if (found != midpoints.end())
+					return found->second;
+				positions.push_back(glm::normalize(positions[a] + positions[b]));
+				uint32_t index = uint32_t(positions.size() - 1);
+				midpoints[edge] = index;
+				return index;
+			};
+
+			std::vector<uint32_t> split;
+			split.reserve(indices.size() * 4);
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+				uint32_t ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+				split.insert(split.end(), { a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca });
+			}
+			indices.swap(split);
+		}
+
+		data._vertices.reserve(positions.size());
+		for (const glm::vec3& position : positions)
+			AddVertex(data, position, position, SphereUV(position));
+		data._indices = std::move(indices);
+	}
+
+	void GenerateUvSphere(int tessellation, MeshData& data)
+	{
+		uint32_t slices = 4u << tessellation;
+		uint32_t stacks = std::max(slices / 2, 2u);
+
+		//Rows of vertices from the bottom pole to the top, with a repeated column at the seam for the UVs
+		for (uint32_t stack = 0; stack <= stacks; stack++)
+		{
+			float v = float(stack) / float(stacks);
+			float phi = (v - 0.5f) * glm::pi<float>();
+			for (uint32_t slice = 0; slice <= slices; slice++)
+			{
+				float u = float(slice) / float(slices);
+				float theta = u * glm::two_pi<float>();
+				glm::vec3 direction(cosf(phi) * cosf(theta), cosf(phi) * sinf(theta), sinf(phi));
+				AddVertex(data, direction, direction, glm::vec2(u, v));
+			}
+		}
+
+		for (uint32_t stack = 0; stack < stacks; stack++)
+		{
+			for (uint32_t slice = 0; slice < slices; slice++)
+			{
+				uint32_t a = stack * (slices + 1) + slice;
+				uint32_t b = a + slices + 1;
+				data._indices.insert(data._indices.end(), { a, a + 1, b + 1, a, b + 1, b });
+			}
+		}
+	}
+}
+
+bool ProceduralMesh::BuildNotObj(const std::string& fileName, MeshData& data)
+{
+	std::vector<PrimitiveInstance> instances;
+	if (!ParseNotObj(fileName, instances))
+		return false;
+
+	BuildInstances(instances, data);
+	return true;
+}
+
+bool ProceduralMesh::ParseNotObj(const std::string& fileName, std::vector<PrimitiveInstance>& instances)
+{
+	MappedFile file;
+	if (!file.Open(fileName))
+		return false;
+
+	const char* cursor = reinterpret_cast<const char*>(file.GetData());
+	const char* end = cursor + file.GetSize();
+
+	instances.clear();
+	int lineNumber = 0;
+	while (cursor < end)
+	{
+		lineNumber++;
+		cursor = Util::SkipBlank(cursor, end);
+		if (cursor >= end || *cursor == '#' || *cursor == '\r' || *cursor == '\n')
+		{
+			cursor = Util::SkipLine(cursor, end);
+			continue;
+		}
+
+		std::string keyword = ReadWord(cursor, end);
+		PrimitiveInstance instance;
+		bool valid = true;
+
+		if (keyword == "plane")
+		{
+			//position, normal, tangent, size, colour
+			float values[14];
+			valid = ReadFloats(cursor, end, values, 14);
+			if (valid)
+			{
+				glm::vec3 normal = glm::normalize(glm::vec3(values[3], values[4], values[5]));
+				glm::vec3 tangent = glm::vec3(values[6], values[7], values[8]);
+				tangent = glm::normalize(tangent - normal * glm::dot(normal, tangent));
+				glm::vec3 bitangent = glm::cross(normal, tangent);
+
+				instance._type = PrimitiveType::Plane;
+				instance._transform = glm::mat4(glm::vec4(tangent * values[9], 0.0f), glm::vec4(bitangent * values[10], 0.0f),
+					glm::vec4(normal, 0.0f), glm::vec4(values[0], values[1], values[2], 1.0f));
+				instance._color = glm::vec4(values[11], values[12], values[13], 1.0f);
+			}
+		}
+		else if (keyword == "cube")
+		{
+			//position, scale, rotation (degrees), colour
+			float values[12];
+			valid = ReadFloats(cursor, end, values, 12);
+			if (valid)
+			{
+				glm::quat rotation = glm::quat(glm::radians(glm::vec3(values[6], values[7], values[8])));
+				instance._type = PrimitiveType::Cube;
+				instance._transform = glm::translate(glm::mat4(1.0f), glm::vec3(values[0], values[1], values[2])) *
+					glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), glm::vec3(values[3], values[4], values[5]));
+				instance._color = glm::vec4(values[9], values[10], values[11], 1.0f);
+			}
+		}
+		else if (keyword == "sphere")
+		{
+			//ico or uv, tessellation, position, radius on each axis, colour
+			std::string kind = ReadWord(cursor, end);
+			float values[9];
+			cursor = Util::SkipBlank(cursor, end);
+			valid = (kind == "ico" || kind == "uv") && Util::ReadInt(cursor, end, instance._tessellation) &&
+				ReadFloats(cursor, end, values, 9);
+			if (valid)
+			{
+				instance._type = kind == "ico" ? PrimitiveType::IcoSphere : PrimitiveType::UvSphere;
+				instance._transform = glm::translate(glm::mat4(1.0f), glm::vec3(values[0], values[1], values[2])) *
+					glm::scale(glm::mat4(1.0f), glm::vec3(values[3], values[4], values[5]));
+				instance._color = glm::vec4(values[6], values[7], values[8], 1.0f);
+			}
+		}
+		else
+		{
+			LOG_WARN("Unknown primitive \"{}\" on line {} of \"{}\"", keyword, lineNumber, fileName);
+			valid = false;
+		}
+
+		if (valid)
+			instances.push_back(instance);
+		else
+			LOG_WARN("Skipping bad line {} of \"{}\"", lineNumber, fileName);
+
+		cursor = Util::SkipLine(cursor, end);
+	}
+
+	return true;
+}
+
+void ProceduralMesh::BuildInstances(const std::vector<PrimitiveInstance>& instances, MeshData& data)
+{
+	//Generate each distinct primitive once, in parallel
+	std::vector<uint64_t> keys;
+	std::unordered_map<uint64_t, size_t> keyIndex;
+	for (const PrimitiveInstance& instance : instances)
+	{
+		uint64_t key = PrimitiveKey(instance._type, instance._tessellation);
+		if (keyIndex.emplace(key, keys.size()).second)
+			keys.push_back(key);
+	}
+
+	std::vector<std::shared_ptr<const MeshData>> primitives(keys.size());
+	ThreadPool::ParallelFor(keys.size(), [&](size_t i) {
+		primitives[i] = GetPrimitive(PrimitiveType(keys[i] >> 32), int(uint32_t(keys[i])));
+	});
+
+	//Work out where each instance lands so they can all be written at once
+	std::vector<const MeshData*> sources(instances.size());
+	std::vector<size_t> vertexOffsets(instances.size() + 1, 0);
+	std::vector<size_t> indexOffsets(instances.size() + 1, 0);
+	for (size_t i = 0; i < instances.size(); i++)
+	{
+		sources[i] = primitives[keyIndex[PrimitiveKey(instances[i]._type, instances[i]._tessellation)]].get();
+		vertexOffsets[i + 1] = vertexOffsets[i] + sources[i]->_vertices.size();
+		indexOffsets[i + 1] = indexOffsets[i] + sources[i]->_indices.size();
+	}
+
+	data._vertices.resize(vertexOffsets.back());
+	data._indices.resize(indexOffsets.back());
+
+	ThreadPool::ParallelFor(instances.size(), [&](size_t i) {
+		const PrimitiveInstance& instance = instances[i];
+		const MeshData& source = *sources[i];
+		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(instance._transform)));
+
+		VertexPosNormTexCol* vertices = data._vertices.data() + vertexOffsets[i];
+		for (size_t v = 0; v < source._vertices.size(); v++)
+		{
+			vertices[v] = source._vertices[v];
+			vertices[v].Position = glm::vec3(instance._transform * glm::vec4(source._vertices[v].Position, 1.0f));
+			vertices[v].Normal = glm::normalize(normalMatrix * source._vertices[v].Normal);
+			vertices[v].Color = instance._color;
+		}
+
+		uint32_t base = uint32_t(vertexOffsets[i]);
+		uint32_t* indices = data._indices.data() + indexOffsets[i];
+		for (size_t n = 0; n < source._indices.size(); n++)
+		{
+			indices[n] = source._indices[n] + base;
+		}
+	});
+
+	data.CalculateBounds();
+}
+
+std::shared_ptr<const MeshData> ProceduralMesh::GetPrimitive(PrimitiveType type, int tessellation)
+{
+	uint64_t key = PrimitiveKey(type, tessellation);
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto found = _primitives.find(key);
+		if (found != _primitives.end())
+			return found->second;
+	}
+
+	//Built outside the lock so different primitives can be generated at the same time
+	std::shared_ptr<MeshData> primitive = std::make_shared<MeshData>();
+	GeneratePrimitive(type, tessellation, *primitive);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	//If someone beat us to it keep theirs, they're identical
+	return _primitives.emplace(key, primitive).first->second;
+}
+
+void ProceduralMesh::GeneratePrimitive(PrimitiveType type, int tessellation, MeshData& data)
+{
+	data._vertices.clear();
+	data._indices.clear();
+
+	switch (type)
+	{
+	case PrimitiveType::Plane:
+		AddQuad(data, glm::vec3(0.0f), glm::vec3(0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.5f, 0.0f));
+		break;
+	case PrimitiveType::Cube:
+		AddQuad(data, glm::vec3(0.0f, 0.0f, 0.5f), glm::vec3(0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.5f, 0.0f));
+		AddQuad(data, glm::vec3(0.0f, 0.0f, -0.5f), glm::vec3(-0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.5f, 0.0f));
+		AddQuad(data, glm::vec3(0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(0.0f, 0.0f, 0.5f));
+		AddQuad(data, glm::vec3(-0.5f, 0.0f, 0.0f), glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(0.0f, 0.0f, 0.5f));
+		AddQuad(data, glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(-0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.5f));
+		AddQuad(data, glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.5f));
+		break;
+	case PrimitiveType::IcoSphere:
+		GenerateIcoSphere(glm::clamp(tessellation, 0, MAX_ICO_TESSELLATION), data);
+		break;
+	case PrimitiveType::UvSphere:
+		GenerateUvSphere(glm::clamp(tessellation, 0, MAX_UV_TESSELLATION), data);
+		break;
+	}
+
+	data.CalculateBounds();
+}
+
+void ProceduralMesh::InvertFaces(MeshData& data)
+{
+	for (size_t i = 0; i + 2 < data._indices.size(); i += 3)
+	{
+		std::swap(data._indices[i + 1], data._indices[i + 2]);
+	}
+	for (VertexPosNormTexCol& vertex : data._vertices)
+	{
+		vertex.Normal = -vertex.Normal;
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+
+#include "Utilities/MeshCache.h"
+
+//Primitives a NotObj file can describe
+enum class PrimitiveType
+{
+	Plane,
+	Cube,
+	IcoSphere,
+	UvSphere
+};
+
+//One primitive out of a NotObj file, a unit primitive moved into place
+struct PrimitiveInstance
+{
+	PrimitiveType _type = PrimitiveType::Cube;
+	int _tessellation = 0;
+	glm::mat4 _transform = glm::mat4(1.0f);
+	glm::vec4 _color = glm::vec4(1.0f);
+};
+
+//Builds meshes out of primitives (NotObj files and the like) without going through MeshBuilder,
+//so they can be generated on worker threads and baked by MeshCache
+class ProceduralMesh abstract
+{
+public:
+	//Builds the mesh a NotObj file describes, merged into one mesh
+	//*Each distinct primitive/tessellation is only generated once, then copied into place for every instance
+	//*Generating and placing both run on the thread pool
+	static bool BuildNotObj(const std::string& fileName, MeshData& data);
+	//Parses a NotObj file into its primitives, returns false if the file can't be read
+	static bool ParseNotObj(const std::string& fileName, std::vector<PrimitiveInstance>& instances);
+	//Merges every instance into one mesh
+	static void BuildInstances(const std::vector<PrimitiveInstance>& instances, MeshData& data);
+
+	//Gets a unit primitive (centred on the origin and white), each one is only generated once
+	//*Planes are 1x1 facing +Z, cubes are 1x1x1 and spheres have a radius of 1
+	//*Icospheres are subdivided tessellation times, UV spheres have 4 << tessellation slices
+	static std::shared_ptr<const MeshData> GetPrimitive(PrimitiveType type, int tessellation);
+	//Generates a unit primitive
+	static void GeneratePrimitive(PrimitiveType type, int tessellation, MeshData& data);
+
+	//Flips the winding and normals of a mesh, so it can be seen from the inside (skyboxes)
+	static void InvertFaces(MeshData& data);
+
+private:
+	static std::unordered_map<uint64_t, std::shared_ptr<const MeshData>> _primitives;
+	static std::mutex _mutex;
+};
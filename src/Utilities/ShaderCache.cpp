@@ -0,0 +1,340 @@
+#include "ShaderCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <Logging.h>
+
+#include "Utilities/MappedFile.h"
+#include "Utilities/Util.h"
+
+std::string ShaderCache::_cacheDirectory = "cache/shaders";
+bool ShaderCache::_cacheEnabled = true;
+int ShaderCache::_hits = 0;
+int ShaderCache::_misses = 0;
+
+namespace
+{
+	//Every cached program starts with these
+	const char SHADER_CACHE_MAGIC[4] = { 'S', 'H', 'P', 'C' };
+	//Bump this whenever the layout of a cached program changes
+	const uint32_t SHADER_CACHE_VERSION = 1;
+
+	bool ReadSource(const std::string& fileName, std::string& source)
+	{
+		std::ifstream stream(fileName, std::ios::binary);
+		if (!stream)
+			return false;
+
+		std::stringstream contents;
+		contents << stream.rdbuf();
+		source = contents.str();
+		return true;
+	}
+
+	//Compiles one stage and links it into a separable program, logging why if it fails
+	bool CompileSeparable(GLuint program, const ShaderStage& stage, const std::string& source)
+	{
+		GLuint part = glCreateShader(stage._type);
+		const char* text = source.c_str();
+		glShaderSource(part, 1, &text, nullptr);
+		glCompileShader(part);
+
+		GLint status = GL_FALSE;
+		glGetShaderiv(part, GL_COMPILE_STATUS, &status);
+		if (status != GL_TRUE)
+		{
+			GLchar log[1024];
+			glGetShaderInfoLog(part, sizeof(log), nullptr, log);
+			LOG_ERROR("Failed to compile \"{}\":\n{}", stage._fileName, log);
+			glDeleteShader(part);
+			return false;
+		}
+
+		glAttachShader(program, part);
+		glLinkProgram(program);
+		glDetachShader(program, part);
+		glDeleteShader(part);
+
+		glGetProgramiv(program, GL_LINK_STATUS, &status);
+		if (status != GL_TRUE)
+		{
+			GLchar log[1024];
+			glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+			LOG_ERROR("Failed to link \"{}\":\n{}", stage._fileName, log);
+			return false;
+		}
+
+		return true;
+	}
+
+	void HashString(const char* string, uint64_t& hash)
+	{
+		//Some drivers return null for strings they don't have
+		if (string != nullptr)
+			hash = Util::HashBytes(string, std::strlen(string), hash);
+	}
+}
+
+Shader::sptr ShaderCache::Load(const std::vector<ShaderStage>& stages)
+{
+	return LoadProgram(stages, false);
+}
+
+Shader::sptr ShaderCache::Load(const std::string& vertexFile, const std::string& fragmentFile)
+{
+	return Load({ { vertexFile, GL_VERTEX_SHADER }, { fragmentFile, GL_FRAGMENT_SHADER } });
+}
+
+Shader::sptr ShaderCache::LoadSeparable(const ShaderStage& stage)
+{
+	return LoadProgram({ stage }, true);
+}
+
+Shader::sptr ShaderCache::LoadSeparableSource(const ShaderStage& stage, const std::string& source)
+{
+	return LoadProgram({ stage }, { source }, true);
+}
+
+std::string ShaderCache::InsertDefines(const std::string& source, const std::string& defines)
+{
+	std::string result = source;
+	size_t version = result.find("#version");
+	size_t lineEnd = version == std::string::npos ? std::string::npos : result.find('\n', version);
+	if (version == std::string::npos)
+		result.insert(0, defines);
+	else if (lineEnd == std::string::npos)
+		result += "\n" + defines;
+	else
+		result.insert(lineEnd + 1, defines);
+	return result;
+}
+
+uint64_t ShaderCache::GetKey(const std::vector<ShaderStage>& stages, const std::vector<std::string>& sources, bool separable)
+{
+	uint64_t key = GetDriverHash();
+	key = Util::HashBytes(&separable, sizeof(separable), key);
+	for (size_t i = 0; i < stages.size(); i++)
+	{
+		key = Util::HashBytes(&stages[i]._type, sizeof(stages[i]._type), key);
+		key = Util::HashBytes(sources[i].data(), sources[i].size(), key);
+	}
+	return key;
+}
+
+Shader::sptr ShaderCache::LoadProgram(const std::vector<ShaderStage>& stages, bool separable)
+{
+	std::vector<std::string> sources(stages.size());
+	for (size_t i = 0; i < stages.size(); i++)
+	{
+		if (!ReadSource(stages[i]._fileName, sources[i]))
+		{
+			LOG_WARN("Could not read \"{}\" for the shader cache", stages[i]._fileName);
+			if (separable)
+				return nullptr;
+
+			//Let the shader report the missing file the way it normally does
+			Shader::sptr shader = Shader::Create();
+			for (const ShaderStage& stage : stages)
+				shader->LoadShaderPartFromFile(stage._fileName.c_str(), stage._type);
+			shader->Link();
+			return shader;
+		}
+	}
+
+	return LoadProgram(stages, sources, separable);
+}
+
+Shader::sptr ShaderCache::LoadProgram(const std::vector<ShaderStage>& stages, const std::vector<std::string>& sources, bool separable)
+{
+	uint64_t key = GetKey(stages, sources, separable);
+
+	if (_cacheEnabled)
+	{
+		Shader::sptr shader = Shader::Create();
+		if (LoadBinary(shader, key, separable))
+		{
+			_hits++;
+			return shader;
+		}
+	}
+
+	//A program that refused a binary is left unlinked, start from a clean one
+	_misses++;
+	Shader::sptr shader = Shader::Create();
+	GLuint handle = shader->GetHandle();
+
+	if (_cacheEnabled)
+	{
+		//Has to be set before linking for some drivers to keep the binary around
+		glProgramParameteri(handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
+	bool linked = false;
+	if (separable)
+	{
+		//Shader::Link wants a vertex and fragment stage, so separable programs are linked here
+		glProgramParameteri(handle, GL_PROGRAM_SEPARABLE, GL_TRUE);
+		linked = CompileSeparable(handle, stages[0], sources[0]);
+		if (!linked)
+			return nullptr;
+	}
+	else
+	{
+		for (size_t i = 0; i < stages.size(); i++)
+		{
+			shader->LoadShaderPart(sources[i].c_str(), stages[i]._type);
+		}
+		linked = shader->Link();
+	}
+
+	if (linked && _cacheEnabled)
+	{
+		WriteBinary(shader, key);
+	}
+
+	return shader;
+}
+
+std::string ShaderCache::GetCachePath(uint64_t key)
+{
+	std::stringstream name;
+	name << _cacheDirectory << "/" << std::hex << key << ".prog";
+	return name.str();
+}
+
+bool ShaderCache::LoadBinary(const Shader::sptr& shader, uint64_t key, bool separable)
+{
+	MappedFile file;
+	if (!file.Open(GetCachePath(key)) || file.GetSize() < sizeof(ShaderCacheHeader))
+		return false;
+
+	const ShaderCacheHeader* header = reinterpret_cast<const ShaderCacheHeader*>(file.GetData());
+	if (std::memcmp(header->_magic, SHADER_CACHE_MAGIC, sizeof(SHADER_CACHE_MAGIC)) != 0 ||
+		header->_version != SHADER_CACHE_VERSION ||
+		header->_keyHash != key ||
+		sizeof(ShaderCacheHeader) + uint64_t(header->_binaryLength) > file.GetSize())
+	{
+		return false;
+	}
+
+	GLuint handle = shader->GetHandle();
+	if (separable)
+		glProgramParameteri(handle, GL_PROGRAM_SEPARABLE, GL_TRUE);
+	glProgramBinary(handle, header->_binaryFormat, file.GetData() + sizeof(ShaderCacheHeader), GLsizei(header->_binaryLength));
+
+	//Drivers are allowed to reject binaries at any time (after an update, for example)
+	GLint linked = GL_FALSE;
+	glGetProgramiv(handle, GL_LINK_STATUS, &linked);
+	if (linked != GL_TRUE)
+	{
+		LOG_INFO("Driver rejected the cached program \"{}\", compiling from source", GetCachePath(key));
+		return false;
+	}
+
+	return true;
+}
+
+bool ShaderCache::WriteBinary(const Shader::sptr& shader, uint64_t key)
+{
+	//Some drivers don't support program binaries at all
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	if (formatCount <= 0)
+		return false;
+
+	GLuint handle = shader->GetHandle();
+	GLint length = 0;
+	glGetProgramiv(handle, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return false;
+
+	std::vector<uint8_t> binary(size_t(length));
+	GLenum format = GL_NONE;
+	GLsizei written = 0;
+	glGetProgramBinary(handle, length, &written, &format, binary.data());
+	if (written <= 0)
+		return false;
+
+	ShaderCacheHeader header;
+	std::memset(static_cast<void*>(&header), 0, sizeof(header));
+	std::memcpy(header._magic, SHADER_CACHE_MAGIC, sizeof(SHADER_CACHE_MAGIC));
+	header._version = SHADER_CACHE_VERSION;
+	header._keyHash = key;
+	header._binaryFormat = uint32_t(format);
+	header._binaryLength = uint32_t(written);
+
+	std::error_code error;
+	std::filesystem::create_directories(_cacheDirectory, error);
+
+	//Write to a temporary file first so a half written file never looks valid
+	std::string cachePath = GetCachePath(key);
+	std::stringstream tempPath;
+	tempPath << cachePath << "." << std::hash<std::thread::id>()(std::this_thread::get_id()) << ".tmp";
+
+	{
+		std::ofstream stream(tempPath.str(), std::ios::binary | std::ios::trunc);
+		if (!stream)
+		{
+			LOG_WARN("Could not write cached program \"{}\"", cachePath);
+			return false;
+		}
+
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		stream.write(reinterpret_cast<const char*>(binary.data()), written);
+
+		if (!stream)
+		{
+			stream.close();
+			std::filesystem::remove(tempPath.str(), error);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(tempPath.str(), cachePath, error);
+	if (error)
+	{
+		std::filesystem::remove(tempPath.str(), error);
+		return false;
+	}
+
+	return true;
+}
+
+uint64_t ShaderCache::GetDriverHash()
+{
+	//The driver can't change while we're running, so only ask once
+	static uint64_t driverHash = 0;
+	if (driverHash == 0)
+	{
+		uint64_t hash = Util::HashBytes(nullptr, 0);
+		HashString(reinterpret_cast<const char*>(glGetString(GL_VENDOR)), hash);
+		HashString(reinterpret_cast<const char*>(glGetString(GL_RENDERER)), hash);
+		HashString(reinterpret_cast<const char*>(glGetString(GL_VERSION)), hash);
+		driverHash = hash;
+	}
+	return driverHash;
+}
+
+void ShaderCache::SetCacheDirectory(const std::string& directory)
+{
+	_cacheDirectory = directory;
+}
+
+void ShaderCache::SetCacheEnabled(bool enabled)
+{
+	_cacheEnabled = enabled;
+}
+
+int ShaderCache::GetHitCount()
+{
+	return _hits;
+}
+
+int ShaderCache::GetMissCount()
+{
+	return _misses;
+}
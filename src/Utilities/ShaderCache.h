@@ -0,0 +1,73 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <Shader.h>
+
+//One stage of a program, the source file and what it's compiled as (GL_VERTEX_SHADER etc.)
+struct ShaderStage
+{
+	std::string _fileName;
+	GLenum _type;
+};
+
+//Header at the front of every cached program binary
+//*The driver's binary follows straight after it
+struct ShaderCacheHeader
+{
+	char _magic[4];
+	uint32_t _version;
+	uint64_t _keyHash;
+	uint32_t _binaryFormat;
+	uint32_t _binaryLength;
+};
+
+class ShaderCache abstract
+{
+public:
+	//Creates a program from its stage sources, loading the cached binary when one matches
+	//*The key is a hash of every stage's source plus the driver's vendor, renderer and version,
+	// so editing a shader or updating the driver just misses the cache
+	//*Compiles from source (and caches the result) when there's no binary or the driver rejects it
+	static Shader::sptr Load(const std::vector<ShaderStage>& stages);
+	static Shader::sptr Load(const std::string& vertexFile, const std::string& fragmentFile);
+	//Creates a separable program from a single stage, for use in a ShaderPipeline
+	//*Returns nullptr if the stage doesn't compile
+	static Shader::sptr LoadSeparable(const ShaderStage& stage);
+	//Creates a separable program from source that was generated at runtime
+	//*The stage's file name is only used in log messages, the source is what gets keyed
+	static Shader::sptr LoadSeparableSource(const ShaderStage& stage, const std::string& source);
+	//Puts defines into a source on the line after #version (which has to come before anything but comments),
+	// or at the front if there's no #version
+	static std::string InsertDefines(const std::string& source, const std::string& defines);
+
+	//Gets the key for a set of stage sources on the current driver
+	static uint64_t GetKey(const std::vector<ShaderStage>& stages, const std::vector<std::string>& sources, bool separable = false);
+	//Gets the cached binary path for a key
+	static std::string GetCachePath(uint64_t key);
+
+	//Sets where program binaries are stored (relative to the working directory)
+	static void SetCacheDirectory(const std::string& directory);
+	//Turns reading and writing program binaries on or off
+	static void SetCacheEnabled(bool enabled);
+
+	//Number of programs loaded from binaries and compiled from source since startup
+	static int GetHitCount();
+	static int GetMissCount();
+
+private:
+	static Shader::sptr LoadProgram(const std::vector<ShaderStage>& stages, bool separable);
+	static Shader::sptr LoadProgram(const std::vector<ShaderStage>& stages, const std::vector<std::string>& sources, bool separable);
+	//Loads the cached binary into the program, returns false if there isn't one or the driver won't take it
+	static bool LoadBinary(const Shader::sptr& shader, uint64_t key, bool separable);
+	//Writes the linked program's binary out for next time
+	static bool WriteBinary(const Shader::sptr& shader, uint64_t key);
+	//Hash of the driver strings, a binary is only good for the driver that made it
+	static uint64_t GetDriverHash();
+
+	static std::string _cacheDirectory;
+	static bool _cacheEnabled;
+	static int _hits;
+	static int _misses;
+};
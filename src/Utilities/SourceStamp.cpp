@@ -0,0 +1,42 @@
+#include "SourceStamp.h"
+
+#include <filesystem>
+#include <fstream>
+
+#include "Utilities/MappedFile.h"
+#include "Utilities/Util.h"
+
+bool SourceStamp::Get(const std::string& fileName, SourceStamp& stamp, bool hashContents)
+{
+	std::error_code error;
+	std::filesystem::file_time_type time = std::filesystem::last_write_time(fileName, error);
+	if (error)
+		return false;
+	uintmax_t size = std::filesystem::file_size(fileName, error);
+	if (error)
+		return false;
+
+	stamp._time = uint64_t(time.time_since_epoch().count());
+	stamp._size = uint64_t(size);
+	stamp._hash = 0;
+
+	if (hashContents)
+	{
+		MappedFile file;
+		if (!file.Open(fileName))
+			return false;
+		stamp._hash = Util::HashBytes(file.GetData(), file.GetSize());
+	}
+
+	return true;
+}
+
+bool SourceStamp::Rewrite(const std::string& bakedFile, size_t offset, const SourceStamp& stamp)
+{
+	std::fstream stream(bakedFile, std::ios::binary | std::ios::in | std::ios::out);
+	if (!stream)
+		return false;
+	stream.seekp(std::streamoff(offset));
+	stream.write(reinterpret_cast<const char*>(&stamp), sizeof(stamp));
+	return bool(stream);
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+//Identifies the version of a source file a baked file was made from
+//*Stored as is in the headers of baked meshes and LUTs, so keep it plain data
+struct SourceStamp
+{
+	uint64_t _time = 0;
+	uint64_t _size = 0;
+	uint64_t _hash = 0;
+
+	//Gets the stamp of a source file (hashing it is optional because it means reading the whole file)
+	static bool Get(const std::string& fileName, SourceStamp& stamp, bool hashContents);
+	//Overwrites the stamp stored at offset in a baked file, for when the source was touched but its contents didn't change
+	//*The baked file can't be mapped while this runs, returns false if it couldn't be written (it's just checked again next time)
+	static bool Rewrite(const std::string& bakedFile, size_t offset, const SourceStamp& stamp);
+};
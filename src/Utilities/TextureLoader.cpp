@@ -0,0 +1,78 @@
+#include "TextureLoader.h"
+
+#include <filesystem>
+
+#include <Logging.h>
+
+#include "Graphics/CompressedTexture.h"
+#include "Graphics/KTX2File.h"
+
+bool TextureLoader::Decode(const std::string& fileName, DecodedTexture& decoded)
+{
+	decoded._fileName = fileName;
+
+	//Baked blocks go straight to the GPU, no decoding needed
+	std::string bakedPath = GetBakedPath(fileName);
+	if (!bakedPath.empty())
+	{
+		std::string error;
+		decoded._isCompressed = KTX2File::Read(bakedPath, decoded._compressed, &error, &decoded._srgb);
+		if (decoded._isCompressed)
+			return true;
+		LOG_WARN("Ignoring baked texture \"{}\": {}", bakedPath, error);
+	}
+
+	//Every caller flips, so the shared stb flip flag is always set to the same thing
+	decoded._data = Texture2DData::LoadFromFile(fileName, true, false);
+	if (decoded._data == nullptr)
+	{
+		LOG_WARN("Could not decode texture \"{}\"", fileName);
+		return false;
+	}
+
+	return true;
+}
+
+Texture2D::sptr TextureLoader::Upload(const DecodedTexture& decoded)
+{
+	if (decoded._isCompressed)
+	{
+		Texture2D::sptr texture = Texture2D::Create();
+		CompressedTexture::UploadInto(texture, decoded._compressed, decoded._srgb);
+		return texture;
+	}
+
+	Texture2D::sptr texture = Texture2D::Create();
+	texture->LoadData(decoded._data);
+	return texture;
+}
+
+void TextureLoader::UploadInto(const Texture2D::sptr& texture, const DecodedTexture& decoded)
+{
+	if (decoded._isCompressed)
+	{
+		CompressedTexture::UploadInto(texture, decoded._compressed, decoded._srgb);
+	}
+	else
+	{
+		texture->LoadData(decoded._data);
+	}
+}
+
+std::string TextureLoader::GetBakedPath(const std::string& fileName)
+{
+	std::filesystem::path bakedPath(fileName);
+	bakedPath.replace_extension(".ktx2");
+
+	std::error_code error;
+	std::filesystem::file_time_type bakedTime = std::filesystem::last_write_time(bakedPath, error);
+	if (error)
+		return "";
+
+	//If the source is gone the baked one is all we have
+	std::filesystem::file_time_type sourceTime = std::filesystem::last_write_time(fileName, error);
+	if (!error && sourceTime > bakedTime)
+		return "";
+
+	return bakedPath.string();
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+#include <Texture2D.h>
+#include <Texture2DData.h>
+#include <TextureCubeMap.h>
+#include <TextureCubeMapData.h>
+
+#include "Graphics/BlockCompression.h"
+
+//Everything a worker made for one texture, ready to hand to GL
+struct DecodedTexture
+{
+	std::string _fileName;
+	Texture2DData::sptr _data;
+	//Filled in instead of the rest when there's an up to date baked KTX2 for the file
+	CompressedImage _compressed;
+	bool _isCompressed = false;
+	bool _srgb = false;
+};
+
+//Splits texture loading into a decode that's safe on a worker and an upload for the GL thread
+//*AsyncLoader runs Decode on the thread pool and the upload from Poll, so decodes overlap each other
+class TextureLoader abstract
+{
+public:
+	//Decodes a texture, no GL calls so it's safe on a worker
+	static bool Decode(const std::string& fileName, DecodedTexture& decoded);
+	//Creates the GL texture for something decoded
+	static Texture2D::sptr Upload(const DecodedTexture& decoded);
+	//Loads something decoded into an existing texture (for placeholders)
+	static void UploadInto(const Texture2D::sptr& texture, const DecodedTexture& decoded);
+
+	//Gets the baked KTX2 for a texture (same name, .ktx2 extension) if there is one at least as new as the source
+	//*Returns an empty string if there isn't
+	static std::string GetBakedPath(const std::string& fileName);
+};
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+
+std::vector<std::thread> ThreadPool::_workers;
+std::queue<std::function<void()>> ThreadPool::_jobs;
+std::mutex ThreadPool::_mutex;
+std::condition_variable ThreadPool::_wake;
+bool ThreadPool::_stopping = false;
+
+void ThreadPool::Init(unsigned threadCount)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (!_workers.empty())
+		return;
+
+	if (threadCount == 0)
+	{
+		//hardware_concurrency can report 0 if it doesn't know
+		unsigned cores = std::thread::hardware_concurrency();
+		threadCount = cores > 1 ? cores - 1 : 1;
+	}
+
+	_stopping = false;
+	for (unsigned i = 0; i < threadCount; i++)
+	{
+		_workers.emplace_back(WorkerLoop);
+	}
+}
+
+void ThreadPool::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_wake.notify_all();
+
+	for (std::thread& worker : _workers)
+	{
+		worker.join();
+	}
+	_workers.clear();
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& func)
+{
+	if (count == 0)
+		return;
+	if (count == 1)
+	{
+		func(0);
+		return;
+	}
+
+	//Shared with the helper jobs, which can outlive this call if they start after the work is done
+	struct Batch
+	{
+		std::atomic<size_t> _next { 0 };
+		std::atomic<size_t> _done { 0 };
+		size_t _count = 0;
+		const std::function<void(size_t)>* _func = nullptr;
+		std::mutex _mutex;
+		std::condition_variable _finished;
+	};
+	std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+	batch->_count = count;
+	batch->_func = &func;
+
+	auto work = [batch]() {
+		size_t finished = 0;
+		for (size_t i = batch->_next++; i < batch->_count; i = batch->_next++)
+		{
+			(*batch->_func)(i);
+			finished++;
+		}
+
+		if (finished > 0 && (batch->_done += finished) == batch->_count)
+		{
+			std::lock_guard<std::mutex> lock(batch->_mutex);
+			batch->_finished.notify_all();
+		}
+	};
+
+	Init();
+	size_t helpers = std::min(size_t(GetThreadCount()), count - 1);
+	for (size_t i = 0; i < helpers; i++)
+	{
+		Push(work);
+	}
+
+	work();
+
+	//Only wait for items someone has already picked up
+	std::unique_lock<std::mutex> lock(batch->_mutex);
+	batch->_finished.wait(lock, [&batch]() { return batch->_done == batch->_count; });
+}
+
+unsigned ThreadPool::GetThreadCount()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return unsigned(_workers.size());
+}
+
+void ThreadPool::Push(std::function<void()> job)
+{
+	Init();
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_jobs.push(std::move(job));
+	}
+	_wake.notify_one();
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_wake.wait(lock, []() { return _stopping || !_jobs.empty(); });
+
+			//Drain the queue before stopping so nobody is left waiting on a future
+			if (_jobs.empty())
+				return;
+
+			job = std::move(_jobs.front());
+			_jobs.pop();
+		}
+
+		job();
+	}
+}
\ No newline at end of file
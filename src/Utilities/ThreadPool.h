@@ -0,0 +1,57 @@
+#pragma once
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+//Pool of worker threads shared by everything that wants to do CPU work off the main thread
+//*Workers are started the first time a job is queued
+//*Jobs must not make GL calls, hand anything that needs the context back to the main thread
+class ThreadPool abstract
+{
+public:
+	//Starts the workers (0 means one per core, leaving one for the main thread)
+	static void Init(unsigned threadCount = 0);
+	//Finishes the queued jobs and joins the workers
+	static void Shutdown();
+
+	//Queues a job, the future gets its result (or the exception it threw)
+	template <typename TFunc>
+	static auto Enqueue(TFunc func) -> std::future<decltype(func())>
+	{
+		typedef decltype(func()) TResult;
+
+		//packaged_task can't be copied, so share it so std::function can hold it
+		std::shared_ptr<std::packaged_task<TResult()>> task = std::make_shared<std::packaged_task<TResult()>>(std::move(func));
+		std::future<TResult> result = task->get_future();
+
+		Push([task]() { (*task)(); });
+
+		return result;
+	}
+
+	//Runs func(i) for every i in [0, count) spread over the workers, returns once they've all run
+	//*The calling thread works through the items as well and never waits on a job that hasn't started,
+	// so this is safe to call from inside a job
+	//*func must not throw
+	static void ParallelFor(size_t count, const std::function<void(size_t)>& func);
+
+	//Gets how many workers there are
+	static unsigned GetThreadCount();
+
+private:
+	//Adds a job to the queue and wakes a worker
+	static void Push(std::function<void()> job);
+	//Loop each worker runs until shutdown
+	static void WorkerLoop();
+
+	static std::vector<std::thread> _workers;
+	static std::queue<std::function<void()>> _jobs;
+	static std::mutex _mutex;
+	static std::condition_variable _wake;
+	static bool _stopping;
+};
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "Util.h"
 
+#include <charconv>
+#include <algorithm>
+
 bool Util::Init()
 {
     //Seeds random so we can use it
@@ -157,3 +160,100 @@ glm::vec3 Util::GetRandomNumberBetween(glm::vec4 from, glm::vec4 to, std::vector
 
     return randomNum;
 }
+
+uint64_t Util::HashBytes(const void* data, size_t size, uint64_t seed)
+{
+    //FNV-1a, xor in each byte then multiply by the prime
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+const char* Util::SkipBlank(const char* cursor, const char* end)
+{
+    while (cursor < end && (*cursor == ' ' || *cursor == '\t'))
+        cursor++;
+    return cursor;
+}
+
+const char* Util::SkipLine(const char* cursor, const char* end)
+{
+    while (cursor < end && *cursor != '\n')
+        cursor++;
+    return cursor < end ? cursor + 1 : end;
+}
+
+bool Util::ReadFloat(const char*& cursor, const char* end, float& value)
+{
+    cursor = SkipBlank(cursor, end);
+    //from_chars doesn't accept a leading plus
+    if (cursor < end && *cursor == '+')
+        cursor++;
+
+    std::from_chars_result result = std::from_chars(cursor, end, value);
+    if (result.ec != std::errc())
+        return false;
+
+    cursor = result.ptr;
+    return true;
+}
+
+bool Util::ReadInt(const char*& cursor, const char* end, int& value)
+{
+    std::from_chars_result result = std::from_chars(cursor, end, value);
+    if (result.ec != std::errc())
+        return false;
+
+    cursor = result.ptr;
+    return true;
+}
+
+void Util::BuildMipChain(const uint8_t* pixels, uint32_t width, uint32_t height, std::vector<MipLevel>& mips)
+{
+    mips.clear();
+
+    MipLevel base;
+    base._width = width;
+    base._height = height;
+    base._pixels.assign(pixels, pixels + size_t(width) * height * 4);
+    mips.push_back(std::move(base));
+
+    while (mips.back()._width > 1 || mips.back()._height > 1)
+    {
+        const MipLevel& source = mips.back();
+        MipLevel next;
+        next._width = std::max(source._width / 2, 1u);
+        next._height = std::max(source._height / 2, 1u);
+        next._pixels.resize(size_t(next._width) * next._height * 4);
+
+        for (uint32_t y = 0; y < next._height; y++)
+        {
+            //Clamp so odd sizes (and 1 pixel wide levels) don't read off the edge
+            uint32_t y0 = std::min(y * 2, source._height - 1);
+            uint32_t y1 = std::min(y * 2 + 1, source._height - 1);
+            for (uint32_t x = 0; x < next._width; x++)
+            {
+                uint32_t x0 = std::min(x * 2, source._width - 1);
+                uint32_t x1 = std::min(x * 2 + 1, source._width - 1);
+
+                for (uint32_t channel = 0; channel < 4; channel++)
+                {
+                    uint32_t sum = source._pixels[(size_t(y0) * source._width + x0) * 4 + channel] +
+                        source._pixels[(size_t(y0) * source._width + x1) * 4 + channel] +
+                        source._pixels[(size_t(y1) * source._width + x0) * 4 + channel] +
+                        source._pixels[(size_t(y1) * source._width + x1) * 4 + channel];
+                    next._pixels[(size_t(y) * next._width + x) * 4 + channel] = uint8_t((sum + 2) / 4);
+                }
+            }
+        }
+
+        mips.push_back(std::move(next));
+    }
+}
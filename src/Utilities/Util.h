@@ -2,9 +2,18 @@
 #include <GLM/glm.hpp>
 #include <time.h>
 #include <vector>
+#include <cstdint>
 
 namespace Util
 {
+	//One mip level on the CPU, tightly packed RGBA8
+	struct MipLevel
+	{
+		uint32_t _width = 0;
+		uint32_t _height = 0;
+		std::vector<uint8_t> _pixels;
+	};
+
 	bool Init();
 
 	//Find templated type in vector
@@ -36,4 +45,19 @@ namespace Util
 	glm::vec2 GetRandomNumberBetween(glm::vec2 from, glm::vec2 to, std::vector <glm::vec2> avoidFrom = std::vector <glm::vec2>(), std::vector <glm::vec2> avoidTo = std::vector <glm::vec2>());
 	glm::vec3 GetRandomNumberBetween(glm::vec3 from, glm::vec3 to, std::vector <glm::vec3> avoidFrom = std::vector <glm::vec3>(), std::vector <glm::vec3> avoidTo = std::vector <glm::vec3>());
 	glm::vec3 GetRandomNumberBetween(glm::vec4 from, glm::vec4 to, std::vector <glm::vec4> avoidFrom = std::vector <glm::vec4>(), std::vector <glm::vec4> avoidTo = std::vector <glm::vec4>());
+
+	//Hashes a block of bytes (64 bit FNV-1a), pass a previous hash as the seed to chain blocks together
+	uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+
+	//Helpers for parsing text files in place (from_chars based, so no copies or locale lookups)
+	//Skips spaces and tabs
+	const char* SkipBlank(const char* cursor, const char* end);
+	//Skips to the start of the next line
+	const char* SkipLine(const char* cursor, const char* end);
+	//Reads a float/int at the cursor (after any blanks for floats), returns false if there isn't one
+	bool ReadFloat(const char*& cursor, const char* end, float& value);
+	bool ReadInt(const char*& cursor, const char* end, int& value);
+
+	//Box filters an RGBA8 image down until it's 1x1, level 0 is a copy of the source
+	void BuildMipChain(const uint8_t* pixels, uint32_t width, uint32_t height, std::vector<MipLevel>& mips);
 }
\ No newline at end of file
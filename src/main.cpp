@@ -4,6 +4,8 @@
 #include <filesystem>
 #include <json.hpp>
 #include <fstream>
+#include <algorithm>
+#include <limits>
 
 //TODO: New for this tutorial
 #include <DirectionalLight.h>
@@ -17,6 +19,20 @@
 #include <MeshFactory.h>
 #include <NotObjLoader.h>
 #include <ObjLoader.h>
+#include "Graphics/CascadedShadows.h"
+#include "Graphics/ClusteredLights.h"
+#include "Graphics/FrameGraph.h"
+#include "Graphics/GpuDrivenRenderer.h"
+#include "Graphics/InstanceBatcher.h"
+#include "Graphics/LODComponent.h"
+#include "Graphics/OcclusionCuller.h"
+#include "Graphics/SceneBVH.h"
+#include "Graphics/UniformRing.h"
+#include "Utilities/AssetRegistry.h"
+#include "Utilities/AsyncLoader.h"
+#include "Utilities/ProceduralMesh.h"
+#include "Utilities/ShaderCache.h"
+#include "Utilities/ThreadPool.h"
 #include <VertexTypes.h>
 #include <ShaderMaterial.h>
 #include <RendererComponent.h>
@@ -55,32 +71,19 @@ int main() {
 	// Push another scope so most memory should be freed *before* we exit the app
 	{
 		#pragma region Shader and ImGui
-		Shader::sptr passthroughShader = Shader::Create();
-		passthroughShader->LoadShaderPartFromFile("shaders/passthrough_vert.glsl", GL_VERTEX_SHADER);
-		passthroughShader->LoadShaderPartFromFile("shaders/passthrough_frag.glsl", GL_FRAGMENT_SHADER);
-		passthroughShader->Link();
-
-		Shader::sptr simpleDepthShader = Shader::Create();
-		simpleDepthShader->LoadShaderPartFromFile("shaders/simple_depth_vert.glsl", GL_VERTEX_SHADER);
-		simpleDepthShader->LoadShaderPartFromFile("shaders/simple_depth_frag.glsl", GL_FRAGMENT_SHADER);
-		simpleDepthShader->Link();
-
-		//Init gBuffer shader
-		Shader::sptr gBufferShader = Shader::Create();
-		gBufferShader->LoadShaderPartFromFile("shaders/vertex_shader.glsl", GL_VERTEX_SHADER);
-		gBufferShader->LoadShaderPartFromFile("shaders/gBuffer_pass_frag.glsl", GL_FRAGMENT_SHADER);
-		gBufferShader->Link();
+		Shader::sptr simpleDepthShader = AssetRegistry::GetShader("shaders/simple_depth_vert.glsl", "shaders/simple_depth_frag.glsl");
+
+		//Init gBuffer shader, it has to write whatever layout the gBuffer is using
+		GBufferLayout gBufferLayout = GBufferLayout::Packed;
+		Shader::sptr gBufferShader = AssetRegistry::GetShader("shaders/vertex_shader.glsl", GBuffer::GetPassShaderFile(gBufferLayout));
 
 		// Load our shaders
-		Shader::sptr shader = Shader::Create();
-		shader->LoadShaderPartFromFile("shaders/vertex_shader.glsl", GL_VERTEX_SHADER);
 		//Directional Light Shader
-		shader->LoadShaderPartFromFile("shaders/directional_blinn_phong_frag.glsl", GL_FRAGMENT_SHADER);
-		shader->Link();
+		Shader::sptr shader = AssetRegistry::GetShader("shaders/vertex_shader.glsl", "shaders/directional_blinn_phong_frag.glsl");
 
 		//Basic effect for drawing to
 		PostEffect* basicEffect;
-		Framebuffer* shadowBuffer;
+		CascadedShadows* shadows;
 		GBuffer* gBuffer;
 		IlluminationBuffer* illumBuffer;
 
@@ -94,11 +97,70 @@ int main() {
 		FilmGrainEffect* filmGrainEffect;
 		PixelatedEffect* pixelatedEffect;
 
+		//Ordered chain of effects, runs of point-wise effects get fused into one pass
+		PostChain* postChain;
+		bool usePostChain = false;
+
 		bool showOnlyOneDeferredLightSource = false;
 		bool drawPositionBufferOnly = false;
 		bool drawNormalBufferOnly = false;
 		bool drawColourBufferOnly = false;
 		bool showLightAccumulationBuffer = false;
+
+		//Triangles drawn through LOD chains last frame
+		size_t sceneTriangles = 0;
+		size_t shadowTriangles = 0;
+
+		//What the frame graph did last frame
+		size_t livePasses = 0;
+		size_t culledPasses = 0;
+		size_t transientTargets = 0;
+
+		//Renderers are frustum culled through a BVH before each pass draws them
+		SceneBVH sceneBVH;
+		bool frustumCulling = true;
+		std::vector<entt::entity> cameraVisible;
+		std::vector<entt::entity> shadowVisible;
+		size_t cameraNodesTested = 0;
+		size_t shadowVisibleTotal = 0;
+		//What a pass draws one at a time, all their matrices go into the uniform ring in one batch before drawing
+		std::vector<entt::entity> passDraws;
+		std::vector<const Transform*> passTransforms;
+
+		//Big solid meshes are rasterised into a small CPU depth buffer and the camera's list is tested against it
+		OcclusionCuller occlusionCuller;
+		occlusionCuller.Init(256, 128);
+		bool occlusionCulling = true;
+
+		//Alternative path where a compute shader culls everything and each material is one indirect draw
+		GpuDrivenRenderer gpuDriven;
+		gpuDriven.Init();
+		bool gpuDrivenRendering = false;
+		//Renderers the GPU driven path can't take, drawn the normal way
+		std::vector<entt::entity> gpuFallbacks;
+
+		//Renderers sharing a material and a LOD level go out in one instanced draw per pass
+		InstanceBatcher instancer;
+		bool instancing = true;
+
+		//Procedural point lights for benchmarking the clustered lighting, they bob around where they were spawned
+		ClusteredLights pointLights;
+		std::vector<glm::vec3> pointLightOrigins;
+		int pointLightCount = 1024;
+		bool animatePointLights = true;
+
+		auto spawnPointLights = [&]() {
+			std::vector<ClusterLight>& lights = pointLights.GetLightsRef();
+			lights.resize(pointLightCount);
+			pointLightOrigins.resize(pointLightCount);
+			for (int i = 0; i < pointLightCount; i++)
+			{
+				pointLightOrigins[i] = Util::GetRandomNumberBetween(glm::vec3(-10.0f, -10.0f, 0.2f), glm::vec3(10.0f, 10.0f, 4.0f));
+				float radius = Util::GetRandomNumberBetween(0.75f, 2.5f);
+				lights[i]._positionRadius = glm::vec4(pointLightOrigins[i], radius);
+				lights[i]._colour = glm::vec4(Util::GetRandomNumberBetween(glm::vec3(0.1f), glm::vec3(1.0f)), 2.0f);
+			}
+		};
 		
 		// We'll add some ImGui controls to control our shader
 		BackendHandler::imGuiCallbacks.push_back([&]() {
@@ -150,16 +212,42 @@ int main() {
 
 				BloomEffect* temp = (BloomEffect*)effects[activeEffect];
 				float threshold = temp->GetThreshold();
-				int passes = temp->GetPasses();
 
 				if (ImGui::SliderFloat("Bloom Threshold", &threshold, 0.01f, 1.0f))
 				{
 					temp->SetThreshold(threshold);
 				}
 
-				if (ImGui::SliderInt("Blur Passes", &passes, 1, 10))
+				bool mipChain = temp->GetMode() == BloomMode::MipChain;
+				if (ImGui::Checkbox("Mip Chain Bloom", &mipChain))
 				{
-					temp->SetPasses(passes);
+					temp->SetMode(mipChain ? BloomMode::MipChain : BloomMode::Gaussian);
+				}
+
+				if (mipChain)
+				{
+					int levels = temp->GetMipLevels();
+					if (ImGui::SliderInt("Mip Levels", &levels, 1, 8))
+					{
+						temp->SetMipLevels(levels);
+					}
+				}
+				else
+				{
+					SeparableBlur& blur = temp->GetBlurRef();
+					int radius = blur.GetRadius();
+					if (ImGui::SliderInt("Blur Radius", &radius, 1, SeparableBlur::MAX_RADIUS))
+					{
+						blur.SetRadius(radius);
+					}
+
+					//Flip this to compare the two paths on the same radius
+					bool compute = blur.GetPath() == BlurPath::Compute;
+					if (SeparableBlur::IsComputeSupported() && ImGui::Checkbox("Compute Blur", &compute))
+					{
+						blur.SetPath(compute ? BlurPath::Compute : BlurPath::Fragment);
+					}
+					ImGui::Text("Blur GPU time: %.3f ms (%s)", blur.GetGpuMilliseconds(), compute ? "compute" : "fragment");
 				}
 			}
 			if (activeEffect == 1)
@@ -186,12 +274,152 @@ int main() {
 					temp->SetPixels(pixelation);
 				}
 			}
+			if (ImGui::CollapsingHeader("Post Chain"))
+			{
+				ImGui::Checkbox("Use Chain Instead Of Chosen Effect", &usePostChain);
+				bool fusing = postChain->IsFusing();
+				if (ImGui::Checkbox("Fuse Point-wise Effects", &fusing))
+				{
+					postChain->SetFusing(fusing);
+				}
+
+				std::vector<PostChainEntry>& entries = postChain->GetEffectsRef();
+				for (int i = 0; i < entries.size(); i++)
+				{
+					ImGui::PushID(i);
+					if (i > 0)
+					{
+						if (ImGui::ArrowButton("Up", ImGuiDir_Up))
+						{
+							std::swap(entries[i], entries[i - 1]);
+						}
+						ImGui::SameLine();
+					}
+					ImGui::Checkbox(entries[i]._name.c_str(), &entries[i]._enabled);
+					ImGui::PopID();
+				}
+
+				ImGui::Text("Fused: %d effects in %d passes, %d shaders built", postChain->GetFusedEffectCount(),
+					postChain->GetFusedPassCount(), (int)postChain->GetFusedShaderCount());
+			}
 			if (ImGui::CollapsingHeader("Light Level Lighting Settings"))
 			{
 				if (ImGui::DragFloat3("Light Direction/Position", glm::value_ptr(illumBuffer->GetSunRef()._lightDirection), 0.01f, -10.0f, 10.0f)) 
 				{
 				}
 			}
+			if (ImGui::CollapsingHeader("Point Lights"))
+			{
+				if (ImGui::SliderInt("Light Count", &pointLightCount, 0, 8192))
+				{
+					spawnPointLights();
+				}
+				if (ImGui::Button("Respawn Lights"))
+				{
+					spawnPointLights();
+				}
+				ImGui::Checkbox("Animate Lights", &animatePointLights);
+				bool volumes = illumBuffer->GetPointLightMode() == PointLightMode::Volumes;
+				if (ImGui::Checkbox("Light Volumes", &volumes))
+				{
+					illumBuffer->SetPointLightMode(volumes ? PointLightMode::Volumes : PointLightMode::Clustered);
+				}
+
+				const ClusterStats& stats = pointLights.GetStats();
+				ImGui::Text("Assignment: %.3f ms", stats._assignMilliseconds);
+				ImGui::Text("Visible: %d of %d lights", (int)stats._visibleLights, (int)stats._lightCount);
+				ImGui::Text("Cluster references: %d, most in one cluster: %d", (int)stats._references, (int)stats._maxPerCluster);
+			}
+			if (ImGui::CollapsingHeader("Shadows"))
+			{
+				int cascades = shadows->GetCascadeCount();
+				if (ImGui::SliderInt("Cascades", &cascades, 2, CascadedShadows::MAX_CASCADES))
+				{
+					shadows->SetCascadeCount(cascades);
+				}
+
+				//Resolutions go up in powers of two
+				int resolutionLog = int(std::log2(shadows->GetResolution()));
+				if (ImGui::SliderInt("Resolution", &resolutionLog, 9, 12, std::to_string(1 << resolutionLog).c_str()))
+				{
+					shadows->SetResolution(1u << resolutionLog);
+				}
+
+				float distance = shadows->GetShadowDistance();
+				if (ImGui::SliderFloat("Shadow Distance", &distance, 5.0f, 200.0f))
+				{
+					shadows->SetShadowDistance(distance);
+				}
+				float blend = shadows->GetSplitBlend();
+				if (ImGui::SliderFloat("Split Blend", &blend, 0.0f, 1.0f))
+				{
+					shadows->SetSplitBlend(blend);
+				}
+
+				bool caching = shadows->IsCaching();
+				if (ImGui::Checkbox("Cache Static Casters", &caching))
+				{
+					shadows->SetCaching(caching);
+				}
+				ImGui::Text("Cascades redrawn with static casters: %d", shadows->GetStaticRedrawCount());
+
+				glm::vec4 splits = shadows->GetSplits();
+				ImGui::Text("Splits: %.1f, %.1f, %.1f, %.1f", splits.x, splits.y, splits.z, splits.w);
+				ImGui::Text("Shadow memory: %.1f MB", shadows->GetMemoryBytes() / (1024.0f * 1024.0f));
+			}
+			if (ImGui::CollapsingHeader("Mesh LODs"))
+			{
+				LODSettings& lodSettings = LODComponent::GetSettingsRef();
+				ImGui::SliderFloat("Pixel Error", &lodSettings._pixelError, 0.0f, 8.0f);
+				ImGui::SliderFloat("Bias", &lodSettings._bias, 0.0f, 8.0f);
+				ImGui::SliderFloat("Shadow Bias", &lodSettings._shadowBias, 0.0f, 16.0f);
+				ImGui::Text("LOD triangles: %d in the G-buffer, %d in shadows", (int)sceneTriangles, (int)shadowTriangles);
+			}
+			if (ImGui::CollapsingHeader("Culling"))
+			{
+				ImGui::Checkbox("Frustum Culling", &frustumCulling);
+				ImGui::Text("Camera: %d renderers visible, %d nodes tested", (int)cameraVisible.size(), (int)cameraNodesTested);
+				ImGui::Text("Shadows: %d renderers drawn across the cascades", (int)shadowVisibleTotal);
+				ImGui::Text("BVH: %d nodes, %d leaves, %d high, %d reinserted", (int)sceneBVH.GetNodeCount(), (int)sceneBVH.GetLeafCount(), sceneBVH.GetHeight(),
+					(int)sceneBVH.GetReinsertCount());
+
+				ImGui::Checkbox("Occlusion Culling", &occlusionCulling);
+				const OcclusionStats& occlusion = occlusionCuller.GetStats();
+				ImGui::Text("Occluders: %d, %d triangles at %dx%d", (int)occlusion._occluders, (int)occlusion._triangles, occlusionCuller.GetWidth(), occlusionCuller.GetHeight());
+				ImGui::Text("Occluded: %d of %d tested", (int)occlusion._culled, (int)occlusion._tested);
+				ImGui::Text("Rasterise %.3f ms, test %.3f ms", occlusion._rasteriseMilliseconds, occlusion._testMilliseconds);
+
+				ImGui::Checkbox("GPU Driven", &gpuDrivenRendering);
+				const GpuDrivenStats& gpuStats = gpuDriven.GetStats();
+				ImGui::Text("GPU driven: %d objects, %d meshes, %d fallbacks", (int)gpuStats._objects, (int)gpuStats._meshes, (int)gpuStats._fallbacks);
+				ImGui::Text("%d multi draws from %d cull dispatches", (int)gpuStats._drawCalls, (int)gpuStats._cullDispatches);
+				ImGui::Text("Mesh pool: %.2f MB", MeshPool::GetUsedBytes() / (1024.0f * 1024.0f));
+
+				ImGui::Checkbox("Instancing", &instancing);
+				const InstanceStats& instanceStats = instancer.GetStats();
+				ImGui::Text("Instanced: %d renderers in %d draws", (int)instanceStats._instances, (int)instanceStats._drawCalls);
+			}
+			if (ImGui::CollapsingHeader("Frame Graph"))
+			{
+				ImGui::Text("Passes: %d run, %d culled", (int)livePasses, (int)culledPasses);
+				ImGui::Text("Uniform ring: %.1f of %.1f KB, waited %.3f ms", UniformRing::GetUsedBytes() / 1024.0f, UniformRing::GetFrameCapacity() / 1024.0f, UniformRing::GetWaitMilliseconds());
+				ImGui::Text("Transient targets: %d this frame, %d pooled, %.2f MB", (int)transientTargets,
+					(int)RenderTargetPool::GetTargetCount(), RenderTargetPool::GetResidentBytes() / (1024.0f * 1024.0f));
+			}
+			if (ImGui::CollapsingHeader("Asset Registry"))
+			{
+				ImGui::Text("Still loading: %d", (int)AsyncLoader::GetPendingCount());
+				ImGui::Text("Shader programs: %d from binaries, %d compiled", ShaderCache::GetHitCount(), ShaderCache::GetMissCount());
+				for (const AssetStats& stats : AssetRegistry::GetStats())
+				{
+					ImGui::Text("%s: %d loaded, %d refs, %.2f MB", stats._type.c_str(), (int)stats._count, (int)stats._references, stats._residentBytes / (1024.0f * 1024.0f));
+					ImGui::Text("    %d loads, %d shared", (int)stats._loads, (int)stats._hits);
+				}
+				if (ImGui::Button("Release unused assets"))
+				{
+					AssetRegistry::Collect();
+				}
+			}
 			});
 
 		#pragma endregion 
@@ -205,31 +433,32 @@ int main() {
 		#pragma region Texture
 
 		// Load some textures from files
-		Texture2D::sptr diffuse = Texture2D::LoadFromFile("images/Stone_001_Diffuse.png");
-		Texture2D::sptr diffuse2 = Texture2D::LoadFromFile("images/box.bmp");
-		Texture2D::sptr specular = Texture2D::LoadFromFile("images/Stone_001_Specular.png");
-		Texture2D::sptr reflectivity = Texture2D::LoadFromFile("images/box-reflections.bmp");
+		// These (and the meshes and skybox) load in the background, the scene draws with placeholders until they're in
+		Texture2D::sptr diffuse = AssetRegistry::GetTextureAsync("images/Stone_001_Diffuse.png");
+		Texture2D::sptr diffuse2 = AssetRegistry::GetTextureAsync("images/box.bmp");
+		Texture2D::sptr specular = AssetRegistry::GetTextureAsync("images/Stone_001_Specular.png");
+		Texture2D::sptr reflectivity = AssetRegistry::GetTextureAsync("images/box-reflections.bmp");
 
 		// Lego Character Textures
-		Texture2D::sptr legodiffuse1 = Texture2D::LoadFromFile("images/HappyBusinessman.png");
-		Texture2D::sptr legospecular1 = Texture2D::LoadFromFile("images/HappyBusinessman_s.png");
-		Texture2D::sptr legodiffuse2 = Texture2D::LoadFromFile("images/Magician.png");
-		Texture2D::sptr legodiffuse3 = Texture2D::LoadFromFile("images/ShellLady.png");
-		Texture2D::sptr legodiffuse4 = Texture2D::LoadFromFile("images/Wonderwoman.png");
-		Texture2D::sptr legodiffuse5 = Texture2D::LoadFromFile("images/LegoHead.png");
+		Texture2D::sptr legodiffuse1 = AssetRegistry::GetTextureAsync("images/HappyBusinessman.png");
+		Texture2D::sptr legospecular1 = AssetRegistry::GetTextureAsync("images/HappyBusinessman_s.png");
+		Texture2D::sptr legodiffuse2 = AssetRegistry::GetTextureAsync("images/Magician.png");
+		Texture2D::sptr legodiffuse3 = AssetRegistry::GetTextureAsync("images/ShellLady.png");
+		Texture2D::sptr legodiffuse4 = AssetRegistry::GetTextureAsync("images/Wonderwoman.png");
+		Texture2D::sptr legodiffuse5 = AssetRegistry::GetTextureAsync("images/LegoHead.png");
 
 		//Specular Textures
-		Texture2D::sptr nospecular = Texture2D::LoadFromFile("images/nospec.png");
-		Texture2D::sptr darkspecular = Texture2D::LoadFromFile("images/DarkGrey.png");
-		Texture2D::sptr offwhitespecular = Texture2D::LoadFromFile("images/offwhite.png");
+		Texture2D::sptr nospecular = AssetRegistry::GetTextureAsync("images/nospec.png");
+		Texture2D::sptr darkspecular = AssetRegistry::GetTextureAsync("images/DarkGrey.png");
+		Texture2D::sptr offwhitespecular = AssetRegistry::GetTextureAsync("images/offwhite.png");
 
 		//Lego Block Colour Textures
-		Texture2D::sptr legoblockred = Texture2D::LoadFromFile("images/Red.png");
-		Texture2D::sptr legoblockbrown = Texture2D::LoadFromFile("images/Brown.png");
+		Texture2D::sptr legoblockred = AssetRegistry::GetTextureAsync("images/Red.png");
+		Texture2D::sptr legoblockbrown = AssetRegistry::GetTextureAsync("images/Brown.png");
 
 		// Load the cube map
-		//TextureCubeMap::sptr environmentMap = TextureCubeMap::LoadFromImages("images/cubemaps/skybox/sample.jpg");
-		TextureCubeMap::sptr environmentMap = TextureCubeMap::LoadFromImages("images/cubemaps/skybox/space.jpg"); 
+		//TextureCubeMap::sptr environmentMap = AssetRegistry::GetCubeMapAsync("images/cubemaps/skybox/sample.jpg");
+		TextureCubeMap::sptr environmentMap = AssetRegistry::GetCubeMapAsync("images/cubemaps/skybox/space.jpg"); 
 
 		// Creating an empty texture
 		Texture2DDescription desc = Texture2DDescription();  
@@ -248,6 +477,7 @@ int main() {
 		
 		// We need to tell our scene system what extra component types we want to support
 		GameScene::RegisterComponentType<RendererComponent>();
+		GameScene::RegisterComponentType<LODComponent>();
 		GameScene::RegisterComponentType<BehaviourBinding>();
 		GameScene::RegisterComponentType<Camera>();
 
@@ -321,53 +551,65 @@ int main() {
 
 		GameObject LegoFloor = scene->CreateEntity("lego_floor");
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/LegoFloor.obj");
-			LegoFloor.emplace<RendererComponent>().SetMesh(vao).SetMaterial(legoblock1);
+			MeshLODChain::sptr lods = AssetRegistry::GetMeshLODsAsync("models/LegoFloor.obj");
+			LegoFloor.emplace<RendererComponent>().SetMesh(lods->_levels[0]._mesh).SetMaterial(legoblock1);
+			LegoFloor.emplace<LODComponent>().SetChain(lods);
 			LegoFloor.get<Transform>().SetLocalPosition(0.0f, 0.0f, 0.0f);
 		}
 
 		GameObject LegoTable = scene->CreateEntity("lego_table");
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/LegoTable.obj");
-			LegoTable.emplace<RendererComponent>().SetMesh(vao).SetMaterial(legoblock2);
+			MeshLODChain::sptr lods = AssetRegistry::GetMeshLODsAsync("models/LegoTable.obj");
+			LegoTable.emplace<RendererComponent>().SetMesh(lods->_levels[0]._mesh).SetMaterial(legoblock2);
+			LegoTable.emplace<LODComponent>().SetChain(lods);
+			LegoTable.emplace<OccluderComponent>();
 			LegoTable.get<Transform>().SetLocalPosition(0.0f, 0.0f, 0.0f);
 		}
 
 		GameObject LegoCharacter1 = scene->CreateEntity("lego_character");
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/LegoCharacter.obj");
-			LegoCharacter1.emplace<RendererComponent>().SetMesh(vao).SetMaterial(legocharacter1);
+			MeshLODChain::sptr lods = AssetRegistry::GetMeshLODsAsync("models/LegoCharacter.obj");
+			LegoCharacter1.emplace<RendererComponent>().SetMesh(lods->_levels[0]._mesh).SetMaterial(legocharacter1);
+			LegoCharacter1.emplace<LODComponent>().SetChain(lods);
+			LegoCharacter1.emplace<OccluderComponent>();
 			LegoCharacter1.get<Transform>().SetLocalPosition(0.0f, -3.0f, 0.0f);
 		}
 
 		GameObject LegoCharacter2 = scene->CreateEntity("lego_character1");
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/LegoCharacter.obj");
-			LegoCharacter2.emplace<RendererComponent>().SetMesh(vao).SetMaterial(legocharacter2);
+			MeshLODChain::sptr lods = AssetRegistry::GetMeshLODsAsync("models/LegoCharacter.obj");
+			LegoCharacter2.emplace<RendererComponent>().SetMesh(lods->_levels[0]._mesh).SetMaterial(legocharacter2);
+			LegoCharacter2.emplace<LODComponent>().SetChain(lods);
+			LegoCharacter2.emplace<OccluderComponent>();
 			LegoCharacter2.get<Transform>().SetLocalPosition(3.0f, 0.0f, 0.0f);
 			LegoCharacter2.get<Transform>().SetLocalRotation(0, 0, 90);
 		}
 
 		GameObject LegoCharacter3 = scene->CreateEntity("lego_character2");
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/LegoCharacter.obj");
-			LegoCharacter3.emplace<RendererComponent>().SetMesh(vao).SetMaterial(legocharacter3);
+			MeshLODChain::sptr lods = AssetRegistry::GetMeshLODsAsync("models/LegoCharacter.obj");
+			LegoCharacter3.emplace<RendererComponent>().SetMesh(lods->_levels[0]._mesh).SetMaterial(legocharacter3);
+			LegoCharacter3.emplace<LODComponent>().SetChain(lods);
+			LegoCharacter3.emplace<OccluderComponent>();
 			LegoCharacter3.get<Transform>().SetLocalPosition(-3.0f, 0.0f, 0.0f);
 			LegoCharacter3.get<Transform>().SetLocalRotation(0, 0, -90);
 		}
 
 		GameObject LegoCharacter4 = scene->CreateEntity("lego_character3");
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/LegoCharacter.obj");
-			LegoCharacter4.emplace<RendererComponent>().SetMesh(vao).SetMaterial(legocharacter4);
+			MeshLODChain::sptr lods = AssetRegistry::GetMeshLODsAsync("models/LegoCharacter.obj");
+			LegoCharacter4.emplace<RendererComponent>().SetMesh(lods->_levels[0]._mesh).SetMaterial(legocharacter4);
+			LegoCharacter4.emplace<LODComponent>().SetChain(lods);
+			LegoCharacter4.emplace<OccluderComponent>();
 			LegoCharacter4.get<Transform>().SetLocalPosition(0.0f, 3.0f, 0.0f);
 			LegoCharacter4.get<Transform>().SetLocalRotation(0, 0, 180);
 		}
 
 		GameObject LegoCharacter5 = scene->CreateEntity("lego_character4");
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/LegoHead.obj");
-			LegoCharacter5.emplace<RendererComponent>().SetMesh(vao).SetMaterial(legocharacter5);
+			MeshLODChain::sptr lods = AssetRegistry::GetMeshLODsAsync("models/LegoHead.obj");
+			LegoCharacter5.emplace<RendererComponent>().SetMesh(lods->_levels[0]._mesh).SetMaterial(legocharacter5);
+			LegoCharacter5.emplace<LODComponent>().SetChain(lods);
 			LegoCharacter5.get<Transform>().SetLocalPosition(0.0f, 0.0f, 3.5f);
 			BehaviourBinding::Bind<RotateObjectBehaviour>(LegoCharacter5);
 
@@ -399,7 +641,7 @@ int main() {
 		GameObject gBufferObject = scene->CreateEntity("G Buffer");
 		{
 			gBuffer = &gBufferObject.emplace<GBuffer>();
-			gBuffer->Init(width, height);
+			gBuffer->Init(width, height, gBufferLayout);
 		}
 
 		GameObject illumBufferObject = scene->CreateEntity("Illumination Buffer");
@@ -407,16 +649,16 @@ int main() {
 			illumBuffer = &illumBufferObject.emplace<IlluminationBuffer>();
 			illumBuffer->Init(width, height);
 			illumBuffer->GetSunRef()._ambientPow = 0.3f;
+			illumBuffer->SetPointLights(&pointLights);
 		}
+		spawnPointLights();
 
-		int shadowWidth = 4096;
-		int shadowHeight = 4096;
-
-		GameObject shadowBufferObject = scene->CreateEntity("Shadow Buffer");
+		//Three 2048 cascades, 48 MB against the 64 MB the single 4096 map took
+		GameObject shadowsObject = scene->CreateEntity("Shadow Cascades");
 		{
-			shadowBuffer = &shadowBufferObject.emplace<Framebuffer>();
-			shadowBuffer->AddDepthTarget();
-			shadowBuffer->Init(shadowWidth, shadowHeight);
+			shadows = &shadowsObject.emplace<CascadedShadows>();
+			shadows->Init(2048, 3);
+			illumBuffer->SetShadows(shadows);
 		}
 
 		GameObject framebufferObject = scene->CreateEntity("Basic Effect");
@@ -446,16 +688,43 @@ int main() {
 		}
 		effects.push_back(pixelatedEffect);
 
+		GameObject greyscaleEffectObject = scene->CreateEntity("Greyscale Effect");
+		{
+			greyscaleEffect = &greyscaleEffectObject.emplace<GreyscaleEffect>();
+			greyscaleEffect->Init(width, height);
+		}
+
+		GameObject sepiaEffectObject = scene->CreateEntity("Sepia Effect");
+		{
+			sepiaEffect = &sepiaEffectObject.emplace<SepiaEffect>();
+			sepiaEffect->Init(width, height);
+		}
+
+		GameObject colorCorrectEffectObject = scene->CreateEntity("Color Correct Effect");
+		{
+			colorCorrectEffect = &colorCorrectEffectObject.emplace<ColorCorrectEffect>();
+			colorCorrectEffect->Init(width, height);
+		}
+
+		GameObject postChainObject = scene->CreateEntity("Post Chain");
+		{
+			postChain = &postChainObject.emplace<PostChain>();
+			postChain->Init(width, height);
+			postChain->AddEffect(bloomEffect, "Bloom");
+			postChain->AddEffect(colorCorrectEffect, "Color Correct", false);
+			postChain->AddEffect(greyscaleEffect, "Greyscale", false);
+			postChain->AddEffect(sepiaEffect, "Sepia", false);
+			postChain->AddEffect(filmGrainEffect, "Film Grain");
+			postChain->AddEffect(pixelatedEffect, "Pixelated", false);
+		}
+
 		#pragma endregion 
 		//////////////////////////////////////////////////////////////////////////////////////////
 
 		/////////////////////////////////// SKYBOX ///////////////////////////////////////////////
 		
 		// Load our shaders
-		Shader::sptr skybox = std::make_shared<Shader>();
-		skybox->LoadShaderPartFromFile("shaders/skybox-shader.vert.glsl", GL_VERTEX_SHADER);
-		skybox->LoadShaderPartFromFile("shaders/skybox-shader.frag.glsl", GL_FRAGMENT_SHADER);
-		skybox->Link();
+		Shader::sptr skybox = AssetRegistry::GetShader("shaders/skybox-shader.vert.glsl", "shaders/skybox-shader.frag.glsl");
 
 		ShaderMaterial::sptr skyboxMat = ShaderMaterial::Create();
 		skyboxMat->Shader = skybox;  
@@ -463,10 +732,10 @@ int main() {
 		skyboxMat->Set("u_EnvironmentRotation", glm::mat3(glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1, 0, 0))));
 		skyboxMat->RenderLayer = 100;
 
-		MeshBuilder<VertexPosNormTexCol> mesh;
-		MeshFactory::AddIcoSphere(mesh, glm::vec3(0.0f), 1.0f);
-		MeshFactory::InvertFaces(mesh);
-		VertexArrayObject::sptr meshVao = mesh.Bake();
+		//Shares the generated icosphere with anything else that wants one
+		MeshData mesh = *ProceduralMesh::GetPrimitive(PrimitiveType::IcoSphere, 0);
+		ProceduralMesh::InvertFaces(mesh);
+		VertexArrayObject::sptr meshVao = MeshCache::Upload(mesh);
 		
 		GameObject skyboxObj = scene->CreateEntity("skybox");  
 		skyboxObj.get<Transform>().SetLocalPosition(0.0f, 0.0f, 0.0f);
@@ -519,6 +788,12 @@ int main() {
 		while (!glfwWindowShouldClose(BackendHandler::window)) {
 			glfwPollEvents();
 
+			// Swap in any assets that finished loading
+			AsyncLoader::Poll();
+
+			//Per frame and per draw uniforms go in this frame's part of the ring
+			UniformRing::BeginFrame();
+
 			// Update the timing
 			time.CurrentFrame = glfwGetTime();
 			time.DeltaTime = static_cast<float>(time.CurrentFrame - time.LastFrame);
@@ -552,18 +827,7 @@ int main() {
 			});
 
 			// Clear the screen
-			basicEffect->Clear();
-			/*greyscaleEffect->Clear();
-			sepiaEffect->Clear();*/
-			for (int i = 0; i < effects.size(); i++)
-			{
-				effects[i]->Clear();
-			}
-			shadowBuffer->Clear();
-			gBuffer->Clear();
-			illumBuffer->Clear();
-
-
+			//*Offscreen targets are cleared by the frame graph, and only when a pass that runs needs it
 			glClearColor(1.0f, 1.0f, 1.0f, 0.3f);
 			glEnable(GL_DEPTH_TEST);
 			glClearDepth(1.0f);
@@ -580,19 +844,80 @@ int main() {
 			glm::mat4 projection = cameraObject.get<Camera>().GetProjection();
 			glm::mat4 viewProjection = projection * view;
 
-			//Set up light space matrix
-			glm::mat4 lightProjectionMatrix = glm::ortho(-20.0f, 20.0f, -20.0f, 20.0f, -30.0f, 30.0f);
-			glm::mat4 lightViewMatrix = glm::lookAt(glm::vec3(-illumBuffer->GetSunRef()._lightDirection), glm::vec3(), glm::vec3(0.0f, 0.0f, 1.0f));
-			glm::mat4 lightSpaceViewProj = lightProjectionMatrix * lightViewMatrix;
+			//Fit the shadow cascades around everything that casts, using the LOD bounding spheres where there are any
+			//*Anything with behaviours can move, so it's dynamic, the rest is hashed so the static shadow cache knows when it changes
+			glm::vec3 casterMin = glm::vec3(std::numeric_limits<float>::max());
+			glm::vec3 casterMax = glm::vec3(-std::numeric_limits<float>::max());
+			//Static casters pick their LOD from the cascades (which the cache already checks) and these settings
+			const LODSettings& casterLodSettings = LODComponent::GetSettingsRef();
+			uint64_t staticCasterHash = Util::HashBytes(&casterLodSettings._pixelError, sizeof(casterLodSettings._pixelError));
+			staticCasterHash = Util::HashBytes(&casterLodSettings._shadowBias, sizeof(casterLodSettings._shadowBias), staticCasterHash);
+			renderGroup.each([&](entt::entity e, RendererComponent& renderer, Transform& transform) {
+				if (!renderer.CastShadows)
+					return;
+
+				const glm::mat4& world = transform.WorldTransform();
+				const LODComponent* lod = scene->Registry().try_get<LODComponent>(e);
+				if (scene->Registry().try_get<BehaviourBinding>(e) == nullptr)
+				{
+					const VertexArrayObject* mesh = renderer.Mesh.get();
+					staticCasterHash = Util::HashBytes(&world, sizeof(world), staticCasterHash);
+					staticCasterHash = Util::HashBytes(&mesh, sizeof(mesh), staticCasterHash);
+
+					//Async loads fill the same VAOs in, so the pointers don't change when they finish, the index counts do
+					if (lod != nullptr && lod->GetChain() != nullptr)
+					{
+						for (const MeshLODLevel& level : lod->GetChain()->_levels)
+						{
+							staticCasterHash = Util::HashBytes(&level._indexCount, sizeof(level._indexCount), staticCasterHash);
+						}
+					}
+					const MeshInfo* info = AssetRegistry::GetMeshInfo(renderer.Mesh);
+					size_t indexCount = info != nullptr ? info->_indexCount : 0;
+					staticCasterHash = Util::HashBytes(&indexCount, sizeof(indexCount), staticCasterHash);
+				}
 
-			//Set shadow stuff
-			illumBuffer->SetLightSpaceViewProj(lightSpaceViewProj);
-			glm::vec3 camPos = glm::inverse(view) * glm::vec4(0, 0, 0, 1);
-			illumBuffer->SetCamPos(camPos);
+				glm::vec3 centre = glm::vec3(world[3]);
+				float radius = 1.0f;
+				if (lod != nullptr && lod->GetChain() != nullptr)
+				{
+					float scale = std::max(glm::length(glm::vec3(world[0])), std::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+					centre = glm::vec3(world * glm::vec4(lod->GetChain()->_centre, 1.0f));
+					radius = lod->GetChain()->_radius * scale;
+				}
+				casterMin = glm::min(casterMin, centre - radius);
+				casterMax = glm::max(casterMax, centre + radius);
+			});
+			if (casterMin.x <= casterMax.x)
+			{
+				shadows->SetSceneBounds(casterMin, casterMax);
+			}
+			shadows->SetStaticHash(staticCasterHash);
+			shadows->Update(view, projection, glm::vec3(illumBuffer->GetSunRef()._lightDirection));
+			//Forward shaders still take one light space matrix, they get the nearest cascade
+			glm::mat4 lightSpaceViewProj = shadows->GetViewProjection(0);
+			//Every scene shader reads the camera from here, so it's set once rather than per shader
+			BackendHandler::SetFrameUniforms(view, projection, lightSpaceViewProj);
+
+			gBuffer->SetViewProjection(viewProjection);
+
+			//Move the point lights and sort them into clusters for this camera
+			if (animatePointLights)
+			{
+				std::vector<ClusterLight>& lights = pointLights.GetLightsRef();
+				float t = float(time.CurrentFrame);
+				for (size_t i = 0; i < lights.size(); i++)
+				{
+					float phase = float(i) * 0.618f;
+					glm::vec3 offset = glm::vec3(glm::sin(t + phase), glm::cos(t * 0.7f + phase), glm::sin(t * 1.3f + phase) * 0.5f);
+					lights[i]._positionRadius = glm::vec4(pointLightOrigins[i] + offset, lights[i]._positionRadius.w);
+				}
+			}
+			pointLights.Update(view, projection);
 
 			// Sort the renderers by shader and material, we will go for a minimizing context switches approach here,
 			// but you could for instance sort front to back to optimize for fill rate if you have intensive fragment shaders
-			renderGroup.sort<RendererComponent>([](const RendererComponent& l, const RendererComponent& r) {
+			auto materialOrder = [](const RendererComponent& l, const RendererComponent& r) {
 				// Sort by render layer first, higher numbers get drawn last
 				if (l.Material->RenderLayer < r.Material->RenderLayer) return true;
 				if (l.Material->RenderLayer > r.Material->RenderLayer) return false;
@@ -606,95 +931,277 @@ int main() {
 				if (l.Material > r.Material) return false;
 
 				return false;
+			};
+			renderGroup.sort<RendererComponent>(materialOrder);
+
+			//Refit the BVH to this frame's transforms, then cull the camera's list (kept in the same order as the group)
+			sceneBVH.Update(scene->Registry());
+			if (frustumCulling)
+			{
+				sceneBVH.Cull(viewProjection, cameraVisible);
+				cameraNodesTested = sceneBVH.GetStats()._nodesTested;
+			}
+			else
+			{
+				cameraVisible.assign(renderGroup.begin(), renderGroup.end());
+				cameraNodesTested = 0;
+			}
+
+			//Draw the occluders into the CPU depth buffer, then drop anything whose box is hidden behind them
+			if (occlusionCulling && !gpuDrivenRendering)
+			{
+				auto isOccluder = [&](entt::entity e) {
+					const OccluderComponent* occluder = scene->Registry().try_get<OccluderComponent>(e);
+					const LODComponent* lod = scene->Registry().try_get<LODComponent>(e);
+					return occluder != nullptr && occluder->_enabled && lod != nullptr && lod->GetChain() != nullptr;
+				};
+
+				occlusionCuller.Begin(viewProjection);
+				for (entt::entity e : cameraVisible)
+				{
+					if (isOccluder(e))
+					{
+						const MeshLODChain::sptr& chain = scene->Registry().get<LODComponent>(e).GetChain();
+						occlusionCuller.AddOccluder(chain->_occluderPositions, chain->_occluderIndices, renderGroup.get<Transform>(e).WorldTransform());
+					}
+				}
+				occlusionCuller.Rasterise();
+
+				cameraVisible.erase(std::remove_if(cameraVisible.begin(), cameraVisible.end(), [&](entt::entity e) {
+					glm::vec3 boundsMin, boundsMax;
+					if (isOccluder(e) || !sceneBVH.GetBounds(e, boundsMin, boundsMax))
+						return false;
+					return !occlusionCuller.IsVisible(boundsMin, boundsMax);
+				}), cameraVisible.end());
+			}
+
+			std::sort(cameraVisible.begin(), cameraVisible.end(), [&](entt::entity l, entt::entity r) {
+				return materialOrder(renderGroup.get<RendererComponent>(l), renderGroup.get<RendererComponent>(r));
 			});
+			shadowVisibleTotal = 0;
+			instancer.ResetStats();
+
+			//The GPU driven path takes the whole group in material order, the GPU does the culling
+			gpuFallbacks.clear();
+			if (gpuDrivenRendering)
+			{
+				gpuDriven.Begin();
+				renderGroup.each([&](entt::entity e, RendererComponent& renderer, Transform& transform) {
+					uint32_t flags = renderer.CastShadows ? GPU_OBJECT_CASTS_SHADOWS : 0;
+					flags |= scene->Registry().try_get<BehaviourBinding>(e) != nullptr ? GPU_OBJECT_DYNAMIC : 0;
+					if (!gpuDriven.Add(renderer, transform, scene->Registry().try_get<LODComponent>(e), flags))
+					{
+						gpuFallbacks.push_back(e);
+					}
+				});
+				gpuDriven.Upload();
+			}
 
 			// Start by assuming no shader or material is applied
 			Shader::sptr current = nullptr;
 			ShaderMaterial::sptr currentMat = nullptr;
 
-			glViewport(0, 0, shadowWidth, shadowHeight);
-			shadowBuffer->Bind();
-
-			renderGroup.each([&](entt::entity e, RendererComponent& renderer, Transform& transform) {
-				// Render the mesh
-				if (renderer.CastShadows)
+			//Each pass picks its own LOD, the shadow pass has its own bias so it can go coarser
+			//*Shadow casters pick from their cascade rather than the camera, so the cached static casters stay valid as it moves
+			LODSettings& lodSettings = LODComponent::GetSettingsRef();
+			LODView lodView = LODView::Create(view, projection, height, lodSettings._bias);
+			shadowTriangles = 0;
+			sceneTriangles = 0;
+			auto selectMesh = [&](entt::entity e, const RendererComponent& renderer, const Transform& transform, const LODView& passView, size_t& triangles) -> const VertexArrayObject::sptr& {
+				const LODComponent* lod = scene->Registry().try_get<LODComponent>(e);
+				if (lod == nullptr || lod->GetChain() == nullptr)
 				{
-					BackendHandler::RenderVAO(simpleDepthShader, renderer.Mesh, viewProjection, transform, lightSpaceViewProj);
+					return renderer.Mesh;
 				}
-			});
-
-			shadowBuffer->Unbind();
+				int level = lod->SelectLevel(transform, passView);
+				triangles += lod->GetIndexCount(level) / 3;
+				return lod->GetChain()->_levels[level]._mesh;
+			};
+			//Hands the renderer to the instancer, false means it has to be drawn the normal way
+			auto addInstance = [&](entt::entity e, const RendererComponent& renderer, const Transform& transform, const LODView& passView, size_t& triangles) {
+				const LODComponent* lod = scene->Registry().try_get<LODComponent>(e);
+				if (!instancing || lod == nullptr || lod->GetChain() == nullptr)
+				{
+					return false;
+				}
+				int level = lod->SelectLevel(transform, passView);
+				const InstanceVariant* variant = scene->Registry().try_get<InstanceVariant>(e);
+				if (!instancer.Add(renderer, transform, lod, level, variant != nullptr ? variant->_albedoIndex : 0))
+				{
+					return false;
+				}
+				triangles += lod->GetIndexCount(level) / 3;
+				return true;
+			};
 
 			glfwGetWindowSize(BackendHandler::window, &width, &height);
 
-			glViewport(0, 0, width, height);
-			gBuffer->Bind();
-			// Iterate over the render group components and draw them
-			renderGroup.each([&](entt::entity e, RendererComponent& renderer, Transform& transform) {
-				// If the shader has changed, set up it's uniforms
-				if (current != renderer.Material->Shader) {
-					current = renderer.Material->Shader;
-					current->Bind();
-					BackendHandler::SetupShaderForFrame(current, view, projection);
+			//Every pass declares what it reads and writes, passes that don't feed the screen get culled
+			//and the transient targets are packed into as few pooled framebuffers as possible
+			FrameGraph frameGraph;
+			FrameGraphResource shadowMap = shadows->Import(frameGraph);
+			FrameGraphResource gBufferTarget = gBuffer->Import(frameGraph);
+
+			frameGraph.AddPass("Shadow", [&](const FrameGraph&) {
+				//Static casters only get drawn when a cascade's cache is out of date, dynamic ones every frame
+				//Each cascade culls against its own ortho volume
+				auto drawCasters = [&](const glm::mat4& cascadeViewProj, bool dynamic) {
+					LODView shadowLodView = LODView::CreateOrthographic(cascadeViewProj, int(shadows->GetResolution()), lodSettings._shadowBias);
+					if (gpuDrivenRendering)
+					{
+						uint32_t flagMask = GPU_OBJECT_CASTS_SHADOWS | GPU_OBJECT_DYNAMIC;
+						uint32_t flagValue = GPU_OBJECT_CASTS_SHADOWS | (dynamic ? GPU_OBJECT_DYNAMIC : 0);
+						int commands = gpuDriven.Cull(cascadeViewProj, shadowLodView, flagMask, flagValue, false);
+						gpuDriven.DrawDepth(commands, simpleDepthShader, cascadeViewProj);
+						shadowVisible = gpuFallbacks;
+					}
+					else if (frustumCulling)
+					{
+						sceneBVH.Cull(cascadeViewProj, shadowVisible);
+					}
+					else
+					{
+						shadowVisible.assign(renderGroup.begin(), renderGroup.end());
+					}
+					instancer.Begin();
+					passDraws.clear();
+					passTransforms.clear();
+					for (entt::entity e : shadowVisible)
+					{
+						RendererComponent& renderer = renderGroup.get<RendererComponent>(e);
+						Transform& transform = renderGroup.get<Transform>(e);
+						if (renderer.CastShadows && (scene->Registry().try_get<BehaviourBinding>(e) != nullptr) == dynamic)
+						{
+							if (!addInstance(e, renderer, transform, shadowLodView, shadowTriangles))
+							{
+								passDraws.push_back(e);
+								passTransforms.push_back(&transform);
+							}
+							shadowVisibleTotal++;
+						}
+					}
+
+					// Render the meshes
+					UniformAllocation objects = BackendHandler::WriteObjectUniforms(cascadeViewProj, passTransforms);
+					simpleDepthShader->Bind();
+					for (size_t i = 0; i < passDraws.size(); i++)
+					{
+						RendererComponent& renderer = renderGroup.get<RendererComponent>(passDraws[i]);
+						BackendHandler::RenderVAO(selectMesh(passDraws[i], renderer, *passTransforms[i], shadowLodView, shadowTriangles), objects, i);
+					}
+					simpleDepthShader->UnBind();
+					instancer.Upload();
+					instancer.DrawDepth(simpleDepthShader, cascadeViewProj);
+				};
+				shadows->Render(
+					[&](const glm::mat4& cascadeViewProj) { drawCasters(cascadeViewProj, false); },
+					[&](const glm::mat4& cascadeViewProj) { drawCasters(cascadeViewProj, true); });
+			}).Write(shadowMap);
+
+			frameGraph.AddPass("G-Buffer", [&](const FrameGraph&) {
+				glViewport(0, 0, width, height);
+				gBuffer->Bind();
+				if (gpuDrivenRendering)
+				{
+					int commands = gpuDriven.Cull(viewProjection, lodView, 0, 0, true);
+					gpuDriven.DrawMaterials(commands);
 				}
-				// If the material has changed, apply it
-				if (currentMat != renderer.Material) {
-					currentMat = renderer.Material;
-					currentMat->Apply();
+
+				// Iterate over the visible renderers and draw them
+				//*Anything the instancer takes is drawn after the loop, grouped by material and mesh
+				instancer.Begin();
+				passDraws.clear();
+				passTransforms.clear();
+				for (entt::entity e : gpuDrivenRendering ? gpuFallbacks : cameraVisible)
+				{
+					RendererComponent& renderer = renderGroup.get<RendererComponent>(e);
+					Transform& transform = renderGroup.get<Transform>(e);
+					if (!addInstance(e, renderer, transform, lodView, sceneTriangles))
+					{
+						passDraws.push_back(e);
+						passTransforms.push_back(&transform);
+					}
 				}
 
+				UniformAllocation objects = BackendHandler::WriteObjectUniforms(viewProjection, passTransforms);
+				for (size_t i = 0; i < passDraws.size(); i++)
+				{
+					RendererComponent& renderer = renderGroup.get<RendererComponent>(passDraws[i]);
+					// If the shader has changed, set up it's uniforms
+					if (current != renderer.Material->Shader) {
+						current = renderer.Material->Shader;
+						current->Bind();
+					}
+					// If the material has changed, apply it
+					if (currentMat != renderer.Material) {
+						currentMat = renderer.Material;
+						currentMat->Apply();
+					}
 
-				shadowBuffer->BindDepthAsTexture(30);
-				// Render the mesh
-				BackendHandler::RenderVAO(renderer.Material->Shader, renderer.Mesh, viewProjection, transform, lightSpaceViewProj);
 
+					// Render the mesh
+					BackendHandler::RenderVAO(selectMesh(passDraws[i], renderer, *passTransforms[i], lodView, sceneTriangles), objects, i);
+				}
+				if (current != nullptr)
+				{
+					current->UnBind();
+				}
+				instancer.Upload();
+				instancer.Draw();
+
+				//The skybox stays out of the stencil, so lighting skips it
+				//*Drawn once after everything else, it'd vanish along with the list if everything was culled
+				glStencilMask(0x00);
+				//*Its matrix is in the frame block, so it needs no per draw uniforms at all
 				skybox->Bind();
-				BackendHandler::SetupShaderForFrame(skybox, view, projection);
 				skyboxMat->Apply();
-				BackendHandler::RenderVAO(skybox, meshVao, viewProjection, skyboxObj.get<Transform>(), lightSpaceViewProj);
+				meshVao->Render();
 				skybox->UnBind();
+				glStencilMask(0xFF);
+				current = nullptr;
+				currentMat = nullptr;
 
-			});
-
-			gBuffer->Unbind();
-
-			illumBuffer->BindBuffer(0);
+				gBuffer->Unbind();
 
-			illumBuffer->UnbindBuffer();
-
-			shadowBuffer->BindDepthAsTexture(30);
-
-			illumBuffer->ApplyEffect(gBuffer);
+				//Next frame's GPU occlusion culling tests against this frame's depth
+				if (gpuDrivenRendering)
+				{
+					gpuDriven.BuildHiZ(gBuffer, viewProjection);
+				}
+			}).Write(gBufferTarget, true);
 
-			shadowBuffer->UnbindTexture(30);
+			FrameGraphResource lightAccumulation = INVALID_RESOURCE;
+			FrameGraphResource lit = illumBuffer->AddPasses(frameGraph, gBuffer, gBufferTarget, shadowMap, &lightAccumulation);
 
+			//Only the view that's showing goes on the graph, everything it doesn't need is culled
+			PostEffect* post = usePostChain ? postChain : effects[activeEffect];
+			int gBufferView = drawPositionBufferOnly ? 3 : drawNormalBufferOnly ? 1 : drawColourBufferOnly ? 0 : -1;
 			if (showOnlyOneDeferredLightSource)
 			{
-				effects[activeEffect]->ApplyEffect(illumBuffer);
-				effects[activeEffect]->DrawToScreen();
+				basicEffect->AddDrawToScreen(frameGraph, post->AddPasses(frameGraph, lit));
 			}
-			else if (drawPositionBufferOnly)
+			else if (gBufferView >= 0)
 			{
-				gBuffer->DrawBuffersToScreen(3);
-			}
-			else if (drawNormalBufferOnly)
-			{
-				gBuffer->DrawBuffersToScreen(1);
-			}
-			else if (drawColourBufferOnly)
-			{
-				gBuffer->DrawBuffersToScreen(0);
+				frameGraph.AddPass("Draw G-Buffer", [&, gBufferView](const FrameGraph&) {
+					gBuffer->DrawBuffersToScreen(gBufferView);
+				}).Read(gBufferTarget).SideEffect();
 			}
 			else if (showLightAccumulationBuffer)
 			{
-				illumBuffer->DrawIllumBuffer();
+				basicEffect->AddDrawToScreen(frameGraph, lightAccumulation);
 			}
 			else
 			{
-				effects[activeEffect]->ApplyEffect(illumBuffer);
-				effects[activeEffect]->DrawToScreen();
+				basicEffect->AddDrawToScreen(frameGraph, post->AddPasses(frameGraph, lit));
 			}
 
+			frameGraph.Execute();
+			RenderTargetPool::EndFrame();
+			UniformRing::EndFrame();
+			livePasses = frameGraph.GetLivePassCount();
+			culledPasses = frameGraph.GetCulledPassCount();
+			transientTargets = frameGraph.GetTransientTargetCount();
+
 			// Draw our ImGui content
 			BackendHandler::RenderImGui();
 
@@ -707,6 +1214,16 @@ int main() {
 		Application::Instance().ActiveScene = nullptr;
 		//Clean up the environment generator so we can release references
 		EnvironmentGenerator::CleanUpPointers();
+		//Drop any loads that haven't finished while we still have a context
+		AsyncLoader::Shutdown();
+		//Release the registry's references too
+		AssetRegistry::Clear();
+		MeshPool::Clear();
+		UniformRing::Clear();
+		//Free the pooled render targets while we still have a context
+		RenderTargetPool::Clear();
+		//Stop the loading workers
+		ThreadPool::Shutdown();
 		BackendHandler::ShutdownImGui();
 	}	
 
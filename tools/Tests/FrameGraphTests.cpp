@@ -0,0 +1,126 @@
+//Checks for FrameGraph, run through ctest (see tools/CMakeLists.txt)
+//*Framebuffer is swapped for FramebufferDouble, so nothing needs a GL context and clears are counted instead of done
+//*The graph is a cut down frame: a shadow map and the screen are imported, everything in between is transient
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Graphics/FrameGraph.h"
+
+#include "FramebufferDouble.h"
+#include "TestHarness.h"
+
+namespace
+{
+	using Tests::Check;
+
+	RenderTargetDesc MakeDesc(unsigned width, unsigned height, GLenum format = GL_RGBA8)
+	{
+		RenderTargetDesc desc;
+		desc._width = width;
+		desc._height = height;
+		desc._colorFormats = { format };
+		return desc;
+	}
+
+	void TestExecute()
+	{
+		RenderTargetPool::Clear();
+		FramebufferDouble::Reset();
+
+		//Imported targets are never destroyed by the graph, they're just dummies sized like real ones
+		Framebuffer shadowTarget;
+		shadowTarget.SetSize(128, 128);
+		Framebuffer screenTarget;
+		screenTarget.SetSize(64, 32);
+
+		FrameGraph graph;
+		FrameGraphResource shadow = graph.ImportTarget("Shadow Map", &shadowTarget);
+		FrameGraphResource screen = graph.ImportTarget("Screen", &screenTarget);
+		FrameGraphResource unused = graph.CreateTarget("Unused", MakeDesc(64, 32));
+		FrameGraphResource lit = graph.CreateTarget("Lit", MakeDesc(64, 32));
+		FrameGraphResource bloom = graph.CreateTarget("Bloom", MakeDesc(64, 32));
+		FrameGraphResource toneMapped = graph.CreateTarget("Tone Mapped", MakeDesc(64, 32));
+		Check(graph.GetDesc(shadow)._width == 128 && graph.GetDesc(shadow)._height == 128, "imported targets take their size from the framebuffer");
+
+		std::vector<std::string> ran;
+		//Which transients had a framebuffer while each pass ran
+		std::vector<std::vector<bool>> held;
+		Framebuffer* litTarget = nullptr;
+		Framebuffer* toneMappedTarget = nullptr;
+		auto record = [&](const std::string& name) {
+			return [&, name](const FrameGraph& frame) {
+				ran.push_back(name);
+				held.push_back({ frame.GetTarget(lit) != nullptr, frame.GetTarget(bloom) != nullptr, frame.GetTarget(toneMapped) != nullptr });
+				if (name == "Lighting")
+					litTarget = frame.GetTarget(lit);
+				if (name == "Tone Map")
+					toneMappedTarget = frame.GetTarget(toneMapped);
+			};
+		};
+
+		graph.AddPass("Shadows", record("Shadows")).Write(shadow, true);
+		//Nothing reads what this writes, so it has to be culled
+		graph.AddPass("Unused", record("Unused")).Read(shadow).Write(unused, true);
+		graph.AddPass("Lighting", record("Lighting")).Read(shadow).Write(lit, true);
+		//Asks for the shadow map to be cleared again, it already was this frame
+		graph.AddPass("Shadow Decals", record("Shadow Decals")).Read(lit).Write(shadow, true);
+		graph.AddPass("Bloom", record("Bloom")).Read(lit).Write(bloom, true);
+		graph.AddPass("Tone Map", record("Tone Map")).Read(bloom).Write(toneMapped);
+		graph.AddPass("Draw To Screen", record("Draw To Screen")).Read(toneMapped).Read(shadow).Write(screen).SideEffect();
+
+		graph.Execute();
+
+		std::vector<std::string> expected = { "Shadows", "Lighting", "Shadow Decals", "Bloom", "Tone Map", "Draw To Screen" };
+		Check(ran == expected, "live passes run in the order they were added, the unused one doesn't run");
+		Check(graph.GetLivePassCount() == 6 && graph.GetCulledPassCount() == 1, "one pass is culled (" +
+			std::to_string(graph.GetCulledPassCount()) + ")");
+
+		//Lit is used from Lighting to Bloom, Bloom from Bloom to Tone Map, Tone Mapped from Tone Map to the screen
+		std::vector<std::vector<bool>> expectedHeld = {
+			{ false, false, false },
+			{ true, false, false },
+			{ true, false, false },
+			{ true, true, false },
+			{ false, true, true },
+			{ false, false, true }
+		};
+		Check(held == expectedHeld, "transients only have a target between their first and last use");
+		Check(graph.GetTarget(lit) == nullptr && graph.GetTarget(toneMapped) == nullptr, "transients are handed back after the frame");
+		Check(graph.GetTarget(shadow) == &shadowTarget, "imported targets stay put");
+
+		//Lit is handed back after Bloom, so Tone Mapped (same description) gets its framebuffer
+		Check(litTarget != nullptr && litTarget == toneMappedTarget, "transients with disjoint lifetimes share a target");
+		Check(graph.GetTransientTargetCount() == 2, "transients are packed into two targets (got " +
+			std::to_string(graph.GetTransientTargetCount()) + ")");
+		Check(RenderTargetPool::GetTargetCount() == 2 && FramebufferDouble::GetInitCount() == 2, "the culled pass' target is never created");
+
+		Check(FramebufferDouble::GetClearCount(&shadowTarget) == 1, "a target asked to be cleared twice is cleared once (" +
+			std::to_string(FramebufferDouble::GetClearCount(&shadowTarget)) + ")");
+		Check(FramebufferDouble::GetClearCount(&screenTarget) == 0, "targets nobody asked to clear aren't cleared");
+		//Lit and Tone Mapped share a framebuffer, only Lit asked for a clear
+		Check(FramebufferDouble::GetClearCount(litTarget) == 1, "the shared target is only cleared for the pass that asked");
+
+		//Next frame the pool hands the same targets back out
+		FrameGraph next;
+		FrameGraphResource again = next.CreateTarget("Lit", MakeDesc(64, 32));
+		FrameGraphResource nextScreen = next.ImportTarget("Screen", &screenTarget);
+		next.AddPass("Lighting", [](const FrameGraph&) {}).Write(again, true);
+		next.AddPass("Draw To Screen", [](const FrameGraph&) {}).Read(again).Write(nextScreen).SideEffect();
+		next.Execute();
+		Check(RenderTargetPool::GetTargetCount() == 2 && FramebufferDouble::GetInitCount() == 2, "the next frame reuses pooled targets");
+
+		//Unused targets age out of the pool
+		for (int frame = 0; frame < 4; frame++)
+			RenderTargetPool::EndFrame(3);
+		Check(RenderTargetPool::GetTargetCount() == 0, "idle targets are freed");
+	}
+}
+
+int main()
+{
+	TestExecute();
+
+	return Tests::Finish("frame graph");
+}
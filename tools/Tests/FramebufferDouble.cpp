@@ -0,0 +1,96 @@
+#include "FramebufferDouble.h"
+
+#include <unordered_map>
+
+namespace
+{
+	std::unordered_map<const Framebuffer*, int> _clears;
+	int _inits = 0;
+}
+
+int FramebufferDouble::GetClearCount(const Framebuffer* target)
+{
+	auto found = _clears.find(target);
+	return found != _clears.end() ? found->second : 0;
+}
+
+int FramebufferDouble::GetInitCount()
+{
+	return _inits;
+}
+
+void FramebufferDouble::Reset()
+{
+	_clears.clear();
+	_inits = 0;
+}
+
+DepthTarget::~DepthTarget()
+{
+}
+
+void DepthTarget::Unload()
+{
+}
+
+ColorTarget::~ColorTarget()
+{
+}
+
+void ColorTarget::Unload()
+{
+}
+
+Framebuffer::Framebuffer()
+{
+}
+
+Framebuffer::~Framebuffer()
+{
+	_clears.erase(this);
+}
+
+void Framebuffer::Unload()
+{
+	_isInit = false;
+}
+
+void Framebuffer::Init(unsigned width, unsigned height)
+{
+	SetSize(width, height);
+	Init();
+}
+
+void Framebuffer::Init()
+{
+	_inits++;
+	_isInit = true;
+}
+
+void Framebuffer::AddDepthTarget(bool stencil)
+{
+	_depthActive = true;
+	_stencilActive = stencil;
+}
+
+void Framebuffer::AddColorTarget(GLenum format)
+{
+	_color._formats.push_back(format);
+	_color._numAttachments++;
+}
+
+void Framebuffer::SetFilter(GLenum filter)
+{
+	_filter = filter;
+}
+
+void Framebuffer::SetSize(unsigned width, unsigned height)
+{
+	_width = width;
+	_height = height;
+}
+
+void Framebuffer::Clear()
+{
+	_clears[this]++;
+}
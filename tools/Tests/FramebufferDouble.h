@@ -0,0 +1,13 @@
+#pragma once
+//Stands in for Framebuffer.cpp in tests that run without a GL context, nothing is created on the GPU
+//*Keeps track of what would have happened so the tests can check it
+#include "Graphics/Framebuffer.h"
+
+namespace FramebufferDouble
+{
+	//Number of times Clear was called on a target
+	int GetClearCount(const Framebuffer* target);
+	//Number of framebuffers that have been initialized (pooled targets being created)
+	int GetInitCount();
+	void Reset();
+}
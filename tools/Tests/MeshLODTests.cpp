@@ -0,0 +1,222 @@
+//Checks for the LOD path, MeshSimplifier's chains and MeshCache baking them, run through ctest (see tools/CMakeLists.txt)
+//*Bakes into a folder under the working directory, which is cleared before and after
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <Logging.h>
+
+#include "Utilities/MeshCache.h"
+#include "Utilities/MeshSimplifier.h"
+#include "Utilities/ThreadPool.h"
+
+#include "TestHarness.h"
+
+namespace
+{
+	using Tests::Check;
+
+	const float PI = 3.14159265358979f;
+
+	//A lumpy UV sphere, round enough that every simplified level has some error
+	void MakeSphere(int rings, int segments, std::vector<glm::vec3>& positions, std::vector<glm::vec2>& uvs, std::vector<uint32_t>& indices)
+	{
+		for (int r = 0; r <= rings; r++)
+		{
+			float phi = PI * float(r) / float(rings);
+			for (int s = 0; s <= segments; s++)
+			{
+				float theta = 2.0f * PI * float(s) / float(segments);
+				float radius = 1.0f + 0.05f * std::sin(theta * 5.0f) * std::sin(phi * 4.0f);
+				positions.push_back(glm::vec3(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta)) * radius);
+				uvs.push_back(glm::vec2(float(s) / float(segments), float(r) / float(rings)));
+			}
+		}
+
+		for (int r = 0; r < rings; r++)
+		{
+			for (int s = 0; s < segments; s++)
+			{
+				uint32_t a = uint32_t(r * (segments + 1) + s);
+				uint32_t b = a + uint32_t(segments + 1);
+				//The poles only get one triangle per segment
+				if (r != 0)
+					indices.insert(indices.end(), { a, a + 1, b });
+				if (r != rings - 1)
+					indices.insert(indices.end(), { a + 1, b + 1, b });
+			}
+		}
+	}
+
+	MeshData MakeSphereData()
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec2> uvs;
+		std::vector<uint32_t> indices;
+		MakeSphere(32, 48, positions, uvs, indices);
+
+		MeshData data;
+		for (size_t i = 0; i < positions.size(); i++)
+		{
+			VertexPosNormTexCol vertex;
+			std::memset(&vertex, 0, sizeof(vertex));
+			vertex.Position = positions[i];
+			vertex.Normal = glm::normalize(positions[i]);
+			vertex.UV = uvs[i];
+			vertex.Color = glm::vec4(1.0f);
+			data._vertices.push_back(vertex);
+		}
+		data._indices = indices;
+		data.CalculateBounds();
+		return data;
+	}
+
+	void WriteSphereObj(const std::string& fileName)
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec2> uvs;
+		std::vector<uint32_t> indices;
+		MakeSphere(32, 48, positions, uvs, indices);
+
+		std::ofstream stream(fileName, std::ios::trunc);
+		for (const glm::vec3& position : positions)
+			stream << "v " << position.x << " " << position.y << " " << position.z << "\n";
+		for (const glm::vec2& uv : uvs)
+			stream << "vt " << uv.x << " " << uv.y << "\n";
+		for (const glm::vec3& position : positions)
+		{
+			glm::vec3 normal = glm::normalize(position);
+			stream << "vn " << normal.x << " " << normal.y << " " << normal.z << "\n";
+		}
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			stream << "f";
+			for (int k = 0; k < 3; k++)
+			{
+				uint32_t index = indices[i + k] + 1;
+				stream << " " << index << "/" << index << "/" << index;
+			}
+			stream << "\n";
+		}
+	}
+
+	bool SameLevel(const MeshData& a, const MeshData& b)
+	{
+		return a._indices == b._indices && a._vertices.size() == b._vertices.size() &&
+			std::memcmp(a._vertices.data(), b._vertices.data(), a._vertices.size() * sizeof(VertexPosNormTexCol)) == 0;
+	}
+
+	void CheckChain(const std::vector<MeshData>& levels, const std::vector<float>& errors, const std::string& what)
+	{
+		Check(levels.size() >= 3, what + " has at least three levels (got " + std::to_string(levels.size()) + ")");
+		Check(levels.size() == errors.size(), what + " has an error for every level");
+		if (levels.empty() || levels.size() != errors.size())
+			return;
+
+		Check(errors[0] == 0.0f, what + " level 0 has no error");
+		for (size_t level = 1; level < levels.size(); level++)
+		{
+			std::string name = what + " level " + std::to_string(level);
+			Check(errors[level] >= errors[level - 1], name + " error doesn't go down (" + std::to_string(errors[level - 1]) +
+				" -> " + std::to_string(errors[level]) + ")");
+			Check(levels[level]._indices.size() < levels[level - 1]._indices.size(), name + " has fewer indices than the level before");
+			Check(levels[level]._indices.size() % 3 == 0, name + " is whole triangles");
+
+			bool inRange = true;
+			for (uint32_t index : levels[level]._indices)
+				inRange = inRange && index < levels[level]._vertices.size();
+			Check(inRange, name + " indices are in range");
+		}
+	}
+
+	void TestChain()
+	{
+		MeshData source = MakeSphereData();
+		std::vector<MeshData> levels;
+		std::vector<float> errors;
+		MeshSimplifier::BuildLODChain(source, levels, errors);
+		CheckChain(levels, errors, "chain");
+		Check(!levels.empty() && SameLevel(levels[0], source), "chain level 0 is the source");
+
+		//Vertices only ever collapse onto their neighbours, so every position a level uses is one of the source's
+		bool subset = true;
+		for (size_t level = 1; level < levels.size(); level++)
+		{
+			for (uint32_t index : levels[level]._indices)
+			{
+				const glm::vec3& position = levels[level]._vertices[index].Position;
+				bool found = false;
+				for (const VertexPosNormTexCol& vertex : source._vertices)
+					found = found || vertex.Position == position;
+				subset = subset && found;
+			}
+		}
+		Check(subset, "simplified levels only use the source's positions");
+
+		//A tight error bound has to be kept even if it means stopping early
+		MeshData tight;
+		float error = MeshSimplifier::Simplify(source, source._indices.size() / 8 / 3 * 3, 0.001f, tight);
+		Check(error <= 0.001f, "Simplify keeps under its error bound (got " + std::to_string(error) + ")");
+		Check(tight._indices.size() <= source._indices.size(), "Simplify never adds triangles");
+	}
+
+	void TestCacheRoundTrip()
+	{
+		const std::string folder = "mesh_lod_test";
+		std::filesystem::remove_all(folder);
+		std::filesystem::create_directories(folder);
+		const std::string source = folder + "/sphere.obj";
+		WriteSphereObj(source);
+
+		MeshCache::SetCacheDirectory(folder + "/cache");
+		MeshCache::SetCacheEnabled(true);
+
+		std::vector<MeshData> built;
+		std::vector<float> builtErrors;
+		Check(MeshCache::LoadMeshLODs(source, built, builtErrors), "first load builds the chain");
+		CheckChain(built, builtErrors, "built chain");
+
+		//Every level was baked under its own key
+		size_t baked = 0;
+		for (size_t level = 0; level < built.size(); level++)
+			baked += std::filesystem::exists(MeshCache::GetCachePath(MeshCache::GetLODKey(source, level))) ? 1 : 0;
+		Check(baked == built.size(), "every level is baked (" + std::to_string(baked) + " of " + std::to_string(built.size()) + ")");
+
+		std::vector<MeshData> loaded;
+		std::vector<float> loadedErrors;
+		Check(MeshCache::LoadMeshLODs(source, loaded, loadedErrors), "second load reads the baked chain");
+		Check(loaded.size() == built.size() && loadedErrors == builtErrors, "baked chain has the same levels and errors");
+		bool same = loaded.size() == built.size();
+		for (size_t level = 0; same && level < built.size(); level++)
+			same = SameLevel(loaded[level], built[level]) && loaded[level]._boundsMin == built[level]._boundsMin &&
+				loaded[level]._boundsMax == built[level]._boundsMax;
+		Check(same, "baked chain has the same vertices, indices and bounds");
+
+		//A chain missing a level isn't trusted, it's rebuilt and comes out the same
+		std::filesystem::remove(MeshCache::GetCachePath(MeshCache::GetLODKey(source, built.size() - 1)));
+		std::vector<MeshData> rebuilt;
+		std::vector<float> rebuiltErrors;
+		Check(MeshCache::LoadMeshLODs(source, rebuilt, rebuiltErrors), "chain missing a level loads");
+		Check(rebuilt.size() == built.size() && rebuiltErrors == builtErrors, "chain missing a level is rebuilt the same");
+
+		std::filesystem::remove_all(folder);
+	}
+}
+
+int main()
+{
+	//MeshCache logs what it builds
+	Logger::Init();
+
+	TestChain();
+	TestCacheRoundTrip();
+
+	ThreadPool::Shutdown();
+	Logger::Uninitialize();
+
+	return Tests::Finish("mesh LOD");
+}
@@ -0,0 +1,161 @@
+//Checks for MeshOptimizer, run through ctest (see tools/CMakeLists.txt)
+//*Every pass is only meant to change the order things are drawn in, so the triangles (compared by their vertices'
+// contents, winding included) have to come out the same as they went in
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Utilities/MeshOptimizer.h"
+
+#include "TestHarness.h"
+
+namespace
+{
+	using Tests::Check;
+
+	typedef std::array<uint8_t, sizeof(VertexPosNormTexCol)> VertexBytes;
+	typedef std::array<VertexBytes, 3> Triangle;
+
+	VertexBytes GetBytes(const VertexPosNormTexCol& vertex)
+	{
+		VertexBytes bytes;
+		std::memcpy(bytes.data(), &vertex, sizeof(vertex));
+		return bytes;
+	}
+
+	//Every triangle by its vertices' contents, rotated to start at its smallest vertex so the winding is kept
+	std::vector<Triangle> GetTriangles(const MeshData& data)
+	{
+		std::vector<Triangle> triangles;
+		for (size_t t = 0; t + 2 < data._indices.size(); t += 3)
+		{
+			Triangle triangle;
+			for (int k = 0; k < 3; k++)
+				triangle[k] = GetBytes(data._vertices[data._indices[t + k]]);
+			std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+			triangles.push_back(triangle);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	//A size x size grid of quads as a triangle soup, every triangle has its own copy of its corners
+	//*The triangles are shuffled, so the cache does badly on it to start with
+	MeshData MakeGridSoup(int size)
+	{
+		MeshData data;
+		auto corner = [size](int x, int y) {
+			VertexPosNormTexCol vertex;
+			std::memset(&vertex, 0, sizeof(vertex));
+			vertex.Position = glm::vec3(float(x), float((x * 7 + y * 3) % 5) * 0.1f, float(y));
+			vertex.Normal = glm::vec3(0.0f, 1.0f, 0.0f);
+			vertex.UV = glm::vec2(float(x) / float(size), float(y) / float(size));
+			vertex.Color = glm::vec4(1.0f);
+			return vertex;
+		};
+
+		std::vector<std::array<int, 6>> triangles;
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				triangles.push_back({ x, y, x, y + 1, x + 1, y + 1 });
+				triangles.push_back({ x, y, x + 1, y + 1, x + 1, y });
+			}
+		}
+		std::shuffle(triangles.begin(), triangles.end(), std::mt19937(1234));
+
+		for (const std::array<int, 6>& triangle : triangles)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				data._indices.push_back(uint32_t(data._vertices.size()));
+				data._vertices.push_back(corner(triangle[k * 2], triangle[k * 2 + 1]));
+			}
+		}
+		return data;
+	}
+
+	void TestPassesKeepTriangles()
+	{
+		const int SIZE = 16;
+		MeshData source = MakeGridSoup(SIZE);
+		std::vector<Triangle> expected = GetTriangles(source);
+
+		MeshData welded = source;
+		MeshOptimizer::WeldVertices(welded);
+		Check(welded._vertices.size() == size_t((SIZE + 1) * (SIZE + 1)), "welding merges the soup down to the grid's vertices (got " +
+			std::to_string(welded._vertices.size()) + ")");
+		Check(GetTriangles(welded) == expected, "welding keeps the triangles");
+
+		MeshData cache = welded;
+		MeshOptimizer::OptimizeVertexCache(cache._indices, cache._vertices.size());
+		Check(GetTriangles(cache) == expected, "vertex cache ordering keeps the triangles");
+
+		MeshData overdraw = cache;
+		MeshOptimizer::OptimizeOverdraw(overdraw);
+		Check(GetTriangles(overdraw) == expected, "overdraw ordering keeps the triangles");
+
+		MeshData fetch = overdraw;
+		//A vertex nothing uses, fetch ordering is allowed to drop it
+		fetch._vertices.push_back(fetch._vertices.front());
+		fetch._vertices.back().Position.y += 100.0f;
+		MeshOptimizer::OptimizeVertexFetch(fetch);
+		Check(GetTriangles(fetch) == expected, "vertex fetch ordering keeps the triangles");
+		Check(fetch._vertices.size() == welded._vertices.size(), "vertex fetch ordering drops the unused vertex");
+
+		//Indices have to come out in first use order
+		uint32_t next = 0;
+		bool ordered = true;
+		for (uint32_t index : fetch._indices)
+		{
+			ordered = ordered && index <= next;
+			next = std::max(next, index + 1);
+		}
+		Check(ordered, "vertex fetch ordering numbers vertices by first use");
+
+		MeshData all = source;
+		MeshOptimizer::Optimize(all);
+		Check(GetTriangles(all) == expected, "Optimize keeps the triangles");
+	}
+
+	void TestCacheGetsBetter()
+	{
+		MeshData data = MakeGridSoup(24);
+		MeshOptimizer::WeldVertices(data);
+		VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(data._indices, data._vertices.size());
+
+		MeshData optimized = data;
+		MeshOptimizationReport report = MeshOptimizer::Optimize(optimized);
+		VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(optimized._indices, optimized._vertices.size());
+
+		Check(after._acmr <= before._acmr, "ACMR doesn't get worse (" + std::to_string(before._acmr) + " -> " + std::to_string(after._acmr) + ")");
+		Check(after._acmr < 1.0f, "ACMR of an optimised grid is under 1 (got " + std::to_string(after._acmr) + ")");
+		Check(report._after._acmr == after._acmr, "report's ACMR matches the mesh it left");
+
+		//The overdraw pass has to stay inside its threshold of the cache optimised order
+		MeshData cacheOnly = data;
+		MeshOptimizer::OptimizeVertexCache(cacheOnly._indices, cacheOnly._vertices.size());
+		float cacheAcmr = MeshOptimizer::AnalyzeVertexCache(cacheOnly._indices, cacheOnly._vertices.size())._acmr;
+		MeshOptimizer::OptimizeOverdraw(cacheOnly, 1.05f);
+		float overdrawAcmr = MeshOptimizer::AnalyzeVertexCache(cacheOnly._indices, cacheOnly._vertices.size())._acmr;
+		Check(overdrawAcmr <= cacheAcmr * 1.05f + 1e-5f, "overdraw ordering stays within its ACMR threshold");
+
+		//Already optimised, going again shouldn't undo it
+		MeshData again = optimized;
+		MeshOptimizationReport second = MeshOptimizer::Optimize(again);
+		Check(second._after._acmr <= second._before._acmr + 1e-5f, "optimising twice doesn't make it worse");
+	}
+}
+
+int main()
+{
+	TestPassesKeepTriangles();
+	TestCacheGetsBetter();
+
+	return Tests::Finish("mesh optimizer");
+}
@@ -0,0 +1,64 @@
+//Checks for OcclusionCuller, run through ctest (see tools/CMakeLists.txt)
+//*Built twice, once as is and once with OCCLUSION_NO_SIMD, so the SSE and scalar rasterisers both get checked
+//*The camera is the identity, so world positions are NDC and a box's depth is just (z + 1) / 2
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Graphics/OcclusionCuller.h"
+#include "Utilities/ThreadPool.h"
+
+#include "TestHarness.h"
+
+namespace
+{
+	using Tests::Check;
+
+	//Quad facing the camera at depth z, covering [min, max] in x and y
+	void AddQuad(OcclusionCuller& culler, const glm::vec2& min, const glm::vec2& max, float z)
+	{
+		std::vector<glm::vec3> positions = {
+			glm::vec3(min.x, min.y, z), glm::vec3(max.x, min.y, z), glm::vec3(max.x, max.y, z), glm::vec3(min.x, max.y, z)
+		};
+		std::vector<uint32_t> indices = { 0, 1, 2, 0, 2, 3 };
+		culler.AddOccluder(positions, indices, glm::mat4(1.0f));
+	}
+}
+
+int main()
+{
+	//Not a multiple of the tile size, so the edge tiles get checked too
+	OcclusionCuller culler;
+	culler.Init(200, 100);
+	culler.Begin(glm::mat4(1.0f));
+	AddQuad(culler, glm::vec2(-0.5f), glm::vec2(0.5f), 0.0f);
+	culler.Rasterise();
+
+	//The quad's centre is at depth 0.5 and the corners of the screen are still clear
+	const std::vector<float>& depth = culler.GetDepth();
+	int width = culler.GetWidth();
+	int height = culler.GetHeight();
+	float centre = depth[size_t(height / 2) * width + width / 2];
+	Check(centre > 0.49f && centre < 0.51f, "quad is rasterised at depth 0.5 (got " + std::to_string(centre) + ")");
+	Check(depth[0] == 1.0f && depth.back() == 1.0f, "pixels outside the quad are left clear");
+
+	Check(!culler.IsVisible(glm::vec3(-0.2f, -0.2f, 0.2f), glm::vec3(0.2f, 0.2f, 0.6f)), "box behind the quad is culled");
+	Check(!culler.IsVisible(glm::vec3(-0.45f, -0.45f, 0.1f), glm::vec3(0.45f, 0.45f, 0.2f)), "box just inside the quad's edges is culled");
+	Check(culler.IsVisible(glm::vec3(0.6f, -0.2f, 0.2f), glm::vec3(0.9f, 0.2f, 0.6f)), "box beside the quad is visible");
+	Check(culler.IsVisible(glm::vec3(0.3f, -0.2f, 0.2f), glm::vec3(0.7f, 0.2f, 0.6f)), "box poking out past the quad is visible");
+	Check(culler.IsVisible(glm::vec3(-0.2f, -0.2f, -0.6f), glm::vec3(0.2f, 0.2f, -0.2f)), "box in front of the quad is visible");
+	Check(culler.IsVisible(glm::vec3(-0.2f, -0.2f, -2.0f), glm::vec3(0.2f, 0.2f, 0.6f)), "box crossing the near plane is visible");
+	Check(!culler.IsVisible(glm::vec3(1.5f, -0.2f, 0.2f), glm::vec3(1.9f, 0.2f, 0.6f)), "box off screen is culled");
+
+	const OcclusionStats& stats = culler.GetStats();
+	Check(stats._occluders == 1 && stats._triangles == 2, "stats count the occluder and its triangles");
+	Check(stats._tested == 7 && stats._culled == 3, "stats count the tests");
+
+	ThreadPool::Shutdown();
+
+#ifdef OCCLUSION_NO_SIMD
+	return Tests::Finish("occlusion culler (scalar path)");
+#else
+	return Tests::Finish("occlusion culler (default path)");
+#endif
+}
@@ -0,0 +1,165 @@
+//Checks for SceneBVH, run through ctest (see tools/CMakeLists.txt)
+//*Built twice, once as is and once with BVH_NO_SIMD, so the SSE and scalar frustum tests both get checked
+//*Every Cull is compared against testing each leaf's box on its own, which the tree has to match exactly
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <GLM/gtc/matrix_transform.hpp>
+#include <RendererComponent.h>
+#include <Transform.h>
+
+#include "Graphics/LODComponent.h"
+#include "Graphics/SceneBVH.h"
+
+#include "TestHarness.h"
+
+namespace
+{
+	using Tests::Check;
+
+	//Renderer with a LOD chain that's only a bounding sphere, which is all the tree looks at
+	entt::entity AddRenderer(entt::registry& registry, const glm::vec3& position, float radius)
+	{
+		entt::entity entity = registry.create();
+		registry.emplace<RendererComponent>(entity);
+		Transform& transform = registry.emplace<Transform>(entity);
+		transform.SetLocalPosition(position);
+		transform.UpdateWorldMatrix();
+
+		MeshLODChain::sptr chain = std::make_shared<MeshLODChain>();
+		chain->_levels.resize(1);
+		chain->_radius = radius;
+		registry.emplace<LODComponent>(entity).SetChain(chain);
+		return entity;
+	}
+
+	//The same plane test the tree does, one leaf at a time
+	bool IsOutside(const Frustum& frustum, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		glm::vec3 centre = (boundsMin + boundsMax) * 0.5f;
+		glm::vec3 extents = (boundsMax - boundsMin) * 0.5f;
+		for (const glm::vec4& plane : frustum._planes)
+		{
+			float distance = plane.x * centre.x + plane.y * centre.y + plane.z * centre.z + plane.w;
+			float reach = std::abs(plane.x) * extents.x + std::abs(plane.y) * extents.y + std::abs(plane.z) * extents.z;
+			if (distance + reach < 0.0f)
+				return true;
+		}
+		return false;
+	}
+
+	void CheckCull(SceneBVH& bvh, const std::vector<entt::entity>& entities, const glm::mat4& viewProjection, const std::string& what)
+	{
+		std::vector<entt::entity> visible;
+		bvh.Cull(viewProjection, visible);
+		std::sort(visible.begin(), visible.end());
+
+		Frustum frustum = Frustum::FromMatrix(viewProjection);
+		std::vector<entt::entity> expected;
+		for (entt::entity entity : entities)
+		{
+			glm::vec3 boundsMin, boundsMax;
+			//Not in the tree means no bounds, those are always visible
+			if (!bvh.GetBounds(entity, boundsMin, boundsMax) || !IsOutside(frustum, boundsMin, boundsMax))
+				expected.push_back(entity);
+		}
+		std::sort(expected.begin(), expected.end());
+
+		Check(visible == expected, what + " matches testing every leaf (" + std::to_string(visible.size()) + " visible, expected " +
+			std::to_string(expected.size()) + ")");
+		Check(bvh.GetStats()._visible == visible.size(), what + " stats count what's visible");
+	}
+
+	//A few cameras that see some of the scene: looking in from outside, from inside, a shadow cascade and one that misses it all
+	void CheckCameras(SceneBVH& bvh, const std::vector<entt::entity>& entities, const std::string& what)
+	{
+		glm::mat4 perspective = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 80.0f);
+		CheckCull(bvh, entities, perspective * glm::lookAt(glm::vec3(0.0f, 10.0f, 60.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+			what + ", camera outside");
+		CheckCull(bvh, entities, perspective * glm::lookAt(glm::vec3(5.0f, 2.0f, 0.0f), glm::vec3(30.0f, 0.0f, 10.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+			what + ", camera inside");
+		glm::mat4 cascade = glm::ortho(-15.0f, 15.0f, -15.0f, 15.0f, 0.0f, 100.0f) *
+			glm::lookAt(glm::vec3(-20.0f, 40.0f, 10.0f), glm::vec3(-5.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		CheckCull(bvh, entities, cascade, what + ", shadow cascade");
+		CheckCull(bvh, entities, perspective * glm::lookAt(glm::vec3(0.0f, 0.0f, 200.0f), glm::vec3(0.0f, 0.0f, 300.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+			what + ", camera facing away");
+	}
+
+	void TestCull()
+	{
+		entt::registry registry;
+		std::vector<entt::entity> entities;
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+		std::uniform_real_distribution<float> radius(0.2f, 3.0f);
+		for (int i = 0; i < 500; i++)
+			entities.push_back(AddRenderer(registry, glm::vec3(position(random), position(random) * 0.2f, position(random)), radius(random)));
+
+		//No chain means no bounds
+		entt::entity unbounded = registry.create();
+		registry.emplace<RendererComponent>(unbounded);
+		registry.emplace<Transform>(unbounded).SetLocalPosition(glm::vec3(0.0f, 0.0f, 500.0f));
+		entities.push_back(unbounded);
+
+		SceneBVH bvh;
+		bvh.Update(registry);
+		Check(bvh.GetLeafCount() == 500, "every bounded renderer gets a leaf");
+		Check(bvh.GetNodeCount() == 999, "a binary tree over 500 leaves has 999 nodes");
+		CheckCameras(bvh, entities, "built");
+
+		//Move some far enough to leave their boxes, and drop some
+		for (size_t i = 0; i < 100; i++)
+		{
+			Transform& transform = registry.get<Transform>(entities[i]);
+			transform.SetLocalPosition(glm::vec3(position(random), 0.0f, position(random)));
+			transform.UpdateWorldMatrix();
+		}
+		for (size_t i = 100; i < 150; i++)
+			registry.destroy(entities[i]);
+		entities.erase(entities.begin() + 100, entities.begin() + 150);
+
+		bvh.Update(registry);
+		Check(bvh.GetReinsertCount() > 0 && bvh.GetReinsertCount() <= 100, "moved leaves are reinserted (" + std::to_string(bvh.GetReinsertCount()) + ")");
+		Check(bvh.GetLeafCount() == 450, "removed renderers lose their leaves");
+		CheckCameras(bvh, entities, "after moving and removing");
+	}
+
+	//Sorted along a line is the worst case for inserting by surface area, every leaf goes in next to the last one
+	void TestBalance()
+	{
+		const int COUNT = 2000;
+		entt::registry registry;
+		std::vector<entt::entity> entities;
+		for (int i = 0; i < COUNT; i++)
+			entities.push_back(AddRenderer(registry, glm::vec3(float(i) * 3.0f, 0.0f, 0.0f), 1.0f));
+
+		SceneBVH bvh;
+		bvh.Update(registry);
+
+		//Each side is never more than a level taller than the other, which bounds the height to about 1.44 log2(n)
+		int bound = int(std::ceil(1.44f * std::log2(float(COUNT)))) + 1;
+		Check(bvh.GetHeight() <= bound, "a line of leaves stays balanced (height " + std::to_string(bvh.GetHeight()) + ", at most " +
+			std::to_string(bound) + ")");
+
+		//Only part of the line is in view, so the walk has to go all the way down along the edge of it
+		glm::mat4 viewProjection = glm::ortho(-10.0f, 2500.0f, -5.0f, 5.0f, 0.0f, 100.0f) *
+			glm::lookAt(glm::vec3(0.0f, 0.0f, 50.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		CheckCull(bvh, entities, viewProjection, "line of leaves");
+	}
+}
+
+int main()
+{
+	TestCull();
+	TestBalance();
+
+#ifdef BVH_NO_SIMD
+	return Tests::Finish("scene BVH (scalar path)");
+#else
+	return Tests::Finish("scene BVH (default path)");
+#endif
+}
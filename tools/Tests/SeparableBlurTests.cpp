@@ -0,0 +1,265 @@
+//Checks that SeparableBlur's compute shader blurs the same as its fragment passes, run through ctest (see tools/CMakeLists.txt)
+//*Needs a GL 4.5 context (the test's own setup uses DSA, the blur only needs 4.3), a hidden GLFW window is enough
+// and llvmpipe has one (LIBGL_ALWAYS_SOFTWARE=1 forces it)
+//*Skipped (exit code 77) when there's no context to be had, a headless machine without llvmpipe for example
+//*The shaders are built the way SeparableBlur builds them, through ShaderCache with RADIUS inserted after #version,
+// so a define landing in front of #version fails the compile here instead of silently dropping bloom to the fragment path
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <Logging.h>
+
+#include "Utilities/ShaderCache.h"
+
+#include "TestHarness.h"
+
+namespace
+{
+	using Tests::Check;
+
+	const char* COMPUTE_SHADER_FILE = "shaders/Post/separable_blur_comp.glsl";
+	//Matches TILE in the compute shader
+	const int COMPUTE_TILE = 16;
+	//Not a multiple of the tile, so the edge groups are checked too
+	const int WIDTH = 61;
+	const int HEIGHT = 47;
+	//8 bit intermediates and filtering on the fragment path, half floats in shared memory on the compute path
+	const int TOLERANCE = 3;
+
+	//Same weights as SeparableBlur::GetWeights
+	std::vector<float> GetWeights(int radius)
+	{
+		float sigma = std::max(float(radius) / 3.0f, 0.5f);
+		std::vector<float> weights(size_t(radius) + 1);
+		float total = 0.0f;
+		for (int i = 0; i <= radius; i++)
+		{
+			weights[i] = std::exp(-float(i * i) / (2.0f * sigma * sigma));
+			total += i == 0 ? weights[i] : weights[i] * 2.0f;
+		}
+		for (float& weight : weights)
+			weight /= total;
+		return weights;
+	}
+
+	GLuint MakeTexture(const std::vector<uint8_t>* pixels)
+	{
+		GLuint texture = 0;
+		glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+		glTextureStorage2D(texture, 1, GL_RGBA8, WIDTH, HEIGHT);
+		glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		if (pixels != nullptr)
+			glTextureSubImage2D(texture, 0, 0, 0, WIDTH, HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, pixels->data());
+		return texture;
+	}
+
+	std::vector<uint8_t> ReadTexture(GLuint texture)
+	{
+		std::vector<uint8_t> pixels(size_t(WIDTH) * HEIGHT * 4);
+		glGetTextureImage(texture, 0, GL_RGBA, GL_UNSIGNED_BYTE, GLsizei(pixels.size()), pixels.data());
+		return pixels;
+	}
+
+	//Largest difference in any colour channel, alpha is always written as 1
+	int GetLargestDifference(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b)
+	{
+		int largest = 0;
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			if (i % 4 != 3)
+				largest = std::max(largest, std::abs(int(a[i]) - int(b[i])));
+		}
+		return largest;
+	}
+
+	void TestInsertDefines()
+	{
+		const std::string define = "#define RADIUS 4\n";
+
+		std::string commented = ShaderCache::InsertDefines("//About the shader\n//*More about it\n#version 430\n\nvoid main() {}\n", define);
+		Check(commented == "//About the shader\n//*More about it\n#version 430\n#define RADIUS 4\n\nvoid main() {}\n",
+			"defines go after #version even when comments come first");
+
+		std::string first = ShaderCache::InsertDefines("#version 430\nvoid main() {}\n", define);
+		Check(first == "#version 430\n#define RADIUS 4\nvoid main() {}\n", "defines go after #version on the first line");
+
+		std::string unversioned = ShaderCache::InsertDefines("void main() {}\n", define);
+		Check(unversioned == "#define RADIUS 4\nvoid main() {}\n", "defines go at the front without a #version");
+	}
+
+	std::vector<uint8_t> BlurCompute(GLuint source, int radius)
+	{
+		std::ifstream stream(COMPUTE_SHADER_FILE);
+		Check(bool(stream), std::string("read \"") + COMPUTE_SHADER_FILE + "\"");
+		std::stringstream contents;
+		contents << stream.rdbuf();
+		std::string defined = ShaderCache::InsertDefines(contents.str(), "#define RADIUS " + std::to_string(radius) + "\n");
+
+		Shader::sptr shader = ShaderCache::LoadSeparableSource({ COMPUTE_SHADER_FILE, GL_COMPUTE_SHADER }, defined);
+		Check(shader != nullptr, "compute shader compiles at radius " + std::to_string(radius));
+		if (shader == nullptr)
+			return {};
+
+		std::vector<float> weights = GetWeights(radius);
+		GLuint handle = shader->GetHandle();
+		glProgramUniform1fv(handle, glGetUniformLocation(handle, "u_Weights"), GLsizei(weights.size()), weights.data());
+
+		GLuint output = MakeTexture(nullptr);
+		shader->Bind();
+		glBindTextureUnit(0, source);
+		glBindImageTexture(0, output, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+		glDispatchCompute((WIDTH + COMPUTE_TILE - 1) / COMPUTE_TILE, (HEIGHT + COMPUTE_TILE - 1) / COMPUTE_TILE, 1);
+		glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+		shader->UnBind();
+
+		std::vector<uint8_t> pixels = ReadTexture(output);
+		glDeleteTextures(1, &output);
+		return pixels;
+	}
+
+	std::vector<uint8_t> BlurFragment(GLuint source, int radius)
+	{
+		Shader::sptr shader = ShaderCache::Load("shaders/passthrough_vert.glsl", "shaders/Post/separable_blur_frag.glsl");
+
+		//Folded the same way SeparableBlur::SetRadius folds them
+		std::vector<float> weights = GetWeights(radius);
+		std::vector<float> offsets = { 0.0f };
+		std::vector<float> folded = { weights[0] };
+		for (int i = 1; i <= radius; i += 2)
+		{
+			float first = weights[i];
+			float second = i + 1 <= radius ? weights[i + 1] : 0.0f;
+			offsets.push_back((float(i) * first + float(i + 1) * second) / (first + second));
+			folded.push_back(first + second);
+		}
+
+		GLuint handle = shader->GetHandle();
+		glProgramUniform1i(handle, glGetUniformLocation(handle, "u_TapCount"), GLint(folded.size()));
+		glProgramUniform1fv(handle, glGetUniformLocation(handle, "u_Offsets"), GLsizei(offsets.size()), offsets.data());
+		glProgramUniform1fv(handle, glGetUniformLocation(handle, "u_Weights"), GLsizei(folded.size()), folded.data());
+		GLint direction = glGetUniformLocation(handle, "u_Direction");
+
+		//Fullscreen quad laid out like OTTER's, position then UV
+		const float quad[] = {
+			-1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
+			 1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+			-1.0f,  1.0f, 0.0f, 0.0f, 1.0f,
+			 1.0f,  1.0f, 0.0f, 1.0f, 1.0f
+		};
+		GLuint vbo = 0;
+		GLuint vao = 0;
+		glCreateBuffers(1, &vbo);
+		glNamedBufferStorage(vbo, sizeof(quad), quad, 0);
+		glCreateVertexArrays(1, &vao);
+		glVertexArrayVertexBuffer(vao, 0, vbo, 0, sizeof(float) * 5);
+		glEnableVertexArrayAttrib(vao, 0);
+		glEnableVertexArrayAttrib(vao, 1);
+		glVertexArrayAttribFormat(vao, 0, 3, GL_FLOAT, GL_FALSE, 0);
+		glVertexArrayAttribFormat(vao, 1, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 3);
+		glVertexArrayAttribBinding(vao, 0, 0);
+		glVertexArrayAttribBinding(vao, 1, 0);
+
+		GLuint horizontal = MakeTexture(nullptr);
+		GLuint output = MakeTexture(nullptr);
+		GLuint framebuffer = 0;
+		glCreateFramebuffers(1, &framebuffer);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glViewport(0, 0, WIDTH, HEIGHT);
+		glBindVertexArray(vao);
+		shader->Bind();
+		auto pass = [&](GLuint from, GLuint to, float x, float y) {
+			glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, to, 0);
+			glProgramUniform2f(handle, direction, x, y);
+			glBindTextureUnit(0, from);
+			glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		};
+		pass(source, horizontal, 1.0f, 0.0f);
+		pass(horizontal, output, 0.0f, 1.0f);
+		shader->UnBind();
+		glBindVertexArray(0);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		std::vector<uint8_t> pixels = ReadTexture(output);
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteTextures(1, &horizontal);
+		glDeleteTextures(1, &output);
+		glDeleteVertexArrays(1, &vao);
+		glDeleteBuffers(1, &vbo);
+		return pixels;
+	}
+
+	void TestPathsMatch()
+	{
+		//Noise is the worst case for the folded taps, every texel differs from its neighbours
+		std::vector<uint8_t> pixels(size_t(WIDTH) * HEIGHT * 4);
+		std::mt19937 random(1234);
+		for (uint8_t& value : pixels)
+			value = uint8_t(random() & 0xFF);
+		GLuint source = MakeTexture(&pixels);
+
+		//Smallest, odd (the last fold has one tap) and the largest a single compute step does
+		for (int radius : { 1, 3, 16 })
+		{
+			std::vector<uint8_t> compute = BlurCompute(source, radius);
+			std::vector<uint8_t> fragment = BlurFragment(source, radius);
+			if (compute.empty())
+				continue;
+
+			std::string name = "radius " + std::to_string(radius);
+			int difference = GetLargestDifference(compute, fragment);
+			Check(difference <= TOLERANCE, name + " compute matches the fragment passes (largest difference " + std::to_string(difference) + ")");
+			Check(GetLargestDifference(compute, pixels) > TOLERANCE, name + " compute actually blurs");
+		}
+
+		glDeleteTextures(1, &source);
+	}
+}
+
+int main()
+{
+	TestInsertDefines();
+
+	GLFWwindow* window = nullptr;
+	if (glfwInit() == GLFW_TRUE)
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		window = glfwCreateWindow(WIDTH, HEIGHT, "Separable Blur Tests", nullptr, nullptr);
+	}
+	if (window == nullptr)
+	{
+		std::printf("No GL 4.5 context, skipping the separable blur comparison\n");
+		glfwTerminate();
+		return Tests::Finish("separable blur") == 0 ? 77 : 1;
+	}
+	glfwMakeContextCurrent(window);
+	gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+
+	//ShaderCache logs compile errors through it
+	Logger::Init();
+	//Always compile, a cached binary would hide a broken source
+	ShaderCache::SetCacheEnabled(false);
+
+	TestPathsMatch();
+
+	Logger::Uninitialize();
+	glfwDestroyWindow(window);
+	glfwTerminate();
+
+	return Tests::Finish("separable blur");
+}
@@ -0,0 +1,26 @@
+#pragma once
+//What the checks under tools/Tests share, failures are printed as they happen and main hands Finish's result to ctest
+#include <cstdio>
+#include <string>
+
+namespace Tests
+{
+	inline int _failures = 0;
+
+	inline void Check(bool condition, const std::string& what)
+	{
+		if (!condition)
+		{
+			printf("FAILED: %s\n", what.c_str());
+			_failures++;
+		}
+	}
+
+	//Prints the summary for a set of checks, returns what main should exit with
+	inline int Finish(const std::string& what)
+	{
+		if (_failures == 0)
+			printf("All %s checks passed\n", what.c_str());
+		return _failures == 0 ? 0 : 1;
+	}
+}
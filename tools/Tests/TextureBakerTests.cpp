@@ -0,0 +1,177 @@
+//Checks for the CPU half of the texture baker, run through ctest (see tools/CMakeLists.txt)
+//*Encodes test images in every format and decodes them again, then round trips them through a KTX2 file
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "Graphics/BlockCompression.h"
+#include "Graphics/KTX2File.h"
+
+#include "TestHarness.h"
+
+namespace
+{
+	using Tests::Check;
+
+	const char* FormatName(BlockFormat format)
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1: return "BC1";
+		case BlockFormat::BC3: return "BC3";
+		case BlockFormat::BC5: return "BC5";
+		case BlockFormat::BC7: return "BC7";
+		}
+		return "?";
+	}
+
+	//A smooth diagonal ramp with alpha, the kind of content block compression is meant for
+	//*Every channel follows the same ramp, so each block's colours sit close to a line the encoders can fit
+	std::vector<uint8_t> MakeGradient(uint32_t width, uint32_t height)
+	{
+		std::vector<uint8_t> pixels(size_t(width) * height * 4);
+		for (uint32_t y = 0; y < height; y++)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				int ramp = int((x * 8 + y * 7) % 256);
+				uint8_t* texel = &pixels[(size_t(y) * width + x) * 4];
+				texel[0] = uint8_t(ramp);
+				texel[1] = uint8_t(255 - ramp);
+				texel[2] = uint8_t(ramp / 2);
+				texel[3] = uint8_t(255 - ramp / 3);
+			}
+		}
+		return pixels;
+	}
+
+	//Largest difference in any of the channels the format stores
+	int MaxError(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, BlockFormat format)
+	{
+		int channels = format == BlockFormat::BC5 ? 2 : (format == BlockFormat::BC1 ? 3 : 4);
+		int worst = 0;
+		for (size_t i = 0; i < a.size(); i += 4)
+			for (int c = 0; c < channels; c++)
+				worst = std::max(worst, std::abs(int(a[i + c]) - int(b[i + c])));
+		return worst;
+	}
+
+	void TestEncodeDecode()
+	{
+		//Worst error each format is allowed on the ramp, BC1's 565 endpoints and 4 entry palette are the coarsest
+		const BlockFormat formats[] = { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC5, BlockFormat::BC7 };
+		const int tolerances[] = { 12, 12, 4, 4 };
+
+		//16x16 is whole blocks, 13x6 needs the edge padding dropped again
+		const uint32_t sizes[][2] = { { 16, 16 }, { 13, 6 } };
+		for (const uint32_t* size : sizes)
+		{
+			std::vector<uint8_t> source = MakeGradient(size[0], size[1]);
+			for (int f = 0; f < 4; f++)
+			{
+				std::vector<uint8_t> blocks, decoded;
+				BlockCompression::Encode(source.data(), size[0], size[1], formats[f], blocks);
+				Check(blocks.size() == BlockCompression::GetImageBytes(formats[f], size[0], size[1]),
+					std::string(FormatName(formats[f])) + " block count");
+
+				BlockCompression::Decode(blocks.data(), size[0], size[1], formats[f], decoded);
+				Check(decoded.size() == source.size(), std::string(FormatName(formats[f])) + " decoded size");
+
+				int error = MaxError(source, decoded, formats[f]);
+				Check(error <= tolerances[f], std::string(FormatName(formats[f])) + " " + std::to_string(size[0]) + "x" +
+					std::to_string(size[1]) + " error " + std::to_string(error) + " is over " + std::to_string(tolerances[f]));
+			}
+		}
+
+		//A flat block has to come back as exactly its endpoint, whatever the format
+		uint8_t flat[64];
+		for (int i = 0; i < 16; i++)
+		{
+			flat[i * 4 + 0] = 200;
+			flat[i * 4 + 1] = 100;
+			flat[i * 4 + 2] = 50;
+			flat[i * 4 + 3] = 255;
+		}
+		uint8_t block[16], texels[64];
+		BlockCompression::EncodeBC7(flat, block);
+		Check((block[0] & 0x7F) == 0x40, "BC7 writes mode 6");
+		BlockCompression::DecodeBC7(block, texels);
+		Check(MaxError(std::vector<uint8_t>(flat, flat + 64), std::vector<uint8_t>(texels, texels + 64), BlockFormat::BC7) <= 1,
+			"BC7 flat block");
+
+		BlockCompression::EncodeBC4(flat, 0, block);
+		BlockCompression::DecodeBC4(block, 1, texels);
+		bool exact = true;
+		for (int i = 0; i < 16; i++)
+			exact = exact && texels[i * 4 + 1] == 200;
+		Check(exact, "BC4 flat block is exact");
+	}
+
+	void TestKTX2RoundTrip()
+	{
+		const BlockFormat formats[] = { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC5, BlockFormat::BC7 };
+		for (BlockFormat format : formats)
+		{
+			//A 20x12 image with its full chain, down to 1x1
+			CompressedImage image;
+			image._format = format;
+			image._width = 20;
+			image._height = 12;
+			for (uint32_t level = 0; std::max(image._width >> level, image._height >> level) > 0; level++)
+			{
+				uint32_t width = std::max(image._width >> level, 1u);
+				uint32_t height = std::max(image._height >> level, 1u);
+				std::vector<uint8_t> pixels = MakeGradient(width, height);
+				image._levels.emplace_back();
+				BlockCompression::Encode(pixels.data(), width, height, format, image._levels.back());
+			}
+
+			bool srgb = format != BlockFormat::BC5;
+			std::string path = std::string("round_trip_") + FormatName(format) + ".ktx2";
+			Check(KTX2File::Write(path, image, srgb), std::string(FormatName(format)) + " KTX2 write");
+
+			CompressedImage read;
+			std::string error;
+			bool readSrgb = !srgb;
+			bool loaded = KTX2File::Read(path, read, &error, &readSrgb);
+			Check(loaded, std::string(FormatName(format)) + " KTX2 read (" + error + ")");
+			if (loaded)
+			{
+				Check(read._format == image._format, std::string(FormatName(format)) + " KTX2 format");
+				Check(read._width == image._width && read._height == image._height, std::string(FormatName(format)) + " KTX2 size");
+				Check(readSrgb == srgb, std::string(FormatName(format)) + " KTX2 sRGB flag");
+				Check(read._levels == image._levels, std::string(FormatName(format)) + " KTX2 levels");
+			}
+
+			std::error_code removeError;
+			std::filesystem::remove(path, removeError);
+		}
+
+		//Anything that isn't KTX2 has to be turned away, not half read
+		{
+			FILE* file = fopen("not_ktx2.ktx2", "wb");
+			const char garbage[] = "definitely not a texture, just enough bytes to get past the size check";
+			fwrite(garbage, 1, sizeof(garbage), file);
+			fclose(file);
+
+			CompressedImage read;
+			std::string error;
+			Check(!KTX2File::Read("not_ktx2.ktx2", read, &error), "KTX2 rejects a file without the identifier");
+			Check(!error.empty(), "KTX2 gives a reason");
+
+			std::error_code removeError;
+			std::filesystem::remove("not_ktx2.ktx2", removeError);
+		}
+	}
+}
+
+int main()
+{
+	TestEncodeDecode();
+	TestKTX2RoundTrip();
+
+	return Tests::Finish("texture baker");
+}
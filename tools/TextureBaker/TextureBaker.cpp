@@ -0,0 +1,227 @@
+//Offline texture baker, encodes images to BC1/BC3/BC5/BC7 with full mip chains and writes KTX2 files
+//*Built by tools/CMakeLists.txt (TextureBaker target) from src/Graphics/BlockCompression, src/Graphics/KTX2File,
+// src/Utilities/Util, src/Utilities/MappedFile and src/Utilities/ThreadPool
+//*Everything here is CPU only, so it runs (and validates its output) on machines without a GPU
+//
+//Usage: TextureBaker [--format auto|bc1|bc3|bc5|bc7] [--srgb] [--no-mips] [--out folder] <image or folder>...
+//       TextureBaker --validate <file.ktx2>...
+//*auto picks BC1 for opaque images and BC3 for ones with alpha
+//*Output goes next to each source (same name, .ktx2) unless --out is given, which is where Texture loading looks for it
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "Graphics/BlockCompression.h"
+#include "Graphics/KTX2File.h"
+#include "Utilities/ThreadPool.h"
+#include "Utilities/Util.h"
+
+namespace
+{
+	struct BakeSettings
+	{
+		bool _auto = true;
+		BlockFormat _format = BlockFormat::BC1;
+		bool _srgb = false;
+		bool _mips = true;
+		std::string _outFolder;
+	};
+
+	bool IsImage(const std::filesystem::path& path)
+	{
+		std::string extension = path.extension().string();
+		for (char& c : extension)
+			c = char(tolower(c));
+		return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".bmp" || extension == ".tga";
+	}
+
+	const char* FormatName(BlockFormat format)
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1: return "BC1";
+		case BlockFormat::BC3: return "BC3";
+		case BlockFormat::BC5: return "BC5";
+		case BlockFormat::BC7: return "BC7";
+		}
+		return "?";
+	}
+
+	//Bakes one image, returns a line for the log (starting with "error" if it failed)
+	std::string Bake(const std::filesystem::path& source, const BakeSettings& settings)
+	{
+		int width = 0, height = 0, channels = 0;
+		//Flipped the same way Texture2DData loads them, so UVs line up
+		stbi_uc* pixels = stbi_load(source.string().c_str(), &width, &height, &channels, 4);
+		if (pixels == nullptr)
+			return "error: could not decode " + source.string();
+
+		CompressedImage image;
+		image._width = uint32_t(width);
+		image._height = uint32_t(height);
+		image._format = settings._auto ?
+			(BlockCompression::HasAlpha(pixels, image._width, image._height) ? BlockFormat::BC3 : BlockFormat::BC1) :
+			settings._format;
+
+		std::vector<Util::MipLevel> mips;
+		if (settings._mips)
+		{
+			Util::BuildMipChain(pixels, image._width, image._height, mips);
+		}
+		else
+		{
+			mips.resize(1);
+			mips[0]._width = image._width;
+			mips[0]._height = image._height;
+			mips[0]._pixels.assign(pixels, pixels + size_t(width) * height * 4);
+		}
+		stbi_image_free(pixels);
+
+		image._levels.resize(mips.size());
+		for (size_t level = 0; level < mips.size(); level++)
+		{
+			BlockCompression::Encode(mips[level]._pixels.data(), mips[level]._width, mips[level]._height, image._format, image._levels[level]);
+		}
+
+		std::filesystem::path output = source;
+		output.replace_extension(".ktx2");
+		if (!settings._outFolder.empty())
+			output = std::filesystem::path(settings._outFolder) / output.filename();
+
+		if (!KTX2File::Write(output.string(), image, settings._srgb))
+			return "error: could not write " + output.string();
+
+		//Read it back so a bad file never ships
+		CompressedImage check;
+		std::string error;
+		if (!KTX2File::Read(output.string(), check, &error) || check._levels != image._levels)
+			return "error: " + output.string() + " did not validate (" + error + ")";
+
+		size_t bytes = 0;
+		for (const std::vector<uint8_t>& level : image._levels)
+			bytes += level.size();
+
+		return source.string() + " -> " + output.string() + " (" + FormatName(image._format) + ", " +
+			std::to_string(image._levels.size()) + " levels, " + std::to_string(bytes / 1024) + " KB)";
+	}
+
+	int Validate(const std::vector<std::string>& files)
+	{
+		int failures = 0;
+		for (const std::string& file : files)
+		{
+			CompressedImage image;
+			std::string error;
+			if (KTX2File::Read(file, image, &error))
+			{
+				printf("%s: %s %ux%u, %d levels\n", file.c_str(), FormatName(image._format), image._width, image._height, int(image._levels.size()));
+			}
+			else
+			{
+				printf("%s: invalid (%s)\n", file.c_str(), error.c_str());
+				failures++;
+			}
+		}
+		return failures == 0 ? 0 : 1;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BakeSettings settings;
+	std::vector<std::string> inputs;
+	bool validate = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--format" && i + 1 < argc)
+		{
+			std::string format = argv[++i];
+			settings._auto = format == "auto";
+			if (format == "bc1") settings._format = BlockFormat::BC1;
+			else if (format == "bc3") settings._format = BlockFormat::BC3;
+			else if (format == "bc5") settings._format = BlockFormat::BC5;
+			else if (format == "bc7") settings._format = BlockFormat::BC7;
+			else if (format != "auto")
+			{
+				printf("Unknown format \"%s\"\n", format.c_str());
+				return 1;
+			}
+		}
+		else if (arg == "--srgb")
+			settings._srgb = true;
+		else if (arg == "--no-mips")
+			settings._mips = false;
+		else if (arg == "--out" && i + 1 < argc)
+			settings._outFolder = argv[++i];
+		else if (arg == "--validate")
+			validate = true;
+		else
+			inputs.push_back(arg);
+	}
+
+	if (inputs.empty())
+	{
+		printf("Usage: TextureBaker [--format auto|bc1|bc3|bc5|bc7] [--srgb] [--no-mips] [--out folder] <image or folder>...\n");
+		printf("       TextureBaker --validate <file.ktx2>...\n");
+		return 1;
+	}
+
+	if (validate)
+		return Validate(inputs);
+
+	if (!settings._outFolder.empty())
+	{
+		std::error_code error;
+		std::filesystem::create_directories(settings._outFolder, error);
+	}
+
+	//Expand folders into the images in them
+	std::vector<std::filesystem::path> sources;
+	for (const std::string& input : inputs)
+	{
+		if (std::filesystem::is_directory(input))
+		{
+			for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(input))
+			{
+				if (entry.is_regular_file() && IsImage(entry.path()))
+					sources.push_back(entry.path());
+			}
+		}
+		else
+		{
+			sources.push_back(input);
+		}
+	}
+
+	//stb's flip flag is shared, set it once before any worker starts
+	stbi_set_flip_vertically_on_load(true);
+
+	//One image per job, encoding is where all the time goes
+	std::vector<std::future<std::string>> results;
+	for (const std::filesystem::path& source : sources)
+	{
+		results.push_back(ThreadPool::Enqueue([source, &settings]() { return Bake(source, settings); }));
+	}
+
+	int failures = 0;
+	for (std::future<std::string>& result : results)
+	{
+		std::string line = result.get();
+		if (line.compare(0, 5, "error") == 0)
+			failures++;
+		printf("%s\n", line.c_str());
+	}
+
+	ThreadPool::Shutdown();
+
+	printf("Baked %d of %d textures\n", int(sources.size()) - failures, int(sources.size()));
+	return failures == 0 ? 0 : 1;
+}
\ No newline at end of file